@@ -0,0 +1,61 @@
+/** @file
+ *
+ * @brief Advertising airtime implementation.
+ */
+#include <stddef.h>
+
+#include "adv_airtime.h"
+
+#define PDU_HEADER_LEN          2                           /**< PDU header. */
+#define CRC_LEN                 3
+#define ADV_A_LEN               6                           /**< Advertiser address. */
+#define EXT_HEADER_LEN          2                           /**< Extended header length and AdvMode byte, and the flags byte. */
+#define ADI_LEN                 2                           /**< AdvDataInfo. */
+#define AUX_PTR_LEN             3
+
+#define CODED_FEC1_US           (80 + 256 + 16 + 24)        /**< Preamble, access address, CI and TERM1, always S8. */
+#define CODED_TERM2_BITS        3
+
+
+uint32_t adv_airtime_packet_us(adv_airtime_phy_t phy, uint32_t pdu_len)
+{
+    switch (phy)
+    {
+        case ADV_AIRTIME_PHY_2M:
+            return (2 + 4 + pdu_len + CRC_LEN) * 4;
+
+        case ADV_AIRTIME_PHY_CODED_S2:
+            return CODED_FEC1_US + ((pdu_len + CRC_LEN) * 8 + CODED_TERM2_BITS) * 2;
+
+        case ADV_AIRTIME_PHY_CODED_S8:
+            return CODED_FEC1_US + ((pdu_len + CRC_LEN) * 8 + CODED_TERM2_BITS) * 8;
+
+        case ADV_AIRTIME_PHY_1M:
+        default:
+            return (1 + 4 + pdu_len + CRC_LEN) * 8;
+    }
+}
+
+
+void adv_airtime_legacy(uint32_t data_len, adv_airtime_t * p_airtime)
+{
+    uint32_t pdu_len = PDU_HEADER_LEN + ADV_A_LEN + data_len;
+
+    p_airtime->packets  = ADV_AIRTIME_CHANNELS;
+    p_airtime->air_us   = ADV_AIRTIME_CHANNELS * adv_airtime_packet_us(ADV_AIRTIME_PHY_1M, pdu_len);
+    p_airtime->radio_us = p_airtime->air_us + p_airtime->packets * ADV_AIRTIME_RAMP_UP_US;
+}
+
+
+void adv_airtime_extended(adv_airtime_phy_t phy, uint32_t data_len, adv_airtime_t * p_airtime)
+{
+    // ADV_EXT_IND: ADI and AuxPtr, no AdvA and no data.
+    uint32_t ext_len = PDU_HEADER_LEN + EXT_HEADER_LEN + ADI_LEN + AUX_PTR_LEN;
+    // AUX_ADV_IND: AdvA, ADI and the data.
+    uint32_t aux_len = PDU_HEADER_LEN + EXT_HEADER_LEN + ADV_A_LEN + ADI_LEN + data_len;
+
+    p_airtime->packets  = ADV_AIRTIME_CHANNELS + 1;
+    p_airtime->air_us   = ADV_AIRTIME_CHANNELS * adv_airtime_packet_us(phy, ext_len) +
+                          adv_airtime_packet_us(phy, aux_len);
+    p_airtime->radio_us = p_airtime->air_us + p_airtime->packets * ADV_AIRTIME_RAMP_UP_US;
+}
@@ -0,0 +1,84 @@
+/** @file
+ *
+ * @defgroup adv_airtime Advertising airtime
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Time on air and radio time of one advertising event, per PHY.
+ *
+ * @details A legacy event sends one ADV_NONCONN_IND on each of the three primary channels, on
+ *          the 1M PHY. An extended non-connectable, non-scannable event sends an ADV_EXT_IND
+ *          with the ADI and an AuxPtr on each primary channel, and one AUX_ADV_IND with AdvA,
+ *          ADI and the advertising data on a secondary channel. Both use the same PHY here.
+ *
+ *          Packet durations follow the Core specification, Vol 6, Part B, 2.1 and 2.2:
+ *          - 1M: 1 byte preamble, 4 byte access address, PDU, 3 byte CRC, 8 us per byte.
+ *          - 2M: 2 byte preamble, then as 1M at 4 us per byte.
+ *          - Coded: 80 us preamble, 256 us access address, 16 us CI and 24 us TERM1 in S8,
+ *            then the PDU, CRC and TERM2 at 2 (S2) or 8 (S8) us per bit.
+ *
+ *          The radio time adds the ramp-up before every packet, it is what the radio draws
+ *          current for. Interframe spaces and the SoftDevice processing around the event are
+ *          left out.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ADV_AIRTIME_H__
+#define ADV_AIRTIME_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_AIRTIME_CHANNELS            3                   /**< Primary advertising channels. */
+#define ADV_AIRTIME_RAMP_UP_US          140                 /**< nRF52 radio TX ramp-up in the default mode. */
+
+/**@brief PHYs an advertising packet can be sent on. */
+typedef enum
+{
+    ADV_AIRTIME_PHY_1M,
+    ADV_AIRTIME_PHY_2M,
+    ADV_AIRTIME_PHY_CODED_S2,
+    ADV_AIRTIME_PHY_CODED_S8
+} adv_airtime_phy_t;
+
+/**@brief Airtime of one advertising event. */
+typedef struct
+{
+    uint32_t packets;                                       /**< Packets sent in the event. */
+    uint32_t air_us;                                        /**< Time on air of all packets. */
+    uint32_t radio_us;                                      /**< Time on air plus the ramp-up of every packet. */
+} adv_airtime_t;
+
+/**@brief Function for getting the time on air of one packet.
+ *
+ * @param[in] phy      PHY of the packet.
+ * @param[in] pdu_len  PDU length in bytes, the 2 byte header included.
+ */
+uint32_t adv_airtime_packet_us(adv_airtime_phy_t phy, uint32_t pdu_len);
+
+/**@brief Function for getting the airtime of a legacy non-connectable advertising event.
+ *
+ * @param[in]  data_len   Advertising data length, at most 31.
+ * @param[out] p_airtime  Airtime of the event on the 1M PHY.
+ */
+void adv_airtime_legacy(uint32_t data_len, adv_airtime_t * p_airtime);
+
+/**@brief Function for getting the airtime of an extended non-connectable, non-scannable
+ *        advertising event with its data in one AUX_ADV_IND.
+ *
+ * @param[in]  phy        Primary and secondary PHY. 2M is only valid as a secondary PHY, it is
+ *                        computed as if it were both.
+ * @param[in]  data_len   Advertising data length, at most the 245 bytes of one AUX_ADV_IND.
+ * @param[out] p_airtime  Airtime of the event.
+ */
+void adv_airtime_extended(adv_airtime_phy_t phy, uint32_t data_len, adv_airtime_t * p_airtime);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_AIRTIME_H__
+
+/** @} */
@@ -0,0 +1,184 @@
+/** @file
+ *
+ * @brief Authenticated advertising frames implementation.
+ */
+#include <stddef.h>
+
+#include "adv_auth.h"
+
+
+static uint32_t u32_be_get(uint8_t const * p_data)
+{
+    return ((uint32_t)p_data[0] << 24) | ((uint32_t)p_data[1] << 16) | ((uint32_t)p_data[2] << 8) | p_data[3];
+}
+
+
+static void u32_be_put(uint8_t * p_data, uint32_t value)
+{
+    p_data[0] = (uint8_t)(value >> 24);
+    p_data[1] = (uint8_t)(value >> 16);
+    p_data[2] = (uint8_t)(value >> 8);
+    p_data[3] = (uint8_t)value;
+}
+
+
+/**@brief Nonce: type, major and minor, then a type specific word, zero padded. */
+static void nonce_build(adv_auth_t const * p_auth, uint8_t type, uint32_t word, uint8_t * p_block)
+{
+    for (uint32_t i = 0; i < ADV_AUTH_BLOCK_LEN; i++)
+    {
+        p_block[i] = 0;
+    }
+    p_block[0] = type;
+    for (uint32_t i = 0; i < ADV_AUTH_ID_LEN; i++)
+    {
+        p_block[1 + i] = p_auth->id[i];
+    }
+    u32_be_put(&p_block[1 + ADV_AUTH_ID_LEN], word);
+}
+
+
+static bool keystream_word(adv_auth_t const * p_auth, uint32_t counter, uint32_t * p_word)
+{
+    uint8_t nonce[ADV_AUTH_BLOCK_LEN];
+    uint8_t block[ADV_AUTH_BLOCK_LEN];
+
+    nonce_build(p_auth, ADV_AUTH_NONCE_KEYSTREAM, counter, nonce);
+    if (!p_auth->cipher(p_auth->key, nonce, block))
+    {
+        return false;
+    }
+    *p_word = u32_be_get(block);
+    return true;
+}
+
+
+static uint32_t hash(adv_auth_t const * p_auth, uint8_t status)
+{
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < ADV_AUTH_HASH_WORDS; i++)
+    {
+        if (status & (1U << i))
+        {
+            value ^= p_auth->hash[i];
+        }
+    }
+    return value;
+}
+
+
+bool adv_auth_init(adv_auth_t *       p_auth,
+                   adv_auth_cipher_t  cipher,
+                   uint8_t const *    p_key,
+                   uint8_t const *    p_id,
+                   uint32_t           counter,
+                   uint32_t           limit)
+{
+    uint8_t nonce[ADV_AUTH_BLOCK_LEN];
+    uint8_t block[ADV_AUTH_BLOCK_LEN];
+
+    p_auth->cipher = cipher;
+    for (uint32_t i = 0; i < ADV_AUTH_KEY_LEN; i++)
+    {
+        p_auth->key[i] = p_key[i];
+    }
+    for (uint32_t i = 0; i < ADV_AUTH_ID_LEN; i++)
+    {
+        p_auth->id[i] = p_id[i];
+    }
+    p_auth->counter         = counter;
+    p_auth->limit           = limit;
+    p_auth->keystream_first = 0;
+    p_auth->keystream_count = 0;
+
+    for (uint32_t b = 0; b < ADV_AUTH_HASH_WORDS / 4; b++)
+    {
+        nonce_build(p_auth, ADV_AUTH_NONCE_HASH, b, nonce);
+        if (!cipher(p_auth->key, nonce, block))
+        {
+            return false;
+        }
+        for (uint32_t w = 0; w < 4; w++)
+        {
+            p_auth->hash[b * 4 + w] = u32_be_get(&block[w * 4]);
+        }
+    }
+    return true;
+}
+
+
+void adv_auth_limit_set(adv_auth_t * p_auth, uint32_t limit)
+{
+    // Only ever up, a late confirmation of an older limit changes nothing.
+    if ((int32_t)(limit - p_auth->limit) > 0)
+    {
+        p_auth->limit = limit;
+    }
+}
+
+
+uint32_t adv_auth_counters_left(adv_auth_t const * p_auth)
+{
+    int32_t left = (int32_t)(p_auth->limit - p_auth->counter);
+
+    return (left > 0) ? (uint32_t)left : 0;
+}
+
+
+uint32_t adv_auth_refill(adv_auth_t * p_auth)
+{
+    while (p_auth->keystream_count < ADV_AUTH_KEYSTREAM_COUNT)
+    {
+        uint32_t counter = p_auth->counter + p_auth->keystream_count;
+        uint32_t index   = (p_auth->keystream_first + p_auth->keystream_count) % ADV_AUTH_KEYSTREAM_COUNT;
+
+        if (((int32_t)(p_auth->limit - counter) <= 0) ||
+            !keystream_word(p_auth, counter, &p_auth->keystream[index]))
+        {
+            break;
+        }
+        p_auth->keystream_count++;
+    }
+    return p_auth->keystream_count;
+}
+
+
+bool adv_auth_sign(adv_auth_t * p_auth, uint8_t status, uint8_t * p_counter, uint8_t * p_tag)
+{
+    uint32_t word;
+
+    if (adv_auth_counters_left(p_auth) == 0)
+    {
+        return false;
+    }
+
+    if (p_auth->keystream_count != 0)
+    {
+        word = p_auth->keystream[p_auth->keystream_first];
+        p_auth->keystream_first = (p_auth->keystream_first + 1) % ADV_AUTH_KEYSTREAM_COUNT;
+        p_auth->keystream_count--;
+    }
+    else if (!keystream_word(p_auth, p_auth->counter, &word))
+    {
+        return false;
+    }
+
+    u32_be_put(p_counter, p_auth->counter);
+    u32_be_put(p_tag, word ^ hash(p_auth, status));
+    p_auth->counter++;
+    return true;
+}
+
+
+bool adv_auth_tag(adv_auth_t const * p_auth, uint32_t counter, uint8_t status, uint32_t * p_tag)
+{
+    uint32_t word;
+
+    if (!keystream_word(p_auth, counter, &word))
+    {
+        return false;
+    }
+    *p_tag = word ^ hash(p_auth, status);
+    return true;
+}
@@ -0,0 +1,136 @@
+/** @file
+ *
+ * @defgroup adv_auth Authenticated advertising frames
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Rolling counter and truncated MAC for the status byte of the beacon frame.
+ *
+ * @details Every status change gets the next value of a 32-bit counter and a 32-bit tag:
+ *
+ *              tag = KS(counter) ^ H(status)
+ *
+ *          - KS(counter) is the first word of the keystream block AES-128_K(nonce), with the
+ *            nonce 0x01, major (BE), minor (BE), counter (BE), zero padded.
+ *          - H is a keyed hash, linear in the status bits: the XOR of the words hash[i] of
+ *            every set bit i. The eight words come from AES-128_K(0x02, major, minor, i) for
+ *            i = 0, 1, four big endian words each.
+ *
+ *          As long as no counter value is used twice this is a one-time MAC in the
+ *          Carter-Wegman style. The keystream word hides the hash, and changing any status bit
+ *          changes the tag by secret words, so a forged tag is right with probability 2^-32.
+ *          Major and minor are in the nonce, so a tag is only valid for its own beacon. A
+ *          receiver rejects counters it has already seen, so old frames cannot be replayed.
+ *
+ *          The keystream words of the next ADV_AUTH_KEYSTREAM_COUNT counter values are
+ *          computed ahead with adv_auth_refill() while nothing else is to be done. Signing then
+ *          only takes a word from that queue, XORs the hash words and writes bytes.
+ *          Counters are only handed out below a limit, which the caller raises after it has
+ *          stored a new limit persistently. That way a reset never reuses a counter.
+ *
+ *          The block cipher is a callback: the SoftDevice ECB in the firmware, a software
+ *          AES-128 on the host.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ADV_AUTH_H__
+#define ADV_AUTH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_AUTH_KEY_LEN                16                  /**< AES-128 key. */
+#define ADV_AUTH_BLOCK_LEN              16                  /**< AES block. */
+#define ADV_AUTH_ID_LEN                 4                   /**< Major and minor, big endian, as in the frame. */
+#define ADV_AUTH_COUNTER_LEN            4                   /**< Counter in the frame, big endian. */
+#define ADV_AUTH_TAG_LEN                4                   /**< Tag in the frame, big endian. */
+#define ADV_AUTH_HASH_WORDS             8                   /**< One hash word per status bit. */
+#define ADV_AUTH_KEYSTREAM_COUNT        8                   /**< Keystream words computed ahead. */
+
+#define ADV_AUTH_NONCE_KEYSTREAM        0x01                /**< First nonce byte of a keystream block. */
+#define ADV_AUTH_NONCE_HASH             0x02                /**< First nonce byte of a hash key block. */
+
+/**@brief Block cipher: AES-128 encryption of one block.
+ *
+ * @param[in]  p_key  ADV_AUTH_KEY_LEN bytes of key.
+ * @param[in]  p_in   Clear text block.
+ * @param[out] p_out  Cipher text block.
+ *
+ * @return False if the cipher failed.
+ */
+typedef bool (*adv_auth_cipher_t)(uint8_t const * p_key, uint8_t const * p_in, uint8_t * p_out);
+
+/**@brief Authentication state. Initialise with adv_auth_init(). */
+typedef struct
+{
+    adv_auth_cipher_t cipher;
+    uint8_t           key[ADV_AUTH_KEY_LEN];
+    uint8_t           id[ADV_AUTH_ID_LEN];
+    uint32_t          hash[ADV_AUTH_HASH_WORDS];
+    uint32_t          counter;                              /**< Counter of the next signature. */
+    uint32_t          limit;                                /**< Counters below this are safe to use. */
+    uint32_t          keystream[ADV_AUTH_KEYSTREAM_COUNT];  /**< Words for counter, counter + 1, ... */
+    uint32_t          keystream_first;                      /**< Index of the word for counter. */
+    uint32_t          keystream_count;                      /**< Words ready. */
+} adv_auth_t;
+
+/**@brief Function for initializing the authentication and deriving the hash words.
+ *
+ * @param[in] cipher   Block cipher.
+ * @param[in] p_key    Key of this beacon.
+ * @param[in] p_id     Major and minor, big endian.
+ * @param[in] counter  First counter to use.
+ * @param[in] limit    Counters below this are safe to use.
+ *
+ * @return False if the cipher failed.
+ */
+bool adv_auth_init(adv_auth_t *       p_auth,
+                   adv_auth_cipher_t  cipher,
+                   uint8_t const *    p_key,
+                   uint8_t const *    p_id,
+                   uint32_t           counter,
+                   uint32_t           limit);
+
+/**@brief Function for raising the counter limit, after the new limit was stored. */
+void adv_auth_limit_set(adv_auth_t * p_auth, uint32_t limit);
+
+/**@brief Function for getting the number of counters left below the limit. */
+uint32_t adv_auth_counters_left(adv_auth_t const * p_auth);
+
+/**@brief Function for computing keystream words ahead, up to ADV_AUTH_KEYSTREAM_COUNT.
+ *
+ * @return Keystream words ready.
+ */
+uint32_t adv_auth_refill(adv_auth_t * p_auth);
+
+/**@brief Function for signing a status byte with the next counter.
+ *
+ * @details Uses a keystream word computed ahead, or computes one if none is ready.
+ *
+ * @param[in]  status     Status byte.
+ * @param[out] p_counter  ADV_AUTH_COUNTER_LEN bytes for the counter.
+ * @param[out] p_tag      ADV_AUTH_TAG_LEN bytes for the tag.
+ *
+ * @retval true   Signed, the counter moved on.
+ * @retval false  The counter reached the limit or the cipher failed, nothing written.
+ */
+bool adv_auth_sign(adv_auth_t * p_auth, uint8_t status, uint8_t * p_counter, uint8_t * p_tag);
+
+/**@brief Function for computing the tag of a counter and status directly, for checks and receivers.
+ *
+ * @param[out] p_tag  Tag, valid if true is returned.
+ *
+ * @return False if the cipher failed.
+ */
+bool adv_auth_tag(adv_auth_t const * p_auth, uint32_t counter, uint8_t status, uint32_t * p_tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_AUTH_H__
+
+/** @} */
@@ -0,0 +1,128 @@
+/** @file
+ *
+ * @defgroup adv_frame Advertising frame layout
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Compile-time advertising data of the beacon and the offsets of its mutable fields.
+ *
+ * @details The advertising data never changes shape, so it is written out here instead of
+ *          being encoded at boot. It is two AD structures, 31 bytes, the legacy maximum:
+ *
+ *          | Offset | Length | Field |
+ *          | --- | --- | --- |
+ *          | 0 | 3 | Flags AD structure |
+ *          | 3 | 4 | Manufacturer specific AD header: length, type, company identifier (LE) |
+ *          | 7 | 1 | Device type |
+ *          | 8 | 1 | iBeacon data length (0x15) |
+ *          | 9 | 16 | UUID |
+ *          | 17 | 4 | With USE_AUTH_FRAMES: frame counter (BE), in place of UUID bytes 8 to 11 |
+ *          | 21 | 4 | With USE_AUTH_FRAMES: tag (BE), in place of UUID bytes 12 to 15 |
+ *          | 25 | 2 | Major (BE) |
+ *          | 27 | 2 | Minor (BE) |
+ *          | 29 | 1 | Measured RSSI |
+ *          | 30 | 1 | Status |
+ *
+ *          This is the byte layout ble_advdata_encode() produced for the same fields, flags
+ *          first. Fields are updated with a store at their offset.
+ *
+ *          The telemetry frame takes turns with the beacon frame, it is 31 bytes:
+ *
+ *          | Offset | Length | Field |
+ *          | --- | --- | --- |
+ *          | 0 | 3 | Flags AD structure |
+ *          | 3 | 4 | Manufacturer specific AD header: length, type, company identifier (LE) |
+ *          | 7 | 1 | Frame type (0x11) |
+ *          | 8 | 2 | Major (BE) |
+ *          | 10 | 2 | Minor (BE) |
+ *          | 12 | 1 | Status, as in the beacon frame |
+ *          | 13 | 2 | Supply voltage in mV (BE), 0 if not measured |
+ *          | 15 | 4 | Uptime in s (BE) |
+ *          | 19 | 4 | Tones decoded (BE) |
+ *          | 23 | 2 | Tones rejected (BE), saturates |
+ *          | 25 | 2 | Alarms (BE), saturates |
+ *          | 27 | 4 | Energy used since boot in mJ (BE), 0 without USE_ENERGY_METER |
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ADV_FRAME_H__
+#define ADV_FRAME_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_FRAME_AD_TYPE_FLAGS         0x01                /**< Flags AD type. */
+#define ADV_FRAME_AD_TYPE_MANUF         0xFF                /**< Manufacturer specific data AD type. */
+
+#define ADV_FRAME_LEN                   31                  /**< Whole advertising data. */
+#define ADV_FRAME_FLAGS_OFFSET          2                   /**< Flags value. */
+#define ADV_FRAME_COMPANY_OFFSET        5                   /**< Company identifier, little endian. */
+#define ADV_FRAME_INFO_OFFSET           7                   /**< Beacon information, the rest of the frame. */
+#define ADV_FRAME_INFO_LEN              (ADV_FRAME_LEN - ADV_FRAME_INFO_OFFSET)
+#define ADV_FRAME_UUID_OFFSET           9                   /**< Proximity UUID. */
+#define ADV_FRAME_AUTH_COUNTER_OFFSET   17                  /**< Frame counter, big endian, see adv_auth.h. */
+#define ADV_FRAME_AUTH_TAG_OFFSET       21                  /**< Tag, big endian, see adv_auth.h. */
+#define ADV_FRAME_MAJOR_OFFSET          25                  /**< Major value, big endian. */
+#define ADV_FRAME_MINOR_OFFSET          27                  /**< Minor value, big endian. */
+#define ADV_FRAME_RSSI_OFFSET           29                  /**< Measured RSSI. */
+#define ADV_FRAME_STATUS_OFFSET         30                  /**< Status byte. */
+
+#define ADV_TELEMETRY_TYPE              0x11                /**< Telemetry frame type, after the company identifier. */
+#define ADV_TELEMETRY_LEN               31                  /**< Whole telemetry advertising data. */
+#define ADV_TELEMETRY_TYPE_OFFSET       7
+#define ADV_TELEMETRY_MAJOR_OFFSET      8                   /**< Major value, big endian. */
+#define ADV_TELEMETRY_MINOR_OFFSET      10                  /**< Minor value, big endian. */
+#define ADV_TELEMETRY_STATUS_OFFSET     12                  /**< Status byte. */
+#define ADV_TELEMETRY_SUPPLY_OFFSET     13                  /**< Supply voltage in mV, big endian. */
+#define ADV_TELEMETRY_UPTIME_OFFSET     15                  /**< Uptime in s, big endian. */
+#define ADV_TELEMETRY_TONES_OFFSET      19                  /**< Tones decoded, big endian. */
+#define ADV_TELEMETRY_REJECTED_OFFSET   23                  /**< Tones rejected, big endian. */
+#define ADV_TELEMETRY_ALARMS_OFFSET     25                  /**< Alarms, big endian. */
+#define ADV_TELEMETRY_ENERGY_OFFSET     27                  /**< Energy in mJ, big endian. */
+
+/**@brief Initializer of a frame.
+ *
+ * @param[in] flags    Flags value.
+ * @param[in] company  Company identifier.
+ * @param[in] ...      ADV_FRAME_INFO_LEN bytes of beacon information, device type first.
+ */
+#define ADV_FRAME_INIT(flags, company, ...)                 \
+{                                                           \
+    0x02, ADV_FRAME_AD_TYPE_FLAGS, (flags),                 \
+    ADV_FRAME_INFO_LEN + 3, ADV_FRAME_AD_TYPE_MANUF,        \
+    (uint8_t)((company) & 0xFF), (uint8_t)((company) >> 8), \
+    __VA_ARGS__                                             \
+}
+
+/**@brief Initializer of a telemetry frame, the run time fields zero.
+ *
+ * @param[in] flags    Flags value.
+ * @param[in] company  Company identifier.
+ * @param[in] major    Two bytes of major value, big endian.
+ * @param[in] minor    Two bytes of minor value, big endian.
+ */
+#define ADV_TELEMETRY_INIT(flags, company, major, minor)    \
+{                                                           \
+    0x02, ADV_FRAME_AD_TYPE_FLAGS, (flags),                 \
+    ADV_TELEMETRY_LEN - 4, ADV_FRAME_AD_TYPE_MANUF,         \
+    (uint8_t)((company) & 0xFF), (uint8_t)((company) >> 8), \
+    ADV_TELEMETRY_TYPE,                                     \
+    major, minor,                                           \
+    0,                                                      \
+    0, 0,                                                   \
+    0, 0, 0, 0,                                             \
+    0, 0, 0, 0,                                             \
+    0, 0,                                                   \
+    0, 0,                                                   \
+    0, 0, 0, 0                                              \
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_FRAME_H__
+
+/** @} */
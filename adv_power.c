@@ -0,0 +1,114 @@
+/** @file
+ *
+ * @brief Alarm delivery policy implementation.
+ */
+#include <stddef.h>
+
+#include "adv_power.h"
+
+
+/**@brief TX power and radio current of one nRF52840 setting. */
+typedef struct
+{
+    int8_t   dbm;
+    uint16_t ua;
+} tx_step_t;
+
+/**@brief Every TX power of the radio, ascending. */
+static const tx_step_t m_tx_steps[] =
+{
+    { -40, 2300 }, { -20, 2700 }, { -16, 2800 }, { -12, 3000 }, { -8, 3300 }, { -4, 3800 },
+    {   0, 4800 }, {   2, 7200 }, {   3, 8400 }, {   4, 9600 }, {  5, 10900 }, { 6, 12200 },
+    {   7, 13500 }, { 8, 14800 }
+};
+
+#define TX_STEP_COUNT   (sizeof(m_tx_steps) / sizeof(m_tx_steps[0]))
+
+
+/**@brief Function for finding the highest setting at or below a TX power, the lowest one if none is. */
+static tx_step_t const * tx_step(int8_t dbm)
+{
+    tx_step_t const * p_step = &m_tx_steps[0];
+
+    for (uint32_t i = 0; i < TX_STEP_COUNT; i++)
+    {
+        if (m_tx_steps[i].dbm <= dbm)
+        {
+            p_step = &m_tx_steps[i];
+        }
+    }
+    return p_step;
+}
+
+
+void adv_power_init(adv_power_t * p_power, adv_power_policy_t const * p_policy, uint32_t seed)
+{
+    p_power->policy           = *p_policy;
+    p_power->policy.idle_dbm  = tx_step(p_policy->idle_dbm)->dbm;
+    p_power->policy.alarm_dbm = tx_step(p_policy->alarm_dbm)->dbm;
+    if (p_power->policy.copies < 1)
+    {
+        p_power->policy.copies = 1;
+    }
+    if (p_power->policy.copies > ADV_POWER_COPIES_MAX)
+    {
+        p_power->policy.copies = ADV_POWER_COPIES_MAX;
+    }
+    if (p_power->policy.spread_pct > 100)
+    {
+        p_power->policy.spread_pct = 100;
+    }
+    // Xorshift never leaves zero.
+    p_power->seed = (seed != 0) ? seed : 1;
+}
+
+
+bool adv_power_tx_valid(int8_t dbm)
+{
+    return (tx_step(dbm)->dbm == dbm);
+}
+
+
+int8_t adv_power_tx_dbm(adv_power_t const * p_power, bool alarm)
+{
+    return alarm ? p_power->policy.alarm_dbm : p_power->policy.idle_dbm;
+}
+
+
+uint32_t adv_power_gap_ms(adv_power_t * p_power, uint32_t alarm_ms)
+{
+    uint32_t mean_ms = alarm_ms / p_power->policy.copies;
+    uint32_t range   = (mean_ms * p_power->policy.spread_pct) / 100;
+    uint32_t x       = p_power->seed;
+    uint32_t gap_ms;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    p_power->seed = x;
+
+    // Uniform in mean - range to mean + range.
+    gap_ms = mean_ms - range + (uint32_t)(((uint64_t)x * (2 * range + 1)) >> 32);
+    return (gap_ms < ADV_POWER_GAP_MIN_MS) ? ADV_POWER_GAP_MIN_MS : gap_ms;
+}
+
+
+uint32_t adv_power_tx_ua(int8_t dbm)
+{
+    return tx_step(dbm)->ua;
+}
+
+
+uint32_t adv_power_event_nj(int8_t dbm, uint32_t radio_us)
+{
+    // uA * us * mV is 1e-15 J.
+    return (uint32_t)(((uint64_t)adv_power_tx_ua(dbm) * radio_us * ADV_POWER_SUPPLY_MV) / 1000000);
+}
+
+
+uint32_t adv_power_alarm_uj(adv_power_t const * p_power, uint32_t alarm_ms, uint32_t radio_us, uint32_t duration_ms)
+{
+    uint64_t events = ((uint64_t)duration_ms * p_power->policy.copies) / ((alarm_ms != 0) ? alarm_ms : 1);
+
+    return (uint32_t)((events * adv_power_event_nj(p_power->policy.alarm_dbm, radio_us)) / 1000);
+}
@@ -0,0 +1,116 @@
+/** @file
+ *
+ * @defgroup adv_power Alarm delivery policy
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief TX power and event redundancy: strong and repeated while an alarm is advertised,
+ *        weak otherwise.
+ *
+ * @details A policy has two TX powers, one while the alarm status is advertised and one for
+ *          everything else: heartbeat, hold and back-off. During the alarm the advertising set
+ *          sends single events, each on all three primary channels, @ref
+ *          adv_power_policy_t::copies of them per alarm interval. The gap to the next event is
+ *          random around its mean, so the events never lock to the scan interval of a gateway
+ *          or to periodic interference, the way fixed spacing can.
+ *
+ *          The radio current of each TX power is the nRF52840 product specification figure
+ *          with the DC/DC converter at 3 V. The steps between +4 and +8 dBm and between 0 and
+ *          +4 dBm are interpolated. Energy counts the radio time of an event at that current,
+ *          the CPU and the SoftDevice around the event are left out.
+ *
+ *          The delivery probability a policy buys is modelled on the host, see
+ *          host/delivery_model.c.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ADV_POWER_H__
+#define ADV_POWER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_POWER_COPIES_MAX            8                   /**< Most events per alarm interval. */
+#define ADV_POWER_GAP_MIN_MS            8                   /**< Shortest gap between two alarm events. */
+#define ADV_POWER_SUPPLY_MV             3000                /**< Supply the currents are given for. */
+
+/**@brief Policy. */
+typedef struct
+{
+    int8_t  idle_dbm;                                       /**< TX power without an alarm. */
+    int8_t  alarm_dbm;                                      /**< TX power while the alarm status is advertised. */
+    uint8_t copies;                                         /**< Events per alarm interval, 1 to ADV_POWER_COPIES_MAX. */
+    uint8_t spread_pct;                                     /**< Gaps are random within this percentage of their mean, 0 to 100. */
+} adv_power_policy_t;
+
+/**@brief Default policy: -20 dBm idle, +8 dBm during an alarm, 2 events per alarm interval
+ *        with gaps of 50 to 150 % of their mean. */
+#define ADV_POWER_DEFAULT_POLICY                            \
+{                                                           \
+    .idle_dbm   = -20,                                      \
+    .alarm_dbm  = 8,                                        \
+    .copies     = 2,                                        \
+    .spread_pct = 50                                        \
+}
+
+/**@brief Policy in use. Initialise with adv_power_init(). */
+typedef struct
+{
+    adv_power_policy_t policy;
+    uint32_t           seed;                                /**< State of the gap generator. */
+} adv_power_t;
+
+/**@brief Function for initializing a policy.
+ *
+ * @details TX powers the radio does not have are rounded down to one it has, copies and
+ *          spread are clamped.
+ *
+ * @param[in] seed  Seed of the gaps, different beacons should use different ones.
+ */
+void adv_power_init(adv_power_t * p_power, adv_power_policy_t const * p_policy, uint32_t seed);
+
+/**@brief Function for checking that a TX power is one the nRF52840 radio has. */
+bool adv_power_tx_valid(int8_t dbm);
+
+/**@brief Function for getting the TX power to advertise with.
+ *
+ * @param[in] alarm  True while the alarm status is advertised.
+ */
+int8_t adv_power_tx_dbm(adv_power_t const * p_power, bool alarm);
+
+/**@brief Function for getting the gap to the next alarm event.
+ *
+ * @param[in] alarm_ms  Alarm interval, copies events go out in it on average.
+ *
+ * @return Random gap, at least ADV_POWER_GAP_MIN_MS.
+ */
+uint32_t adv_power_gap_ms(adv_power_t * p_power, uint32_t alarm_ms);
+
+/**@brief Function for getting the radio current while sending at a TX power, in uA. */
+uint32_t adv_power_tx_ua(int8_t dbm);
+
+/**@brief Function for getting the energy of one advertising event, in nJ.
+ *
+ * @param[in] dbm       TX power.
+ * @param[in] radio_us  Radio time of the event, ramp-up included.
+ */
+uint32_t adv_power_event_nj(int8_t dbm, uint32_t radio_us);
+
+/**@brief Function for getting the energy the advertising of an alarm takes, in uJ.
+ *
+ * @param[in] alarm_ms     Alarm interval.
+ * @param[in] radio_us     Radio time of one event.
+ * @param[in] duration_ms  Time the alarm status is advertised.
+ */
+uint32_t adv_power_alarm_uj(adv_power_t const * p_power, uint32_t alarm_ms, uint32_t radio_us, uint32_t duration_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_POWER_H__
+
+/** @} */
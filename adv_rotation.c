@@ -0,0 +1,51 @@
+/** @file
+ *
+ * @brief Advertising frame rotation implementation.
+ */
+#include <stddef.h>
+
+#include "adv_rotation.h"
+
+
+void adv_rotation_init(adv_rotation_t * p_rotation, uint8_t const * p_weights, uint32_t count)
+{
+    if (count > ADV_ROTATION_FRAMES_MAX)
+    {
+        count = ADV_ROTATION_FRAMES_MAX;
+    }
+
+    p_rotation->count = count;
+    p_rotation->total = 0;
+    for (uint32_t i = 0; i < ADV_ROTATION_FRAMES_MAX; i++)
+    {
+        p_rotation->weight[i] = (i < count) ? p_weights[i] : 0;
+        p_rotation->credit[i] = 0;
+        p_rotation->picks[i]  = 0;
+        p_rotation->total    += p_rotation->weight[i];
+    }
+}
+
+
+uint32_t adv_rotation_next(adv_rotation_t * p_rotation)
+{
+    uint32_t best = 0;
+
+    if (p_rotation->total == 0)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < p_rotation->count; i++)
+    {
+        p_rotation->credit[i] += p_rotation->weight[i];
+        if (p_rotation->credit[i] > p_rotation->credit[best])
+        {
+            best = i;
+        }
+    }
+
+    // The credits always sum to 0, so they stay within plus or minus the total.
+    p_rotation->credit[best] -= (int32_t)p_rotation->total;
+    p_rotation->picks[best]++;
+    return best;
+}
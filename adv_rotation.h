@@ -0,0 +1,56 @@
+/** @file
+ *
+ * @defgroup adv_rotation Advertising frame rotation
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Picks the frame of the next advertising event, each frame type as often as its weight.
+ *
+ * @details Smooth weighted round robin: every pick adds each weight to the credit of its
+ *          frame, takes the frame with the most credit and takes the sum of the weights off it.
+ *          Over sum-of-weights picks every frame comes up exactly weight times, spread out
+ *          instead of in runs: weights 3 and 1 give A A B A, A A B A, ... A weight of 0 leaves
+ *          the frame out. A pick is a few additions per frame type, no division.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ADV_ROTATION_H__
+#define ADV_ROTATION_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_ROTATION_FRAMES_MAX         4                   /**< Frame types a rotation can hold. */
+
+/**@brief Rotation. Initialise with adv_rotation_init(). */
+typedef struct
+{
+    uint32_t count;                                         /**< Frame types. */
+    uint32_t total;                                         /**< Sum of the weights. */
+    uint8_t  weight[ADV_ROTATION_FRAMES_MAX];
+    int32_t  credit[ADV_ROTATION_FRAMES_MAX];
+    uint32_t picks[ADV_ROTATION_FRAMES_MAX];                /**< Times each frame was picked. */
+} adv_rotation_t;
+
+/**@brief Function for initializing a rotation.
+ *
+ * @param[in] p_weights  Weight of each frame type, frame 0 first.
+ * @param[in] count      Frame types, at most ADV_ROTATION_FRAMES_MAX.
+ */
+void adv_rotation_init(adv_rotation_t * p_rotation, uint8_t const * p_weights, uint32_t count);
+
+/**@brief Function for picking the frame of the next advertising event.
+ *
+ * @return Frame type, 0 if every weight is 0.
+ */
+uint32_t adv_rotation_next(adv_rotation_t * p_rotation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_ROTATION_H__
+
+/** @} */
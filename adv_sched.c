@@ -0,0 +1,184 @@
+/** @file
+ *
+ * @brief Advertising interval scheduler implementation.
+ */
+#include <stddef.h>
+
+#include "adv_sched.h"
+
+
+static uint32_t interval_clamp(uint32_t interval_ms)
+{
+    return (interval_ms < ADV_SCHED_INTERVAL_MIN_MS) ? ADV_SCHED_INTERVAL_MIN_MS :
+           ((interval_ms > ADV_SCHED_INTERVAL_MAX_MS) ? ADV_SCHED_INTERVAL_MAX_MS : interval_ms);
+}
+
+
+/**@brief Radio time of a span at one interval, in microseconds. */
+static uint64_t radio_us(adv_sched_config_t const * p_config, uint32_t interval_ms, uint64_t span_ms)
+{
+    return (span_ms * p_config->event_us) / (interval_ms + ADV_SCHED_ADV_DELAY_AVG_MS);
+}
+
+
+/**@brief Add the radio time up to now and switch to a new interval. */
+static bool interval_set(adv_sched_t * p_sched, uint32_t interval_ms, uint32_t now_ms)
+{
+    uint32_t span_ms = now_ms - p_sched->since_ms;
+
+    p_sched->radio_us   += radio_us(&p_sched->config, p_sched->interval_ms, span_ms);
+    p_sched->elapsed_ms += span_ms;
+    p_sched->since_ms    = now_ms;
+
+    if (interval_ms == p_sched->interval_ms)
+    {
+        return false;
+    }
+    p_sched->interval_ms = interval_ms;
+    return true;
+}
+
+
+static adv_sched_config_t config_clamp(adv_sched_config_t const * p_config)
+{
+    adv_sched_config_t config = *p_config;
+
+    config.idle_ms        = interval_clamp(config.idle_ms);
+    config.alarm_ms       = interval_clamp(config.alarm_ms);
+    config.alarm_ms       = (config.alarm_ms > config.idle_ms) ? config.idle_ms : config.alarm_ms;
+    config.backoff_events = (config.backoff_events == 0) ? 1 : config.backoff_events;
+
+    return config;
+}
+
+
+void adv_sched_init(adv_sched_t * p_sched, adv_sched_config_t const * p_config, uint32_t now_ms)
+{
+    adv_sched_config_t config = config_clamp(p_config);
+
+    p_sched->config      = config;
+    p_sched->state       = ADV_SCHED_STATE_IDLE;
+    p_sched->interval_ms = config.idle_ms;
+    p_sched->until_ms    = now_ms;
+    p_sched->since_ms    = now_ms;
+    p_sched->radio_us    = 0;
+    p_sched->elapsed_ms  = 0;
+}
+
+
+bool adv_sched_configure(adv_sched_t * p_sched, adv_sched_config_t const * p_config, uint32_t now_ms)
+{
+    uint32_t interval_ms;
+
+    // The radio time so far was spent with the old event time.
+    (void) interval_set(p_sched, p_sched->interval_ms, now_ms);
+    p_sched->config = config_clamp(p_config);
+
+    switch (p_sched->state)
+    {
+        case ADV_SCHED_STATE_ALARM:
+        case ADV_SCHED_STATE_HOLD:
+            interval_ms = p_sched->config.alarm_ms;
+            break;
+
+        case ADV_SCHED_STATE_BACKOFF:
+            interval_ms = (p_sched->interval_ms < p_sched->config.alarm_ms) ? p_sched->config.alarm_ms
+                                                                             : p_sched->interval_ms;
+            if (interval_ms < p_sched->config.idle_ms)
+            {
+                break;
+            }
+            p_sched->state = ADV_SCHED_STATE_IDLE;
+            // Fall through.
+
+        default:
+            interval_ms = p_sched->config.idle_ms;
+            break;
+    }
+
+    return interval_set(p_sched, interval_ms, now_ms);
+}
+
+
+bool adv_sched_alarm(adv_sched_t * p_sched, bool active, uint32_t now_ms)
+{
+    if (active)
+    {
+        p_sched->state = ADV_SCHED_STATE_ALARM;
+        return interval_set(p_sched, p_sched->config.alarm_ms, now_ms);
+    }
+
+    if (p_sched->state == ADV_SCHED_STATE_ALARM)
+    {
+        p_sched->state    = ADV_SCHED_STATE_HOLD;
+        p_sched->until_ms = now_ms + p_sched->config.window_ms;
+    }
+    return false;
+}
+
+
+bool adv_sched_update(adv_sched_t * p_sched, uint32_t now_ms)
+{
+    uint32_t interval_ms;
+
+    if (((p_sched->state != ADV_SCHED_STATE_HOLD) && (p_sched->state != ADV_SCHED_STATE_BACKOFF)) ||
+        ((int32_t)(now_ms - p_sched->until_ms) < 0))
+    {
+        return false;
+    }
+
+    interval_ms = p_sched->interval_ms * 2;
+    if (interval_ms >= p_sched->config.idle_ms)
+    {
+        p_sched->state = ADV_SCHED_STATE_IDLE;
+        interval_ms    = p_sched->config.idle_ms;
+    }
+    else
+    {
+        p_sched->state    = ADV_SCHED_STATE_BACKOFF;
+        p_sched->until_ms = now_ms + interval_ms * p_sched->config.backoff_events;
+    }
+
+    return interval_set(p_sched, interval_ms, now_ms);
+}
+
+
+bool adv_sched_next(adv_sched_t const * p_sched, uint32_t now_ms, uint32_t * p_delay_ms)
+{
+    int32_t delay_ms = (int32_t)(p_sched->until_ms - now_ms);
+
+    if ((p_sched->state != ADV_SCHED_STATE_HOLD) && (p_sched->state != ADV_SCHED_STATE_BACKOFF))
+    {
+        return false;
+    }
+
+    *p_delay_ms = (delay_ms > 0) ? (uint32_t)delay_ms : 0;
+    return true;
+}
+
+
+uint32_t adv_sched_interval_ms(adv_sched_t const * p_sched)
+{
+    return p_sched->interval_ms;
+}
+
+
+uint32_t adv_sched_duty_ppm(adv_sched_t const * p_sched, uint32_t now_ms)
+{
+    uint32_t span_ms    = now_ms - p_sched->since_ms;
+    uint64_t total_us   = p_sched->radio_us + radio_us(&p_sched->config, p_sched->interval_ms, span_ms);
+    uint64_t elapsed_ms = p_sched->elapsed_ms + span_ms;
+
+    if (elapsed_ms == 0)
+    {
+        return adv_sched_fixed_duty_ppm(&p_sched->config, p_sched->interval_ms);
+    }
+    // us / (ms * 1000) * 1000000
+    return (uint32_t)((total_us * 1000) / elapsed_ms);
+}
+
+
+uint32_t adv_sched_fixed_duty_ppm(adv_sched_config_t const * p_config, uint32_t interval_ms)
+{
+    return (uint32_t)(((uint64_t)p_config->event_us * 1000) / (interval_ms + ADV_SCHED_ADV_DELAY_AVG_MS));
+}
@@ -0,0 +1,138 @@
+/** @file
+ *
+ * @defgroup adv_sched Advertising interval scheduler
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Picks the advertising interval: slow heartbeat when idle, fast during an alarm.
+ *
+ * @details The scheduler has four states:
+ *          - Idle: the heartbeat interval.
+ *          - Alarm: the alarm interval, as long as the alarm status is advertised.
+ *          - Hold: the alarm interval for the alarm window after the alarm ended, so a receiver
+ *            that missed the end still gets frames quickly and a pattern that pauses longer than
+ *            the burst timeout does not bounce the interval.
+ *          - Back-off: the interval doubles every @ref adv_sched_config_t::backoff_events
+ *            advertising events until it reaches the heartbeat.
+ *
+ *          An alarm switches to the alarm interval at once from every state, the way down is
+ *          slow, which is the hysteresis. The caller applies the interval whenever a function
+ *          returns true and calls adv_sched_update() when adv_sched_next() says a step is due.
+ *
+ *          The scheduler also adds up the radio time of the advertising events, from the time
+ *          spent at each interval, the average 5 ms advDelay and the radio time of one event.
+ *          Times are in milliseconds of a free running clock, differences wrap.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ADV_SCHED_H__
+#define ADV_SCHED_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_SCHED_INTERVAL_MIN_MS       20                  /**< Shortest non-connectable interval. */
+#define ADV_SCHED_INTERVAL_MAX_MS       10240               /**< Longest legacy advertising interval. */
+#define ADV_SCHED_ADV_DELAY_AVG_MS      5                   /**< Mean of the 0 to 10 ms random advDelay added to every event. */
+
+/**@brief Scheduler configuration. */
+typedef struct
+{
+    uint32_t idle_ms;                                       /**< Heartbeat interval. */
+    uint32_t alarm_ms;                                      /**< Interval during an alarm. */
+    uint32_t window_ms;                                     /**< Time the alarm interval is held after the alarm ended. */
+    uint32_t backoff_events;                                /**< Advertising events per back-off step. */
+    uint32_t event_us;                                      /**< Radio time of one advertising event on all three channels. */
+} adv_sched_config_t;
+
+/**@brief Default configuration: 5 s heartbeat, 20 ms for 30 s after an alarm, 16 events per
+ *        back-off step, 1.5 ms radio time per event (3 x 376 us packets plus ramp-up). */
+#define ADV_SCHED_DEFAULT_CONFIG                            \
+{                                                           \
+    .idle_ms        = 5000,                                 \
+    .alarm_ms       = 20,                                   \
+    .window_ms      = 30000,                                \
+    .backoff_events = 16,                                   \
+    .event_us       = 1500                                  \
+}
+
+/**@brief Scheduler states. */
+typedef enum
+{
+    ADV_SCHED_STATE_IDLE,
+    ADV_SCHED_STATE_ALARM,
+    ADV_SCHED_STATE_HOLD,
+    ADV_SCHED_STATE_BACKOFF
+} adv_sched_state_t;
+
+/**@brief Scheduler. Initialise with adv_sched_init(). */
+typedef struct
+{
+    adv_sched_config_t config;
+    adv_sched_state_t  state;
+    uint32_t           interval_ms;                         /**< Interval to advertise with. */
+    uint32_t           until_ms;                            /**< End of the hold or back-off step. */
+    uint32_t           since_ms;                            /**< Radio time is added up to here. */
+    uint64_t           radio_us;                            /**< Radio time up to since_ms. */
+    uint64_t           elapsed_ms;                          /**< Time the radio time covers. */
+} adv_sched_t;
+
+/**@brief Function for initializing a scheduler in the idle state.
+ *
+ * @details Out of range intervals are clamped, the alarm interval is at most the heartbeat.
+ */
+void adv_sched_init(adv_sched_t * p_sched, adv_sched_config_t const * p_config, uint32_t now_ms);
+
+/**@brief Function for changing the configuration of a running scheduler.
+ *
+ * @details Clamped like adv_sched_init(). The state and the radio time so far are kept, the
+ *          interval moves to what the state calls for with the new configuration: the heartbeat
+ *          when idle, the alarm interval during an alarm or a hold. A back-off step stays where
+ *          it is unless it reached the new heartbeat.
+ *
+ * @return True if the interval changed.
+ */
+bool adv_sched_configure(adv_sched_t * p_sched, adv_sched_config_t const * p_config, uint32_t now_ms);
+
+/**@brief Function for telling the scheduler that the alarm status changed.
+ *
+ * @param[in] active  True while an alarm is advertised.
+ *
+ * @return True if the interval changed.
+ */
+bool adv_sched_alarm(adv_sched_t * p_sched, bool active, uint32_t now_ms);
+
+/**@brief Function for taking a due hold or back-off step.
+ *
+ * @return True if the interval changed.
+ */
+bool adv_sched_update(adv_sched_t * p_sched, uint32_t now_ms);
+
+/**@brief Function for getting the time until the next step.
+ *
+ * @param[out] p_delay_ms  Time until adv_sched_update() should be called, 0 if overdue.
+ *
+ * @retval true   A step is pending.
+ * @retval false  Nothing changes until the next alarm status change.
+ */
+bool adv_sched_next(adv_sched_t const * p_sched, uint32_t now_ms, uint32_t * p_delay_ms);
+
+/**@brief Function for getting the interval to advertise with. */
+uint32_t adv_sched_interval_ms(adv_sched_t const * p_sched);
+
+/**@brief Function for getting the radio duty cycle since initialization, in parts per million. */
+uint32_t adv_sched_duty_ppm(adv_sched_t const * p_sched, uint32_t now_ms);
+
+/**@brief Function for getting the radio duty cycle of a fixed interval, for comparison. */
+uint32_t adv_sched_fixed_duty_ppm(adv_sched_config_t const * p_config, uint32_t interval_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_SCHED_H__
+
+/** @} */
@@ -0,0 +1,83 @@
+/** @file
+ *
+ * @brief Advertising train implementation.
+ */
+#include <stddef.h>
+
+#include "adv_train.h"
+
+
+static void u16_le_put(uint8_t * p_data, uint32_t value)
+{
+    p_data[0] = (uint8_t)(value & 0xFF);
+    p_data[1] = (uint8_t)((value >> 8) & 0xFF);
+}
+
+
+static uint16_t u16_le_get(uint8_t const * p_data)
+{
+    return (uint16_t)(p_data[0] | (p_data[1] << 8));
+}
+
+
+static uint16_t u16_be_get(uint8_t const * p_data)
+{
+    return (uint16_t)((p_data[0] << 8) | p_data[1]);
+}
+
+
+void adv_train_init(adv_train_t * p_train, adv_train_config_t const * p_config, uint32_t now_ms)
+{
+    p_train->config = *p_config;
+    if (p_train->config.pointer_every == 0)
+    {
+        p_train->config.pointer_every = 1;
+    }
+    p_train->last_ms = now_ms;
+    p_train->counter = 0;
+}
+
+
+bool adv_train_event(adv_train_t * p_train, uint32_t now_ms)
+{
+    // The first event and every pointer_every-th after it carry a pointer, so a receiver that
+    // starts with the beacon finds the train at once.
+    bool pointer = ((p_train->counter % p_train->config.pointer_every) == 0);
+
+    p_train->last_ms = now_ms;
+    p_train->counter++;
+    return pointer;
+}
+
+
+void adv_train_pointer_encode(adv_train_t const * p_train, uint32_t now_ms, uint8_t status, uint8_t * p_pointer)
+{
+    uint32_t since_ms = now_ms - p_train->last_ms;
+    uint32_t next_ms  = (since_ms < p_train->config.interval_ms) ? (p_train->config.interval_ms - since_ms) : 0;
+
+    u16_le_put(&p_pointer[ADV_TRAIN_POINTER_INTERVAL_OFFSET], p_train->config.interval_ms);
+    u16_le_put(&p_pointer[ADV_TRAIN_POINTER_NEXT_OFFSET], next_ms);
+    u16_le_put(&p_pointer[ADV_TRAIN_POINTER_COUNTER_OFFSET], p_train->counter);
+    p_pointer[ADV_TRAIN_POINTER_STATUS_OFFSET] = status;
+}
+
+
+bool adv_train_pointer_decode(uint8_t const * p_data, uint32_t len, adv_train_pointer_t * p_pointer)
+{
+    if ((len < ADV_TRAIN_POINTER_LEN) ||
+        (p_data[0] != ADV_TRAIN_POINTER_LEN - 1) ||
+        (p_data[1] != 0xFF) ||
+        (p_data[ADV_TRAIN_POINTER_TYPE_OFFSET] != ADV_TRAIN_POINTER_TYPE))
+    {
+        return false;
+    }
+
+    p_pointer->company     = u16_le_get(&p_data[ADV_TRAIN_POINTER_COMPANY_OFFSET]);
+    p_pointer->major       = u16_be_get(&p_data[ADV_TRAIN_POINTER_MAJOR_OFFSET]);
+    p_pointer->minor       = u16_be_get(&p_data[ADV_TRAIN_POINTER_MINOR_OFFSET]);
+    p_pointer->interval_ms = u16_le_get(&p_data[ADV_TRAIN_POINTER_INTERVAL_OFFSET]);
+    p_pointer->next_ms     = u16_le_get(&p_data[ADV_TRAIN_POINTER_NEXT_OFFSET]);
+    p_pointer->counter     = u16_le_get(&p_data[ADV_TRAIN_POINTER_COUNTER_OFFSET]);
+    p_pointer->status      = p_data[ADV_TRAIN_POINTER_STATUS_OFFSET];
+    return true;
+}
@@ -0,0 +1,135 @@
+/** @file
+ *
+ * @defgroup adv_train Advertising train
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Advertising events at fixed instants, and the pointer that lets receivers find them.
+ *
+ * @details A receiver that knows when the next frame comes only has to scan around that
+ *          instant. Ordinary advertising events are no use for that, every event adds a random
+ *          0 to 10 ms advDelay and the delays add up. The train sends single events at the ticks
+ *          of a fixed timer instead, so the instants do not wander, only the start of each event
+ *          jitters by the time it takes to get it on air.
+ *
+ *          Every @ref adv_train_config_t::pointer_every train events, a pointer follows the train
+ *          event: a short extended advertising event with the train interval, the time to the
+ *          next train event and its counter. A receiver scans until it gets a pointer, then opens
+ *          a window around each train event.
+ *
+ *          Pointer data, one manufacturer specific AD structure:
+ *
+ *          | Offset | Length | Field |
+ *          | --- | --- | --- |
+ *          | 0 | 1 | AD length (15) |
+ *          | 1 | 1 | AD type, manufacturer specific data |
+ *          | 2 | 2 | Company identifier (LE) |
+ *          | 4 | 1 | Pointer type (0x10) |
+ *          | 5 | 2 | Major (BE, as in the beacon frame) |
+ *          | 7 | 2 | Minor (BE) |
+ *          | 9 | 2 | Train interval in ms (LE) |
+ *          | 11 | 2 | Time from the start of this pointer event to the next train event, in ms (LE) |
+ *          | 13 | 2 | Counter of the next train event (LE) |
+ *          | 15 | 1 | Status byte, as in the beacon frame |
+ *
+ *          Times are in milliseconds of a free running clock, differences wrap.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ADV_TRAIN_H__
+#define ADV_TRAIN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_TRAIN_POINTER_TYPE          0x10                /**< Pointer type, after the company identifier. */
+#define ADV_TRAIN_POINTER_LEN           16                  /**< Whole pointer data. */
+#define ADV_TRAIN_POINTER_COMPANY_OFFSET 2
+#define ADV_TRAIN_POINTER_TYPE_OFFSET   4
+#define ADV_TRAIN_POINTER_MAJOR_OFFSET  5
+#define ADV_TRAIN_POINTER_MINOR_OFFSET  7
+#define ADV_TRAIN_POINTER_INTERVAL_OFFSET 9
+#define ADV_TRAIN_POINTER_NEXT_OFFSET   11
+#define ADV_TRAIN_POINTER_COUNTER_OFFSET 13
+#define ADV_TRAIN_POINTER_STATUS_OFFSET 15
+
+/**@brief Initializer of the pointer data, the run time fields zero.
+ *
+ * @param[in] company  Company identifier.
+ * @param[in] major    Two bytes of major value, big endian.
+ * @param[in] minor    Two bytes of minor value, big endian.
+ */
+#define ADV_TRAIN_POINTER_INIT(company, major, minor)       \
+{                                                           \
+    ADV_TRAIN_POINTER_LEN - 1, 0xFF,                        \
+    (uint8_t)((company) & 0xFF), (uint8_t)((company) >> 8), \
+    ADV_TRAIN_POINTER_TYPE,                                 \
+    major, minor,                                           \
+    0, 0, 0, 0, 0, 0, 0                                     \
+}
+
+/**@brief Train configuration. */
+typedef struct
+{
+    uint32_t interval_ms;                                   /**< Time between train events, at most 65535. */
+    uint32_t pointer_every;                                 /**< A pointer follows every this many train events. */
+} adv_train_config_t;
+
+/**@brief Train. Initialise with adv_train_init(). */
+typedef struct
+{
+    adv_train_config_t config;
+    uint32_t           last_ms;                             /**< Time of the last train event. */
+    uint16_t           counter;                             /**< Counter of the next train event. */
+} adv_train_t;
+
+/**@brief Decoded pointer. */
+typedef struct
+{
+    uint16_t company;
+    uint16_t major;
+    uint16_t minor;
+    uint16_t interval_ms;
+    uint16_t next_ms;
+    uint16_t counter;
+    uint8_t  status;
+} adv_train_pointer_t;
+
+/**@brief Function for initializing a train, the first event one interval from now.
+ *
+ * @details A pointer_every of 0 is taken as 1.
+ */
+void adv_train_init(adv_train_t * p_train, adv_train_config_t const * p_config, uint32_t now_ms);
+
+/**@brief Function for counting a train event, called when its timer fires.
+ *
+ * @retval true   A pointer is due after this event.
+ * @retval false  No pointer this time.
+ */
+bool adv_train_event(adv_train_t * p_train, uint32_t now_ms);
+
+/**@brief Function for writing the run time fields of the pointer.
+ *
+ * @param[in]    now_ms     Time the pointer event is started.
+ * @param[in]    status     Status byte to copy.
+ * @param[inout] p_pointer  ADV_TRAIN_POINTER_LEN bytes from ADV_TRAIN_POINTER_INIT().
+ */
+void adv_train_pointer_encode(adv_train_t const * p_train, uint32_t now_ms, uint8_t status, uint8_t * p_pointer);
+
+/**@brief Function for decoding a pointer from advertising data.
+ *
+ * @retval true   p_data holds a pointer, written to p_pointer.
+ * @retval false  Not a pointer.
+ */
+bool adv_train_pointer_decode(uint8_t const * p_data, uint32_t len, adv_train_pointer_t * p_pointer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_TRAIN_H__
+
+/** @} */
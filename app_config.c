@@ -0,0 +1,127 @@
+/** @file
+ *
+ * @brief Run time configuration implementation.
+ */
+#include <stddef.h>
+
+#include "app_config.h"
+#include "adv_power.h"
+
+
+static uint32_t clamp(uint32_t value, uint32_t min, uint32_t max)
+{
+    return (value < min) ? min : ((value > max) ? max : value);
+}
+
+
+void app_config_init(app_config_t *               p_config,
+                     adv_sched_config_t const *   p_sched,
+                     tone_detect_config_t const * p_detect,
+                     int8_t                       tx_power)
+{
+    p_config->idle_ms      = (uint16_t)clamp(p_sched->idle_ms, ADV_SCHED_INTERVAL_MIN_MS, ADV_SCHED_INTERVAL_MAX_MS);
+    p_config->alarm_ms     = (uint16_t)clamp(p_sched->alarm_ms, ADV_SCHED_INTERVAL_MIN_MS, p_config->idle_ms);
+    p_config->window_ms    = clamp(p_sched->window_ms, 0, APP_CONFIG_WINDOW_MAX_MS);
+    p_config->tx_power     = app_config_tx_power_valid(tx_power) ? tx_power : 0;
+    p_config->gap_us       = (uint16_t)clamp(p_detect->gap_us, APP_CONFIG_GAP_MIN_US, UINT16_MAX);
+    p_config->slack_us     = (uint16_t)clamp(p_detect->slack_us, 0, UINT16_MAX);
+    p_config->reject_tones = p_detect->reject_tones;
+
+    p_config->policy.window         = (uint8_t)clamp(p_detect->policy.window, 1, TONE_CONFIDENCE_WINDOW_MAX);
+    p_config->policy.required       = (uint8_t)clamp(p_detect->policy.required, 1, p_config->policy.window);
+    p_config->policy.min_confidence = (uint8_t)clamp(p_detect->policy.min_confidence, 0, 100);
+}
+
+
+bool app_config_tx_power_valid(int8_t tx_power)
+{
+    return adv_power_tx_valid(tx_power);
+}
+
+
+bool app_config_valid(app_config_t const * p_config)
+{
+    return (p_config->idle_ms >= ADV_SCHED_INTERVAL_MIN_MS) &&
+           (p_config->idle_ms <= ADV_SCHED_INTERVAL_MAX_MS) &&
+           (p_config->alarm_ms >= ADV_SCHED_INTERVAL_MIN_MS) &&
+           (p_config->alarm_ms <= p_config->idle_ms) &&
+           (p_config->window_ms <= APP_CONFIG_WINDOW_MAX_MS) &&
+           app_config_tx_power_valid(p_config->tx_power) &&
+           (p_config->gap_us >= APP_CONFIG_GAP_MIN_US) &&
+           (p_config->policy.window >= 1) &&
+           (p_config->policy.window <= TONE_CONFIDENCE_WINDOW_MAX) &&
+           (p_config->policy.required >= 1) &&
+           (p_config->policy.required <= p_config->policy.window) &&
+           (p_config->policy.min_confidence <= 100);
+}
+
+
+void app_config_encode(app_config_t const * p_config, uint8_t * p_buf)
+{
+    p_buf[0]  = APP_CONFIG_VERSION;
+    p_buf[1]  = (uint8_t)p_config->idle_ms;
+    p_buf[2]  = (uint8_t)(p_config->idle_ms >> 8);
+    p_buf[3]  = (uint8_t)p_config->alarm_ms;
+    p_buf[4]  = (uint8_t)(p_config->alarm_ms >> 8);
+    p_buf[5]  = (uint8_t)p_config->window_ms;
+    p_buf[6]  = (uint8_t)(p_config->window_ms >> 8);
+    p_buf[7]  = (uint8_t)(p_config->window_ms >> 16);
+    p_buf[8]  = (uint8_t)(p_config->window_ms >> 24);
+    p_buf[9]  = (uint8_t)p_config->tx_power;
+    p_buf[10] = (uint8_t)p_config->gap_us;
+    p_buf[11] = (uint8_t)(p_config->gap_us >> 8);
+    p_buf[12] = (uint8_t)p_config->slack_us;
+    p_buf[13] = (uint8_t)(p_config->slack_us >> 8);
+    p_buf[14] = p_config->reject_tones ? 1 : 0;
+    p_buf[15] = p_config->policy.window;
+    p_buf[16] = p_config->policy.required;
+    p_buf[17] = p_config->policy.min_confidence;
+}
+
+
+bool app_config_decode(uint8_t const * p_buf, uint32_t len, app_config_t * p_config)
+{
+    app_config_t config;
+
+    if ((len != APP_CONFIG_LEN) || (p_buf[0] != APP_CONFIG_VERSION) || (p_buf[14] > 1))
+    {
+        return false;
+    }
+
+    config.idle_ms      = (uint16_t)(p_buf[1] | (p_buf[2] << 8));
+    config.alarm_ms     = (uint16_t)(p_buf[3] | (p_buf[4] << 8));
+    config.window_ms    = (uint32_t)p_buf[5] | ((uint32_t)p_buf[6] << 8) |
+                          ((uint32_t)p_buf[7] << 16) | ((uint32_t)p_buf[8] << 24);
+    config.tx_power     = (int8_t)p_buf[9];
+    config.gap_us       = (uint16_t)(p_buf[10] | (p_buf[11] << 8));
+    config.slack_us     = (uint16_t)(p_buf[12] | (p_buf[13] << 8));
+    config.reject_tones = (p_buf[14] != 0);
+
+    config.policy.window         = p_buf[15];
+    config.policy.required       = p_buf[16];
+    config.policy.min_confidence = p_buf[17];
+
+    if (!app_config_valid(&config))
+    {
+        return false;
+    }
+    *p_config = config;
+    return true;
+}
+
+
+void app_config_sched_get(app_config_t const * p_config, adv_sched_config_t * p_sched)
+{
+    p_sched->idle_ms   = p_config->idle_ms;
+    p_sched->alarm_ms  = p_config->alarm_ms;
+    p_sched->window_ms = p_config->window_ms;
+}
+
+
+void app_config_detect_get(app_config_t const * p_config, tone_detect_config_t * p_detect)
+{
+    p_detect->gap_us       = p_config->gap_us;
+    p_detect->slack_us     = p_config->slack_us;
+    p_detect->reject_tones = p_config->reject_tones;
+    p_detect->policy       = p_config->policy;
+}
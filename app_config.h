@@ -0,0 +1,97 @@
+/** @file
+ *
+ * @defgroup app_config Run time configuration
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Settings that can be changed over the air, and their wire format.
+ *
+ * @details The configuration characteristic and the flash record hold the same blob, little
+ *          endian:
+ *
+ *          | Offset | Size | Field |
+ *          | --- | --- | --- |
+ *          | 0 | 1 | Format version, APP_CONFIG_VERSION |
+ *          | 1 | 2 | Idle heartbeat interval, ms |
+ *          | 3 | 2 | Alarm advertising interval, ms |
+ *          | 5 | 4 | Alarm interval hold after the alarm, ms |
+ *          | 9 | 1 | TX power, dBm, signed |
+ *          | 10 | 2 | Gap that ends a tone, us |
+ *          | 12 | 2 | Pattern segment slack, us |
+ *          | 14 | 1 | Tone rejection, 0 or 1 |
+ *          | 15 | 1 | Alarm policy: window, cycles |
+ *          | 16 | 1 | Alarm policy: required cycles |
+ *          | 17 | 1 | Alarm policy: minimum confidence, 0 to 100 |
+ *
+ *          A blob is taken whole or not at all: every field is checked before any is used.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef APP_CONFIG_H__
+#define APP_CONFIG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adv_sched.h"
+#include "tone_detect.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_CONFIG_VERSION              1                   /**< Format version of the blob. */
+#define APP_CONFIG_LEN                  18                  /**< Length of the blob. */
+#define APP_CONFIG_WINDOW_MAX_MS        3600000             /**< Longest alarm interval hold. */
+#define APP_CONFIG_GAP_MIN_US           1000                /**< Shortest gap that ends a tone. */
+
+/**@brief Run time configuration. */
+typedef struct
+{
+    uint16_t                 idle_ms;                       /**< Heartbeat interval, ADV_SCHED_INTERVAL_MIN_MS to ADV_SCHED_INTERVAL_MAX_MS. */
+    uint16_t                 alarm_ms;                      /**< Interval during an alarm, ADV_SCHED_INTERVAL_MIN_MS to idle_ms. */
+    uint32_t                 window_ms;                     /**< Alarm interval hold, at most APP_CONFIG_WINDOW_MAX_MS. */
+    int8_t                   tx_power;                      /**< TX power in dBm, one the nRF52840 radio has. */
+    uint16_t                 gap_us;                        /**< Gap that ends a tone, at least APP_CONFIG_GAP_MIN_US. */
+    uint16_t                 slack_us;                      /**< Pattern segment slack. */
+    bool                     reject_tones;                  /**< Tone rejection. */
+    tone_confidence_policy_t policy;                        /**< Alarm policy, within the tone_confidence.h limits. */
+} app_config_t;
+
+/**@brief Function for building a configuration from the compile time settings.
+ *
+ * @details Values that do not fit the blob are clamped, so the result is valid.
+ */
+void app_config_init(app_config_t *               p_config,
+                     adv_sched_config_t const *   p_sched,
+                     tone_detect_config_t const * p_detect,
+                     int8_t                       tx_power);
+
+/**@brief Function for checking every field of a configuration. */
+bool app_config_valid(app_config_t const * p_config);
+
+/**@brief Function for checking that a TX power is one the radio has. */
+bool app_config_tx_power_valid(int8_t tx_power);
+
+/**@brief Function for encoding a configuration into APP_CONFIG_LEN bytes. */
+void app_config_encode(app_config_t const * p_config, uint8_t * p_buf);
+
+/**@brief Function for decoding a blob.
+ *
+ * @retval true   p_config holds the blob.
+ * @retval false  Wrong length or version, or a field out of range. p_config is unchanged.
+ */
+bool app_config_decode(uint8_t const * p_buf, uint32_t len, app_config_t * p_config);
+
+/**@brief Function for copying the advertising settings into a scheduler configuration. */
+void app_config_sched_get(app_config_t const * p_config, adv_sched_config_t * p_sched);
+
+/**@brief Function for copying the detector settings into a detector configuration. */
+void app_config_detect_get(app_config_t const * p_config, tone_detect_config_t * p_detect);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // APP_CONFIG_H__
+
+/** @} */
@@ -0,0 +1,120 @@
+/** @file
+ *
+ * @brief System OFF state implementation.
+ */
+#include <stddef.h>
+
+#include "deep_sleep.h"
+
+
+#define RAM_BASE                0x20000000UL
+#define RAM_SMALL_SECTION       0x1000UL                    /**< RAM0 to RAM7 sections. */
+#define RAM_SMALL_BLOCKS        8
+#define RAM_SMALL_SECTIONS      2
+#define RAM_LARGE_SECTION       0x8000UL                    /**< RAM8 sections. */
+#define RAM_LARGE_SECTIONS      6
+#define RAM_LARGE_BASE          (RAM_BASE + RAM_SMALL_BLOCKS * RAM_SMALL_SECTIONS * RAM_SMALL_SECTION)
+#define RAM_END                 (RAM_LARGE_BASE + RAM_LARGE_SECTIONS * RAM_LARGE_SECTION)
+
+
+/**@brief Function for computing the checksum of a state block, FNV-1a over the bytes before it. */
+static uint32_t state_check(deep_sleep_state_t const * p_state)
+{
+    uint8_t const * p_byte = (uint8_t const *)p_state;
+    uint32_t        hash   = 2166136261UL;
+
+    for (uint32_t i = 0; i < offsetof(deep_sleep_state_t, check); i++)
+    {
+        hash = (hash ^ p_byte[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+
+void deep_sleep_state_init(deep_sleep_state_t * p_state, lpcomp_cal_result_t const * p_cal)
+{
+    *p_state            = (deep_sleep_state_t) {0};
+    p_state->magic      = DEEP_SLEEP_MAGIC;
+    p_state->lpcomp_cal = *p_cal;
+    p_state->edge_us    = DEEP_SLEEP_TIME_NONE;
+    p_state->adv_us     = DEEP_SLEEP_TIME_NONE;
+}
+
+
+void deep_sleep_state_seal(deep_sleep_state_t * p_state)
+{
+    p_state->magic = DEEP_SLEEP_MAGIC;
+    p_state->check = state_check(p_state);
+}
+
+
+bool deep_sleep_state_take(deep_sleep_state_t * p_state)
+{
+    bool valid = (p_state->magic == DEEP_SLEEP_MAGIC) && (p_state->check == state_check(p_state));
+
+    p_state->check = ~p_state->check;
+    return valid;
+}
+
+
+uint32_t deep_sleep_retention(uint32_t address, uint32_t len, uint32_t p_masks[DEEP_SLEEP_RAM_BLOCKS])
+{
+    uint32_t end = address + len;
+
+    if ((len == 0) || (address < RAM_BASE) || (end > RAM_END))
+    {
+        return deep_sleep_retained_bytes(p_masks);
+    }
+
+    while (address < end)
+    {
+        uint32_t block;
+        uint32_t section;
+        uint32_t size;
+
+        if (address < RAM_LARGE_BASE)
+        {
+            size    = RAM_SMALL_SECTION;
+            block   = (address - RAM_BASE) / (RAM_SMALL_SECTIONS * RAM_SMALL_SECTION);
+            section = ((address - RAM_BASE) / RAM_SMALL_SECTION) % RAM_SMALL_SECTIONS;
+        }
+        else
+        {
+            size    = RAM_LARGE_SECTION;
+            block   = RAM_SMALL_BLOCKS;
+            section = (address - RAM_LARGE_BASE) / RAM_LARGE_SECTION;
+        }
+        p_masks[block] |= 1UL << (DEEP_SLEEP_RAM_RETENTION_Pos + section);
+
+        // On to the start of the next section.
+        address = (address & ~(size - 1)) + size;
+    }
+    return deep_sleep_retained_bytes(p_masks);
+}
+
+
+uint32_t deep_sleep_retained_bytes(uint32_t const p_masks[DEEP_SLEEP_RAM_BLOCKS])
+{
+    uint32_t bytes = 0;
+
+    for (uint32_t block = 0; block < DEEP_SLEEP_RAM_BLOCKS; block++)
+    {
+        uint32_t sections = (block < RAM_SMALL_BLOCKS) ? RAM_SMALL_SECTIONS : RAM_LARGE_SECTIONS;
+        uint32_t size     = (block < RAM_SMALL_BLOCKS) ? RAM_SMALL_SECTION : RAM_LARGE_SECTION;
+
+        for (uint32_t section = 0; section < sections; section++)
+        {
+            if (p_masks[block] & (1UL << (DEEP_SLEEP_RAM_RETENTION_Pos + section)))
+            {
+                bytes += size;
+            }
+        }
+    }
+    return bytes;
+}
+
+
+uint32_t deep_sleep_current_na(uint32_t retained_bytes)
+{
+    return DEEP_SLEEP_OFF_NA + (retained_bytes / RAM_SMALL_SECTION) * DEEP_SLEEP_RETENTION_NA;
+}
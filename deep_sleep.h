@@ -0,0 +1,99 @@
+/** @file
+ *
+ * @defgroup deep_sleep System OFF state
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief State kept in retained RAM across System OFF, the RAM sections it needs and the sleep
+ *        current that costs.
+ *
+ * @details System OFF loses everything but the RAM sections whose retention bit is set, and the
+ *          wake up is a reset. The state block is sealed with a checksum before System OFF, a
+ *          boot only trusts it if the seal holds, so a power on reset or a block written by
+ *          another firmware is never taken for a wake up.
+ *
+ *          The RAM map is the one of the nRF52840: RAM0 to RAM7 with two 4 kB sections each
+ *          from 0x20000000, then RAM8 with six 32 kB sections. The sleep current is the
+ *          product specification typical figure at 3 V, System OFF with the LPCOMP armed as
+ *          wake up source, plus the retention current of every retained section.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef DEEP_SLEEP_H__
+#define DEEP_SLEEP_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lpcomp_cal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEEP_SLEEP_MAGIC                0x0FF5EE90UL        /**< First word of a sealed state block. */
+#define DEEP_SLEEP_RESETREAS_LPCOMP     (1UL << 17)         /**< RESETREAS bit of a wake up from System OFF by the LPCOMP. */
+#define DEEP_SLEEP_TIME_NONE            UINT32_MAX          /**< Wake up time that was not measured. */
+#define DEEP_SLEEP_RAM_BLOCKS           9                   /**< RAM blocks with a POWER register. */
+#define DEEP_SLEEP_RAM_RETENTION_Pos    16                  /**< Bit of section 0 retention in RAM[n].POWER. */
+#define DEEP_SLEEP_OFF_NA               860                 /**< System OFF, LPCOMP wake up, no RAM retained. */
+#define DEEP_SLEEP_RETENTION_NA         23                  /**< Retention of one 4 kB of RAM. */
+
+/**@brief State block. */
+typedef struct
+{
+    uint32_t            magic;
+    uint32_t            sleeps;                             /**< System OFF entries since the block was created. */
+    uint32_t            wakes;                              /**< LPCOMP wake ups that found the block. */
+    lpcomp_cal_result_t lpcomp_cal;                         /**< Reference and hysteresis in use, the wake up starts with them. */
+    uint8_t             status;                             /**< Status byte on air at System OFF, the change counter goes on from it. */
+    uint8_t             reserved[3];
+    uint32_t            edge_us;                            /**< Last wake up: main() to the first LPCOMP edge, DEEP_SLEEP_TIME_NONE without one. */
+    uint32_t            adv_us;                             /**< Last wake up: main() to the first advertising event. */
+    uint32_t            check;                              /**< Checksum of everything above. */
+} deep_sleep_state_t;
+
+/**@brief Function for initializing a new, unsealed state block.
+ *
+ * @param[in] p_cal  Calibration in use.
+ */
+void deep_sleep_state_init(deep_sleep_state_t * p_state, lpcomp_cal_result_t const * p_cal);
+
+/**@brief Function for sealing a state block, call it last before System OFF. */
+void deep_sleep_state_seal(deep_sleep_state_t * p_state);
+
+/**@brief Function for checking the seal of a state block.
+ *
+ * @details The seal is broken on success, so the block is only taken once per System OFF.
+ *
+ * @retval true   The block was sealed, its contents are valid.
+ * @retval false  Power on reset, or the block was never sealed.
+ */
+bool deep_sleep_state_take(deep_sleep_state_t * p_state);
+
+/**@brief Function for finding the RAM sections that hold a range of memory.
+ *
+ * @param[in]  address  Start of the range.
+ * @param[in]  len      Length of the range.
+ * @param[out] p_masks  Retention bits to set in RAM[n].POWER, one word per RAM block. Bits
+ *                      already set are kept, so several ranges can be added up.
+ *
+ * @return Bytes of RAM those sections hold, retained in System OFF.
+ */
+uint32_t deep_sleep_retention(uint32_t address, uint32_t len, uint32_t p_masks[DEEP_SLEEP_RAM_BLOCKS]);
+
+/**@brief Function for getting the bytes of RAM a set of retention bits keeps. */
+uint32_t deep_sleep_retained_bytes(uint32_t const p_masks[DEEP_SLEEP_RAM_BLOCKS]);
+
+/**@brief Function for estimating the System OFF current, in nA.
+ *
+ * @param[in] retained_bytes  RAM retained, from deep_sleep_retained_bytes().
+ */
+uint32_t deep_sleep_current_na(uint32_t retained_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEEP_SLEEP_H__
+
+/** @} */
@@ -0,0 +1,114 @@
+/** @file
+ *
+ * @brief Edge decoder implementation.
+ */
+#include <stddef.h>
+
+#include "edge_decoder.h"
+
+
+static void evt_send(edge_decoder_t * p_decoder,
+                     edge_decoder_evt_type_t type,
+                     uint32_t timestamp,
+                     uint32_t duration)
+{
+    edge_decoder_evt_t evt =
+    {
+        .type      = type,
+        .timestamp = timestamp,
+        .duration  = duration
+    };
+
+    p_decoder->evt_handler(&evt, p_decoder->p_context);
+}
+
+
+static void tone_end(edge_decoder_t * p_decoder)
+{
+    p_decoder->tone_on   = false;
+    p_decoder->end_valid = true;
+    p_decoder->last_end  = p_decoder->last_edge;
+
+    evt_send(p_decoder,
+             EDGE_DECODER_EVT_TONE_OFF,
+             p_decoder->last_edge,
+             p_decoder->last_edge - p_decoder->tone_start);
+}
+
+
+static bool tone_quiet(edge_decoder_t const * p_decoder, uint32_t now)
+{
+    // A time before the last edge is no time passed, not a wrapped gap.
+    return p_decoder->tone_on &&
+           !p_decoder->level &&
+           ((int32_t)(now - p_decoder->last_edge) >= (int32_t)p_decoder->gap_us);
+}
+
+
+void edge_decoder_init(edge_decoder_t *           p_decoder,
+                       uint32_t                   gap_us,
+                       edge_decoder_evt_handler_t evt_handler,
+                       void *                     p_context)
+{
+    *p_decoder = (edge_decoder_t)
+    {
+        .evt_handler = evt_handler,
+        .p_context   = p_context,
+        .gap_us      = gap_us
+    };
+}
+
+
+void edge_decoder_feed(edge_decoder_t * p_decoder, uint32_t timestamp, bool up)
+{
+    // An edge stamped before the last one came out of order: no time has passed since it.
+    if ((p_decoder->tone_on || p_decoder->end_valid) && ((int32_t)(timestamp - p_decoder->last_edge) < 0))
+    {
+        timestamp = p_decoder->last_edge;
+    }
+
+    if (tone_quiet(p_decoder, timestamp))
+    {
+        tone_end(p_decoder);
+    }
+
+    if (!p_decoder->tone_on)
+    {
+        p_decoder->tone_on    = true;
+        p_decoder->tone_start = timestamp;
+
+        evt_send(p_decoder,
+                 EDGE_DECODER_EVT_TONE_ON,
+                 timestamp,
+                 p_decoder->end_valid ? (timestamp - p_decoder->last_end)
+                                      : EDGE_DECODER_DURATION_UNKNOWN);
+    }
+
+    p_decoder->last_edge = timestamp;
+    p_decoder->level     = up;
+}
+
+
+void edge_decoder_poll(edge_decoder_t * p_decoder, uint32_t now)
+{
+    if (tone_quiet(p_decoder, now))
+    {
+        tone_end(p_decoder);
+    }
+}
+
+
+void edge_decoder_timebase_break(edge_decoder_t * p_decoder, uint32_t now)
+{
+    if (p_decoder->tone_on && !p_decoder->level)
+    {
+        tone_end(p_decoder);
+    }
+
+    if (!p_decoder->tone_on && p_decoder->end_valid)
+    {
+        evt_send(p_decoder, EDGE_DECODER_EVT_SILENCE, now, now - p_decoder->last_end);
+    }
+
+    p_decoder->end_valid = false;
+}
@@ -0,0 +1,104 @@
+/** @file
+ *
+ * @defgroup edge_decoder Edge decoder
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Turns LPCOMP edge timestamps into tone on/off intervals.
+ *
+ * @details Edges closer together than the configured gap belong to the same tone, so both
+ *          a raw 3 kHz horn signal and an envelope (one UP and one DOWN per tone) decode to one
+ *          tone. A tone ends on its last DOWN edge once no edge has followed for the gap time.
+ *
+ *          All times are microseconds of a free-running 32-bit timer, differences wrap.
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef EDGE_DECODER_H__
+#define EDGE_DECODER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EDGE_DECODER_DEFAULT_GAP_US     20000               /**< Default gap that ends a tone (20 ms). */
+#define EDGE_DECODER_DURATION_UNKNOWN   UINT32_MAX          /**< Duration of an interval whose start was not seen. */
+
+/**@brief Decoder event types. */
+typedef enum
+{
+    EDGE_DECODER_EVT_TONE_ON,                               /**< A tone started, duration is the preceding off time. */
+    EDGE_DECODER_EVT_TONE_OFF,                              /**< A tone ended, duration is its on time. */
+    EDGE_DECODER_EVT_SILENCE                                /**< The timebase stopped, duration is the off time so far. */
+} edge_decoder_evt_type_t;
+
+/**@brief Decoder event. */
+typedef struct
+{
+    edge_decoder_evt_type_t type;
+    uint32_t                timestamp;                      /**< Time of the tone start or end. */
+    uint32_t                duration;                       /**< Length of the interval that just finished, or EDGE_DECODER_DURATION_UNKNOWN. */
+} edge_decoder_evt_t;
+
+/**@brief Decoder event handler type. */
+typedef void (*edge_decoder_evt_handler_t)(edge_decoder_evt_t const * p_evt, void * p_context);
+
+/**@brief Decoder instance. */
+typedef struct
+{
+    edge_decoder_evt_handler_t evt_handler;
+    void *                     p_context;
+    uint32_t                   gap_us;
+    bool                       tone_on;                     /**< A tone is in progress. */
+    bool                       level;                       /**< Direction of the last edge, true for UP. */
+    bool                       end_valid;                   /**< last_end holds the end of the previous tone. */
+    uint32_t                   tone_start;
+    uint32_t                   last_edge;
+    uint32_t                   last_end;
+} edge_decoder_t;
+
+/**@brief Function for initializing a decoder.
+ *
+ * @param[out] p_decoder    Decoder instance.
+ * @param[in]  gap_us       Silence after a DOWN edge that ends a tone.
+ * @param[in]  evt_handler  Handler called for every tone start and end.
+ * @param[in]  p_context    Passed to @p evt_handler.
+ */
+void edge_decoder_init(edge_decoder_t *           p_decoder,
+                       uint32_t                   gap_us,
+                       edge_decoder_evt_handler_t evt_handler,
+                       void *                     p_context);
+
+/**@brief Function for feeding one edge into the decoder. Edges should come in timestamp order.
+ *
+ * @details An edge stamped before the one fed last counts as at the same time, so a late edge
+ *          never looks like a gap of almost the whole timer range.
+ *
+ * @param[in] timestamp  Edge time.
+ * @param[in] up         True for a rising edge.
+ */
+void edge_decoder_feed(edge_decoder_t * p_decoder, uint32_t timestamp, bool up);
+
+/**@brief Function for ending a tone when no edge has arrived for the gap time.
+ *
+ * @param[in] now  Current time on the same timebase as the edges.
+ */
+void edge_decoder_poll(edge_decoder_t * p_decoder, uint32_t now);
+
+/**@brief Function for telling the decoder that the timebase stopped.
+ *
+ * @details Ends a tone that has gone quiet, reports the off time so far with
+ *          EDGE_DECODER_EVT_SILENCE and marks the next off time as unknown.
+ *
+ * @param[in] now  Time at which the timebase stopped.
+ */
+void edge_decoder_timebase_break(edge_decoder_t * p_decoder, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EDGE_DECODER_H__
+
+/** @} */
@@ -0,0 +1,109 @@
+/** @file
+ *
+ * @defgroup edge_ring Edge timestamp ring
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Lock-free single-producer/single-consumer ring of LPCOMP edge timestamps.
+ *
+ * @details The LPCOMP interrupt is the only producer and the main loop is the only consumer.
+ *          The producer only writes @ref edge_ring_t::head and the consumer only writes
+ *          @ref edge_ring_t::tail, so no critical region is needed on a single core. When the
+ *          ring is full the new edge is dropped and @ref edge_ring_t::overflows is incremented.
+ *
+ *          This header has no SDK dependencies and compiles on the host.
+ */
+#ifndef EDGE_RING_H__
+#define EDGE_RING_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef EDGE_RING_SIZE
+#define EDGE_RING_SIZE          64                              /**< Number of entries in the ring, must be a power of two. */
+#endif
+
+#if (EDGE_RING_SIZE & (EDGE_RING_SIZE - 1)) != 0
+#error "EDGE_RING_SIZE must be a power of two."
+#endif
+
+#ifndef EDGE_RING_BARRIER
+#define EDGE_RING_BARRIER()     __asm__ volatile ("" ::: "memory") /**< Keeps the entry store ahead of the index store. */
+#endif
+
+/**@brief Edge direction. */
+typedef enum
+{
+    EDGE_RING_EDGE_DOWN = 0,                                    /**< LPCOMP EVENTS_DOWN. */
+    EDGE_RING_EDGE_UP   = 1                                     /**< LPCOMP EVENTS_UP. */
+} edge_ring_edge_t;
+
+/**@brief One captured edge. */
+typedef struct
+{
+    uint32_t timestamp;                                         /**< Capture timer value, in microseconds. */
+    uint32_t edge;                                              /**< @ref edge_ring_edge_t. */
+} edge_ring_entry_t;
+
+/**@brief Ring state. Zero-initialise before use. */
+typedef struct
+{
+    edge_ring_entry_t buffer[EDGE_RING_SIZE];
+    volatile uint32_t head;                                     /**< Free-running write index, producer only. */
+    volatile uint32_t tail;                                     /**< Free-running read index, consumer only. */
+    volatile uint32_t overflows;                                /**< Edges dropped because the ring was full. */
+} edge_ring_t;
+
+/**@brief Function for adding an edge to the ring (producer side).
+ *
+ * @return False if the ring was full and the edge was dropped.
+ */
+static inline bool edge_ring_push(edge_ring_t * p_ring, uint32_t timestamp, uint32_t edge)
+{
+    uint32_t head = p_ring->head;
+
+    if ((head - p_ring->tail) >= EDGE_RING_SIZE)
+    {
+        p_ring->overflows++;
+        return false;
+    }
+
+    p_ring->buffer[head & (EDGE_RING_SIZE - 1)].timestamp = timestamp;
+    p_ring->buffer[head & (EDGE_RING_SIZE - 1)].edge      = edge;
+    EDGE_RING_BARRIER();
+    p_ring->head = head + 1;
+
+    return true;
+}
+
+/**@brief Function for taking the oldest edge from the ring (consumer side).
+ *
+ * @return False if the ring was empty.
+ */
+static inline bool edge_ring_pop(edge_ring_t * p_ring, edge_ring_entry_t * p_entry)
+{
+    uint32_t tail = p_ring->tail;
+
+    if (tail == p_ring->head)
+    {
+        return false;
+    }
+
+    EDGE_RING_BARRIER();
+    *p_entry = p_ring->buffer[tail & (EDGE_RING_SIZE - 1)];
+    EDGE_RING_BARRIER();
+    p_ring->tail = tail + 1;
+
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EDGE_RING_H__
+
+/** @} */
@@ -0,0 +1,102 @@
+/** @file
+ *
+ * @brief Energy accounting implementation.
+ */
+#include "energy_meter.h"
+
+
+/**@brief Function for getting the charge of a current over a time, in nC.
+ *
+ * @details Whole seconds and the rest are taken apart, so a year of ticks at a few mA stays
+ *          far inside 64 bits.
+ */
+static uint64_t charge_nc(uint64_t ticks, uint32_t tick_hz, uint32_t current_na)
+{
+    return (ticks / tick_hz) * current_na + ((ticks % tick_hz) * current_na) / tick_hz;
+}
+
+
+void energy_meter_init(energy_meter_t * p_meter, uint32_t tick_hz)
+{
+    *p_meter         = (energy_meter_t) {0};
+    p_meter->tick_hz = tick_hz;
+}
+
+
+void energy_meter_time_add(energy_meter_t * p_meter, energy_meter_state_t state, uint32_t ticks)
+{
+    p_meter->ticks[state] += ticks;
+}
+
+
+void energy_meter_event_add(energy_meter_t * p_meter, energy_meter_event_t event, uint32_t charge_nc)
+{
+    p_meter->count[event]++;
+    p_meter->charge_nc[event] += charge_nc;
+}
+
+
+uint32_t energy_meter_ms(energy_meter_t const * p_meter, energy_meter_state_t state)
+{
+    uint64_t ms = (p_meter->ticks[state] * 1000) / p_meter->tick_hz;
+
+    return (ms > UINT32_MAX) ? UINT32_MAX : (uint32_t)ms;
+}
+
+
+uint64_t energy_meter_state_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                               energy_meter_state_t state)
+{
+    return charge_nc(p_meter->ticks[state], p_meter->tick_hz, p_model->state_na[state]);
+}
+
+
+uint64_t energy_meter_event_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                               energy_meter_event_t event)
+{
+    return (uint64_t)p_meter->count[event] * p_model->event_nc[event] + p_meter->charge_nc[event];
+}
+
+
+uint64_t energy_meter_base_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                              uint64_t uptime_ticks)
+{
+    return charge_nc(uptime_ticks, p_meter->tick_hz, p_model->base_na);
+}
+
+
+uint64_t energy_meter_total_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                               uint64_t uptime_ticks)
+{
+    uint64_t total = energy_meter_base_nc(p_meter, p_model, uptime_ticks);
+
+    for (uint32_t state = 0; state < ENERGY_METER_STATES; state++)
+    {
+        total += energy_meter_state_nc(p_meter, p_model, (energy_meter_state_t)state);
+    }
+    for (uint32_t event = 0; event < ENERGY_METER_EVENTS; event++)
+    {
+        total += energy_meter_event_nc(p_meter, p_model, (energy_meter_event_t)event);
+    }
+    return total;
+}
+
+
+uint32_t energy_meter_mean_na(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                              uint64_t uptime_ticks)
+{
+    uint64_t total = energy_meter_total_nc(p_meter, p_model, uptime_ticks);
+
+    if (uptime_ticks < p_meter->tick_hz)
+    {
+        return 0;
+    }
+    // nC per second is nA.
+    return (uint32_t)(total / (uptime_ticks / p_meter->tick_hz));
+}
+
+
+uint64_t energy_meter_uj(uint64_t charge_nc)
+{
+    return (charge_nc * ENERGY_METER_SUPPLY_MV) / 1000000;
+}
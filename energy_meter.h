@@ -0,0 +1,148 @@
+/** @file
+ *
+ * @defgroup energy_meter Energy accounting
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Time in state and event counters per subsystem, and the charge and energy they add up
+ *        to with a current model.
+ *
+ * @details The firmware only counts: ticks of a time base spent in each state, and events with
+ *          the charge that varies per event, e.g. the TX power of a radio event. The model turns
+ *          the counts into charge: a base current over the whole uptime, an extra current for
+ *          each state on top of it, and a fixed charge per event. The model can be changed
+ *          after the fact, the counts stay valid.
+ *
+ *          The default model takes the nRF52840 product specification typical figures with the
+ *          DC/DC converter at 3 V. It is a starting point; replace the figures with ones
+ *          measured on the board before ranking fixes by them.
+ *
+ *          Each state and each event must only be written from one context; reading them from
+ *          another one may see a half updated count, which is fine for a report.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef ENERGY_METER_H__
+#define ENERGY_METER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENERGY_METER_SUPPLY_MV          3000                /**< Supply the model currents are given for. */
+
+/**@brief States with a time counter. */
+typedef enum
+{
+    ENERGY_METER_CPU,                                       /**< Main loop running, outside nrf_pwr_mgmt_run(). */
+    ENERGY_METER_SLEEP,                                     /**< Inside nrf_pwr_mgmt_run(), interrupts and SoftDevice included. */
+    ENERGY_METER_HFCLK,                                     /**< Burst window running, HFCLK requested. */
+    ENERGY_METER_UART,                                      /**< Log backend sending on the UART. */
+    ENERGY_METER_STATES
+} energy_meter_state_t;
+
+/**@brief Events with a counter. */
+typedef enum
+{
+    ENERGY_METER_RADIO,                                     /**< Radio event. */
+    ENERGY_METER_FE_ISR,                                    /**< LPCOMP or SAADC interrupt. */
+    ENERGY_METER_TIMER_ISR,                                 /**< Burst window interrupt. */
+    ENERGY_METER_EVENTS
+} energy_meter_event_t;
+
+/**@brief Current model. */
+typedef struct
+{
+    uint32_t base_na;                                       /**< Drawn all the time. */
+    uint32_t state_na[ENERGY_METER_STATES];                 /**< Drawn on top of the base while in a state. */
+    uint32_t event_nc[ENERGY_METER_EVENTS];                 /**< Fixed charge of one event, on top of the charge counted with it. */
+} energy_meter_model_t;
+
+/**@brief Default model, nRF52840 with the DC/DC converter at 3 V:
+ *        - base: System ON idle with RTC and all RAM retained, plus the LPCOMP, 3.5 uA.
+ *        - CPU running from flash with the cache on, 3.3 mA.
+ *        - burst window: HFINT and a 1 MHz TIMER, 0.4 mA.
+ *        - UART: UARTE sending at 115200 baud, 0.5 mA, the CPU waiting on it is the CPU state.
+ *        - radio event: HFXO start-up and SoftDevice processing around the packets, 3 uC. The
+ *          packets themselves are counted with the event, at the current of their TX power.
+ *        - interrupt: wake up and a short handler, 15 us of CPU, 50 nC.
+ */
+#define ENERGY_METER_DEFAULT_MODEL                          \
+{                                                           \
+    .base_na  = 3500,                                       \
+    .state_na =                                             \
+    {                                                       \
+        [ENERGY_METER_CPU]   = 3300000,                     \
+        [ENERGY_METER_SLEEP] = 0,                           \
+        [ENERGY_METER_HFCLK] = 400000,                      \
+        [ENERGY_METER_UART]  = 500000                       \
+    },                                                      \
+    .event_nc =                                             \
+    {                                                       \
+        [ENERGY_METER_RADIO]     = 3000,                    \
+        [ENERGY_METER_FE_ISR]    = 50,                      \
+        [ENERGY_METER_TIMER_ISR] = 50                       \
+    }                                                       \
+}
+
+/**@brief Counters. Initialise with energy_meter_init(). */
+typedef struct
+{
+    uint32_t tick_hz;                                       /**< Ticks of the time base per second. */
+    uint64_t ticks[ENERGY_METER_STATES];                    /**< Time in each state. */
+    uint32_t count[ENERGY_METER_EVENTS];                    /**< Events of each type. */
+    uint64_t charge_nc[ENERGY_METER_EVENTS];                /**< Charge counted with the events. */
+} energy_meter_t;
+
+/**@brief Function for initializing the counters.
+ *
+ * @param[in] tick_hz  Frequency of the time base, 32768 for RTC1.
+ */
+void energy_meter_init(energy_meter_t * p_meter, uint32_t tick_hz);
+
+/**@brief Function for adding time to a state. */
+void energy_meter_time_add(energy_meter_t * p_meter, energy_meter_state_t state, uint32_t ticks);
+
+/**@brief Function for counting an event.
+ *
+ * @param[in] charge_nc  Charge of this event on top of the fixed charge of the model, 0 for none.
+ */
+void energy_meter_event_add(energy_meter_t * p_meter, energy_meter_event_t event, uint32_t charge_nc);
+
+/**@brief Function for getting the time spent in a state, in ms, saturates after 49 days. */
+uint32_t energy_meter_ms(energy_meter_t const * p_meter, energy_meter_state_t state);
+
+/**@brief Function for getting the charge a state added on top of the base, in nC. */
+uint64_t energy_meter_state_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                               energy_meter_state_t state);
+
+/**@brief Function for getting the charge of all events of a type, in nC. */
+uint64_t energy_meter_event_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                               energy_meter_event_t event);
+
+/**@brief Function for getting the charge of the base current, in nC.
+ *
+ * @param[in] uptime_ticks  Time since the counters started, in ticks of the time base.
+ */
+uint64_t energy_meter_base_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                              uint64_t uptime_ticks);
+
+/**@brief Function for getting the whole charge, base, states and events, in nC. */
+uint64_t energy_meter_total_nc(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                               uint64_t uptime_ticks);
+
+/**@brief Function for getting the mean current over the uptime, in nA. */
+uint32_t energy_meter_mean_na(energy_meter_t const * p_meter, energy_meter_model_t const * p_model,
+                              uint64_t uptime_ticks);
+
+/**@brief Function for converting a charge to energy at ENERGY_METER_SUPPLY_MV, in uJ. */
+uint64_t energy_meter_uj(uint64_t charge_nc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENERGY_METER_H__
+
+/** @} */
@@ -0,0 +1,117 @@
+/** @file
+ *
+ * @brief Detection event log implementation.
+ */
+#include <stddef.h>
+
+#include "event_log.h"
+
+
+void event_log_init(event_log_t * p_log)
+{
+    p_log->magic      = EVENT_LOG_MAGIC;
+    p_log->next       = 0;
+    p_log->next_check = UINT32_MAX;
+}
+
+
+bool event_log_valid(event_log_t const * p_log)
+{
+    return (p_log->magic == EVENT_LOG_MAGIC) && (p_log->next_check == ~p_log->next);
+}
+
+
+void event_log_add(event_log_t * p_log, uint32_t time_s, uint8_t type, uint8_t arg8, uint16_t arg16)
+{
+    event_log_record_t * p_record = &p_log->records[p_log->next & (EVENT_LOG_CAPACITY - 1)];
+
+    p_record->time_s = time_s;
+    p_record->type   = type;
+    p_record->arg8   = arg8;
+    p_record->arg16  = arg16;
+    p_log->next++;
+    p_log->next_check = ~p_log->next;
+}
+
+
+uint32_t event_log_first(event_log_t const * p_log)
+{
+    return (p_log->next > EVENT_LOG_CAPACITY) ? (p_log->next - EVENT_LOG_CAPACITY) : 0;
+}
+
+
+uint32_t event_log_next(event_log_t const * p_log)
+{
+    return p_log->next;
+}
+
+
+static void put_u32(uint8_t * p_buf, uint32_t value)
+{
+    p_buf[0] = (uint8_t)value;
+    p_buf[1] = (uint8_t)(value >> 8);
+    p_buf[2] = (uint8_t)(value >> 16);
+    p_buf[3] = (uint8_t)(value >> 24);
+}
+
+
+static uint32_t get_u32(uint8_t const * p_buf)
+{
+    return (uint32_t)p_buf[0] | ((uint32_t)p_buf[1] << 8) | ((uint32_t)p_buf[2] << 16) | ((uint32_t)p_buf[3] << 24);
+}
+
+
+uint32_t event_log_read(event_log_t const * p_log, uint32_t * p_seq, uint8_t * p_buf, uint32_t size)
+{
+    uint32_t seq   = *p_seq;
+    uint32_t first = event_log_first(p_log);
+    uint32_t len   = EVENT_LOG_HEADER_LEN;
+
+    // Gone already, or ahead of the log after a restart: start at the oldest event held.
+    if ((seq < first) || (seq > p_log->next))
+    {
+        seq = first;
+    }
+    put_u32(p_buf, seq);
+
+    while ((seq != p_log->next) && (len + EVENT_LOG_RECORD_LEN <= size))
+    {
+        event_log_record_t const * p_record = &p_log->records[seq & (EVENT_LOG_CAPACITY - 1)];
+
+        put_u32(&p_buf[len], p_record->time_s);
+        p_buf[len + 4] = p_record->type;
+        p_buf[len + 5] = p_record->arg8;
+        p_buf[len + 6] = (uint8_t)p_record->arg16;
+        p_buf[len + 7] = (uint8_t)(p_record->arg16 >> 8);
+        len += EVENT_LOG_RECORD_LEN;
+        seq++;
+    }
+
+    *p_seq = seq;
+    return len;
+}
+
+
+uint32_t event_log_decode(uint8_t const * p_buf, uint32_t len, uint32_t * p_seq,
+                          event_log_record_t * p_records, uint32_t max)
+{
+    uint32_t count = 0;
+
+    if (len < EVENT_LOG_HEADER_LEN)
+    {
+        return 0;
+    }
+    *p_seq = get_u32(p_buf);
+
+    for (uint32_t offset = EVENT_LOG_HEADER_LEN;
+         (offset + EVENT_LOG_RECORD_LEN <= len) && (count < max);
+         offset += EVENT_LOG_RECORD_LEN)
+    {
+        p_records[count].time_s = get_u32(&p_buf[offset]);
+        p_records[count].type   = p_buf[offset + 4];
+        p_records[count].arg8   = p_buf[offset + 5];
+        p_records[count].arg16  = (uint16_t)(p_buf[offset + 6] | (p_buf[offset + 7] << 8));
+        count++;
+    }
+    return count;
+}
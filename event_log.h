@@ -0,0 +1,124 @@
+/** @file
+ *
+ * @defgroup event_log Detection event log
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Ring of detection events, read out in order by sequence number.
+ *
+ * @details Every event gets the next 32-bit sequence number. The ring holds the last
+ *          EVENT_LOG_CAPACITY of them, older ones are overwritten. A reader asks for the events
+ *          from a sequence number on and gets a chunk: the sequence number of its first event,
+ *          then as many whole records as fit. If the events it asked for are gone, the chunk
+ *          starts at the oldest one held, so the reader sees the gap. A reader that keeps the
+ *          next sequence number only ever downloads new events.
+ *
+ *          Chunk layout, little endian:
+ *
+ *          | Offset | Size | Field |
+ *          | --- | --- | --- |
+ *          | 0 | 4 | Sequence number of the first record |
+ *          | 4 + 8n | 4 | Record n: seconds since boot |
+ *          | 8 + 8n | 1 | Record n: type, @ref event_log_type_t |
+ *          | 9 + 8n | 1 | Record n: 8-bit argument |
+ *          | 10 + 8n | 2 | Record n: 16-bit argument |
+ *
+ *          A chunk without records means the reader is up to date.
+ *
+ *          The log can live in RAM that a reset does not clear. event_log_valid() tells a log
+ *          that survived from one that has to be initialised, so the events and their sequence
+ *          numbers go on across resets. Times start over at every boot event.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef EVENT_LOG_H__
+#define EVENT_LOG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVENT_LOG_CAPACITY              1024                /**< Events held, a power of two. */
+#define EVENT_LOG_RECORD_LEN            8                   /**< Bytes per record in a chunk. */
+#define EVENT_LOG_HEADER_LEN            4                   /**< Bytes before the first record of a chunk. */
+#define EVENT_LOG_MAGIC                 0x45564C47UL        /**< Marks an initialised log, "EVLG". */
+
+/**@brief Event types. */
+typedef enum
+{
+    EVENT_LOG_BOOT        = 1,                              /**< Started. arg8: low byte of RESETREAS, arg16: high half, the wake up sources. */
+    EVENT_LOG_ALARM_ON    = 2,                              /**< Alarm advertised. arg8: status byte. */
+    EVENT_LOG_ALARM_OFF   = 3,                              /**< Alarm status cleared. arg8: status byte. */
+    EVENT_LOG_CONFIG      = 4,                              /**< Configuration written over the air. arg8: configuration version. */
+    EVENT_LOG_CALIBRATION = 5,                              /**< LPCOMP calibration. arg8: reference level, arg16: quiet floor << 8 | hysteresis. */
+    EVENT_LOG_CONNECTED   = 6,                              /**< Configuration connection. arg16: connection handle. */
+    EVENT_LOG_BOOT_TIMES  = 7                               /**< Boot timing. arg8: ms from main() to the first edge, arg16: to the first advertising event, all ones if not seen. */
+} event_log_type_t;
+
+/**@brief Event. */
+typedef struct
+{
+    uint32_t time_s;                                        /**< Seconds since boot. */
+    uint8_t  type;
+    uint8_t  arg8;
+    uint16_t arg16;
+} event_log_record_t;
+
+/**@brief Event log. Initialise with event_log_init(). */
+typedef struct
+{
+    uint32_t           magic;                               /**< EVENT_LOG_MAGIC once initialised. */
+    uint32_t           next;                                /**< Sequence number of the next event. */
+    uint32_t           next_check;                          /**< Inverse of next, kept with it. */
+    event_log_record_t records[EVENT_LOG_CAPACITY];
+} event_log_t;
+
+/**@brief Function for initializing an empty event log. */
+void event_log_init(event_log_t * p_log);
+
+/**@brief Function for checking whether a log kept in retained RAM is still whole.
+ *
+ * @return False for RAM that was never initialised or lost its contents, such as after a
+ *         power-on reset.
+ */
+bool event_log_valid(event_log_t const * p_log);
+
+/**@brief Function for adding an event. */
+void event_log_add(event_log_t * p_log, uint32_t time_s, uint8_t type, uint8_t arg8, uint16_t arg16);
+
+/**@brief Function for getting the sequence number of the oldest event held. */
+uint32_t event_log_first(event_log_t const * p_log);
+
+/**@brief Function for getting the sequence number the next event will get. */
+uint32_t event_log_next(event_log_t const * p_log);
+
+/**@brief Function for reading a chunk.
+ *
+ * @param[in,out] p_seq   First event to read. Returns the first event of the next chunk.
+ * @param[out]    p_buf   Chunk.
+ * @param[in]     size    Room in p_buf, at least EVENT_LOG_HEADER_LEN.
+ *
+ * @return Length of the chunk, EVENT_LOG_HEADER_LEN if the reader is up to date.
+ */
+uint32_t event_log_read(event_log_t const * p_log, uint32_t * p_seq, uint8_t * p_buf, uint32_t size);
+
+/**@brief Function for decoding a chunk.
+ *
+ * @param[out] p_seq      Sequence number of the first record.
+ * @param[out] p_records  Records.
+ * @param[in]  max        Room in p_records.
+ *
+ * @return Records decoded, 0 for a chunk that is too short.
+ */
+uint32_t event_log_decode(uint8_t const * p_buf, uint32_t len, uint32_t * p_seq,
+                          event_log_record_t * p_records, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_LOG_H__
+
+/** @} */
@@ -0,0 +1,148 @@
+/** @file
+ *
+ * @brief Goertzel filter bank implementation.
+ */
+#include <math.h>
+#include <stddef.h>
+
+#include "goertzel.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "nrf.h"
+
+#define DSP_SMLAD(x, y, acc)    ((int32_t)__SMLAD((x), (y), (uint32_t)(acc)))
+#define DSP_SSAT16(x)           __SSAT((x), 16)
+#define DSP_PKHBT(lo, hi)       __PKHBT((lo), (hi), 16)
+
+#elif defined(GOERTZEL_SIMD_EMULATE)
+// Same results as the Cortex-M4 instructions.
+static inline int32_t DSP_SMLAD(uint32_t x, uint32_t y, int32_t acc)
+{
+    int32_t lo = (int32_t)(int16_t)(x & 0xFFFF) * (int16_t)(y & 0xFFFF);
+    int32_t hi = (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+
+    return (int32_t)((uint32_t)lo + (uint32_t)hi + (uint32_t)acc);
+}
+
+static inline int32_t DSP_SSAT16(int32_t x)
+{
+    return (x > INT16_MAX) ? INT16_MAX : ((x < INT16_MIN) ? INT16_MIN : x);
+}
+
+static inline uint32_t DSP_PKHBT(int32_t lo, uint32_t hi)
+{
+    return ((uint32_t)lo & 0xFFFF) | (hi << 16);
+}
+#endif
+
+#define COEF_MINUS_ONE          (-(1L << GOERTZEL_COEF_SHIFT))
+#define INPUT_SCALE             (1L << (GOERTZEL_COEF_SHIFT - GOERTZEL_INPUT_SHIFT))
+
+#define PACK(lo, hi)            (((uint32_t)(lo) & 0xFFFF) | ((uint32_t)(hi) << 16))
+#define LOW(x)                  ((int32_t)(int16_t)((x) & 0xFFFF))
+#define HIGH(x)                 ((int32_t)(int16_t)((x) >> 16))
+
+#ifndef M_PI
+#define M_PI                    3.14159265358979323846
+#endif
+
+
+static int32_t sat16(int32_t x)
+{
+    return (x > INT16_MAX) ? INT16_MAX : ((x < INT16_MIN) ? INT16_MIN : x);
+}
+
+
+void goertzel_init(goertzel_bank_t * p_bank, uint16_t const * p_bins, uint8_t count, uint16_t block_len)
+{
+    p_bank->count = (count < GOERTZEL_BINS_MAX) ? count : GOERTZEL_BINS_MAX;
+
+    for (uint32_t i = 0; i < p_bank->count; i++)
+    {
+        double  w    = 2.0 * M_PI * p_bins[i] / block_len;
+        int32_t coef = (int32_t)floor(2.0 * cos(w) * (1L << GOERTZEL_COEF_SHIFT) + 0.5);
+
+        p_bank->coef[i]  = PACK(sat16(coef), COEF_MINUS_ONE);
+        p_bank->state[i] = 0;
+    }
+}
+
+
+void goertzel_update_c(goertzel_bank_t * p_bank, int16_t const * p_samples, uint32_t count)
+{
+    for (uint32_t bin = 0; bin < p_bank->count; bin++)
+    {
+        int32_t coef = LOW(p_bank->coef[bin]);
+        int32_t s1   = LOW(p_bank->state[bin]);
+        int32_t s2   = HIGH(p_bank->state[bin]);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            int32_t acc = coef * s1 + COEF_MINUS_ONE * s2 + p_samples[i] * INPUT_SCALE;
+
+            s2 = s1;
+            s1 = sat16(acc >> GOERTZEL_COEF_SHIFT);
+        }
+
+        p_bank->state[bin] = PACK(s1, s2);
+    }
+}
+
+
+#if GOERTZEL_HAS_SIMD
+void goertzel_update_simd(goertzel_bank_t * p_bank, int16_t const * p_samples, uint32_t count)
+{
+    for (uint32_t bin = 0; bin < p_bank->count; bin++)
+    {
+        uint32_t coef  = p_bank->coef[bin];
+        uint32_t state = p_bank->state[bin];
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            // c * s[n-1] + (-1) * s[n-2] + x[n], all in Q14
+            int32_t acc = DSP_SMLAD(coef, state, p_samples[i] * INPUT_SCALE);
+
+            state = DSP_PKHBT(DSP_SSAT16(acc >> GOERTZEL_COEF_SHIFT), state);
+        }
+
+        p_bank->state[bin] = state;
+    }
+}
+#endif
+
+
+void goertzel_power(goertzel_bank_t * p_bank, uint32_t * p_power)
+{
+    for (uint32_t bin = 0; bin < p_bank->count; bin++)
+    {
+        int64_t coef  = LOW(p_bank->coef[bin]);
+        int64_t s1    = LOW(p_bank->state[bin]);
+        int64_t s2    = HIGH(p_bank->state[bin]);
+        int64_t power = s1 * s1 + s2 * s2 - ((coef * s1 * s2) >> GOERTZEL_COEF_SHIFT);
+
+        p_power[bin]       = (power < 0) ? 0 : ((power > UINT32_MAX) ? UINT32_MAX : (uint32_t)power);
+        p_bank->state[bin] = 0;
+    }
+}
+
+
+bool goertzel_decide(goertzel_decision_t const * p_decision, uint32_t const * p_power, uint8_t count)
+{
+    uint32_t target = 0;
+    uint32_t guard  = 0;
+
+    for (uint32_t bin = 0; bin < count; bin++)
+    {
+        if (p_decision->target_mask & (1UL << bin))
+        {
+            target = (p_power[bin] > target) ? p_power[bin] : target;
+        }
+        else
+        {
+            guard = (p_power[bin] > guard) ? p_power[bin] : guard;
+        }
+    }
+
+    return (target >= p_decision->min_power) &&
+           ((uint64_t)target >= (uint64_t)guard * p_decision->guard_ratio);
+}
@@ -0,0 +1,125 @@
+/** @file
+ *
+ * @defgroup goertzel Goertzel filter bank
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Fixed-point Goertzel filter bank for the SAADC tone front end (USE_SAADC_GOERTZEL).
+ *
+ * @details Each bin runs the recursion s[n] = x[n] + c * s[n-1] - s[n-2] with c = 2cos(2*pi*k/N)
+ *          in Q14 and a saturated 16-bit state. The state pair (s[n-1], s[n-2]) is kept packed
+ *          in one word, so on a Cortex-M4 every sample and bin is a single SMLAD (c * s[n-1] and
+ *          -1 * s[n-2] in one dual multiply-accumulate), a shift and an SSAT. The portable C
+ *          kernel goertzel_update_c() computes the same result with plain 32-bit arithmetic and
+ *          is bit-exact with the SIMD kernel for every int16_t input.
+ *
+ *          The SIMD kernel is built when the compiler targets the DSP extension
+ *          (__ARM_FEATURE_DSP). Defining GOERTZEL_SIMD_EMULATE builds it on other targets with
+ *          C versions of the intrinsics, which is how host/goertzel_check.c compares the two.
+ *
+ *          This module has no SDK dependencies on the host.
+ */
+#ifndef GOERTZEL_H__
+#define GOERTZEL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)) || defined(GOERTZEL_SIMD_EMULATE)
+#define GOERTZEL_HAS_SIMD               1
+#else
+#define GOERTZEL_HAS_SIMD               0
+#endif
+
+#define GOERTZEL_BINS_MAX               8                   /**< Maximum number of bins in a bank. */
+#define GOERTZEL_COEF_SHIFT             14                  /**< Coefficients are Q14, 2cos() needs the range [-2, 2). */
+#define GOERTZEL_INPUT_SHIFT            3                   /**< Samples are scaled down by 2^3 so a full block of a full-scale 12-bit tone fits the 16-bit state. */
+
+/**@brief Smoke alarm horn bank: 15625 Hz sampling (1 MHz / 64), 125 samples (8 ms) per block, 125 Hz bins. */
+#define GOERTZEL_HORN_SAMPLE_RATE_HZ    15625
+#define GOERTZEL_HORN_BLOCK_LEN         125
+#define GOERTZEL_HORN_BLOCK_US          8000
+
+/**@brief Horn bins 3000 to 3500 Hz, with guard bins at 2000 and 4500 Hz to reject broadband sound. */
+#define GOERTZEL_HORN_BINS              { 24, 25, 26, 27, 28, 16, 36 }
+#define GOERTZEL_HORN_TARGET_MASK       0x1F                /**< Bins 0-4 are horn frequencies, the rest are guards. */
+#define GOERTZEL_HORN_MIN_POWER         200000              /**< About a 60 LSB (12-bit) tone amplitude. */
+#define GOERTZEL_HORN_GUARD_RATIO       8                   /**< The strongest horn bin must exceed every guard bin by 9 dB. */
+
+/**@brief Filter bank. Initialise with goertzel_init(). */
+typedef struct
+{
+    uint8_t  count;                                         /**< Number of bins. */
+    uint32_t coef[GOERTZEL_BINS_MAX];                       /**< Packed (c, -1) per bin, Q14. */
+    uint32_t state[GOERTZEL_BINS_MAX];                      /**< Packed (s[n-1], s[n-2]) per bin. */
+} goertzel_bank_t;
+
+/**@brief Tone decision thresholds. */
+typedef struct
+{
+    uint32_t target_mask;                                   /**< Bins that belong to the tone, all other bins are guards. */
+    uint32_t min_power;                                     /**< Minimum power of the strongest target bin. */
+    uint32_t guard_ratio;                                   /**< Minimum ratio of the strongest target bin to the strongest guard bin. */
+} goertzel_decision_t;
+
+/**@brief Default horn decision thresholds. */
+#define GOERTZEL_HORN_DECISION                              \
+{                                                           \
+    .target_mask = GOERTZEL_HORN_TARGET_MASK,               \
+    .min_power   = GOERTZEL_HORN_MIN_POWER,                 \
+    .guard_ratio = GOERTZEL_HORN_GUARD_RATIO                \
+}
+
+/**@brief Function for initializing a filter bank.
+ *
+ * @param[out] p_bank     Filter bank.
+ * @param[in]  p_bins     Bin index k of every bin, the bin frequency is k * sample rate / block_len.
+ * @param[in]  count      Number of bins, at most GOERTZEL_BINS_MAX.
+ * @param[in]  block_len  Samples per block (N).
+ */
+void goertzel_init(goertzel_bank_t * p_bank, uint16_t const * p_bins, uint8_t count, uint16_t block_len);
+
+/**@brief Function for running samples through every bin, portable C kernel. */
+void goertzel_update_c(goertzel_bank_t * p_bank, int16_t const * p_samples, uint32_t count);
+
+#if GOERTZEL_HAS_SIMD
+/**@brief Function for running samples through every bin, SMLAD kernel. */
+void goertzel_update_simd(goertzel_bank_t * p_bank, int16_t const * p_samples, uint32_t count);
+#endif
+
+/**@brief Function for running samples through every bin with the fastest kernel available. */
+static inline void goertzel_update(goertzel_bank_t * p_bank, int16_t const * p_samples, uint32_t count)
+{
+#if GOERTZEL_HAS_SIMD
+    goertzel_update_simd(p_bank, p_samples, count);
+#else
+    goertzel_update_c(p_bank, p_samples, count);
+#endif
+}
+
+/**@brief Function for ending a block.
+ *
+ * @details Computes s1^2 + s2^2 - c*s1*s2 for every bin and clears the state for the next block.
+ *
+ * @param[out] p_power  Power of every bin, saturated to 32 bits.
+ */
+void goertzel_power(goertzel_bank_t * p_bank, uint32_t * p_power);
+
+/**@brief Function for deciding whether a block holds the tone.
+ *
+ * @param[in] p_decision  Thresholds.
+ * @param[in] p_power     Powers from goertzel_power().
+ * @param[in] count       Number of bins.
+ */
+bool goertzel_decide(goertzel_decision_t const * p_decision, uint32_t const * p_power, uint8_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GOERTZEL_H__
+
+/** @} */
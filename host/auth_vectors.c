@@ -0,0 +1,317 @@
+/** @file
+ *
+ * @brief Host reference of the authenticated advertising frames (adv_auth.c).
+ *
+ * @details Runs adv_auth.c with a software AES-128 in place of the SoftDevice ECB:
+ *          - Checks the AES-128 against the FIPS-197 appendix C.1 vector.
+ *          - Prints the hash words and test vectors: counter, status, keystream word and tag,
+ *            signed in sequence with adv_auth_refill() and adv_auth_sign() and checked against
+ *            adv_auth_tag(), as a receiver would compute them.
+ *          - With -f checks a received frame: the 31 bytes of advertising data in hex, as a
+ *            scanner prints them. Major and minor are taken from the frame.
+ *
+ *          The default key is the test key the firmware falls back to when the UICR holds none,
+ *          and the default major/minor are those of the firmware, so the first vector is the
+ *          one the firmware checks at boot.
+ *
+ *          Options:
+ *              -k <hex>     key, 32 hex digits (default 000102030405060708090a0b0c0d0e0f)
+ *              -M <major>   major value (default 0x0102)
+ *              -m <minor>   minor value (default 0x0304)
+ *              -c <counter> first counter (default 0)
+ *              -n <count>   vectors (default 16)
+ *              -f <hex>     check a frame, 62 hex digits, instead of printing vectors
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o auth_vectors auth_vectors.c ../adv_auth.c
+ *              ./auth_vectors
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adv_auth.h"
+#include "adv_frame.h"
+
+static const uint8_t m_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static const uint8_t m_fips_key[ADV_AUTH_KEY_LEN] =
+{
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t m_fips_in[ADV_AUTH_BLOCK_LEN] =
+{
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t m_fips_out[ADV_AUTH_BLOCK_LEN] =
+{
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+
+static uint8_t xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+
+/**@brief AES-128 encryption of one block, byte oriented, as the ECB peripheral does it. */
+static bool aes128_encrypt(uint8_t const * p_key, uint8_t const * p_in, uint8_t * p_out)
+{
+    uint8_t round_key[176];
+    uint8_t s[16];
+    uint8_t rcon = 0x01;
+
+    memcpy(round_key, p_key, 16);
+    for (int i = 16; i < 176; i += 4)
+    {
+        uint8_t t[4] = { round_key[i - 4], round_key[i - 3], round_key[i - 2], round_key[i - 1] };
+
+        if ((i % 16) == 0)
+        {
+            uint8_t t0 = t[0];
+
+            t[0] = m_sbox[t[1]] ^ rcon;
+            t[1] = m_sbox[t[2]];
+            t[2] = m_sbox[t[3]];
+            t[3] = m_sbox[t0];
+            rcon = xtime(rcon);
+        }
+        for (int j = 0; j < 4; j++)
+        {
+            round_key[i + j] = round_key[i - 16 + j] ^ t[j];
+        }
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        s[i] = p_in[i] ^ round_key[i];
+    }
+    for (int round = 1; round <= 10; round++)
+    {
+        uint8_t t[16];
+
+        // SubBytes and ShiftRows, the state is column major.
+        for (int c = 0; c < 4; c++)
+        {
+            for (int r = 0; r < 4; r++)
+            {
+                t[c * 4 + r] = m_sbox[s[((c + r) % 4) * 4 + r]];
+            }
+        }
+        // MixColumns, except in the last round.
+        for (int c = 0; c < 4; c++)
+        {
+            uint8_t * p_col = &t[c * 4];
+
+            if (round != 10)
+            {
+                uint8_t all = p_col[0] ^ p_col[1] ^ p_col[2] ^ p_col[3];
+                uint8_t c0  = p_col[0];
+
+                p_col[0] ^= all ^ xtime(p_col[0] ^ p_col[1]);
+                p_col[1] ^= all ^ xtime(p_col[1] ^ p_col[2]);
+                p_col[2] ^= all ^ xtime(p_col[2] ^ p_col[3]);
+                p_col[3] ^= all ^ xtime(p_col[3] ^ c0);
+            }
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            s[i] = t[i] ^ round_key[round * 16 + i];
+        }
+    }
+
+    memcpy(p_out, s, 16);
+    return true;
+}
+
+
+static bool hex_parse(char const * p_hex, uint8_t * p_out, size_t len)
+{
+    if (strlen(p_hex) != len * 2)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int byte;
+
+        if (sscanf(&p_hex[i * 2], "%2x", &byte) != 1)
+        {
+            return false;
+        }
+        p_out[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+
+static uint32_t u32_be_get(uint8_t const * p_data)
+{
+    return ((uint32_t)p_data[0] << 24) | ((uint32_t)p_data[1] << 16) | ((uint32_t)p_data[2] << 8) | p_data[3];
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "usage: %s [-k key] [-M major] [-m minor] [-c counter] [-n count] [-f frame]\n", p_name);
+    exit(2);
+}
+
+
+/**@brief Checks a frame, returns the exit status. */
+static int frame_check(uint8_t const * p_key, char const * p_hex)
+{
+    uint8_t    frame[ADV_FRAME_LEN];
+    adv_auth_t auth;
+    uint32_t   counter;
+    uint32_t   tag;
+    uint32_t   expected;
+    uint8_t    status;
+
+    if (!hex_parse(p_hex, frame, sizeof(frame)))
+    {
+        fprintf(stderr, "frame: %u bytes of hex expected\n", ADV_FRAME_LEN);
+        return 2;
+    }
+
+    (void) adv_auth_init(&auth, aes128_encrypt, p_key, &frame[ADV_FRAME_MAJOR_OFFSET], 0, 0);
+    counter = u32_be_get(&frame[ADV_FRAME_AUTH_COUNTER_OFFSET]);
+    tag     = u32_be_get(&frame[ADV_FRAME_AUTH_TAG_OFFSET]);
+    status  = frame[ADV_FRAME_STATUS_OFFSET];
+    (void) adv_auth_tag(&auth, counter, status, &expected);
+
+    printf("major 0x%02x%02x minor 0x%02x%02x counter %" PRIu32 " status 0x%02x tag %08" PRIx32 " expected %08" PRIx32 ": %s\n",
+           frame[ADV_FRAME_MAJOR_OFFSET], frame[ADV_FRAME_MAJOR_OFFSET + 1],
+           frame[ADV_FRAME_MINOR_OFFSET], frame[ADV_FRAME_MINOR_OFFSET + 1],
+           counter, status, tag, expected, (tag == expected) ? "ok" : "FORGED");
+    return (tag == expected) ? 0 : 1;
+}
+
+
+int main(int argc, char ** argv)
+{
+    uint8_t      key[ADV_AUTH_KEY_LEN];
+    uint8_t      id[ADV_AUTH_ID_LEN];
+    uint8_t      block[ADV_AUTH_BLOCK_LEN];
+    uint32_t     major   = 0x0102;
+    uint32_t     minor   = 0x0304;
+    uint32_t     counter = 0;
+    uint32_t     count   = 16;
+    char const * p_frame = NULL;
+    adv_auth_t   auth;
+    int          failed  = 0;
+    int          opt;
+
+    memcpy(key, m_fips_key, sizeof(key));
+
+    while ((opt = getopt(argc, argv, "k:M:m:c:n:f:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'k':
+                if (!hex_parse(optarg, key, sizeof(key)))
+                {
+                    fprintf(stderr, "key: 32 hex digits expected\n");
+                    return 2;
+                }
+                break;
+            case 'M': major   = strtoul(optarg, NULL, 0); break;
+            case 'm': minor   = strtoul(optarg, NULL, 0); break;
+            case 'c': counter = strtoul(optarg, NULL, 0); break;
+            case 'n': count   = strtoul(optarg, NULL, 0); break;
+            case 'f': p_frame = optarg;                   break;
+            default:  usage(argv[0]);
+        }
+    }
+
+    (void) aes128_encrypt(m_fips_key, m_fips_in, block);
+    if (memcmp(block, m_fips_out, sizeof(block)) != 0)
+    {
+        fprintf(stderr, "AES-128: FIPS-197 C.1 vector FAILED\n");
+        return 1;
+    }
+
+    if (p_frame != NULL)
+    {
+        return frame_check(key, p_frame);
+    }
+
+    printf("AES-128 FIPS-197 C.1: ok\n");
+    printf("key ");
+    for (uint32_t i = 0; i < sizeof(key); i++)
+    {
+        printf("%02x", key[i]);
+    }
+    printf(", major 0x%04" PRIx32 ", minor 0x%04" PRIx32 "\n", major, minor);
+
+    id[0] = (uint8_t)(major >> 8);
+    id[1] = (uint8_t)major;
+    id[2] = (uint8_t)(minor >> 8);
+    id[3] = (uint8_t)minor;
+    (void) adv_auth_init(&auth, aes128_encrypt, key, id, counter, counter + count);
+
+    printf("hash words:");
+    for (uint32_t i = 0; i < ADV_AUTH_HASH_WORDS; i++)
+    {
+        printf(" %08" PRIx32, auth.hash[i]);
+    }
+    printf("\n\n%10s %6s %8s %8s  %s\n", "counter", "status", "keystr", "tag", "frame bytes 17..24");
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // Statuses as the firmware steps through them: alarm bit, change counter, patterns.
+        uint8_t  status = (uint8_t)(((i & 1) ? 0x80 : 0x00) | ((i & 0x07) << 4) | ((i & 1) ? (1 + (i / 2) % 3) : 0));
+        uint8_t  fields[ADV_AUTH_COUNTER_LEN + ADV_AUTH_TAG_LEN];
+        uint32_t keystream;
+        uint32_t tag;
+
+        (void) adv_auth_refill(&auth);
+        keystream = auth.keystream[auth.keystream_first];
+        (void) adv_auth_sign(&auth, status, &fields[0], &fields[ADV_AUTH_COUNTER_LEN]);
+        (void) adv_auth_tag(&auth, counter + i, status, &tag);
+
+        if ((u32_be_get(&fields[0]) != counter + i) || (u32_be_get(&fields[ADV_AUTH_COUNTER_LEN]) != tag))
+        {
+            failed = 1;
+        }
+        printf("%10" PRIu32 "   0x%02x %08" PRIx32 " %08" PRIx32 " ", counter + i, status, keystream, tag);
+        for (uint32_t j = 0; j < sizeof(fields); j++)
+        {
+            printf(" %02x", fields[j]);
+        }
+        printf("\n");
+    }
+
+    if (adv_auth_sign(&auth, 0, block, block))
+    {
+        printf("signed past the limit\n");
+        failed = 1;
+    }
+    printf("\nsign against tag: %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,870 @@
+/** @file
+ *
+ * @brief Host battery life simulator: an event trace, or a synthetic one, through the energy
+ *        model of every hex target.
+ *
+ * @details The trace is text, one event per line, lines starting with '#' are skipped:
+ *              <timestamp_us> U            LPCOMP rising edge
+ *              <timestamp_us> D            LPCOMP falling edge
+ *              <timestamp_us> T            burst window timer interrupt
+ *              <timestamp_us> A [dBm]      advertising event, at the TX power given or the one
+ *                                          of the alarm status at that time
+ *              <timestamp_us> S <0|1>      alarm status change
+ *              <timestamp_us> L <bytes>    log output
+ *          An edge file from tone_replay -o or blank_sim -o is a trace already.
+ *
+ *          One pass over the trace counts what does not depend on the target: edges, timer
+ *          interrupts, advertising events per TX power, log bytes and the time burst windows
+ *          keep HFCLK requested. A window starts at a rising edge and ends the inter-burst
+ *          timeout after the last one: TONE_PATTERN_SILENCE_US with the edge front end, CC2
+ *          of the tone counter with -p.
+ *
+ *          At the same time the pass runs adv_sched.c, the scheduler of the firmware, with the
+ *          S events as alarms, every event the interval plus the mean advDelay after the one
+ *          before. Its events stand in for the A events when the trace has none, or when -a or
+ *          -A changes the intervals. A trace without T events gets its timer interrupts from
+ *          the windows the same way: one per window, and with -p one more at every CC0.
+ *
+ *          The counts then fill an energy_meter_t per target, with the current model of its
+ *          chip, and the result is the mean current, mAh per day and the lifetime on a -C mAh
+ *          cell, split by subsystem. The pca10040e and pca10056e targets emulate the nRF52810
+ *          and nRF52811 on the DK; their figures are those of the chip the product would use.
+ *          The models are product specification typical figures, as in energy_meter.h, and
+ *          -I replaces the base current with a measured one.
+ *
+ *          L events count the bytes of the text log. The binary log sends a quarter of them,
+ *          at 1 Mbaud whatever -B says.
+ *
+ *          With -S the trace is a synthetic one of -S days: the duty cycle report every 10
+ *          minutes, and a -D s temporal-3 test of the alarm every -W days with its status
+ *          changes and log lines. -o writes that trace to stdout instead of simulating it, to
+ *          edit or to replay later.
+ *
+ *          Options:
+ *              -m <target> only this target: pca10040_s132, pca10040e_s112, pca10056e_s112 or
+ *                          pca10056_s140 (default all four)
+ *              -a <ms>     heartbeat interval, scheduler events (default 5000)
+ *              -A <ms>     alarm interval, scheduler events (default 20)
+ *              -t <dBm>    TX power while idle (default 0)
+ *              -T <dBm>    TX power during an alarm (default 0)
+ *              -r          RTC2 burst window (USE_RTC_BURST_TIMER), not on the s112 targets
+ *              -p          PPI tone counter (USE_PPI_TONE_COUNTER)
+ *              -l <name>   log backend: uart, rtt, binary (USE_LOG_BINARY) or none (default uart)
+ *              -B <baud>   UART baud rate (default 115200)
+ *              -C <mAh>    battery capacity (default 220, a CR2032)
+ *              -I <nA>     base current of every target
+ *              -S <days>   synthetic trace of this many days instead of a file
+ *              -W <days>   days between two alarm tests in the synthetic trace (default 7)
+ *              -D <s>      length of an alarm test (default 10)
+ *              -L <bytes>  log bytes every 10 minutes (default 400)
+ *              -o          write the synthetic trace to stdout
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o battery_sim battery_sim.c ../energy_meter.c ../adv_power.c ../adv_airtime.c ../adv_sched.c
+ *              ./battery_sim -S 365
+ *              ./battery_sim -S 365 -p -r -l none -t -8
+ *              ./tone_replay -o > edges.txt; ./battery_sim edges.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adv_airtime.h"
+#include "adv_frame.h"
+#include "adv_power.h"
+#include "adv_sched.h"
+#include "energy_meter.h"
+#include "tone_counter.h"
+#include "tone_pattern.h"
+
+#define TX_DBM_MIN              (-40)
+#define TX_DBM_MAX              8
+#define TX_DBM_SPAN             (TX_DBM_MAX - TX_DBM_MIN + 1)
+#define LINE_MAX_LEN            128
+
+#define PPI_CC0_US              ((uint64_t)TONE_COUNTER_CC0_TICKS * TONE_COUNTER_TICK_US)
+#define PPI_CC2_US              ((uint64_t)TONE_COUNTER_CC2_TICKS * TONE_COUNTER_TICK_US)
+#define EDGE_CPU_US             20                          /**< Main loop decoding of one edge timestamp. */
+#define RTT_NS_PER_BYTE         50                          /**< Copy of one byte into the RTT buffer. */
+#define UART_BITS_PER_BYTE      10
+#define BINARY_BYTES_PCT        25                          /**< Binary records against the same entries as text. */
+#define BINARY_BAUD             1000000
+
+#define US_PER_DAY              (86400ULL * 1000000ULL)
+#define NC_PER_UAH              3600000ULL                  /**< 1 uAh is 3.6 mC. */
+#define REPORT_PERIOD_US        (600ULL * 1000000ULL)       /**< Duty cycle report of the firmware. */
+#define TEST_START_US           (1000000ULL)                /**< Alarm test start in its report period. */
+#define TEST_DURATION_MAX_S     300
+#define BOOT_LOG_BYTES          600
+#define ALARM_LOG_BYTES         60
+
+/**@brief Trace events. */
+typedef enum
+{
+    EVENT_EDGE_UP,
+    EVENT_EDGE_DOWN,
+    EVENT_TIMER,
+    EVENT_ADV,
+    EVENT_STATUS,
+    EVENT_LOG
+} event_type_t;
+
+typedef struct
+{
+    uint64_t     t_us;
+    event_type_t type;
+    int32_t      arg;                                       /**< dBm, status or bytes. */
+    bool         has_arg;
+} event_t;
+
+typedef enum
+{
+    LOG_UART,
+    LOG_RTT,
+    LOG_BINARY,
+    LOG_NONE
+} log_backend_t;
+
+/**@brief Simulation options. */
+typedef struct
+{
+    char const *       p_target;
+    adv_sched_config_t sched;
+    bool               sched_forced;                        /**< -a or -A given. */
+    int                idle_dbm;
+    int                alarm_dbm;
+    bool               rtc;
+    bool               ppi;
+    log_backend_t      log;
+    uint32_t           baud;
+    double             capacity_mah;
+    long               base_na;                             /**< Negative for the model figure. */
+    double             synth_days;
+    double             test_every_days;
+    uint32_t           test_s;
+    uint32_t           log_bytes;
+    bool               output;
+} options_t;
+
+/**@brief Counts of one pass, the same for every target. */
+typedef struct
+{
+    uint64_t end_us;                                        /**< Length of the trace. */
+    uint64_t events;                                        /**< Lines read or generated. */
+    uint64_t edges;
+    uint64_t timer_recorded;                                /**< T events. */
+    uint64_t timer_derived;                                 /**< From the windows. */
+    uint64_t adv_recorded[TX_DBM_SPAN];                     /**< A events per TX power. */
+    uint64_t adv_sched[TX_DBM_SPAN];                        /**< Scheduler events per TX power. */
+    uint64_t adv_recorded_total;
+    uint64_t adv_sched_total;
+    uint64_t alarm_us;                                      /**< Time the alarm status was set. */
+    uint64_t log_bytes;
+    uint64_t windows;
+    uint64_t window_us;
+} counts_t;
+
+/**@brief Simulation state of one pass. */
+typedef struct
+{
+    counts_t    counts;
+    adv_sched_t sched;
+    uint64_t    next_adv_us;
+    bool        alarm;
+    uint64_t    alarm_since_us;
+    bool        window_open;
+    uint64_t    window_start_us;
+    uint64_t    window_end_us;
+    uint64_t    last_up_us;
+} sim_t;
+
+/**@brief Target hardware and its current model. */
+typedef struct
+{
+    char const *         p_name;
+    char const *         p_chip;
+    bool                 has_rtc2;
+    energy_meter_model_t model;
+    uint32_t (*tx_ua)(int8_t dbm);                          /**< Radio current at a TX power, clamped to the chip. */
+} target_t;
+
+/**@brief Radio current at a TX power, typical with the DC/DC converter at 3 V. */
+typedef struct
+{
+    int8_t   dbm;
+    uint32_t ua;
+} tx_step_t;
+
+static tx_step_t const m_tx_52832[] =
+{
+    { 4, 7500 }, { 3, 7000 }, { 0, 5300 }, { -4, 4200 }, { -8, 3800 }, { -12, 3500 },
+    { -16, 3300 }, { -20, 3200 }, { -40, 2700 }
+};
+
+// The nRF52811 shares the radio figures of the nRF52810.
+static tx_step_t const m_tx_52810[] =
+{
+    { 4, 7000 }, { 3, 6600 }, { 0, 4600 }, { -4, 3900 }, { -8, 3500 }, { -12, 3300 },
+    { -16, 3100 }, { -20, 3000 }, { -40, 2500 }
+};
+
+
+/**@brief Current of the highest step at or below a TX power, the lowest step below all. */
+static uint32_t tx_step_ua(tx_step_t const * p_steps, size_t count, int8_t dbm)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (p_steps[i].dbm <= dbm)
+        {
+            return p_steps[i].ua;
+        }
+    }
+    return p_steps[count - 1].ua;
+}
+
+
+static uint32_t tx_52832_ua(int8_t dbm)
+{
+    return tx_step_ua(m_tx_52832, sizeof(m_tx_52832) / sizeof(m_tx_52832[0]), dbm);
+}
+
+
+static uint32_t tx_52810_ua(int8_t dbm)
+{
+    return tx_step_ua(m_tx_52810, sizeof(m_tx_52810) / sizeof(m_tx_52810[0]), dbm);
+}
+
+
+/**@brief Targets, with the fixed charges of ENERGY_METER_DEFAULT_MODEL scaled by the CPU current. */
+static target_t const m_targets[] =
+{
+    {
+        .p_name   = "pca10040_s132",
+        .p_chip   = "nRF52832",
+        .has_rtc2 = true,
+        .model    = { .base_na  = 2400,
+                      .state_na = { [ENERGY_METER_CPU] = 3700000, [ENERGY_METER_SLEEP] = 0,
+                                    [ENERGY_METER_HFCLK] = 400000, [ENERGY_METER_UART] = 550000 },
+                      .event_nc = { [ENERGY_METER_RADIO] = 3300, [ENERGY_METER_FE_ISR] = 55,
+                                    [ENERGY_METER_TIMER_ISR] = 55 } },
+        .tx_ua    = tx_52832_ua
+    },
+    {
+        .p_name   = "pca10040e_s112",
+        .p_chip   = "nRF52810",
+        .has_rtc2 = false,
+        .model    = { .base_na  = 2100,
+                      .state_na = { [ENERGY_METER_CPU] = 3300000, [ENERGY_METER_SLEEP] = 0,
+                                    [ENERGY_METER_HFCLK] = 400000, [ENERGY_METER_UART] = 500000 },
+                      .event_nc = { [ENERGY_METER_RADIO] = 3000, [ENERGY_METER_FE_ISR] = 50,
+                                    [ENERGY_METER_TIMER_ISR] = 50 } },
+        .tx_ua    = tx_52810_ua
+    },
+    {
+        .p_name   = "pca10056e_s112",
+        .p_chip   = "nRF52811",
+        .has_rtc2 = false,
+        .model    = { .base_na  = 2100,
+                      .state_na = { [ENERGY_METER_CPU] = 3300000, [ENERGY_METER_SLEEP] = 0,
+                                    [ENERGY_METER_HFCLK] = 400000, [ENERGY_METER_UART] = 500000 },
+                      .event_nc = { [ENERGY_METER_RADIO] = 3000, [ENERGY_METER_FE_ISR] = 50,
+                                    [ENERGY_METER_TIMER_ISR] = 50 } },
+        .tx_ua    = tx_52810_ua
+    },
+    {
+        .p_name   = "pca10056_s140",
+        .p_chip   = "nRF52840",
+        .has_rtc2 = true,
+        .model    = ENERGY_METER_DEFAULT_MODEL,
+        .tx_ua    = adv_power_tx_ua
+    }
+};
+
+#define TARGETS (sizeof(m_targets) / sizeof(m_targets[0]))
+
+static options_t m_opt =
+{
+    .p_target        = NULL,
+    .sched           = ADV_SCHED_DEFAULT_CONFIG,
+    .idle_dbm        = 0,
+    .alarm_dbm       = 0,
+    .log             = LOG_UART,
+    .baud            = 115200,
+    .capacity_mah    = 220,
+    .base_na         = -1,
+    .test_every_days = 7,
+    .test_s          = 10,
+    .log_bytes       = 400
+};
+
+static char const * const m_log_names[] = { "UART", "RTT", "binary", "no" };
+
+static sim_t    m_sim;
+static uint32_t m_radio_us;
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "usage: %s [-m target] [-a ms] [-A ms] [-t dBm] [-T dBm] [-r] [-p] [-l uart|rtt|binary|none] "
+                    "[-B baud] [-C mAh] [-I nA] [-S days [-W days] [-D s] [-L bytes] [-o]] [file|-]\n", p_name);
+    exit(2);
+}
+
+
+static FILE * file_open(char const * p_path)
+{
+    FILE * p_file;
+
+    if (strcmp(p_path, "-") == 0)
+    {
+        return stdin;
+    }
+    p_file = fopen(p_path, "r");
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        exit(1);
+    }
+    return p_file;
+}
+
+
+static uint32_t dbm_index(int dbm)
+{
+    if (dbm < TX_DBM_MIN)
+    {
+        dbm = TX_DBM_MIN;
+    }
+    if (dbm > TX_DBM_MAX)
+    {
+        dbm = TX_DBM_MAX;
+    }
+    return (uint32_t)(dbm - TX_DBM_MIN);
+}
+
+
+/**@brief Function for ending the open burst window at its timeout. */
+static void window_close(void)
+{
+    m_sim.counts.windows++;
+    m_sim.counts.window_us += m_sim.window_end_us - m_sim.window_start_us;
+
+    // The timeout interrupt, and with the tone counter the CC0 after the last tone.
+    m_sim.counts.timer_derived += m_opt.ppi ? 2 : 1;
+    m_sim.window_open = false;
+}
+
+
+/**@brief Function for moving the simulation up to a time: window timeouts and scheduler events. */
+static void sim_advance(uint64_t t_us)
+{
+    if (m_sim.window_open && (m_sim.window_end_us <= t_us))
+    {
+        window_close();
+    }
+
+    while (m_sim.next_adv_us <= t_us)
+    {
+        uint32_t now_ms = (uint32_t)(m_sim.next_adv_us / 1000);
+        uint32_t delay_ms;
+        int      dbm    = m_sim.alarm ? m_opt.alarm_dbm : m_opt.idle_dbm;
+
+        if (adv_sched_next(&m_sim.sched, now_ms, &delay_ms) && (delay_ms == 0))
+        {
+            (void)adv_sched_update(&m_sim.sched, now_ms);
+        }
+        m_sim.counts.adv_sched[dbm_index(dbm)]++;
+        m_sim.counts.adv_sched_total++;
+        m_sim.next_adv_us += (uint64_t)(adv_sched_interval_ms(&m_sim.sched) + ADV_SCHED_ADV_DELAY_AVG_MS) * 1000;
+    }
+}
+
+
+static void sim_init(void)
+{
+    memset(&m_sim, 0, sizeof(m_sim));
+    adv_sched_init(&m_sim.sched, &m_opt.sched, 0);
+}
+
+
+static void sim_event(event_t const * p_event)
+{
+    counts_t * p_counts = &m_sim.counts;
+    uint64_t   t_us     = p_event->t_us;
+
+    sim_advance(t_us);
+    p_counts->events++;
+    if (t_us > p_counts->end_us)
+    {
+        p_counts->end_us = t_us;
+    }
+
+    switch (p_event->type)
+    {
+        case EVENT_EDGE_UP:
+            p_counts->edges++;
+            if (m_sim.window_open)
+            {
+                // The tone counter wakes the CPU at CC0 when a tone comes that long after the last.
+                if (m_opt.ppi && (t_us - m_sim.last_up_us > PPI_CC0_US))
+                {
+                    p_counts->timer_derived++;
+                }
+            }
+            else
+            {
+                m_sim.window_open     = true;
+                m_sim.window_start_us = t_us;
+            }
+            m_sim.last_up_us    = t_us;
+            m_sim.window_end_us = t_us + (m_opt.ppi ? PPI_CC2_US : TONE_PATTERN_SILENCE_US);
+            break;
+
+        case EVENT_EDGE_DOWN:
+            p_counts->edges++;
+            break;
+
+        case EVENT_TIMER:
+            p_counts->timer_recorded++;
+            break;
+
+        case EVENT_ADV:
+        {
+            int dbm = p_event->has_arg ? p_event->arg : (m_sim.alarm ? m_opt.alarm_dbm : m_opt.idle_dbm);
+
+            p_counts->adv_recorded[dbm_index(dbm)]++;
+            p_counts->adv_recorded_total++;
+            break;
+        }
+
+        case EVENT_STATUS:
+        {
+            bool active = (p_event->arg != 0);
+
+            if (active == m_sim.alarm)
+            {
+                break;
+            }
+            if (m_sim.alarm)
+            {
+                p_counts->alarm_us += t_us - m_sim.alarm_since_us;
+            }
+            m_sim.alarm          = active;
+            m_sim.alarm_since_us = t_us;
+
+            // A new interval restarts advertising, the first event goes out at once.
+            if (adv_sched_alarm(&m_sim.sched, active, (uint32_t)(t_us / 1000)))
+            {
+                m_sim.next_adv_us = t_us;
+            }
+            break;
+        }
+
+        case EVENT_LOG:
+            p_counts->log_bytes += (uint64_t)p_event->arg;
+            break;
+    }
+}
+
+
+/**@brief Function for ending the pass at a time, at least the last event. */
+static void sim_finish(uint64_t end_us)
+{
+    counts_t * p_counts = &m_sim.counts;
+
+    if (end_us > p_counts->end_us)
+    {
+        p_counts->end_us = end_us;
+    }
+    sim_advance(p_counts->end_us);
+    if (m_sim.window_open)
+    {
+        m_sim.window_end_us = p_counts->end_us;
+        window_close();
+    }
+    if (m_sim.alarm)
+    {
+        p_counts->alarm_us += p_counts->end_us - m_sim.alarm_since_us;
+    }
+}
+
+
+static void event_print(event_t const * p_event)
+{
+    static char const types[] = { 'U', 'D', 'T', 'A', 'S', 'L' };
+
+    if (p_event->has_arg)
+    {
+        printf("%llu %c %ld\n", (unsigned long long)p_event->t_us, types[p_event->type], (long)p_event->arg);
+    }
+    else
+    {
+        printf("%llu %c\n", (unsigned long long)p_event->t_us, types[p_event->type]);
+    }
+}
+
+
+static void emit(void (*handler)(event_t const *), uint64_t t_us, event_type_t type, bool has_arg, int32_t arg)
+{
+    event_t event = { .t_us = t_us, .type = type, .arg = arg, .has_arg = has_arg };
+
+    handler(&event);
+}
+
+
+/**@brief Function for one alarm test: temporal-3 cycles of three 0.5 s tones 1 s apart and a
+ *        1.5 s pause. The detector reports at the end of the first cycle, the status clears at
+ *        the burst timeout after the last tone.
+ */
+static void synth_test(void (*handler)(event_t const *), uint64_t start_us)
+{
+    uint64_t length_us = (uint64_t)m_opt.test_s * 1000000;
+    uint64_t last_up   = start_us;
+    bool     reported  = false;
+
+    for (uint64_t cycle = 0; cycle < length_us; cycle += 4000000)
+    {
+        for (uint32_t tone = 0; (tone < 3) && (cycle + tone * 1000000ULL < length_us); tone++)
+        {
+            last_up = start_us + cycle + tone * 1000000ULL;
+            emit(handler, last_up, EVENT_EDGE_UP, false, 0);
+            emit(handler, last_up + 500000, EVENT_EDGE_DOWN, false, 0);
+            if ((tone == 2) && !reported)
+            {
+                emit(handler, last_up + 500000, EVENT_STATUS, true, 1);
+                emit(handler, last_up + 500000, EVENT_LOG, true, ALARM_LOG_BYTES);
+                reported = true;
+            }
+        }
+    }
+    if (reported)
+    {
+        emit(handler, last_up + TONE_PATTERN_SILENCE_US, EVENT_STATUS, true, 0);
+        emit(handler, last_up + TONE_PATTERN_SILENCE_US, EVENT_LOG, true, ALARM_LOG_BYTES);
+    }
+}
+
+
+/**@brief Function for generating the synthetic trace, in time order.
+ *
+ * @return Length of the trace.
+ */
+static uint64_t synth_run(void (*handler)(event_t const *))
+{
+    uint64_t end_us     = (uint64_t)(m_opt.synth_days * US_PER_DAY);
+    uint64_t every_us   = (uint64_t)(m_opt.test_every_days * US_PER_DAY);
+    uint64_t next_test  = every_us;
+
+    emit(handler, 0, EVENT_LOG, true, BOOT_LOG_BYTES);
+    for (uint64_t t = REPORT_PERIOD_US; t < end_us; t += REPORT_PERIOD_US)
+    {
+        emit(handler, t, EVENT_LOG, true, (int32_t)m_opt.log_bytes);
+        if ((every_us > 0) && (t >= next_test))
+        {
+            synth_test(handler, t + TEST_START_US);
+            next_test += every_us;
+        }
+    }
+    return end_us;
+}
+
+
+/**@brief Function for reading a trace file.
+ *
+ * @return Number of lines that are not events.
+ */
+static uint64_t trace_read(FILE * p_file)
+{
+    char     line[LINE_MAX_LEN];
+    uint64_t bad = 0;
+
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        char *  p_end;
+        event_t event = {0};
+
+        if ((line[0] == '#') || (line[0] == '\n'))
+        {
+            continue;
+        }
+        event.t_us = strtoull(line, &p_end, 10);
+        while (*p_end == ' ' || *p_end == '\t')
+        {
+            p_end++;
+        }
+        switch (*p_end)
+        {
+            case 'U': event.type = EVENT_EDGE_UP;   break;
+            case 'D': event.type = EVENT_EDGE_DOWN; break;
+            case 'T': event.type = EVENT_TIMER;     break;
+            case 'A': event.type = EVENT_ADV;       break;
+            case 'S': event.type = EVENT_STATUS;    break;
+            case 'L': event.type = EVENT_LOG;       break;
+            default:
+                bad++;
+                continue;
+        }
+        if (*p_end != '\0')
+        {
+            char * p_arg = p_end + 1;
+
+            event.arg     = (int32_t)strtol(p_arg, &p_end, 10);
+            event.has_arg = (p_end != p_arg);
+        }
+        if (((event.type == EVENT_STATUS) || (event.type == EVENT_LOG)) && !event.has_arg)
+        {
+            bad++;
+            continue;
+        }
+        sim_event(&event);
+    }
+    return bad;
+}
+
+
+/**@brief Function for filling the counters of a target from the counts of the pass.
+ *
+ * @return false if the target cannot build with the options.
+ */
+static bool target_meter(target_t const * p_target, counts_t const * p_counts, energy_meter_t * p_meter)
+{
+    bool             use_sched = m_opt.sched_forced || (p_counts->adv_recorded_total == 0);
+    uint64_t const * p_adv     = use_sched ? p_counts->adv_sched : p_counts->adv_recorded;
+    uint64_t         cpu_us    = 0;
+    uint64_t         uart_us   = 0;
+    uint64_t         radio_nc  = 0;
+    uint64_t         adv       = 0;
+
+    if (m_opt.rtc && !p_target->has_rtc2)
+    {
+        return false;
+    }
+
+    energy_meter_init(p_meter, 1000000);
+
+    // The edge front end decodes every timestamp in the main loop, the tone counter none.
+    if (!m_opt.ppi)
+    {
+        cpu_us                                   += p_counts->edges * EDGE_CPU_US;
+        p_meter->count[ENERGY_METER_FE_ISR]       = (uint32_t)p_counts->edges;
+    }
+    p_meter->count[ENERGY_METER_TIMER_ISR] = (uint32_t)((p_counts->timer_recorded > 0) ? p_counts->timer_recorded
+                                                                                         : p_counts->timer_derived);
+    if (!(m_opt.rtc && m_opt.ppi))
+    {
+        p_meter->ticks[ENERGY_METER_HFCLK] = p_counts->window_us;
+    }
+
+    // The CPU waits for the UART to take every byte.
+    switch (m_opt.log)
+    {
+        case LOG_UART:
+            uart_us  = (p_counts->log_bytes * UART_BITS_PER_BYTE * 1000000) / m_opt.baud;
+            cpu_us  += uart_us;
+            break;
+        case LOG_RTT:
+            cpu_us  += (p_counts->log_bytes * RTT_NS_PER_BYTE) / 1000;
+            break;
+        case LOG_BINARY:
+            uart_us  = (p_counts->log_bytes * BINARY_BYTES_PCT * UART_BITS_PER_BYTE * 10000) / BINARY_BAUD;
+            cpu_us  += uart_us;
+            break;
+        case LOG_NONE:
+            break;
+    }
+    p_meter->ticks[ENERGY_METER_CPU]  = cpu_us;
+    p_meter->ticks[ENERGY_METER_UART] = uart_us;
+
+    for (uint32_t i = 0; i < TX_DBM_SPAN; i++)
+    {
+        if (p_adv[i] > 0)
+        {
+            radio_nc += p_adv[i] * ((uint64_t)p_target->tx_ua((int8_t)(TX_DBM_MIN + (int)i)) * m_radio_us / 1000);
+            adv      += p_adv[i];
+        }
+    }
+    p_meter->count[ENERGY_METER_RADIO]     = (uint32_t)adv;
+    p_meter->charge_nc[ENERGY_METER_RADIO] = radio_nc;
+    return true;
+}
+
+
+static void report(counts_t const * p_counts)
+{
+    double days      = (double)p_counts->end_us / US_PER_DAY;
+    bool   use_sched = m_opt.sched_forced || (p_counts->adv_recorded_total == 0);
+
+    if (days <= 0)
+    {
+        fprintf(stderr, "empty trace\n");
+        exit(1);
+    }
+
+    printf("trace: %.2f days, %llu edges, %llu burst windows (%.0f s), %llu timer interrupts (%s), "
+           "%llu advertising events (%s), %.0f s alarm, %llu log bytes\n",
+           days, (unsigned long long)p_counts->edges, (unsigned long long)p_counts->windows,
+           p_counts->window_us / 1e6,
+           (unsigned long long)((p_counts->timer_recorded > 0) ? p_counts->timer_recorded : p_counts->timer_derived),
+           (p_counts->timer_recorded > 0) ? "trace" : "windows",
+           (unsigned long long)(use_sched ? p_counts->adv_sched_total : p_counts->adv_recorded_total),
+           use_sched ? "scheduler" : "trace", p_counts->alarm_us / 1e6, (unsigned long long)p_counts->log_bytes);
+    printf("setup: %u/%u ms, %d/%d dBm, %s burst window, %s front end, %s log, %u us radio per event\n\n",
+           m_opt.sched.idle_ms, m_opt.sched.alarm_ms, m_opt.idle_dbm, m_opt.alarm_dbm,
+           m_opt.rtc ? "RTC2" : "TIMER1", m_opt.ppi ? "PPI counter" : "edge",
+           m_log_names[m_opt.log], m_radio_us);
+
+    printf("%-16s %-9s %8s %8s %9s | uAh/day: %7s %7s %7s %7s %7s %7s\n",
+           "target", "chip", "mean uA", "mAh/day", "years", "base", "cpu", "hfclk", "uart", "radio", "irq");
+
+    for (uint32_t i = 0; i < TARGETS; i++)
+    {
+        target_t const *     p_target = &m_targets[i];
+        energy_meter_model_t model    = p_target->model;
+        energy_meter_t       meter;
+        uint64_t             total;
+        double               per_day;
+
+        if ((m_opt.p_target != NULL) && (strcmp(m_opt.p_target, p_target->p_name) != 0))
+        {
+            continue;
+        }
+        if (!target_meter(p_target, p_counts, &meter))
+        {
+            printf("%-16s %-9s no RTC2 for the burst window\n", p_target->p_name, p_target->p_chip);
+            continue;
+        }
+        if (m_opt.base_na >= 0)
+        {
+            model.base_na = (uint32_t)m_opt.base_na;
+        }
+
+        total   = energy_meter_total_nc(&meter, &model, p_counts->end_us);
+        per_day = (double)total / NC_PER_UAH / days;
+        printf("%-16s %-9s %8.2f %8.4f %9.2f | uAh/day: %7.1f %7.1f %7.1f %7.1f %7.1f %7.1f\n",
+               p_target->p_name, p_target->p_chip, per_day / 24.0, per_day / 1000.0,
+               (m_opt.capacity_mah * 1000.0 / per_day) / 365.0,
+               energy_meter_base_nc(&meter, &model, p_counts->end_us) / (double)NC_PER_UAH / days,
+               energy_meter_state_nc(&meter, &model, ENERGY_METER_CPU) / (double)NC_PER_UAH / days,
+               energy_meter_state_nc(&meter, &model, ENERGY_METER_HFCLK) / (double)NC_PER_UAH / days,
+               energy_meter_state_nc(&meter, &model, ENERGY_METER_UART) / (double)NC_PER_UAH / days,
+               energy_meter_event_nc(&meter, &model, ENERGY_METER_RADIO) / (double)NC_PER_UAH / days,
+               (energy_meter_event_nc(&meter, &model, ENERGY_METER_FE_ISR) +
+                energy_meter_event_nc(&meter, &model, ENERGY_METER_TIMER_ISR)) / (double)NC_PER_UAH / days);
+    }
+}
+
+
+int main(int argc, char * argv[])
+{
+    adv_airtime_t airtime;
+    clock_t       start = clock();
+    uint64_t      end_us;
+    int           opt;
+
+    while ((opt = getopt(argc, argv, "m:a:A:t:T:rpl:B:C:I:S:W:D:L:o")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm': m_opt.p_target        = optarg;                             break;
+            case 'a': m_opt.sched.idle_ms   = (uint32_t)strtoul(optarg, NULL, 0);
+                      m_opt.sched_forced    = true;                               break;
+            case 'A': m_opt.sched.alarm_ms  = (uint32_t)strtoul(optarg, NULL, 0);
+                      m_opt.sched_forced    = true;                               break;
+            case 't': m_opt.idle_dbm        = atoi(optarg);                       break;
+            case 'T': m_opt.alarm_dbm       = atoi(optarg);                       break;
+            case 'r': m_opt.rtc             = true;                               break;
+            case 'p': m_opt.ppi             = true;                               break;
+            case 'B': m_opt.baud            = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'C': m_opt.capacity_mah    = atof(optarg);                       break;
+            case 'I': m_opt.base_na         = atol(optarg);                       break;
+            case 'S': m_opt.synth_days      = atof(optarg);                       break;
+            case 'W': m_opt.test_every_days = atof(optarg);                       break;
+            case 'D': m_opt.test_s          = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'L': m_opt.log_bytes       = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'o': m_opt.output          = true;                               break;
+            case 'l':
+                if (strcmp(optarg, "uart") == 0)
+                {
+                    m_opt.log = LOG_UART;
+                }
+                else if (strcmp(optarg, "rtt") == 0)
+                {
+                    m_opt.log = LOG_RTT;
+                }
+                else if (strcmp(optarg, "binary") == 0)
+                {
+                    m_opt.log = LOG_BINARY;
+                }
+                else if (strcmp(optarg, "none") == 0)
+                {
+                    m_opt.log = LOG_NONE;
+                }
+                else
+                {
+                    usage(argv[0]);
+                }
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if ((m_opt.baud == 0) || (m_opt.capacity_mah <= 0) || (m_opt.test_s > TEST_DURATION_MAX_S) ||
+        (m_opt.output && (m_opt.synth_days <= 0)) || ((m_opt.synth_days <= 0) && (optind >= argc)))
+    {
+        usage(argv[0]);
+    }
+    if (m_opt.p_target != NULL)
+    {
+        uint32_t i = 0;
+
+        while ((i < TARGETS) && (strcmp(m_opt.p_target, m_targets[i].p_name) != 0))
+        {
+            i++;
+        }
+        if (i == TARGETS)
+        {
+            usage(argv[0]);
+        }
+    }
+
+    if (m_opt.output)
+    {
+        (void)synth_run(event_print);
+        return 0;
+    }
+
+    // Every event is a legacy 1M event with the full beacon frame.
+    adv_airtime_legacy(ADV_FRAME_LEN, &airtime);
+    m_radio_us            = airtime.radio_us;
+    m_opt.sched.event_us  = airtime.radio_us;
+
+    sim_init();
+    if (m_opt.synth_days > 0)
+    {
+        end_us = synth_run(sim_event);
+    }
+    else
+    {
+        FILE *   p_file = file_open(argv[optind]);
+        uint64_t bad    = trace_read(p_file);
+
+        if (bad > 0)
+        {
+            fprintf(stderr, "%llu lines skipped\n", (unsigned long long)bad);
+        }
+        end_us = 0;
+    }
+    sim_finish(end_us);
+    report(&m_sim.counts);
+
+    fprintf(stderr, "\n%llu trace events and %llu scheduler events in %.2f s\n",
+            (unsigned long long)m_sim.counts.events, (unsigned long long)m_sim.counts.adv_sched_total,
+            (double)(clock() - start) / CLOCKS_PER_SEC);
+    return 0;
+}
@@ -0,0 +1,529 @@
+/** @file
+ *
+ * @brief Host simulation of the LPCOMP radio blanking (USE_LPCOMP_BLANKING, lpcomp_blank.c).
+ *
+ * @details Loads a clean edge file, one "<timestamp_us> <U|D>" line per edge as written by
+ *          tone_replay -o, and puts an advertising event every -i ms plus the 0 to 10 ms
+ *          advDelay on top of it. A -p percentage of the radio events gets a TX glitch: for up
+ *          to -w us, starting while the radio is on air, the comparator output is forced high
+ *          (the supply and the reference sag) or, for -r percent of the glitches, low (the
+ *          regulator overshoots after the TX). The glitched stream is what the LPCOMP reports.
+ *
+ *          The glitched stream then goes through the blanking the way main.c drives it: a
+ *          window opens at the radio notification ACTIVE, 800 us before the event, and closes
+ *          -g us after its end. Both the glitched stream and the blanked stream are scored
+ *          against the clean one: edges that match a clean edge of the same direction within
+ *          a window length, spurious edges (glitch UP edges are what inflate the PPI tone
+ *          count), missing edges, the worst timestamp error and the worst delivery delay.
+ *
+ *          The blanked stream (or the glitched one with -n) can be written for a detection
+ *          level check: -o for tone_replay, -u for tone_counter_model. Rising edges for the
+ *          tone counter carry their delivery time, a restored edge is counted by software
+ *          when the window closes.
+ *
+ *          Options:
+ *              -i <ms>     advertising interval (default 100)
+ *              -d <us>     radio event length (default 1400, legacy advertising on 3 channels)
+ *              -p <pct>    radio events with a glitch (default 50)
+ *              -w <us>     longest glitch, the shortest is 20 us (default 300)
+ *              -r <pct>    glitches that force the output low instead of high (default 0)
+ *              -g <us>     blanking guard after the radio event (default 300, LPCOMP_BLANK_GUARD_US)
+ *              -s <seed>   glitch seed
+ *              -n          write the glitched stream instead of the blanked one
+ *              -o <file>   write the edges for tone_replay
+ *              -u <file>   write the rising edge times for tone_counter_model
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o blank_sim blank_sim.c ../lpcomp_blank.c
+ *              ./tone_replay -S 24 -o clean.edges -L alarm.labels
+ *              ./blank_sim -i 20 -p 50 -o blanked.edges clean.edges
+ *              ./tone_replay -l alarm.labels blanked.edges
+ *              ./blank_sim -i 20 -p 50 -n -u - clean.edges | ./tone_counter_model
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lpcomp_blank.h"
+
+#define RADIO_NOTIFY_DISTANCE_US    800                     /**< Radio notification ACTIVE ahead of the event. */
+#define ADV_DELAY_MAX_US            10000                   /**< advDelay, added to every advertising interval. */
+#define GLITCH_MIN_US               20
+
+/**@brief Edge stream, timestamps with the edge direction in bit 0. */
+typedef struct
+{
+    uint64_t * p_edges;
+    size_t     count;
+    size_t     capacity;
+} edge_stream_t;
+
+/**@brief Radio event with its glitch. */
+typedef struct
+{
+    uint64_t start;                                         /**< Radio on air. */
+    uint64_t glitch_start;                                  /**< Equal to glitch_end without a glitch. */
+    uint64_t glitch_end;
+    bool     glitch_level;                                  /**< Level the glitch forces. */
+} radio_event_t;
+
+typedef struct
+{
+    radio_event_t * p_events;
+    size_t          count;
+    size_t          capacity;
+} radio_list_t;
+
+/**@brief Score of a stream against the clean one. */
+typedef struct
+{
+    uint64_t edges;
+    uint64_t matched;
+    uint64_t spurious_up;
+    uint64_t spurious_down;
+    uint64_t missing;
+    uint64_t error_max;                                     /**< Worst timestamp error of a matched edge. */
+    uint64_t delay_max;                                     /**< Worst time from an edge to its delivery. */
+} score_t;
+
+
+static void * grow(void * p, size_t * p_capacity, size_t size)
+{
+    *p_capacity = (*p_capacity == 0) ? 4096 : (*p_capacity * 2);
+    p           = realloc(p, *p_capacity * size);
+
+    if (p == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+
+static void edge_add(edge_stream_t * p_stream, uint64_t timestamp, bool up)
+{
+    if (p_stream->count == p_stream->capacity)
+    {
+        p_stream->p_edges = grow(p_stream->p_edges, &p_stream->capacity, sizeof(uint64_t));
+    }
+    p_stream->p_edges[p_stream->count++] = (timestamp << 1) | (up ? 1 : 0);
+}
+
+
+static void radio_add(radio_list_t * p_list, radio_event_t const * p_event)
+{
+    if (p_list->count == p_list->capacity)
+    {
+        p_list->p_events = grow(p_list->p_events, &p_list->capacity, sizeof(radio_event_t));
+    }
+    p_list->p_events[p_list->count++] = *p_event;
+}
+
+
+static FILE * file_open(char const * p_path, char const * p_mode)
+{
+    FILE * p_file = (strcmp(p_path, "-") == 0) ? ((p_mode[0] == 'r') ? stdin : stdout)
+                                               : fopen(p_path, p_mode);
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        exit(1);
+    }
+    return p_file;
+}
+
+
+static void file_close(FILE * p_file)
+{
+    if ((p_file != stdin) && (p_file != stdout))
+    {
+        fclose(p_file);
+    }
+}
+
+
+static void edges_load(edge_stream_t * p_stream, char const * p_path)
+{
+    FILE *   p_file = file_open(p_path, "r");
+    char     line[128];
+    uint64_t last   = 0;
+
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        uint64_t timestamp;
+        char     edge;
+
+        if ((line[0] == '#') || (sscanf(line, "%" SCNu64 " %c", &timestamp, &edge) != 2))
+        {
+            continue;
+        }
+        if (timestamp < last)
+        {
+            fprintf(stderr, "%s: timestamp %" PRIu64 " goes back in time\n", p_path, timestamp);
+            exit(1);
+        }
+        last = timestamp;
+        edge_add(p_stream, timestamp, (edge == 'U') || (edge == 'u'));
+    }
+
+    file_close(p_file);
+}
+
+
+static uint64_t m_seed = 1;
+
+static uint32_t rand_next(void)
+{
+    m_seed = m_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(m_seed >> 33);
+}
+
+
+static uint32_t rand_range(uint32_t min, uint32_t max)
+{
+    return min + rand_next() % (max - min + 1);
+}
+
+
+/**@brief Advertising events over the clean stream, a -p percentage of them with a glitch. */
+static void radio_generate(radio_list_t * p_list, uint64_t end, uint32_t interval_us, uint32_t event_us,
+                           uint32_t glitch_pct, uint32_t glitch_max_us, uint32_t low_pct)
+{
+    uint64_t now = RADIO_NOTIFY_DISTANCE_US;
+
+    while (now < end)
+    {
+        radio_event_t event = { .start = now };
+
+        event.glitch_start = now + rand_range(0, event_us);
+        event.glitch_end   = event.glitch_start;
+        if ((rand_next() % 100) < glitch_pct)
+        {
+            event.glitch_end  += rand_range(GLITCH_MIN_US, glitch_max_us);
+            event.glitch_level = ((rand_next() % 100) >= low_pct);
+        }
+        radio_add(p_list, &event);
+
+        now += interval_us + rand_range(0, ADV_DELAY_MAX_US);
+    }
+}
+
+
+/**@brief Comparator output: the clean level, except where a glitch forces its own. */
+static void glitch_apply(edge_stream_t const * p_clean, radio_list_t const * p_radio, edge_stream_t * p_out)
+{
+    size_t   c           = 0;
+    size_t   r           = 0;
+    bool     in_glitch   = false;
+    bool     clean_level = false;
+    bool     level       = false;
+
+    while (true)
+    {
+        uint64_t clean_time = (c < p_clean->count) ? (p_clean->p_edges[c] >> 1) : UINT64_MAX;
+        uint64_t radio_time = UINT64_MAX;
+
+        while ((r < p_radio->count) &&
+               (p_radio->p_events[r].glitch_start == p_radio->p_events[r].glitch_end))
+        {
+            r++;
+        }
+        if (r < p_radio->count)
+        {
+            radio_time = in_glitch ? p_radio->p_events[r].glitch_end : p_radio->p_events[r].glitch_start;
+        }
+        if ((clean_time == UINT64_MAX) && (radio_time == UINT64_MAX))
+        {
+            break;
+        }
+
+        if (clean_time < radio_time)
+        {
+            clean_level = (p_clean->p_edges[c++] & 1) != 0;
+            if (!in_glitch && (level != clean_level))
+            {
+                level = clean_level;
+                edge_add(p_out, clean_time, level);
+            }
+        }
+        else if (!in_glitch)
+        {
+            in_glitch = true;
+            if (level != p_radio->p_events[r].glitch_level)
+            {
+                level = p_radio->p_events[r].glitch_level;
+                edge_add(p_out, radio_time, level);
+            }
+        }
+        else
+        {
+            in_glitch = false;
+            r++;
+            if (level != clean_level)
+            {
+                level = clean_level;
+                edge_add(p_out, radio_time, level);
+            }
+        }
+    }
+}
+
+
+/**@brief Runs the glitched stream through the blanking, p_delivery gets the delivery time of every edge. */
+static void blank_run(lpcomp_blank_t * p_blank, edge_stream_t const * p_in, radio_list_t const * p_radio,
+                      uint32_t event_us, uint32_t guard_us, edge_stream_t * p_out, edge_stream_t * p_delivery)
+{
+    size_t   e     = 0;
+    bool     level = false;
+
+    lpcomp_blank_init(p_blank, false);
+
+    for (size_t r = 0; r <= p_radio->count; r++)
+    {
+        uint64_t open  = UINT64_MAX;
+        uint64_t close = UINT64_MAX;
+
+        if (r < p_radio->count)
+        {
+            open  = p_radio->p_events[r].start - RADIO_NOTIFY_DISTANCE_US;
+            close = p_radio->p_events[r].start + event_us + guard_us;
+            // An event inside the guard of the last one keeps its window open.
+            while ((r + 1 < p_radio->count) && (p_radio->p_events[r + 1].start - RADIO_NOTIFY_DISTANCE_US <= close))
+            {
+                r++;
+                close = p_radio->p_events[r].start + event_us + guard_us;
+            }
+        }
+
+        // Edges before the window go straight through.
+        for (; (e < p_in->count) && ((p_in->p_edges[e] >> 1) < open); e++)
+        {
+            level = (p_in->p_edges[e] & 1) != 0;
+            if (lpcomp_blank_edge(p_blank, level, (uint32_t)(p_in->p_edges[e] >> 1)))
+            {
+                edge_add(p_out, p_in->p_edges[e] >> 1, level);
+                edge_add(p_delivery, p_in->p_edges[e] >> 1, level);
+            }
+        }
+        if (open == UINT64_MAX)
+        {
+            break;
+        }
+
+        lpcomp_blank_start(p_blank);
+        for (; (e < p_in->count) && ((p_in->p_edges[e] >> 1) < close); e++)
+        {
+            level = (p_in->p_edges[e] & 1) != 0;
+            (void)lpcomp_blank_edge(p_blank, level, (uint32_t)(p_in->p_edges[e] >> 1));
+        }
+
+        lpcomp_blank_edge_t edge;
+        if (lpcomp_blank_end(p_blank, level, (uint32_t)close, &edge))
+        {
+            // The 32-bit timestamp is at most a window before the close.
+            uint64_t timestamp = close - (uint32_t)((uint32_t)close - edge.timestamp);
+
+            edge_add(p_out, timestamp, edge.up);
+            edge_add(p_delivery, close, edge.up);
+        }
+    }
+}
+
+
+/**@brief Scores a stream against the clean one, an edge matches within the tolerance. */
+static score_t score(edge_stream_t const * p_clean, edge_stream_t const * p_stream,
+                     edge_stream_t const * p_delivery, uint64_t tolerance)
+{
+    score_t score = { .edges = p_stream->count };
+    size_t  c     = 0;
+    size_t  s     = 0;
+
+    while ((c < p_clean->count) || (s < p_stream->count))
+    {
+        uint64_t clean_time  = (c < p_clean->count) ? (p_clean->p_edges[c] >> 1) : UINT64_MAX;
+        uint64_t stream_time = (s < p_stream->count) ? (p_stream->p_edges[s] >> 1) : UINT64_MAX;
+        bool     same_up     = (c < p_clean->count) && (s < p_stream->count) &&
+                               (((p_clean->p_edges[c] ^ p_stream->p_edges[s]) & 1) == 0);
+        uint64_t error       = (clean_time > stream_time) ? (clean_time - stream_time) : (stream_time - clean_time);
+
+        if (same_up && (error <= tolerance))
+        {
+            uint64_t delay = (p_delivery->p_edges[s] >> 1) - clean_time;
+
+            if (error > score.error_max)
+            {
+                score.error_max = error;
+            }
+            if (((p_delivery->p_edges[s] >> 1) > clean_time) && (delay > score.delay_max))
+            {
+                score.delay_max = delay;
+            }
+            score.matched++;
+            c++;
+            s++;
+        }
+        else if (stream_time < clean_time)
+        {
+            if (p_stream->p_edges[s] & 1)
+            {
+                score.spurious_up++;
+            }
+            else
+            {
+                score.spurious_down++;
+            }
+            s++;
+        }
+        else
+        {
+            score.missing++;
+            c++;
+        }
+    }
+
+    return score;
+}
+
+
+static void score_print(FILE * p_file, char const * p_name, score_t const * p_score)
+{
+    fprintf(p_file, "  %-12s %10" PRIu64 " %10" PRIu64 " %11" PRIu64 " %13" PRIu64 " %8" PRIu64 " %10" PRIu64 " %12" PRIu64 "\n",
+           p_name, p_score->edges, p_score->matched, p_score->spurious_up, p_score->spurious_down,
+           p_score->missing, p_score->error_max, p_score->delay_max);
+}
+
+
+static void edges_write(edge_stream_t const * p_stream, char const * p_path)
+{
+    FILE * p_file = file_open(p_path, "w");
+
+    for (size_t i = 0; i < p_stream->count; i++)
+    {
+        fprintf(p_file, "%" PRIu64 " %c\n", p_stream->p_edges[i] >> 1, (p_stream->p_edges[i] & 1) ? 'U' : 'D');
+    }
+
+    file_close(p_file);
+}
+
+
+static void rising_write(edge_stream_t const * p_delivery, char const * p_path)
+{
+    FILE * p_file = file_open(p_path, "w");
+
+    for (size_t i = 0; i < p_delivery->count; i++)
+    {
+        if (p_delivery->p_edges[i] & 1)
+        {
+            fprintf(p_file, "%" PRIu64 "\n", p_delivery->p_edges[i] >> 1);
+        }
+    }
+
+    file_close(p_file);
+}
+
+
+int main(int argc, char * argv[])
+{
+    edge_stream_t  clean        = { 0 };
+    edge_stream_t  glitched     = { 0 };
+    edge_stream_t  blanked      = { 0 };
+    edge_stream_t  delivery     = { 0 };
+    radio_list_t   radio        = { 0 };
+    lpcomp_blank_t blank;
+    uint32_t       interval_ms  = 100;
+    uint32_t       event_us     = 1400;
+    uint32_t       glitch_pct   = 50;
+    uint32_t       glitch_max   = 300;
+    uint32_t       low_pct      = 0;
+    uint32_t       guard_us     = 300;
+    bool           unblanked    = false;
+    char const *   p_edges_out  = NULL;
+    char const *   p_rising_out = NULL;
+    int            opt;
+
+    while ((opt = getopt(argc, argv, "i:d:p:w:r:g:s:no:u:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i': interval_ms  = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'd': event_us     = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'p': glitch_pct   = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': glitch_max   = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': low_pct      = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'g': guard_us     = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': m_seed       = strtoull(optarg, NULL, 0);          break;
+            case 'n': unblanked    = true;                               break;
+            case 'o': p_edges_out  = optarg;                             break;
+            case 'u': p_rising_out = optarg;                             break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [-i ms] [-d us] [-p pct] [-w us] [-r pct] [-g us] [-s seed] [-n] [-o edges] [-u rising] clean.edges\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        fprintf(stderr, "%s: no edge file\n", argv[0]);
+        return 2;
+    }
+    if ((interval_ms < 20) || (glitch_max < GLITCH_MIN_US) || (glitch_max >= interval_ms * 1000))
+    {
+        fprintf(stderr, "%s: the interval is at least 20 ms, glitches are 20 us to the interval\n", argv[0]);
+        return 2;
+    }
+
+    edges_load(&clean, argv[optind]);
+    if (clean.count == 0)
+    {
+        return 0;
+    }
+
+    radio_generate(&radio, (clean.p_edges[clean.count - 1] >> 1) + 1000000, interval_ms * 1000, event_us,
+                   glitch_pct, glitch_max, low_pct);
+    glitch_apply(&clean, &radio, &glitched);
+    blank_run(&blank, &glitched, &radio, event_us, guard_us, &blanked, &delivery);
+
+    // An edge in a window is late by at most the window, a glitch that overlaps it by its length too.
+    uint64_t tolerance = RADIO_NOTIFY_DISTANCE_US + event_us + guard_us + glitch_max;
+    score_t  raw       = score(&clean, &glitched, &glitched, tolerance);
+    score_t  fixed     = score(&clean, &blanked, &delivery, tolerance);
+    uint64_t glitches  = 0;
+
+    for (size_t i = 0; i < radio.count; i++)
+    {
+        glitches += (radio.p_events[i].glitch_end != radio.p_events[i].glitch_start);
+    }
+
+    // The report moves to stderr when an output goes to stdout.
+    FILE *   p_report  = (((p_edges_out != NULL) && (strcmp(p_edges_out, "-") == 0)) ||
+                          ((p_rising_out != NULL) && (strcmp(p_rising_out, "-") == 0))) ? stderr : stdout;
+
+    fprintf(p_report, "# %zu clean edges, %zu radio events every %" PRIu32 " ms, %" PRIu64 " glitches of %u to %" PRIu32 " us, guard %" PRIu32 " us\n",
+           clean.count, radio.count, interval_ms, glitches, GLITCH_MIN_US, glitch_max, guard_us);
+    fprintf(p_report, "# %-12s %10s %10s %11s %13s %8s %10s %12s\n",
+           "stream", "edges", "matched", "spurious_up", "spurious_down", "missing", "err_max_us", "delay_max_us");
+    score_print(p_report, "glitched", &raw);
+    score_print(p_report, "blanked", &fixed);
+    fprintf(p_report, "# blanking: %" PRIu32 " windows, %" PRIu32 " with edges, %" PRIu32 " UP and %" PRIu32 " DOWN edges blanked, %" PRIu32 " restored\n",
+           blank.stats.windows, blank.stats.windows_hit, blank.stats.up_blanked, blank.stats.down_blanked,
+           blank.stats.restored);
+
+    if (p_edges_out != NULL)
+    {
+        edges_write(unblanked ? &glitched : &blanked, p_edges_out);
+    }
+    if (p_rising_out != NULL)
+    {
+        rising_write(unblanked ? &glitched : &delivery, p_rising_out);
+    }
+    return 0;
+}
@@ -0,0 +1,447 @@
+/** @file
+ *
+ * @brief Host side of the configuration service (USE_CONFIG_SERVICE): blobs, log chunks and
+ *        download time.
+ *
+ * @details Three jobs, picked by the first option:
+ *          - -c encodes a configuration blob for the configuration characteristic from the
+ *            options below, every field defaults to the firmware default. -d decodes and checks
+ *            one, as read from the characteristic.
+ *          - -l reads log notifications from stdin, one per line in hex as a phone or nRF
+ *            Connect shows them, and prints the events. Gaps in the sequence numbers are
+ *            events the ring overwrote before they were downloaded, numbers that go back mean
+ *            the beacon was reset between two chunks. The empty chunk at the end
+ *            gives the sequence number to ask for next visit.
+ *          - -e fills an event log with -n events, cuts it into notifications the way the
+ *            firmware does, checks that they decode back to the same events and estimates the
+ *            download time. Each notification is split into link layer packets of at most the
+ *            data length, the central acknowledges each one with an empty packet, and a
+ *            connection event sends at most -q notifications (the SoftDevice queue) or as
+ *            many packets as fit into -E ms. Connection setup, the MTU, data length and PHY
+ *            exchanges and service discovery are -S ms on top. The same log is also timed at
+ *            1M, MTU 23 and 27 byte packets, what a link without the negotiation gets.
+ *
+ *          Options of -c:
+ *              -I <ms>    idle heartbeat interval (default 5000)
+ *              -A <ms>    alarm interval (default 20)
+ *              -W <ms>    alarm interval hold (default 30000)
+ *              -t <dBm>   TX power (default 0)
+ *              -g <us>    gap that ends a tone (default 20000)
+ *              -k <us>    pattern slack (default 0)
+ *              -R <0|1>   tone rejection (default 1)
+ *              -P <w,r,c> alarm policy window, required cycles, minimum confidence (default 1,1,0)
+ *
+ *          Options of -e:
+ *              -n <n>     events in the log (default 1024, a full ring)
+ *              -m <n>     ATT MTU (default 247)
+ *              -D <n>     link layer data length (default 251)
+ *              -p <1|2>   PHY in Mbps (default 2)
+ *              -i <ms>    connection interval (default 30)
+ *              -E <ms>    radio time per connection event (default the interval, event length extension)
+ *              -q <n>     notifications queued per connection event (default 8)
+ *              -S <ms>    connection setup and discovery (default 1500)
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o config_tool config_tool.c ../app_config.c ../adv_power.c ../event_log.c
+ *              ./config_tool -c -A 50 -P 3,2,0
+ *              ./config_tool -d 01881332003075000004204e000001030200
+ *              ./config_tool -e -n 300
+ *              ./config_tool -l < notifications.txt
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "app_config.h"
+#include "event_log.h"
+
+#define LINE_MAX_LEN        2048
+#define ATT_HEADER_LEN      3                               /**< Opcode and handle of a notification. */
+#define L2CAP_HEADER_LEN    4
+#define LL_OVERHEAD_BYTES   10                              /**< Access address, header and CRC. */
+#define T_IFS_US            150.0
+
+/**@brief Download link parameters. */
+typedef struct
+{
+    uint32_t mtu;
+    uint32_t data_len;
+    uint32_t phy_mbps;
+    double   interval_ms;
+    double   event_ms;
+    uint32_t queue;
+} link_t;
+
+static const char * const m_type_names[] =
+{
+    [EVENT_LOG_BOOT]        = "boot",
+    [EVENT_LOG_ALARM_ON]    = "alarm on",
+    [EVENT_LOG_ALARM_OFF]   = "alarm off",
+    [EVENT_LOG_CONFIG]      = "config",
+    [EVENT_LOG_CALIBRATION] = "calibration",
+    [EVENT_LOG_CONNECTED]   = "connected",
+    [EVENT_LOG_BOOT_TIMES]  = "boot times"
+};
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr,
+            "usage: %s -c [-I ms] [-A ms] [-W ms] [-t dBm] [-g us] [-k us] [-R 0|1] [-P w,r,c]\n"
+            "       %s -d <hex>\n"
+            "       %s -l < notifications\n"
+            "       %s -e [-n events] [-m mtu] [-D len] [-p 1|2] [-i ms] [-E ms] [-q n] [-S ms]\n",
+            p_name, p_name, p_name, p_name);
+    exit(EXIT_FAILURE);
+}
+
+
+/**@brief Parse hex, spaces, colons and dashes between bytes are skipped. */
+static uint32_t hex_parse(char const * p_text, uint8_t * p_buf, uint32_t size)
+{
+    uint32_t len = 0;
+
+    while ((*p_text != '\0') && (len < size))
+    {
+        unsigned int byte;
+
+        if ((*p_text == ' ') || (*p_text == ':') || (*p_text == '-') || (*p_text == '\n') || (*p_text == '\r'))
+        {
+            p_text++;
+            continue;
+        }
+        if ((p_text[0] == '0') && ((p_text[1] == 'x') || (p_text[1] == 'X')))
+        {
+            p_text += 2;
+            continue;
+        }
+        if (sscanf(p_text, "%2x", &byte) != 1)
+        {
+            break;
+        }
+        p_buf[len++] = (uint8_t)byte;
+        p_text += 2;
+    }
+    return len;
+}
+
+
+static void config_print(app_config_t const * p_config)
+{
+    printf("idle interval     %u ms\n", p_config->idle_ms);
+    printf("alarm interval    %u ms\n", p_config->alarm_ms);
+    printf("alarm hold        %u ms\n", p_config->window_ms);
+    printf("TX power          %d dBm\n", p_config->tx_power);
+    printf("tone gap          %u us\n", p_config->gap_us);
+    printf("pattern slack     %u us\n", p_config->slack_us);
+    printf("tone rejection    %s\n", p_config->reject_tones ? "on" : "off");
+    printf("alarm policy      %u,%u,%u\n",
+           p_config->policy.window, p_config->policy.required, p_config->policy.min_confidence);
+}
+
+
+static int config_encode(int argc, char ** argv)
+{
+    adv_sched_config_t   sched  = ADV_SCHED_DEFAULT_CONFIG;
+    tone_detect_config_t detect = TONE_DETECT_DEFAULT_CONFIG;
+    app_config_t         config;
+    uint8_t              blob[APP_CONFIG_LEN];
+    unsigned int         window, required, confidence;
+    int                  opt;
+
+    app_config_init(&config, &sched, &detect, 0);
+
+    while ((opt = getopt(argc, argv, "cI:A:W:t:g:k:R:P:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': break;
+            case 'I': config.idle_ms      = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'A': config.alarm_ms     = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'W': config.window_ms    = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': config.tx_power     = (int8_t)strtol(optarg, NULL, 0);    break;
+            case 'g': config.gap_us       = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'k': config.slack_us     = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'R': config.reject_tones = (strtoul(optarg, NULL, 0) != 0);    break;
+            case 'P':
+                if (sscanf(optarg, "%u,%u,%u", &window, &required, &confidence) != 3)
+                {
+                    usage(argv[0]);
+                }
+                config.policy.window         = (uint8_t)window;
+                config.policy.required       = (uint8_t)required;
+                config.policy.min_confidence = (uint8_t)confidence;
+                break;
+            default:  usage(argv[0]);
+        }
+    }
+
+    if (!app_config_valid(&config))
+    {
+        fprintf(stderr, "configuration out of range, the beacon would reject it\n");
+        config_print(&config);
+        return EXIT_FAILURE;
+    }
+
+    app_config_encode(&config, blob);
+    for (uint32_t i = 0; i < sizeof(blob); i++)
+    {
+        printf("%02x", blob[i]);
+    }
+    printf("\n");
+    return EXIT_SUCCESS;
+}
+
+
+static int config_decode(char const * p_hex)
+{
+    uint8_t      blob[APP_CONFIG_LEN + 1];
+    uint32_t     len = hex_parse(p_hex, blob, sizeof(blob));
+    app_config_t config;
+
+    if (!app_config_decode(blob, len, &config))
+    {
+        fprintf(stderr, "not a valid version %u configuration of %u bytes\n", APP_CONFIG_VERSION, APP_CONFIG_LEN);
+        return EXIT_FAILURE;
+    }
+    config_print(&config);
+    return EXIT_SUCCESS;
+}
+
+
+static void record_print(uint32_t seq, event_log_record_t const * p_record)
+{
+    char const * p_name = ((p_record->type < sizeof(m_type_names) / sizeof(m_type_names[0])) &&
+                           (m_type_names[p_record->type] != NULL)) ? m_type_names[p_record->type] : "unknown";
+
+    printf("%8u %10u s  %-12s 0x%02x %5u\n", seq, p_record->time_s, p_name, p_record->arg8, p_record->arg16);
+}
+
+
+static int log_decode(void)
+{
+    char               line[LINE_MAX_LEN];
+    uint8_t            chunk[LINE_MAX_LEN / 2];
+    event_log_record_t records[LINE_MAX_LEN / 2 / EVENT_LOG_RECORD_LEN];
+    bool               expected_valid = false;
+    uint32_t           expected       = 0;
+    uint32_t           events         = 0;
+    uint32_t           lost           = 0;
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        uint32_t len = hex_parse(line, chunk, sizeof(chunk));
+        uint32_t seq;
+        uint32_t count;
+
+        if (len == 0)
+        {
+            continue;
+        }
+        if ((len < EVENT_LOG_HEADER_LEN) || (((len - EVENT_LOG_HEADER_LEN) % EVENT_LOG_RECORD_LEN) != 0))
+        {
+            fprintf(stderr, "skipped a chunk of %u bytes\n", len);
+            continue;
+        }
+
+        count = event_log_decode(chunk, len, &seq, records, sizeof(records) / sizeof(records[0]));
+        if (expected_valid && (seq < expected))
+        {
+            // A reset empties the RAM log, the numbers start over.
+            printf("%8s log restarted\n", "");
+        }
+        else if (expected_valid && (seq != expected))
+        {
+            printf("%8s gap of %u events\n", "", seq - expected);
+            lost += seq - expected;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            record_print(seq + i, &records[i]);
+        }
+        events        += count;
+        expected       = seq + count;
+        expected_valid = true;
+
+        if (count == 0)
+        {
+            printf("end of log, ask for %u next time\n", seq);
+        }
+    }
+
+    printf("%u events, %u overwritten before the download\n", events, lost);
+    return EXIT_SUCCESS;
+}
+
+
+/**@brief Air time of one link layer packet with a payload, and its empty acknowledgement. */
+static double packet_pair_us(link_t const * p_link, uint32_t payload)
+{
+    double preamble = (p_link->phy_mbps == 2) ? 2.0 : 1.0;
+    double data_us  = (preamble + LL_OVERHEAD_BYTES - 1 + payload) * 8.0 / p_link->phy_mbps;
+    double ack_us   = (preamble + LL_OVERHEAD_BYTES - 1) * 8.0 / p_link->phy_mbps;
+
+    return data_us + T_IFS_US + ack_us + T_IFS_US;
+}
+
+
+/**@brief Cut the log into notifications like the firmware and time them.
+ *
+ * @return Download time without the connection setup, in ms.
+ */
+static double download_ms(event_log_t const * p_log, link_t const * p_link, uint32_t * p_notifications,
+                          double * p_per_event)
+{
+    uint8_t            chunk[EVENT_LOG_HEADER_LEN + EVENT_LOG_CAPACITY * EVENT_LOG_RECORD_LEN];
+    event_log_record_t records[EVENT_LOG_CAPACITY];
+    uint32_t           chunk_max = p_link->mtu - ATT_HEADER_LEN;
+    uint32_t           seq       = event_log_first(p_log);
+    uint32_t           notifications = 0;
+    double             events_needed = 0.0;
+    double             packets_left  = 0.0;
+    uint32_t           queued        = 0;
+    double             event_us      = p_link->event_ms * 1000.0;
+
+    for (;;)
+    {
+        uint32_t first   = seq;
+        uint32_t len     = event_log_read(p_log, &seq, chunk, chunk_max);
+        uint32_t sdu     = len + ATT_HEADER_LEN + L2CAP_HEADER_LEN;
+        uint32_t packets = (sdu + p_link->data_len - 1) / p_link->data_len;
+        double   pair_us = packet_pair_us(p_link, (sdu < p_link->data_len) ? sdu : p_link->data_len);
+        uint32_t decoded_seq;
+        uint32_t count   = event_log_decode(chunk, len, &decoded_seq, records, EVENT_LOG_CAPACITY);
+
+        // What went out must come back the same.
+        for (uint32_t i = 0; i < count; i++)
+        {
+            event_log_record_t const * p_record = &p_log->records[(first + i) & (EVENT_LOG_CAPACITY - 1)];
+
+            if ((decoded_seq != first) || (memcmp(&records[i], p_record, sizeof(*p_record)) != 0))
+            {
+                fprintf(stderr, "chunk at %u does not decode back\n", first);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        notifications++;
+        if ((queued == 0) || (queued == p_link->queue) || (packets_left < packets))
+        {
+            // Next connection event.
+            events_needed += 1.0;
+            packets_left   = event_us / pair_us;
+            queued         = 0;
+        }
+        packets_left -= packets;
+        queued++;
+
+        if (len == EVENT_LOG_HEADER_LEN)
+        {
+            break;
+        }
+    }
+
+    *p_notifications = notifications;
+    *p_per_event     = notifications / events_needed;
+    return events_needed * p_link->interval_ms;
+}
+
+
+static int estimate(int argc, char ** argv)
+{
+    static event_log_t log;
+    link_t             link = { .mtu = 247, .data_len = 251, .phy_mbps = 2, .interval_ms = 30.0, .event_ms = 0.0, .queue = 8 };
+    link_t             legacy;
+    uint32_t           events   = EVENT_LOG_CAPACITY;
+    double             setup_ms = 1500.0;
+    uint32_t           notifications;
+    double             per_event;
+    double             time_ms;
+    int                opt;
+
+    while ((opt = getopt(argc, argv, "en:m:D:p:i:E:q:S:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'e': break;
+            case 'n': events        = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': link.mtu      = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'D': link.data_len = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'p': link.phy_mbps = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'i': link.interval_ms = atof(optarg);                    break;
+            case 'E': link.event_ms = atof(optarg);                       break;
+            case 'q': link.queue    = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'S': setup_ms      = atof(optarg);                       break;
+            default:  usage(argv[0]);
+        }
+    }
+    if ((link.mtu < 23) || (link.mtu > 247) || (link.data_len < 27) || (link.data_len > 251) ||
+        ((link.phy_mbps != 1) && (link.phy_mbps != 2)) || (link.interval_ms < 7.5) || (link.queue == 0))
+    {
+        usage(argv[0]);
+    }
+    if ((link.event_ms <= 0.0) || (link.event_ms > link.interval_ms))
+    {
+        link.event_ms = link.interval_ms;
+    }
+
+    // Alarms on and off with a calibration now and then, a minute apart.
+    event_log_init(&log);
+    event_log_add(&log, 0, EVENT_LOG_BOOT, 0x01, 0);
+    for (uint32_t i = 1; i < events; i++)
+    {
+        uint8_t type = (i % 16 == 0) ? EVENT_LOG_CALIBRATION : ((i & 1) ? EVENT_LOG_ALARM_ON : EVENT_LOG_ALARM_OFF);
+
+        event_log_add(&log, i * 60, type, (type == EVENT_LOG_ALARM_ON) ? 0x81 : 0x00, 0);
+    }
+
+    time_ms = download_ms(&log, &link, &notifications, &per_event);
+    printf("%u events, %u bytes of records\n", events, events * EVENT_LOG_RECORD_LEN);
+    printf("%uM PHY, MTU %u, data length %u, %.1f ms interval: %u notifications, %.1f per connection event, "
+           "%.0f ms, %.0f ms with setup\n",
+           link.phy_mbps, link.mtu, link.data_len, link.interval_ms, notifications, per_event,
+           time_ms, time_ms + setup_ms);
+
+    legacy          = link;
+    legacy.mtu      = 23;
+    legacy.data_len = 27;
+    legacy.phy_mbps = 1;
+    time_ms = download_ms(&log, &legacy, &notifications, &per_event);
+    printf("1M PHY, MTU 23, data length 27, %.1f ms interval: %u notifications, %.1f per connection event, "
+           "%.0f ms, %.0f ms with setup\n",
+           legacy.interval_ms, notifications, per_event, time_ms, time_ms + setup_ms);
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char ** argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+    }
+
+    if (strcmp(argv[1], "-c") == 0)
+    {
+        return config_encode(argc, argv);
+    }
+    if ((strcmp(argv[1], "-d") == 0) && (argc == 3))
+    {
+        return config_decode(argv[2]);
+    }
+    if (strcmp(argv[1], "-l") == 0)
+    {
+        return log_decode();
+    }
+    if (strcmp(argv[1], "-e") == 0)
+    {
+        return estimate(argc, argv);
+    }
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
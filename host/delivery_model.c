@@ -0,0 +1,380 @@
+/** @file
+ *
+ * @brief Host model of alarm delivery (USE_ADV_POWER_POLICY): delivery probability against
+ *        energy per alarm.
+ *
+ * @details An alarm starts at a random moment for one gateway. The beacon advertises it the
+ *          way the firmware does, and the model records when the gateway first gets a frame.
+ *          Every -P policy is run -n times, and so is the firmware without the policy: the
+ *          alarm interval plus the random 0 to 10 ms advDelay, at -t dBm.
+ *
+ *          With a policy the events are single ones with the random gaps of adv_power.c, the
+ *          generator of the firmware. Every event sends one packet on each primary channel,
+ *          37, 38 and 39, about 0.5 ms apart.
+ *
+ *          A packet arrives if the gateway listens and the channel lets it through:
+ *          - The gateway scans -w ms of every -i ms, one channel per scan interval, in turn.
+ *            Its phase and first channel are random.
+ *          - Fading: Rayleigh, on every channel apart. The mean level is the TX power minus
+ *            the path loss -L. The packet is lost if the faded level is below the sensitivity
+ *            -S. The fading changes over the coherence time -c, so two packets close together
+ *            see almost the same fade.
+ *          - Interference: each channel is busy -I percent of the time, in bursts of -B ms on
+ *            average, for example Wi-Fi. A packet sent while the channel is busy is lost.
+ *
+ *          The output is the probability of a frame within -D ms of the alarm, the mean and 99th
+ *          percentile of the time to the first frame, and the advertising energy of an alarm
+ *          sounding -A ms. The energy is the radio current of the TX power over the radio time
+ *          of each event, from adv_power.c and adv_airtime.c. A trial without a frame within
+ *          -A ms counts at -A ms in the percentile.
+ *
+ *          Options:
+ *              -P <list>  comma separated policies alarm_dbm/copies/spread_pct
+ *                         (default 8/1/50,8/2/50,8/3/50,4/2/50,0/2/50)
+ *              -t <dBm>   TX power of the firmware without the policy (default 0)
+ *              -a <ms>    alarm interval (default 20)
+ *              -L <dB>    path loss to the gateway (default 92)
+ *              -S <dBm>   gateway sensitivity (default -95)
+ *              -c <ms>    fading coherence time (default 100)
+ *              -I <list>  busy percentage of channels 37, 38 and 39 (default 5,20,10)
+ *              -B <ms>    mean interference burst (default 5)
+ *              -w <ms>    scan window (default 50)
+ *              -i <ms>    scan interval (default 100)
+ *              -D <ms>    delivery deadline (default 200)
+ *              -A <ms>    alarm duration for the energy (default 10000)
+ *              -n <n>     trials per policy (default 20000)
+ *              -s <seed>  seed
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o delivery_model delivery_model.c ../adv_power.c ../adv_airtime.c -lm
+ *              ./delivery_model
+ *              ./delivery_model -a 100 -P 8/1/50,8/3/50,8/5/50
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "adv_airtime.h"
+#include "adv_frame.h"
+#include "adv_power.h"
+
+#define CHANNELS            3
+#define PACKET_SPACING_MS   0.5                             /**< Start of one primary channel packet to the next. */
+#define ADV_DELAY_MAX_MS    10.0
+#define POLICIES_MAX        16
+#define PI                  3.14159265358979323846
+
+/**@brief Model options. */
+typedef struct
+{
+    int      plain_dbm;
+    uint32_t alarm_ms;
+    double   path_loss_db;
+    double   sensitivity_dbm;
+    double   coherence_ms;
+    double   busy[CHANNELS];
+    double   burst_ms;
+    double   window_ms;
+    double   interval_ms;
+    double   deadline_ms;
+    uint32_t duration_ms;
+    uint32_t trials;
+} options_t;
+
+/**@brief Radio state of one channel. */
+typedef struct
+{
+    double at_ms;                                           /**< Time of the state below. */
+    bool   busy;
+    double h_re;                                            /**< Fading gain, mean power 1. */
+    double h_im;
+} channel_t;
+
+static options_t m_opt =
+{
+    .plain_dbm       = 0,
+    .alarm_ms        = 20,
+    .path_loss_db    = 92,
+    .sensitivity_dbm = -95,
+    .coherence_ms    = 100,
+    .busy            = { 0.05, 0.20, 0.10 },
+    .burst_ms        = 5,
+    .window_ms       = 50,
+    .interval_ms     = 100,
+    .deadline_ms     = 200,
+    .duration_ms     = 10000,
+    .trials          = 20000
+};
+
+static uint32_t m_seed = 1;
+
+
+static uint32_t rand_next(void)
+{
+    m_seed = (m_seed * 1103515245UL) + 12345UL;
+    return (m_seed >> 8);
+}
+
+
+/**@brief Uniform in [0, 1). */
+static double rand_unit(void)
+{
+    return (rand_next() & 0xFFFFFF) / 16777216.0;
+}
+
+
+/**@brief Standard normal, Box-Muller. */
+static double rand_normal(void)
+{
+    double u = rand_unit() + 1e-12;
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * PI * rand_unit());
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "usage: %s [-P list] [-t dBm] [-a ms] [-L dB] [-S dBm] [-c ms] [-I list] [-B ms] "
+                    "[-w ms] [-i ms] [-D ms] [-A ms] [-n n] [-s seed]\n", p_name);
+    exit(2);
+}
+
+
+/**@brief Parse "alarm_dbm/copies/spread_pct,..." into policies. */
+static uint32_t policy_parse(char const * p_list, adv_power_policy_t * p_policies)
+{
+    uint32_t count = 0;
+    int      used;
+    int      dbm;
+    unsigned copies;
+    unsigned spread;
+
+    while ((count < POLICIES_MAX) && (sscanf(p_list, "%d/%u/%u%n", &dbm, &copies, &spread, &used) == 3))
+    {
+        p_policies[count++] = (adv_power_policy_t){ .idle_dbm   = -20,
+                                                    .alarm_dbm  = (int8_t)dbm,
+                                                    .copies     = (uint8_t)copies,
+                                                    .spread_pct = (uint8_t)spread };
+        p_list += used;
+        if (*p_list != ',')
+        {
+            break;
+        }
+        p_list++;
+    }
+    return count;
+}
+
+
+/**@brief Function for moving a channel to a later time.
+ *
+ * @details Interference is a two state Markov process with the busy fraction and mean burst
+ *          of the options, the fading gain a Gauss-Markov process with the coherence time.
+ */
+static void channel_step(channel_t * p_channel, double busy, double at_ms)
+{
+    double dt    = at_ms - p_channel->at_ms;
+    double leave = 1.0 / m_opt.burst_ms;                    // busy -> idle rate
+    double enter = (busy < 1.0) ? (busy * leave / (1.0 - busy)) : 1e9;
+    double p_busy;
+    double rho;
+
+    p_busy = busy + ((p_channel->busy ? 1.0 : 0.0) - busy) * exp(-(enter + leave) * dt);
+    p_channel->busy = (rand_unit() < p_busy);
+
+    rho = exp(-dt / m_opt.coherence_ms);
+    p_channel->h_re = rho * p_channel->h_re + sqrt((1.0 - rho * rho) / 2.0) * rand_normal();
+    p_channel->h_im = rho * p_channel->h_im + sqrt((1.0 - rho * rho) / 2.0) * rand_normal();
+    p_channel->at_ms = at_ms;
+}
+
+
+static int compare_double(void const * p_a, void const * p_b)
+{
+    double a = *(double const *)p_a;
+    double b = *(double const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+/**@brief Function for running the trials of one policy, or of the firmware without one.
+ *
+ * @param[in] p_policy  Policy, NULL for the alarm interval plus advDelay.
+ * @param[in] dbm       TX power during the alarm.
+ */
+static void model_run(adv_power_policy_t const * p_policy, int dbm, double * p_latency, double radio_us)
+{
+    double      snr       = pow(10.0, (dbm - m_opt.path_loss_db - m_opt.sensitivity_dbm) / 10.0);
+    uint32_t    delivered = 0;
+    double      sum       = 0;
+    adv_power_t power;
+    uint32_t    events;
+    double      energy_mj;
+
+    if (p_policy != NULL)
+    {
+        adv_power_init(&power, p_policy, rand_next() | 1);
+    }
+
+    for (uint32_t n = 0; n < m_opt.trials; n++)
+    {
+        channel_t channels[CHANNELS];
+        double    phase   = rand_unit() * m_opt.interval_ms;
+        uint32_t  first   = rand_next() % CHANNELS;
+        double    t       = 0;
+        double    latency = m_opt.duration_ms;
+
+        for (uint32_t c = 0; c < CHANNELS; c++)
+        {
+            channels[c].at_ms = 0;
+            channels[c].busy  = (rand_unit() < m_opt.busy[c]);
+            channels[c].h_re  = sqrt(0.5) * rand_normal();
+            channels[c].h_im  = sqrt(0.5) * rand_normal();
+        }
+
+        // The status change restarts the set, the first event goes out at once.
+        while (t < m_opt.duration_ms)
+        {
+            bool got = false;
+
+            for (uint32_t c = 0; c < CHANNELS; c++)
+            {
+                double at   = t + c * PACKET_SPACING_MS;
+                double scan = fmod(at + phase, m_opt.interval_ms);
+                bool   on   = (scan < m_opt.window_ms) &&
+                              (((uint32_t)((at + phase) / m_opt.interval_ms) + first) % CHANNELS == c);
+                double fade;
+
+                channel_step(&channels[c], m_opt.busy[c], at);
+                fade = channels[c].h_re * channels[c].h_re + channels[c].h_im * channels[c].h_im;
+                if (on && !channels[c].busy && (fade * snr >= 1.0))
+                {
+                    latency = at;
+                    got     = true;
+                    break;
+                }
+            }
+            if (got)
+            {
+                break;
+            }
+
+            t += (p_policy != NULL) ? (double)adv_power_gap_ms(&power, m_opt.alarm_ms)
+                                    : (m_opt.alarm_ms + rand_unit() * ADV_DELAY_MAX_MS);
+        }
+
+        p_latency[n] = latency;
+        if (latency <= m_opt.deadline_ms)
+        {
+            delivered++;
+        }
+        sum += latency;
+    }
+
+    qsort(p_latency, m_opt.trials, sizeof(double), compare_double);
+
+    if (p_policy != NULL)
+    {
+        energy_mj = adv_power_alarm_uj(&power, m_opt.alarm_ms, (uint32_t)radio_us, m_opt.duration_ms) / 1000.0;
+        events    = (uint32_t)(((uint64_t)m_opt.duration_ms * power.policy.copies) / m_opt.alarm_ms);
+        printf("%+4d dBm %2u/%3u%%", power.policy.alarm_dbm, power.policy.copies, power.policy.spread_pct);
+    }
+    else
+    {
+        events    = (uint32_t)(m_opt.duration_ms / (m_opt.alarm_ms + ADV_DELAY_MAX_MS / 2));
+        energy_mj = events * (adv_power_event_nj((int8_t)dbm, (uint32_t)radio_us) / 1e6);
+        printf("%+4d dBm periodic ", dbm);
+    }
+    printf(" %10.2f %10.1f %10.1f %8u %10.2f\n",
+           100.0 * delivered / m_opt.trials, sum / m_opt.trials,
+           p_latency[(uint32_t)(0.99 * (m_opt.trials - 1))], events, energy_mj);
+}
+
+
+int main(int argc, char * argv[])
+{
+    adv_power_policy_t policies[POLICIES_MAX] =
+    {
+        { .idle_dbm = -20, .alarm_dbm = 8, .copies = 1, .spread_pct = 50 },
+        { .idle_dbm = -20, .alarm_dbm = 8, .copies = 2, .spread_pct = 50 },
+        { .idle_dbm = -20, .alarm_dbm = 8, .copies = 3, .spread_pct = 50 },
+        { .idle_dbm = -20, .alarm_dbm = 4, .copies = 2, .spread_pct = 50 },
+        { .idle_dbm = -20, .alarm_dbm = 0, .copies = 2, .spread_pct = 50 }
+    };
+    uint32_t      policy_count = 5;
+    adv_airtime_t airtime;
+    double *      p_latency;
+    int           opt;
+
+    while ((opt = getopt(argc, argv, "P:t:a:L:S:c:I:B:w:i:D:A:n:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'P': policy_count          = policy_parse(optarg, policies);   break;
+            case 't': m_opt.plain_dbm       = atoi(optarg);                     break;
+            case 'a': m_opt.alarm_ms        = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'L': m_opt.path_loss_db    = atof(optarg);                     break;
+            case 'S': m_opt.sensitivity_dbm = atof(optarg);                     break;
+            case 'c': m_opt.coherence_ms    = atof(optarg);                     break;
+            case 'B': m_opt.burst_ms        = atof(optarg);                     break;
+            case 'w': m_opt.window_ms       = atof(optarg);                     break;
+            case 'i': m_opt.interval_ms     = atof(optarg);                     break;
+            case 'D': m_opt.deadline_ms     = atof(optarg);                     break;
+            case 'A': m_opt.duration_ms     = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': m_opt.trials          = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': m_seed                = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'I':
+                if (sscanf(optarg, "%lf,%lf,%lf", &m_opt.busy[0], &m_opt.busy[1], &m_opt.busy[2]) != 3)
+                {
+                    usage(argv[0]);
+                }
+                for (uint32_t c = 0; c < CHANNELS; c++)
+                {
+                    m_opt.busy[c] /= 100.0;
+                }
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if ((policy_count == 0) || (m_opt.alarm_ms == 0) || (m_opt.trials == 0) || (m_opt.burst_ms <= 0) ||
+        (m_opt.coherence_ms <= 0) || (m_opt.window_ms > m_opt.interval_ms))
+    {
+        usage(argv[0]);
+    }
+
+    p_latency = malloc(m_opt.trials * sizeof(double));
+    if (p_latency == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+
+    // Every event is a legacy 1M event with the full beacon frame.
+    adv_airtime_legacy(ADV_FRAME_LEN, &airtime);
+
+    printf("# alarm interval %u ms, path loss %.0f dB, sensitivity %.0f dBm, coherence %.0f ms, "
+           "busy %.0f/%.0f/%.0f %% in %.0f ms bursts, scan %.0f/%.0f ms, %u trials\n",
+           m_opt.alarm_ms, m_opt.path_loss_db, m_opt.sensitivity_dbm, m_opt.coherence_ms,
+           m_opt.busy[0] * 100, m_opt.busy[1] * 100, m_opt.busy[2] * 100, m_opt.burst_ms,
+           m_opt.window_ms, m_opt.interval_ms, m_opt.trials);
+    printf("# deadline %.0f ms, energy of a %u ms alarm, %u us radio per event\n",
+           m_opt.deadline_ms, m_opt.duration_ms, airtime.radio_us);
+    printf("%-17s %10s %10s %10s %8s %10s\n", "# policy", "p_by_dead", "mean_ms", "p99_ms", "events",
+           "alarm_mJ");
+
+    model_run(NULL, m_opt.plain_dbm, p_latency, airtime.radio_us);
+    for (uint32_t i = 0; i < policy_count; i++)
+    {
+        model_run(&policies[i], policies[i].alarm_dbm, p_latency, airtime.radio_us);
+    }
+
+    free(p_latency);
+    return 0;
+}
@@ -0,0 +1,246 @@
+/** @file
+ *
+ * @brief Host check of the Goertzel filter bank (goertzel.c).
+ *
+ * @details Builds goertzel.c with GOERTZEL_SIMD_EMULATE so both kernels run on the host:
+ *          - Bit-exactness: random int16_t blocks over the full range (including saturating
+ *            ones) and the test signals below go through goertzel_update_c() and
+ *            goertzel_update_simd(), the packed states must match after every block.
+ *          - Response: for each test signal (12-bit single-ended samples like the SAADC
+ *            delivers them) the bin powers of one block and the horn decision are printed.
+ *          - Speed: host time per sample and bin of both kernels, for comparison only.
+ *
+ *          Options:
+ *              -n <blocks>  random blocks for the bit-exactness check (default 100000)
+ *              -s <seed>    seed
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -DGOERTZEL_SIMD_EMULATE -o goertzel_check goertzel_check.c \
+ *                 ../goertzel.c -lm
+ *              ./goertzel_check
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "goertzel.h"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+#define ADC_MID     2048                                    /**< 12-bit single-ended mid scale. */
+
+/**@brief Test signal: a tone plus white noise, in 12-bit LSB. */
+typedef struct
+{
+    char const * p_name;
+    double       freq_hz;
+    double       amplitude;
+    double       noise;
+} signal_t;
+
+static const signal_t m_signals[] =
+{
+    { "silence",           0,    0,    0   },
+    { "noise 20",          0,    0,    20  },
+    { "noise 400",         0,    0,    400 },
+    { "1000 Hz 400",       1000, 400,  0   },
+    { "2000 Hz 400",       2000, 400,  0   },
+    { "2900 Hz 400",       2900, 400,  0   },
+    { "3000 Hz 40",        3000, 40,   0   },
+    { "3000 Hz 400",       3000, 400,  0   },
+    { "3100 Hz 400",       3100, 400,  0   },
+    { "3300 Hz 400",       3300, 400,  0   },
+    { "3500 Hz 400",       3500, 400,  0   },
+    { "4500 Hz 400",       4500, 400,  0   },
+    { "3100 Hz 400 + 200", 3100, 400,  200 },
+    { "3100 Hz 2000",      3100, 2000, 0   },
+    { "square 3100 Hz",    3100, -2000, 0  },
+};
+
+static uint32_t m_seed = 1;
+
+
+static uint32_t rand_next(void)
+{
+    m_seed = (m_seed * 1103515245UL) + 12345UL;
+    return (m_seed >> 8);
+}
+
+
+static double rand_gauss(void)
+{
+    double u1 = ((rand_next() & 0xFFFFFF) + 1.0) / 16777217.0;
+    double u2 = (rand_next() & 0xFFFFFF) / 16777216.0;
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+
+/**@brief One block of a test signal, a negative amplitude makes a square wave. */
+static void signal_block(signal_t const * p_signal, int16_t * p_samples, uint32_t count)
+{
+    double phase = (rand_next() % 1000) / 1000.0 * 2.0 * M_PI;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double w = 2.0 * M_PI * p_signal->freq_hz * i / GOERTZEL_HORN_SAMPLE_RATE_HZ + phase;
+        double v = ADC_MID;
+
+        if (p_signal->amplitude >= 0)
+        {
+            v += p_signal->amplitude * sin(w);
+        }
+        else
+        {
+            v += (sin(w) >= 0) ? -p_signal->amplitude : p_signal->amplitude;
+        }
+        v += p_signal->noise * rand_gauss();
+
+        v = (v < 0) ? 0 : ((v > 4095) ? 4095 : v);
+        p_samples[i] = (int16_t)lround(v);
+    }
+}
+
+
+static bool bit_exact(goertzel_bank_t const * p_c, goertzel_bank_t const * p_simd)
+{
+    return memcmp(p_c->state, p_simd->state, sizeof(p_c->state)) == 0;
+}
+
+
+static double seconds_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char * argv[])
+{
+    static const uint16_t     bins[]   = GOERTZEL_HORN_BINS;
+    static const goertzel_decision_t decision = GOERTZEL_HORN_DECISION;
+    uint8_t                   count    = sizeof(bins) / sizeof(bins[0]);
+    uint32_t                  blocks   = 100000;
+    uint32_t                  failures = 0;
+    int16_t                   samples[GOERTZEL_HORN_BLOCK_LEN];
+    uint32_t                  power[GOERTZEL_BINS_MAX];
+    goertzel_bank_t           bank_c;
+    goertzel_bank_t           bank_simd;
+    int                       opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': blocks = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': m_seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n blocks] [-s seed]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    goertzel_init(&bank_c, bins, count, GOERTZEL_HORN_BLOCK_LEN);
+    goertzel_init(&bank_simd, bins, count, GOERTZEL_HORN_BLOCK_LEN);
+
+    // Bit-exactness, state carried across blocks so saturation builds up too.
+    for (uint32_t block = 0; block < blocks; block++)
+    {
+        for (uint32_t i = 0; i < GOERTZEL_HORN_BLOCK_LEN; i++)
+        {
+            samples[i] = (int16_t)(rand_next() & 0xFFFF);
+        }
+        goertzel_update_c(&bank_c, samples, GOERTZEL_HORN_BLOCK_LEN);
+        goertzel_update_simd(&bank_simd, samples, GOERTZEL_HORN_BLOCK_LEN);
+
+        if (!bit_exact(&bank_c, &bank_simd))
+        {
+            failures++;
+            bank_simd = bank_c;
+        }
+        if ((block % 16) == 15)
+        {
+            goertzel_power(&bank_c, power);
+            goertzel_power(&bank_simd, power);
+        }
+    }
+    printf("random blocks: %" PRIu32 ", mismatches: %" PRIu32 "\n\n", blocks, failures);
+
+    // Response of every test signal.
+    printf("%-18s", "signal");
+    for (uint32_t bin = 0; bin < count; bin++)
+    {
+        printf(" %9" PRIu32 "Hz", (uint32_t)bins[bin] * GOERTZEL_HORN_SAMPLE_RATE_HZ / GOERTZEL_HORN_BLOCK_LEN);
+    }
+    printf("  horn\n");
+
+    for (uint32_t s = 0; s < sizeof(m_signals) / sizeof(m_signals[0]); s++)
+    {
+        signal_block(&m_signals[s], samples, GOERTZEL_HORN_BLOCK_LEN);
+        goertzel_update_c(&bank_c, samples, GOERTZEL_HORN_BLOCK_LEN);
+        goertzel_update_simd(&bank_simd, samples, GOERTZEL_HORN_BLOCK_LEN);
+        if (!bit_exact(&bank_c, &bank_simd))
+        {
+            failures++;
+        }
+        goertzel_power(&bank_simd, power);
+        goertzel_power(&bank_c, power);
+
+        printf("%-18s", m_signals[s].p_name);
+        for (uint32_t bin = 0; bin < count; bin++)
+        {
+            printf(" %11" PRIu32, power[bin]);
+        }
+        printf("  %s\n", goertzel_decide(&decision, power, count) ? "yes" : "no");
+    }
+
+    // Host speed of both kernels over one second of samples.
+    static int16_t second[GOERTZEL_HORN_SAMPLE_RATE_HZ];
+    for (uint32_t i = 0; i < GOERTZEL_HORN_SAMPLE_RATE_HZ; i++)
+    {
+        second[i] = (int16_t)(rand_next() & 0xFFF);
+    }
+    for (uint32_t kernel = 0; kernel < 2; kernel++)
+    {
+        double begin = seconds_now();
+
+        for (uint32_t n = 0; n < 200; n++)
+        {
+            for (uint32_t i = 0; i + GOERTZEL_HORN_BLOCK_LEN <= GOERTZEL_HORN_SAMPLE_RATE_HZ; i += GOERTZEL_HORN_BLOCK_LEN)
+            {
+                if (kernel == 0)
+                {
+                    goertzel_update_c(&bank_c, &second[i], GOERTZEL_HORN_BLOCK_LEN);
+                }
+                else
+                {
+                    goertzel_update_simd(&bank_simd, &second[i], GOERTZEL_HORN_BLOCK_LEN);
+                }
+            }
+        }
+
+        double elapsed = seconds_now() - begin;
+        printf("%s kernel: %.2f ns per sample and bin\n",
+               (kernel == 0) ? "\nC   " : "SIMD",
+               elapsed * 1e9 / (200.0 * GOERTZEL_HORN_SAMPLE_RATE_HZ * count));
+    }
+    if (!bit_exact(&bank_c, &bank_simd))
+    {
+        failures++;
+    }
+
+    printf("\n%s\n", (failures == 0) ? "bit-exact" : "MISMATCH");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+/** @file
+ *
+ * @brief Host decoder of the latency histograms (latency_hist.h) in a RAM dump.
+ *
+ * @details Debug builds of the firmware keep their latency histograms in RAM behind a
+ *          @ref latency_hist_header_t. This tool scans a binary dump for the header magic, so
+ *          the address does not have to be known, and prints every histogram: sample count,
+ *          p50/p90/p99 upper bounds and the maximum in microseconds, and with -a the buckets.
+ *          The firmware also logs its address at boot.
+ *
+ *          Take the dump with the debugger attached and the firmware running or halted, for
+ *          example:
+ *              nrfjprog --readram ram.bin
+ *
+ *          Options:
+ *              -a  print every non-empty bucket with a bar
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o latency_dump latency_dump.c ../latency_hist.c
+ *              ./latency_dump [-a] ram.bin
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "latency_hist.h"
+
+#define HIST_COUNT_MAX  32                                  /**< More histograms than this is not a real header. */
+#define BAR_WIDTH       40
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "usage: %s [-a] <ram dump>\n", p_name);
+    exit(2);
+}
+
+
+/**@brief Load a whole file into memory. */
+static uint8_t * file_load(char const * p_path, size_t * p_size)
+{
+    FILE *    p_file = fopen(p_path, "rb");
+    uint8_t * p_data = NULL;
+    size_t    size   = 0;
+    size_t    cap    = 0;
+    size_t    n;
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        exit(1);
+    }
+
+    do
+    {
+        if (size == cap)
+        {
+            cap    = (cap == 0) ? 65536 : (cap * 2);
+            p_data = realloc(p_data, cap);
+            if (p_data == NULL)
+            {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        n     = fread(p_data + size, 1, cap - size, p_file);
+        size += n;
+    } while (n != 0);
+
+    fclose(p_file);
+    *p_size = size;
+    return p_data;
+}
+
+
+/**@brief Sanity check of a histogram, so a stray magic value is not decoded. */
+static bool hist_valid(latency_hist_t const * p_hist)
+{
+    uint32_t sum = 0;
+
+    if ((p_hist->name[LATENCY_HIST_NAME_LEN - 1] != '\0') || (p_hist->unit_hz == 0))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+    {
+        sum += p_hist->bucket[i];
+    }
+    // The count may be one ahead of the buckets if the dump caught a sample half recorded.
+    return (sum == p_hist->count) || (sum + 1 == p_hist->count) || (sum == p_hist->count + 1);
+}
+
+
+/**@brief Value in microseconds, with the fraction CPU cycle histograms need. */
+static double value_us(latency_hist_t const * p_hist, uint32_t value)
+{
+    return (double)value * 1e6 / p_hist->unit_hz;
+}
+
+
+static void hist_print(latency_hist_t const * p_hist, bool buckets)
+{
+    printf("%-12s %10u %12.2f %12.2f %12.2f %12.2f   %u Hz\n",
+           p_hist->name,
+           p_hist->count,
+           value_us(p_hist, latency_hist_percentile(p_hist, 50)),
+           value_us(p_hist, latency_hist_percentile(p_hist, 90)),
+           value_us(p_hist, latency_hist_percentile(p_hist, 99)),
+           value_us(p_hist, p_hist->max),
+           p_hist->unit_hz);
+
+    if (!buckets || (p_hist->count == 0))
+    {
+        return;
+    }
+
+    uint32_t peak = 0;
+    for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+    {
+        peak = (p_hist->bucket[i] > peak) ? p_hist->bucket[i] : peak;
+    }
+
+    for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+    {
+        uint32_t low = (i == 0) ? 0 : (latency_hist_bucket_limit(i - 1) + 1);
+        uint32_t n   = p_hist->bucket[i];
+        int      bar = (int)(((uint64_t)n * BAR_WIDTH + peak - 1) / peak);
+
+        if (n == 0)
+        {
+            continue;
+        }
+        printf("    %12.2f .. %12.2f us %10u %.*s\n",
+               value_us(p_hist, low),
+               value_us(p_hist, latency_hist_bucket_limit(i)),
+               n, bar, "########################################");
+    }
+}
+
+
+int main(int argc, char * argv[])
+{
+    bool      buckets = false;
+    size_t    size;
+    uint8_t * p_data;
+    int       found   = 0;
+    int       opt;
+
+    while ((opt = getopt(argc, argv, "a")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a':
+                buckets = true;
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind + 1 != argc)
+    {
+        usage(argv[0]);
+    }
+
+    p_data = file_load(argv[optind], &size);
+
+    for (size_t offset = 0; offset + sizeof(latency_hist_header_t) <= size; offset += 4)
+    {
+        latency_hist_header_t header;
+
+        memcpy(&header, p_data + offset, sizeof(header));
+        if ((header.magic != LATENCY_HIST_MAGIC) || (header.version != LATENCY_HIST_VERSION) ||
+            (header.count == 0) || (header.count > HIST_COUNT_MAX) ||
+            (offset + sizeof(header) + header.count * sizeof(latency_hist_t) > size))
+        {
+            continue;
+        }
+
+        latency_hist_t * p_hist = malloc(header.count * sizeof(latency_hist_t));
+        bool             valid  = true;
+
+        if (p_hist == NULL)
+        {
+            perror("malloc");
+            return 1;
+        }
+        memcpy(p_hist, p_data + offset + sizeof(header), header.count * sizeof(latency_hist_t));
+        for (uint32_t i = 0; i < header.count; i++)
+        {
+            valid = valid && hist_valid(&p_hist[i]);
+        }
+
+        if (valid)
+        {
+            printf("# histograms at offset 0x%zx\n", offset);
+            printf("%-12s %10s %12s %12s %12s %12s\n", "# name", "count", "p50_us", "p90_us", "p99_us", "max_us");
+            for (uint32_t i = 0; i < header.count; i++)
+            {
+                hist_print(&p_hist[i], buckets);
+            }
+            found++;
+        }
+        free(p_hist);
+    }
+
+    free(p_data);
+
+    if (found == 0)
+    {
+        fprintf(stderr, "no latency histograms found\n");
+        return 1;
+    }
+    return 0;
+}
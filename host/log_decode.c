@@ -0,0 +1,438 @@
+/** @file
+ *
+ * @brief Host decoder of the binary log (USE_LOG_BINARY, log_binary.h): turns the frames the
+ *        firmware sends on the UART back into text.
+ *
+ * @details The records hold the flash addresses of the format strings and module names. The
+ *          decoder looks them up in the allocated sections of the ELF file of the same build,
+ *          and formats the raw arguments with them: %d %i %u %x %X %o %c %p, flags, width and
+ *          precision. A %s argument is an address too; strings in flash are found in the ELF,
+ *          others print as their address.
+ *
+ *          The input is the raw byte stream, a file or a serial port. The decoder finds frames
+ *          by their sync bytes and checksum, so it can start in the middle of a burst. Every
+ *          frame prints a line with the uptime it was sent at and the records dropped before
+ *          it. An ELF file of another build gives wrong strings, not an error: keep the ELF of
+ *          every release.
+ *
+ *          Options:
+ *              -q  no frame lines, records only
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o log_decode log_decode.c ../log_binary.c
+ *              stty -F /dev/ttyACM0 1000000 raw -echo
+ *              ./log_decode ../_build/ble_app_beacon_pca10056_s140.elf /dev/ttyACM0
+ *              ./log_decode ble_app_beacon.elf capture.bin
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log_binary.h"
+
+#define STREAM_BUF_LEN  8192
+#define TEXT_MAX_LEN    512
+#define SPEC_MAX_LEN    32
+
+#define ELF_SHT_PROGBITS    1
+#define ELF_SHF_ALLOC       0x2
+
+/**@brief Allocated section of the ELF file. */
+typedef struct
+{
+    uint32_t        addr;
+    uint32_t        size;
+    uint8_t const * p_data;
+} section_t;
+
+static section_t * m_sections;
+static uint32_t    m_section_count;
+static bool        m_quiet;
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "usage: %s [-q] <elf> [stream|-]\n", p_name);
+    exit(2);
+}
+
+
+/**@brief Load a whole file into memory. */
+static uint8_t * file_load(char const * p_path, size_t * p_size)
+{
+    FILE *    p_file = fopen(p_path, "rb");
+    uint8_t * p_data = NULL;
+    size_t    size   = 0;
+    size_t    cap    = 0;
+    size_t    n;
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        exit(1);
+    }
+
+    do
+    {
+        if (size == cap)
+        {
+            cap    = (cap == 0) ? 65536 : (cap * 2);
+            p_data = realloc(p_data, cap);
+            if (p_data == NULL)
+            {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        n     = fread(p_data + size, 1, cap - size, p_file);
+        size += n;
+    } while (n != 0);
+
+    fclose(p_file);
+    *p_size = size;
+    return p_data;
+}
+
+
+static uint32_t get_u16(uint8_t const * p_buf)
+{
+    return (uint32_t)p_buf[0] | ((uint32_t)p_buf[1] << 8);
+}
+
+
+static uint32_t get_u32(uint8_t const * p_buf)
+{
+    return get_u16(p_buf) | (get_u16(&p_buf[2]) << 16);
+}
+
+
+/**@brief Function for keeping the allocated sections with contents of a 32-bit little endian
+ *        ELF file, flash and initialised data.
+ */
+static void elf_load(char const * p_path)
+{
+    size_t    size;
+    uint8_t * p_elf = file_load(p_path, &size);
+    uint32_t  shoff;
+    uint32_t  shentsize;
+    uint32_t  shnum;
+
+    if ((size < 52) || (memcmp(p_elf, "\x7f" "ELF", 4) != 0) || (p_elf[4] != 1) || (p_elf[5] != 1))
+    {
+        fprintf(stderr, "%s: not a 32-bit little endian ELF file\n", p_path);
+        exit(1);
+    }
+    shoff     = get_u32(&p_elf[32]);
+    shentsize = get_u16(&p_elf[46]);
+    shnum     = get_u16(&p_elf[48]);
+    if ((shentsize < 40) || (shoff > size) || ((size - shoff) / shentsize < shnum))
+    {
+        fprintf(stderr, "%s: bad section headers\n", p_path);
+        exit(1);
+    }
+
+    m_sections = calloc(shnum, sizeof(section_t));
+    if (m_sections == NULL)
+    {
+        perror("calloc");
+        exit(1);
+    }
+    for (uint32_t i = 0; i < shnum; i++)
+    {
+        uint8_t const * p_sh     = &p_elf[shoff + i * shentsize];
+        uint32_t        offset   = get_u32(&p_sh[16]);
+        uint32_t        sec_size = get_u32(&p_sh[20]);
+
+        if ((get_u32(&p_sh[4]) != ELF_SHT_PROGBITS) || ((get_u32(&p_sh[8]) & ELF_SHF_ALLOC) == 0) ||
+            (offset > size) || (sec_size > size - offset))
+        {
+            continue;
+        }
+        m_sections[m_section_count++] = (section_t){ .addr   = get_u32(&p_sh[12]),
+                                                     .size   = sec_size,
+                                                     .p_data = &p_elf[offset] };
+    }
+    if (m_section_count == 0)
+    {
+        fprintf(stderr, "%s: no allocated sections\n", p_path);
+        exit(1);
+    }
+}
+
+
+/**@brief Function for finding the string at an address of the firmware.
+ *
+ * @details Record addresses are cut to 24 bits, so only those bits are compared.
+ *
+ * @return The string, NULL if no section holds a terminated one there.
+ */
+static char const * elf_string(uint32_t addr)
+{
+    for (uint32_t i = 0; i < m_section_count; i++)
+    {
+        section_t const * p_sec = &m_sections[i];
+        uint32_t          start = p_sec->addr & LOG_BINARY_ADDR_MASK;
+
+        if ((addr >= start) && (addr - start < p_sec->size))
+        {
+            uint32_t offset = addr - start;
+
+            if (memchr(&p_sec->p_data[offset], '\0', p_sec->size - offset) == NULL)
+            {
+                return NULL;
+            }
+            return (char const *)&p_sec->p_data[offset];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for formatting an entry like the firmware's printf would.
+ *
+ * @details Length modifiers are dropped, every argument is 32 bits in the record.
+ */
+static void entry_format(char * p_text, size_t size, char const * p_fmt, uint32_t const * p_args, uint32_t nargs)
+{
+    size_t   len = 0;
+    uint32_t arg = 0;
+
+#define TEXT_ADD(...)                                                   \
+    do                                                                  \
+    {                                                                   \
+        int n = snprintf(&p_text[len], size - len, __VA_ARGS__);        \
+        len   = ((n >= 0) && ((size_t)n < size - len)) ? len + n : size - 1; \
+    } while (0)
+#define NEXT_ARG()  ((arg < nargs) ? p_args[arg++] : 0)
+
+    p_text[0] = '\0';
+    while ((*p_fmt != '\0') && (len < size - 1))
+    {
+        char spec[SPEC_MAX_LEN];
+        int  spec_len = 0;
+        int  width    = -1;
+
+        if (*p_fmt != '%')
+        {
+            p_text[len++] = *p_fmt++;
+            p_text[len]   = '\0';
+            continue;
+        }
+
+        spec[spec_len++] = *p_fmt++;
+        while ((strchr("-+ #0", *p_fmt) != NULL) && (*p_fmt != '\0') && (spec_len < SPEC_MAX_LEN - 4))
+        {
+            spec[spec_len++] = *p_fmt++;
+        }
+        if (*p_fmt == '*')
+        {
+            width = (int32_t)NEXT_ARG();
+            spec[spec_len++] = *p_fmt++;
+        }
+        while ((((*p_fmt >= '0') && (*p_fmt <= '9')) || (*p_fmt == '.')) && (spec_len < SPEC_MAX_LEN - 4))
+        {
+            spec[spec_len++] = *p_fmt++;
+        }
+        while ((*p_fmt == 'l') || (*p_fmt == 'h') || (*p_fmt == 'z') || (*p_fmt == 't'))
+        {
+            p_fmt++;
+        }
+        spec[spec_len++] = *p_fmt;
+        spec[spec_len]   = '\0';
+
+        switch (*p_fmt)
+        {
+            case '%':
+                TEXT_ADD("%%");
+                break;
+            case 'd':
+            case 'i':
+                if (width >= 0) TEXT_ADD(spec, width, (int)(int32_t)NEXT_ARG());
+                else            TEXT_ADD(spec, (int)(int32_t)NEXT_ARG());
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                if (width >= 0) TEXT_ADD(spec, width, (unsigned)NEXT_ARG());
+                else            TEXT_ADD(spec, (unsigned)NEXT_ARG());
+                break;
+            case 'c':
+                if (width >= 0) TEXT_ADD(spec, width, (int)(uint8_t)NEXT_ARG());
+                else            TEXT_ADD(spec, (int)(uint8_t)NEXT_ARG());
+                break;
+            case 'p':
+                TEXT_ADD("0x%08x", (unsigned)NEXT_ARG());
+                break;
+            case 's':
+            {
+                uint32_t     addr  = NEXT_ARG();
+                char const * p_str = NULL;
+                char         ram[16];
+
+                // Above 16 MB is RAM, a string the ELF file does not have.
+                if ((addr & ~LOG_BINARY_ADDR_MASK) == 0)
+                {
+                    p_str = elf_string(addr);
+                }
+                if (p_str == NULL)
+                {
+                    snprintf(ram, sizeof(ram), "<0x%08x>", (unsigned)addr);
+                    p_str = ram;
+                }
+                if (width >= 0) TEXT_ADD(spec, width, p_str);
+                else            TEXT_ADD(spec, p_str);
+                break;
+            }
+            case '\0':
+                return;
+            default:
+                TEXT_ADD("%s", spec);
+                break;
+        }
+        p_fmt++;
+    }
+
+#undef NEXT_ARG
+#undef TEXT_ADD
+}
+
+
+static void record_print(log_binary_record_t const * p_record)
+{
+    static char const * const severities[] = { "none", "error", "warning", "info", "debug" };
+    char const *              p_severity   = (p_record->severity < 5) ? severities[p_record->severity] : "?";
+    char const *              p_module     = elf_string(p_record->module_addr);
+    char                      text[TEXT_MAX_LEN];
+
+    if (p_module == NULL)
+    {
+        p_module = "?";
+    }
+
+    if (p_record->dump)
+    {
+        printf("<%s> %s:", p_severity, p_module);
+        for (uint32_t i = 0; i < p_record->len; i++)
+        {
+            printf("%s%02x", ((i % 16) == 0) ? "\n    " : " ", p_record->p_data[i]);
+        }
+        printf("\n");
+        return;
+    }
+
+    {
+        char const * p_fmt = elf_string(p_record->fmt_addr);
+
+        if (p_fmt == NULL)
+        {
+            printf("<%s> %s: unknown format at 0x%06x, %u arguments\n", p_severity, p_module,
+                   (unsigned)p_record->fmt_addr, (unsigned)p_record->nargs);
+            return;
+        }
+        entry_format(text, sizeof(text), p_fmt, p_record->args, p_record->nargs);
+        printf("<%s> %s: %s\n", p_severity, p_module, text);
+    }
+}
+
+
+int main(int argc, char * argv[])
+{
+    static uint8_t stream[STREAM_BUF_LEN];
+    uint32_t       have    = 0;
+    uint64_t       skipped = 0;
+    uint64_t       frames  = 0;
+    uint64_t       dropped = 0;
+    bool           end     = false;
+    int            fd      = STDIN_FILENO;
+    int            opt;
+
+    while ((opt = getopt(argc, argv, "q")) != -1)
+    {
+        switch (opt)
+        {
+            case 'q': m_quiet = true; break;
+            default:  usage(argv[0]);
+        }
+    }
+    if (optind >= argc)
+    {
+        usage(argv[0]);
+    }
+    elf_load(argv[optind]);
+    if ((optind + 1 < argc) && (strcmp(argv[optind + 1], "-") != 0))
+    {
+        fd = open(argv[optind + 1], O_RDONLY);
+        if (fd < 0)
+        {
+            perror(argv[optind + 1]);
+            return 1;
+        }
+    }
+
+    // A serial port gives what it has, so frames are taken as soon as they are whole.
+    while (!end || (have > 0))
+    {
+        log_binary_frame_t  frame;
+        log_binary_record_t record;
+        uint32_t            used;
+        log_binary_parse_t  result;
+
+        if (!end && (have < sizeof(stream)))
+        {
+            ssize_t n = read(fd, &stream[have], sizeof(stream) - have);
+
+            if (n <= 0)
+            {
+                end = true;
+            }
+            else
+            {
+                have += (uint32_t)n;
+            }
+        }
+
+        result = log_binary_frame_parse(stream, have, &frame, &used);
+        while ((result == LOG_BINARY_PARSE_BAD) ||
+               ((end || (have == sizeof(stream))) && (result == LOG_BINARY_PARSE_MORE) && (have > 0)))
+        {
+            memmove(stream, &stream[1], --have);
+            skipped++;
+            result = log_binary_frame_parse(stream, have, &frame, &used);
+        }
+        if (result != LOG_BINARY_PARSE_OK)
+        {
+            continue;
+        }
+
+        frames++;
+        dropped += frame.dropped;
+        if (!m_quiet)
+        {
+            printf("# frame at %u.%03u s%s", (unsigned)(frame.uptime_ms / 1000), (unsigned)(frame.uptime_ms % 1000),
+                   (frame.dropped > 0) ? "" : "\n");
+            if (frame.dropped > 0)
+            {
+                printf(", %u records dropped before it\n", (unsigned)frame.dropped);
+            }
+        }
+        while (log_binary_record_next(&frame, &record))
+        {
+            record_print(&record);
+        }
+        fflush(stdout);
+
+        have -= used;
+        memmove(stream, &stream[used], have);
+    }
+
+    fprintf(stderr, "%llu frames, %llu records dropped, %llu bytes skipped\n",
+            (unsigned long long)frames, (unsigned long long)dropped, (unsigned long long)skipped);
+    return 0;
+}
@@ -0,0 +1,411 @@
+/** @file
+ *
+ * @brief Host model of the PPI tone counter (USE_PPI_TONE_COUNTER).
+ *
+ * @details Interprets TONE_COUNTER_PPI_LINKS from tone_counter.h against a model of LPCOMP,
+ *          the burst window timer (TIMER1 at 31.25 kHz, or RTC2 at 32.768 kHz with -r) and
+ *          TIMER2 (counter), plus the CPU side of the CC0/CC2 handlers in main.c. Rising edge
+ *          timestamps in microseconds are read from stdin, one per line ('#' starts a comment).
+ *          Every closed burst window is printed and a summary goes to stderr.
+ *
+ *          The summary includes how long the burst window ran and how long it kept the high
+ *          frequency clock requested (all of it for TIMER1, none for RTC2). With -H and -L,
+ *          the bench-measured extra current of a running TIMER1 and RTC2 window in uA, it
+ *          also gives the charge and the average current of the window for the input.
+ *
+ *          With -e the run is a check: the closed windows and the detections must match the
+ *          expected ones, or the exit status is 1. With -t the model runs its own cases on
+ *          both backends instead of reading stdin: a 3-tone burst detects, 2 and 4 tones do
+ *          not, raw 3 kHz carrier tones count once each because LPCOMP stays stopped until
+ *          the CC1 re-arm, and two bursts apart give two windows. Any mismatch fails.
+ *
+ *          Options:
+ *              -r         RTC2 burst window (USE_RTC_BURST_TIMER)
+ *              -H <uA>    measured extra current while the TIMER1 window runs
+ *              -L <uA>    measured extra current while the RTC2 window runs
+ *              -e <w,d>   expected windows and detections for the input
+ *              -t         run the built-in cases on TIMER1 and RTC2
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o tone_counter_model tone_counter_model.c
+ *              ./tone_counter_model -t
+ *              printf "0\n1000000\n2000000\n" | ./tone_counter_model -e 1,1
+ *              printf "0\n1000000\n2000000\n" | ./tone_counter_model -r -H 250 -L 0.1
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tone_counter.h"
+
+#define WINDOW_CC_COUNT 3
+#define CARRIER_HALF_US 167                                 /**< Half period of a raw 3 kHz horn. */
+#define CASE_EDGES_MAX  20000
+
+/**@brief State of the modelled peripherals. */
+typedef struct
+{
+    bool     lpcomp_running;    /**< LPCOMP started (edges generate EVENTS_UP). */
+    bool     window_running;    /**< Burst window timer started. */
+    uint32_t window_value;      /**< Burst window counter value, in ticks. */
+    uint32_t counter;           /**< TIMER2 counter value. */
+    uint64_t now;               /**< Model time, in ticks. */
+
+    uint64_t edges;             /**< Rising edges presented to LPCOMP. */
+    uint64_t edges_counted;     /**< Edges that reached TIMER2 TASKS_COUNT. */
+    uint64_t cpu_wakeups;       /**< Interrupts taken by the CPU. */
+    uint64_t windows;           /**< Burst windows closed (CC0). */
+    uint64_t detections;        /**< Burst windows that matched an alarm burst. */
+    uint64_t window_ticks;      /**< Ticks the burst window timer was running. */
+} model_t;
+
+/**@brief Burst window timer backend. */
+typedef struct
+{
+    char const * p_name;
+    uint32_t     tick_hz;
+    bool         hfclk;         /**< Keeps the high frequency clock requested while running. */
+    uint32_t     cc[WINDOW_CC_COUNT];
+} backend_t;
+
+static const backend_t m_timer1 =
+{
+    "TIMER1", 1000000 / TONE_COUNTER_TICK_US, true,
+    { TONE_COUNTER_CC0_TICKS, TONE_COUNTER_CC1_TICKS, TONE_COUNTER_CC2_TICKS }
+};
+
+static const backend_t m_rtc2 =
+{
+    "RTC2", TONE_COUNTER_RTC_FREQ_HZ, false,
+    { TONE_COUNTER_RTC_CC0_TICKS, TONE_COUNTER_RTC_CC1_TICKS, TONE_COUNTER_RTC_CC2_TICKS }
+};
+
+static backend_t const * mp_backend = &m_timer1;
+static bool              m_verbose   = true;                /**< Print every window. */
+
+static const tone_counter_link_t m_links[TONE_COUNTER_PPI_LINK_COUNT] = TONE_COUNTER_PPI_LINKS;
+
+static uint64_t ticks_to_us(uint64_t ticks)
+{
+    return ticks * 1000000 / mp_backend->tick_hz;
+}
+
+
+static void task_trigger(model_t * p_model, tone_counter_task_t task)
+{
+    switch (task)
+    {
+        case TONE_COUNTER_TASK_COUNT:
+            p_model->counter = (p_model->counter + 1) & 0xFFFF;
+            p_model->edges_counted++;
+            break;
+
+        case TONE_COUNTER_TASK_LPCOMP_START:
+            p_model->lpcomp_running = true;
+            break;
+
+        case TONE_COUNTER_TASK_LPCOMP_STOP:
+            p_model->lpcomp_running = false;
+            break;
+
+        case TONE_COUNTER_TASK_WINDOW_CLEAR:
+            p_model->window_value = 0;
+            break;
+
+        case TONE_COUNTER_TASK_WINDOW_START:
+            p_model->window_running = true;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+static void event_generate(model_t * p_model, tone_counter_evt_t event)
+{
+    for (uint32_t i = 0; i < TONE_COUNTER_PPI_LINK_COUNT; i++)
+    {
+        if (m_links[i].event == event)
+        {
+            task_trigger(p_model, m_links[i].task);
+            task_trigger(p_model, m_links[i].fork);
+        }
+    }
+}
+
+
+/**@brief CPU side of a burst window compare, mirrors nrfx_timer_event_handler in main.c. */
+static void window_compare(model_t * p_model, uint32_t channel)
+{
+    switch (channel)
+    {
+        case 0:
+        {
+            uint32_t count    = p_model->counter;
+            bool     detected = tone_counter_burst_detected(count);
+
+            p_model->counter = 0;
+            p_model->cpu_wakeups++;
+            p_model->windows++;
+            p_model->detections += detected ? 1 : 0;
+            if (m_verbose)
+            {
+                printf("%" PRIu64 " window count=%" PRIu32 " detected=%d\n",
+                       ticks_to_us(p_model->now), count, detected ? 1 : 0);
+            }
+        } break;
+
+        case 1:
+            event_generate(p_model, TONE_COUNTER_EVT_WINDOW_COMPARE1);
+            break;
+
+        case 2:
+            p_model->cpu_wakeups++;
+            p_model->window_running = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**@brief Advance model time to @p to, firing every compare event on the way. */
+static void advance(model_t * p_model, uint64_t to)
+{
+    while (p_model->window_running && (p_model->now < to))
+    {
+        uint32_t step    = UINT32_MAX;
+        uint32_t channel = WINDOW_CC_COUNT;
+
+        for (uint32_t i = 0; i < WINDOW_CC_COUNT; i++)
+        {
+            uint32_t cc = mp_backend->cc[i];
+
+            if ((cc > p_model->window_value) &&
+                (cc - p_model->window_value < step))
+            {
+                step    = cc - p_model->window_value;
+                channel = i;
+            }
+        }
+
+        if ((channel == WINDOW_CC_COUNT) || (p_model->now + step > to))
+        {
+            p_model->window_value += (uint32_t)(to - p_model->now);
+            p_model->window_ticks += to - p_model->now;
+            p_model->now           = to;
+            break;
+        }
+
+        p_model->now          += step;
+        p_model->window_value += step;
+        p_model->window_ticks += step;
+        window_compare(p_model, channel);
+    }
+
+    if (p_model->now < to)
+    {
+        p_model->now = to;
+    }
+}
+
+
+/**@brief Function for presenting one rising edge to LPCOMP. */
+static void edge(model_t * p_model, uint64_t t_us)
+{
+    advance(p_model, t_us * mp_backend->tick_hz / 1000000);
+
+    p_model->edges++;
+    if (p_model->lpcomp_running)
+    {
+        event_generate(p_model, TONE_COUNTER_EVT_LPCOMP_UP);
+    }
+}
+
+
+/**@brief Function for letting the last burst window run out. */
+static void finish(model_t * p_model)
+{
+    advance(p_model, p_model->now + mp_backend->cc[2] + 1);
+}
+
+
+/**@brief Function for the rising edges of tones: envelope tones give one edge each, carrier
+ *        tones a rising edge every 3 kHz period for their length.
+ *
+ * @return Number of edges.
+ */
+static uint32_t tones_make(uint64_t * p_edges, uint32_t tones, uint64_t start_us, uint64_t period_us,
+                           uint64_t length_us, bool carrier)
+{
+    uint32_t count = 0;
+
+    for (uint32_t tone = 0; tone < tones; tone++)
+    {
+        uint64_t on_us = start_us + tone * period_us;
+
+        for (uint64_t t = 0; (t == 0) || (carrier && (t < length_us)); t += 2 * CARRIER_HALF_US)
+        {
+            if (count < CASE_EDGES_MAX)
+            {
+                p_edges[count++] = on_us + t;
+            }
+        }
+    }
+    return count;
+}
+
+
+/**@brief Function for running the built-in cases on the selected backend.
+ *
+ * @return Number of failed cases.
+ */
+static uint32_t cases_run(void)
+{
+    static uint64_t edges[CASE_EDGES_MAX];
+    static const struct
+    {
+        char const * p_name;
+        uint32_t     bursts;
+        uint32_t     tones;
+        uint64_t     length_us;
+        bool         carrier;
+        uint64_t     windows;
+        uint64_t     detections;
+    } cases[] =
+    {
+        { "3 tones",                      1, 3, 500000, false, 1, 1 },
+        { "2 tones",                      1, 2, 500000, false, 1, 0 },
+        { "4 tones",                      1, 4, 500000, false, 1, 0 },
+        { "3 carrier tones, 0.5 s",       1, 3, 500000, true,  1, 1 },
+        { "3 carrier tones, up to CC1",   1, 3, 700000, true,  1, 1 },
+        { "2 carrier tones",              1, 2, 500000, true,  1, 0 },
+        { "two bursts 10 s apart",        2, 3, 500000, false, 2, 2 },
+    };
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        model_t  model = { .lpcomp_running = true };
+        uint32_t count = 0;
+        bool     pass;
+
+        for (uint32_t burst = 0; burst < cases[i].bursts; burst++)
+        {
+            count += tones_make(&edges[count], cases[i].tones, 1000000 + burst * 10000000ULL, 1000000,
+                                cases[i].length_us, cases[i].carrier);
+        }
+        for (uint32_t n = 0; n < count; n++)
+        {
+            edge(&model, edges[n]);
+        }
+        finish(&model);
+
+        pass = (model.windows == cases[i].windows) && (model.detections == cases[i].detections) &&
+               (model.edges_counted == (uint64_t)cases[i].bursts * cases[i].tones);
+        failed += pass ? 0 : 1;
+        printf("%-6s %-28s windows %" PRIu64 "/%" PRIu64 ", detections %" PRIu64 "/%" PRIu64
+               ", tones counted %" PRIu64 "/%" PRIu32 "  %s\n",
+               mp_backend->p_name, cases[i].p_name, model.windows, cases[i].windows, model.detections,
+               cases[i].detections, model.edges_counted, cases[i].bursts * cases[i].tones, pass ? "ok" : "FAIL");
+    }
+    return failed;
+}
+
+
+int main(int argc, char * argv[])
+{
+    model_t  model      = { .lpcomp_running = true };
+    double   timer1_ua  = -1;
+    double   rtc2_ua    = -1;
+    bool     test       = false;
+    bool     expect     = false;
+    uint64_t windows    = 0;
+    uint64_t detections = 0;
+    char     line[128];
+    int      opt;
+
+    while ((opt = getopt(argc, argv, "rH:L:e:t")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': mp_backend = &m_rtc2;             break;
+            case 'H': timer1_ua  = strtod(optarg, NULL); break;
+            case 'L': rtc2_ua    = strtod(optarg, NULL); break;
+            case 't': test       = true;                 break;
+            case 'e':
+                if (sscanf(optarg, "%" SCNu64 ",%" SCNu64, &windows, &detections) != 2)
+                {
+                    fprintf(stderr, "-e needs windows,detections\n");
+                    return 2;
+                }
+                expect = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r] [-H uA] [-L uA] [-e windows,detections] < edges\n"
+                                "       %s -t\n", argv[0], argv[0]);
+                return 2;
+        }
+    }
+
+    if (test)
+    {
+        uint32_t failed;
+
+        m_verbose  = false;
+        mp_backend = &m_timer1;
+        failed     = cases_run();
+        mp_backend = &m_rtc2;
+        failed    += cases_run();
+        printf("%s\n", (failed == 0) ? "all cases pass" : "FAILED");
+        return (failed == 0) ? 0 : 1;
+    }
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        char *   p_end;
+        uint64_t t_us = strtoull(line, &p_end, 10);
+
+        if ((p_end == line) || (line[0] == '#'))
+        {
+            continue;
+        }
+        edge(&model, t_us);
+    }
+    finish(&model);
+
+    fprintf(stderr,
+            "edges %" PRIu64 ", counted %" PRIu64 ", cpu wakeups %" PRIu64
+            ", windows %" PRIu64 ", detections %" PRIu64 "\n",
+            model.edges, model.edges_counted, model.cpu_wakeups,
+            model.windows, model.detections);
+
+    double run_s   = (double)ticks_to_us(model.window_ticks) * 1e-6;
+    double total_s = (double)ticks_to_us(model.now) * 1e-6;
+    double ua      = mp_backend->hfclk ? timer1_ua : rtc2_ua;
+
+    fprintf(stderr,
+            "%s burst window: ran %.3f s of %.3f s, HFCLK requested %.3f s\n",
+            mp_backend->p_name, run_s, total_s, mp_backend->hfclk ? run_s : 0.0);
+
+    if (ua >= 0)
+    {
+        fprintf(stderr,
+                "%s burst window: %.1f uC at %.2f uA, %.3f uA average\n",
+                mp_backend->p_name, run_s * ua, ua, (total_s > 0) ? (run_s * ua / total_s) : 0.0);
+    }
+
+    if (expect && ((model.windows != windows) || (model.detections != detections)))
+    {
+        fprintf(stderr, "expected %" PRIu64 " windows and %" PRIu64 " detections\n", windows, detections);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,304 @@
+/** @file
+ *
+ * @brief Synthetic edge streams for the pattern tables in tone_pattern.c.
+ *
+ * @details For every pattern table (or the one chosen with -p) three edge streams of several
+ *          alarm cycles are generated from the table's segment limits: one UP/DOWN pair per
+ *          tone, a raw 3 kHz carrier, and one pair per tone with random timing jitter. Each
+ *          stream runs through tone_detect.c the way main.c drives it: tone_detect_edge() for
+ *          every edge, tone_detect_poll() every main loop pass and tone_detect_timeout() when
+ *          the burst timer runs out. The table of the stream must raise one alarm per cycle
+ *          and no other table may raise any; every deviation is printed and the exit status
+ *          is 1. With -o one stream (chosen with -r and -j, no jitter by default) is written to stdout instead, one
+ *          "<timestamp_us> <U|D>" line per edge.
+ *
+ *          Options:
+ *              -p <id>    only this pattern table
+ *              -c <n>     cycles per stream (default 3)
+ *              -j <pct>   timing jitter of the jitter stream in percent of the nominal duration (default 8)
+ *              -r         with -o, raw 3 kHz carrier instead of one UP/DOWN pair per tone
+ *              -s <seed>  jitter seed
+ *              -o         write the edge stream to stdout
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o tone_pattern_synth tone_pattern_synth.c \
+ *                 ../edge_decoder.c ../tone_pattern.c ../tone_confidence.c ../tone_detect.c
+ *              ./tone_pattern_synth
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tone_detect.h"
+
+#define CARRIER_HALF_PERIOD_US  167                         /**< Half period of a 3 kHz horn. */
+#define LOOP_PERIOD_US          10000                       /**< Main loop passes, each polls the detector. */
+#define JITTER_DEFAULT_PCT      8
+
+/**@brief Options and running state of one stream. */
+typedef struct
+{
+    uint32_t               cycles;
+    uint32_t               jitter_pct;
+    bool                   raw;
+    bool                   output;
+    uint32_t               seed;
+
+    tone_detect_t          detect;
+    uint32_t               now;                             /**< Time of the last main loop pass. */
+    uint32_t               last_edge;
+    bool                   timer_running;                   /**< Burst timer armed. */
+    bool                   timer_restart;                   /**< Restart asked for by the last edge. */
+    uint32_t               timer_expiry;
+    uint32_t               matches[TONE_PATTERN_MAX];
+} synth_t;
+
+
+static uint32_t rand_next(uint32_t * p_seed)
+{
+    *p_seed = (*p_seed * 1103515245UL) + 12345UL;
+    return (*p_seed >> 8);
+}
+
+
+/**@brief Duration of a segment: nominal (the middle of its limits) plus jitter, kept within limits. */
+static uint32_t segment_duration(synth_t * p_synth, tone_pattern_segment_t const * p_segment)
+{
+    uint32_t nominal = (p_segment->max_us == TONE_PATTERN_OPEN)
+                     ? (p_segment->min_us + p_segment->min_us / 9)
+                     : (p_segment->min_us + (p_segment->max_us - p_segment->min_us) / 2);
+
+    if (p_synth->jitter_pct != 0)
+    {
+        uint32_t span   = (nominal / 100) * p_synth->jitter_pct;
+        int64_t  offset = (int64_t)(rand_next(&p_synth->seed) % (2 * span + 1)) - span;
+
+        nominal = (uint32_t)((int64_t)nominal + offset);
+    }
+
+    if (nominal < p_segment->min_us)
+    {
+        nominal = p_segment->min_us;
+    }
+    if (nominal > p_segment->max_us)
+    {
+        nominal = p_segment->max_us;
+    }
+
+    return nominal;
+}
+
+
+static void hal_tone_set(bool on, void * p_context)
+{
+    (void)on;
+    (void)p_context;
+}
+
+
+static void hal_alarm_set(bool on, uint32_t matched, uint32_t timestamp, void * p_context)
+{
+    synth_t * p_synth = p_context;
+
+    (void)timestamp;
+    for (uint32_t i = 0; on && (i < tone_pattern_count()); i++)
+    {
+        if (matched & (1UL << i))
+        {
+            p_synth->matches[i]++;
+        }
+    }
+}
+
+
+static void hal_burst_timer_restart(void * p_context)
+{
+    synth_t * p_synth = p_context;
+
+    p_synth->timer_restart = true;
+}
+
+
+static const tone_detect_hal_t m_hal =
+{
+    .tone_set            = hal_tone_set,
+    .alarm_set           = hal_alarm_set,
+    .burst_timer_restart = hal_burst_timer_restart,
+};
+
+
+/**@brief Run main loop passes up to a time, with the burst timer expiring in between. */
+static void loop_run(synth_t * p_synth, uint32_t until)
+{
+    while ((int32_t)(until - p_synth->now) >= LOOP_PERIOD_US)
+    {
+        p_synth->now += LOOP_PERIOD_US;
+        if (p_synth->timer_running && ((int32_t)(p_synth->now - p_synth->timer_expiry) >= 0))
+        {
+            p_synth->timer_running = false;
+            tone_detect_timeout(&p_synth->detect, p_synth->timer_expiry);
+        }
+        tone_detect_poll(&p_synth->detect, p_synth->now);
+    }
+}
+
+
+static void edge(synth_t * p_synth, uint32_t timestamp, bool up)
+{
+    if (p_synth->output)
+    {
+        printf("%" PRIu32 " %c\n", timestamp, up ? 'U' : 'D');
+    }
+    else
+    {
+        loop_run(p_synth, timestamp);
+        tone_detect_edge(&p_synth->detect, timestamp, up);
+        if (p_synth->timer_restart)
+        {
+            p_synth->timer_restart = false;
+            p_synth->timer_running = true;
+            p_synth->timer_expiry  = timestamp + TONE_PATTERN_SILENCE_US;
+        }
+    }
+}
+
+
+static void tone(synth_t * p_synth, uint32_t start, uint32_t duration)
+{
+    if (!p_synth->raw)
+    {
+        edge(p_synth, start, true);
+        edge(p_synth, start + duration, false);
+        return;
+    }
+
+    for (uint32_t t = 0; t + 2 * CARRIER_HALF_PERIOD_US <= duration; t += 2 * CARRIER_HALF_PERIOD_US)
+    {
+        edge(p_synth, start + t, true);
+        edge(p_synth, start + t + CARRIER_HALF_PERIOD_US, false);
+    }
+}
+
+
+/**@brief Generate and detect one stream of the given pattern. */
+static void stream_run(synth_t * p_synth, tone_pattern_t const * p_pattern)
+{
+    static const tone_detect_config_t config = TONE_DETECT_DEFAULT_CONFIG;
+    uint32_t                          now    = 1000;
+
+    tone_detect_init(&p_synth->detect, &config, &m_hal, p_synth);
+    p_synth->now           = 0;
+    p_synth->timer_running = false;
+    p_synth->timer_restart = false;
+    memset(p_synth->matches, 0, sizeof(p_synth->matches));
+
+    for (uint32_t cycle = 0; cycle < p_synth->cycles; cycle++)
+    {
+        for (uint32_t i = 0; i < p_pattern->segment_count; i++)
+        {
+            tone_pattern_segment_t const * p_segment = &p_pattern->p_segments[i];
+            uint32_t                       duration  = segment_duration(p_synth, p_segment);
+
+            if (p_segment->on)
+            {
+                tone(p_synth, now, duration);
+            }
+            now += duration;
+        }
+    }
+
+    if (!p_synth->output)
+    {
+        // Long enough for the burst timer to run out after the last tone.
+        loop_run(p_synth, now + TONE_PATTERN_SILENCE_US + LOOP_PERIOD_US);
+    }
+}
+
+
+/**@brief Run one stream and compare the alarms with one per cycle of its own table.
+ *
+ * @return Number of deviations.
+ */
+static uint32_t stream_check(synth_t * p_synth, uint32_t id, char const * p_kind)
+{
+    uint32_t failures = 0;
+
+    stream_run(p_synth, tone_pattern_get(id));
+
+    printf("%-12s %-8s %" PRIu32 " cycles:", tone_pattern_get(id)->p_name, p_kind, p_synth->cycles);
+    for (uint32_t i = 0; i < tone_pattern_count(); i++)
+    {
+        uint32_t expected = (i == id) ? p_synth->cycles : 0;
+
+        printf(" %s=%" PRIu32, tone_pattern_get(i)->p_name, p_synth->matches[i]);
+        failures += (p_synth->matches[i] != expected) ? 1 : 0;
+    }
+    printf("%s\n", (failures == 0) ? "" : "  MISMATCH");
+
+    return failures;
+}
+
+
+int main(int argc, char * argv[])
+{
+    synth_t  synth      = { .cycles = 3, .seed = 1 };
+    int32_t  only_id    = -1;
+    uint32_t jitter_pct = JITTER_DEFAULT_PCT;
+    bool     jitter     = false;
+    uint32_t failures   = 0;
+    int      opt;
+
+    while ((opt = getopt(argc, argv, "p:c:j:rs:o")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p': only_id      = atoi(optarg);                       break;
+            case 'c': synth.cycles = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'j': jitter_pct   = (uint32_t)strtoul(optarg, NULL, 0);
+                      jitter       = true;                               break;
+            case 'r': synth.raw    = true;                               break;
+            case 's': synth.seed   = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'o': synth.output = true;                               break;
+            default:
+                fprintf(stderr, "usage: %s [-p id] [-c cycles] [-j pct] [-r] [-s seed] [-o]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for (uint32_t id = 0; id < tone_pattern_count(); id++)
+    {
+        if ((only_id >= 0) && ((uint32_t)only_id != id))
+        {
+            continue;
+        }
+
+        if (synth.output)
+        {
+            synth.jitter_pct = jitter ? jitter_pct : 0;
+            stream_run(&synth, tone_pattern_get(id));
+            continue;
+        }
+
+        synth.raw        = false;
+        synth.jitter_pct = 0;
+        failures        += stream_check(&synth, id, "envelope");
+        synth.raw        = true;
+        failures        += stream_check(&synth, id, "carrier");
+        synth.raw        = false;
+        synth.jitter_pct = jitter_pct;
+        failures        += stream_check(&synth, id, "jitter");
+    }
+
+    if (synth.output)
+    {
+        return 0;
+    }
+    printf("%s\n", (failures == 0) ? "all streams match" : "MISMATCH");
+    return (failures == 0) ? 0 : 1;
+}
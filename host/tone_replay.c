@@ -0,0 +1,710 @@
+/** @file
+ *
+ * @brief Replay benchmark of the tone detector core (tone_detect.c).
+ *
+ * @details Loads an edge stream into memory and runs it through the detector in virtual time,
+ *          once per parameter set. The burst timer of main.c (Timer 1 CC2) is emulated: every
+ *          tone start arms a deadline TONE_PATTERN_SILENCE_US later and when the next edge is
+ *          past the deadline the detector gets tone_detect_timeout() at the deadline time.
+ *
+ *          The stream is either an edge file, one "<timestamp_us> <U|D>" line per edge
+ *          ('#' starts a comment, timestamps are 64-bit and must not decrease), or a synthetic
+ *          scenario (-S) of temporal-3/temporal-4 alarm episodes and random noise tones
+ *          separated by quiet periods.
+ *
+ *          Detections are scored against labels, one "<start_us> <end_us>" line per alarm
+ *          episode. A detection between the start of a label and TONE_PATTERN_SILENCE_US after
+ *          its end is a true positive (the first one per label) or a repeat; any other
+ *          detection is a false positive and a label without a detection is a false negative.
+ *          Latency is measured from the label start to the detection in virtual time.
+ *
+ *          With -b some pauses inside the alarm episodes get a short blip (20 to 60 ms) of
+ *          another sound, which is what tone rejection (-R) is for. With -m some noise bursts
+ *          are a single alarm cycle with sloppier timing (up to +-15 %), like a beeping
+ *          appliance, which is what the confidence policies (-P) are for.
+ *
+ *          For every combination of the -g, -k, -R and -P values one line is printed with the
+ *          throughput (host time spent in the detector only), the detection counts and the
+ *          latency.
+ *
+ *          Options:
+ *              -S <hours>   synthetic scenario of this length instead of an edge file
+ *              -r           synthetic tones as a raw 3 kHz carrier (about 6000 edges per second of tone)
+ *              -s <seed>    synthetic scenario seed
+ *              -l <file>    labels of the edge file
+ *              -o <file>    write the loaded or generated edges to this file
+ *              -L <file>    write the labels to this file
+ *              -g <list>    comma separated gap_us values (default EDGE_DECODER_DEFAULT_GAP_US)
+ *              -k <list>    comma separated slack_us values (default 0)
+ *              -R <list>    comma separated tone rejection settings, 0 or 1 (default 1)
+ *              -b <pct>     synthetic blips in this percentage of the alarm pauses (default 0)
+ *              -m <pct>     synthetic single-cycle mimics in this percentage of the noise bursts (default 0)
+ *              -P <list>    comma separated confidence policies window/required/min_confidence
+ *                           (default 1/1/0, every cycle fires)
+ *              -n <n>       replays per parameter set, the fastest one is reported (default 1)
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o tone_replay tone_replay.c \
+ *                 ../edge_decoder.c ../tone_pattern.c ../tone_confidence.c ../tone_detect.c
+ *              ./tone_replay -S 24 -r -g 5000,20000,50000 -k 0,20000,50000
+ *              ./tone_replay -S 24 -b 30 -R 0,1
+ *              ./tone_replay -S 24 -m 30 -P 1/1/0,1/1/70,2/2/0,3/2/0
+ *              ./tone_replay -l alarm.labels alarm.edges
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tone_detect.h"
+
+#define CARRIER_HALF_PERIOD_US  167                         /**< Half period of a 3 kHz horn. */
+#define GRID_MAX                16                          /**< Maximum number of values per -g/-k/-R list. */
+
+/**@brief Edge stream, timestamps with the edge direction in bit 0. */
+typedef struct
+{
+    uint64_t * p_edges;
+    size_t     count;
+    size_t     capacity;
+} edge_stream_t;
+
+/**@brief Alarm episode. */
+typedef struct
+{
+    uint64_t start;
+    uint64_t end;
+} label_t;
+
+typedef struct
+{
+    label_t * p_labels;
+    size_t    count;
+    size_t    capacity;
+} label_list_t;
+
+/**@brief State of one replay. */
+typedef struct
+{
+    tone_detect_t        detect;
+    uint64_t             now;                               /**< Virtual time of the call into the detector. */
+    uint64_t             deadline;                          /**< Burst timer expiry. */
+    bool                 timer_running;
+
+    label_list_t const * p_labels;
+    size_t               label;                             /**< First label that can still be detected. */
+    bool *               p_hit;                             /**< Per label, detected. */
+    uint64_t             alarms;
+    uint64_t             true_positives;
+    uint64_t             false_positives;
+    uint64_t             repeats;
+    uint64_t             latency_sum;
+    uint64_t             latency_max;
+} replay_t;
+
+
+static void * grow(void * p, size_t * p_capacity, size_t size)
+{
+    *p_capacity = (*p_capacity == 0) ? 4096 : (*p_capacity * 2);
+    p           = realloc(p, *p_capacity * size);
+
+    if (p == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+
+static void edge_add(edge_stream_t * p_stream, uint64_t timestamp, bool up)
+{
+    if (p_stream->count == p_stream->capacity)
+    {
+        p_stream->p_edges = grow(p_stream->p_edges, &p_stream->capacity, sizeof(uint64_t));
+    }
+    p_stream->p_edges[p_stream->count++] = (timestamp << 1) | (up ? 1 : 0);
+}
+
+
+static void label_add(label_list_t * p_list, uint64_t start, uint64_t end)
+{
+    if (p_list->count == p_list->capacity)
+    {
+        p_list->p_labels = grow(p_list->p_labels, &p_list->capacity, sizeof(label_t));
+    }
+    p_list->p_labels[p_list->count++] = (label_t){ start, end };
+}
+
+
+static FILE * file_open(char const * p_path, char const * p_mode)
+{
+    FILE * p_file = (strcmp(p_path, "-") == 0) ? ((p_mode[0] == 'r') ? stdin : stdout)
+                                               : fopen(p_path, p_mode);
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        exit(1);
+    }
+    return p_file;
+}
+
+
+static void edges_load(edge_stream_t * p_stream, char const * p_path)
+{
+    FILE *   p_file = file_open(p_path, "r");
+    char     line[128];
+    uint64_t last   = 0;
+
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        uint64_t timestamp;
+        char     edge;
+
+        if ((line[0] == '#') || (sscanf(line, "%" SCNu64 " %c", &timestamp, &edge) != 2))
+        {
+            continue;
+        }
+        if (timestamp < last)
+        {
+            fprintf(stderr, "%s: timestamp %" PRIu64 " goes back in time\n", p_path, timestamp);
+            exit(1);
+        }
+        last = timestamp;
+        edge_add(p_stream, timestamp, (edge == 'U') || (edge == 'u'));
+    }
+
+    if (p_file != stdin)
+    {
+        fclose(p_file);
+    }
+}
+
+
+static void labels_load(label_list_t * p_list, char const * p_path)
+{
+    FILE * p_file = file_open(p_path, "r");
+    char   line[128];
+
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        uint64_t start;
+        uint64_t end;
+
+        if ((line[0] != '#') && (sscanf(line, "%" SCNu64 " %" SCNu64, &start, &end) == 2))
+        {
+            label_add(p_list, start, end);
+        }
+    }
+
+    if (p_file != stdin)
+    {
+        fclose(p_file);
+    }
+}
+
+
+static void edges_write(edge_stream_t const * p_stream, char const * p_path)
+{
+    FILE * p_file = file_open(p_path, "w");
+
+    for (size_t i = 0; i < p_stream->count; i++)
+    {
+        fprintf(p_file, "%" PRIu64 " %c\n", p_stream->p_edges[i] >> 1, (p_stream->p_edges[i] & 1) ? 'U' : 'D');
+    }
+
+    if (p_file != stdout)
+    {
+        fclose(p_file);
+    }
+}
+
+
+static void labels_write(label_list_t const * p_list, char const * p_path)
+{
+    FILE * p_file = file_open(p_path, "w");
+
+    for (size_t i = 0; i < p_list->count; i++)
+    {
+        fprintf(p_file, "%" PRIu64 " %" PRIu64 "\n", p_list->p_labels[i].start, p_list->p_labels[i].end);
+    }
+
+    if (p_file != stdout)
+    {
+        fclose(p_file);
+    }
+}
+
+
+/**@brief Synthetic scenario generator. */
+typedef struct
+{
+    edge_stream_t * p_stream;
+    label_list_t *  p_labels;
+    uint64_t        now;
+    uint64_t        seed;
+    bool            raw;
+    uint32_t        blip_pct;
+    uint32_t        mimic_pct;
+} synth_t;
+
+
+static uint32_t rand_next(synth_t * p_synth)
+{
+    p_synth->seed = p_synth->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(p_synth->seed >> 33);
+}
+
+
+static uint32_t rand_range(synth_t * p_synth, uint32_t min, uint32_t max)
+{
+    return min + rand_next(p_synth) % (max - min + 1);
+}
+
+
+static void synth_tone(synth_t * p_synth, uint32_t duration)
+{
+    uint64_t start = p_synth->now;
+
+    if (!p_synth->raw)
+    {
+        edge_add(p_synth->p_stream, start, true);
+        edge_add(p_synth->p_stream, start + duration, false);
+    }
+    else
+    {
+        for (uint32_t t = 0; t + 2 * CARRIER_HALF_PERIOD_US <= duration; t += 2 * CARRIER_HALF_PERIOD_US)
+        {
+            edge_add(p_synth->p_stream, start + t, true);
+            edge_add(p_synth->p_stream, start + t + CARRIER_HALF_PERIOD_US, false);
+        }
+    }
+    p_synth->now += duration;
+}
+
+
+/**@brief Duration of a pattern segment: nominal plus up to +-5 % jitter, kept within limits. */
+static uint32_t synth_segment(synth_t * p_synth, tone_pattern_segment_t const * p_segment)
+{
+    uint32_t nominal = (p_segment->max_us == TONE_PATTERN_OPEN)
+                     ? (p_segment->min_us + p_segment->min_us / 9)
+                     : (p_segment->min_us + (p_segment->max_us - p_segment->min_us) / 2);
+    uint32_t span    = nominal / 20;
+    uint32_t value   = rand_range(p_synth, nominal - span, nominal + span);
+
+    if (value < p_segment->min_us)
+    {
+        value = p_segment->min_us;
+    }
+    if (value > p_segment->max_us)
+    {
+        value = p_segment->max_us;
+    }
+    return value;
+}
+
+
+/**@brief Alarm episode of 2 to 8 cycles of a built-in pattern, labelled. */
+static void synth_alarm(synth_t * p_synth)
+{
+    tone_pattern_t const * p_pattern = tone_pattern_get(rand_next(p_synth) % 2);
+    uint32_t               cycles    = rand_range(p_synth, 2, 8);
+    uint64_t               start     = p_synth->now;
+
+    for (uint32_t cycle = 0; cycle < cycles; cycle++)
+    {
+        for (uint32_t i = 0; i < p_pattern->segment_count; i++)
+        {
+            tone_pattern_segment_t const * p_segment = &p_pattern->p_segments[i];
+            uint32_t                       duration  = synth_segment(p_synth, p_segment);
+
+            if (p_segment->on)
+            {
+                synth_tone(p_synth, duration);
+            }
+            else if ((rand_next(p_synth) % 100) < p_synth->blip_pct)
+            {
+                // Blip somewhere in the middle of the pause, the pause keeps its length.
+                uint32_t blip  = rand_range(p_synth, 20000, 60000);
+                uint32_t first = rand_range(p_synth, (duration - blip) / 4, (duration - blip) * 3 / 4);
+
+                p_synth->now += first;
+                synth_tone(p_synth, blip);
+                p_synth->now += duration - blip - first;
+            }
+            else
+            {
+                p_synth->now += duration;
+            }
+        }
+    }
+
+    label_add(p_synth->p_labels, start, p_synth->now);
+}
+
+
+/**@brief One cycle of a built-in pattern with up to +-15 % jitter per segment, not labelled. */
+static void synth_mimic(synth_t * p_synth)
+{
+    tone_pattern_t const * p_pattern = tone_pattern_get(rand_next(p_synth) % 2);
+
+    for (uint32_t i = 0; i < p_pattern->segment_count; i++)
+    {
+        tone_pattern_segment_t const * p_segment = &p_pattern->p_segments[i];
+        uint32_t                       nominal   = (p_segment->max_us == TONE_PATTERN_OPEN)
+                                                 ? (p_segment->min_us + p_segment->min_us / 9)
+                                                 : (p_segment->min_us + (p_segment->max_us - p_segment->min_us) / 2);
+        uint32_t                       span      = nominal * 15 / 100;
+        uint32_t                       duration  = rand_range(p_synth, nominal - span, nominal + span);
+
+        if (p_segment->on)
+        {
+            synth_tone(p_synth, duration);
+        }
+        else
+        {
+            p_synth->now += duration;
+        }
+    }
+}
+
+
+/**@brief Noise burst: 1 to 10 tones of random length with random pauses, not labelled. */
+static void synth_noise(synth_t * p_synth)
+{
+    uint32_t tones = rand_range(p_synth, 1, 10);
+
+    if ((rand_next(p_synth) % 100) < p_synth->mimic_pct)
+    {
+        synth_mimic(p_synth);
+        return;
+    }
+
+    for (uint32_t i = 0; i < tones; i++)
+    {
+        synth_tone(p_synth, rand_range(p_synth, 30000, 2000000));
+        p_synth->now += rand_range(p_synth, 50000, 3000000);
+    }
+}
+
+
+static void synth_run(synth_t * p_synth, uint32_t hours)
+{
+    uint64_t end = p_synth->now + (uint64_t)hours * 3600000000ULL;
+
+    while (p_synth->now < end)
+    {
+        // Quiet for 10 s to 2 min, long enough for the burst timer to expire.
+        p_synth->now += rand_range(p_synth, 10000000, 120000000);
+
+        if ((rand_next(p_synth) % 3) == 0)
+        {
+            synth_alarm(p_synth);
+        }
+        else
+        {
+            synth_noise(p_synth);
+        }
+    }
+}
+
+
+static void hal_tone_set(bool on, void * p_context)
+{
+    (void)on;
+    (void)p_context;
+}
+
+
+static void hal_alarm_set(bool on, uint32_t matched, uint32_t timestamp, void * p_context)
+{
+    replay_t *           p_replay = p_context;
+    label_list_t const * p_labels = p_replay->p_labels;
+
+    (void)matched;
+    (void)timestamp;
+
+    if (!on)
+    {
+        return;
+    }
+
+    p_replay->alarms++;
+
+    // Labels are sorted, skip the ones that can no longer be detected.
+    while ((p_replay->label < p_labels->count) &&
+           (p_labels->p_labels[p_replay->label].end + TONE_PATTERN_SILENCE_US < p_replay->now))
+    {
+        p_replay->label++;
+    }
+
+    if ((p_replay->label < p_labels->count) && (p_labels->p_labels[p_replay->label].start <= p_replay->now))
+    {
+        if (!p_replay->p_hit[p_replay->label])
+        {
+            uint64_t latency = p_replay->now - p_labels->p_labels[p_replay->label].start;
+
+            p_replay->p_hit[p_replay->label] = true;
+            p_replay->true_positives++;
+            p_replay->latency_sum += latency;
+            if (latency > p_replay->latency_max)
+            {
+                p_replay->latency_max = latency;
+            }
+        }
+        else
+        {
+            p_replay->repeats++;
+        }
+    }
+    else
+    {
+        p_replay->false_positives++;
+    }
+}
+
+
+static void hal_burst_timer_restart(void * p_context)
+{
+    replay_t * p_replay = p_context;
+
+    p_replay->deadline      = p_replay->now + TONE_PATTERN_SILENCE_US;
+    p_replay->timer_running = true;
+}
+
+
+static const tone_detect_hal_t m_replay_hal =
+{
+    .tone_set            = hal_tone_set,
+    .alarm_set           = hal_alarm_set,
+    .burst_timer_restart = hal_burst_timer_restart
+};
+
+
+static void replay_timeout(replay_t * p_replay)
+{
+    p_replay->now           = p_replay->deadline;
+    p_replay->timer_running = false;
+    tone_detect_timeout(&p_replay->detect, (uint32_t)p_replay->now);
+}
+
+
+/**@brief Run the stream through the detector, return the host time spent in seconds. */
+static double replay_run(replay_t *                   p_replay,
+                         tone_detect_config_t const * p_config,
+                         edge_stream_t const *        p_stream,
+                         label_list_t const *         p_labels)
+{
+    struct timespec begin;
+    struct timespec end;
+
+    memset(p_replay->p_hit, 0, p_labels->count * sizeof(bool));
+    *p_replay = (replay_t){ .p_labels = p_labels, .p_hit = p_replay->p_hit };
+    tone_detect_init(&p_replay->detect, p_config, &m_replay_hal, p_replay);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    for (size_t i = 0; i < p_stream->count; i++)
+    {
+        uint64_t timestamp = p_stream->p_edges[i] >> 1;
+
+        if (p_replay->timer_running && (timestamp >= p_replay->deadline))
+        {
+            replay_timeout(p_replay);
+        }
+
+        p_replay->now = timestamp;
+        tone_detect_edge(&p_replay->detect, (uint32_t)timestamp, (p_stream->p_edges[i] & 1) != 0);
+    }
+
+    if (p_replay->timer_running)
+    {
+        replay_timeout(p_replay);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) * 1e-9;
+}
+
+
+/**@brief Parse "window/required/min_confidence,..." into policies. */
+static uint32_t policy_parse(char const * p_list, tone_confidence_policy_t * p_policies)
+{
+    uint32_t count = 0;
+    int      used;
+    unsigned window;
+    unsigned required;
+    unsigned min_confidence;
+
+    while ((count < GRID_MAX) &&
+           (sscanf(p_list, "%u/%u/%u%n", &window, &required, &min_confidence, &used) == 3))
+    {
+        p_policies[count++] = (tone_confidence_policy_t){ (uint8_t)window, (uint8_t)required, (uint8_t)min_confidence };
+        p_list             += used;
+        if (*p_list != ',')
+        {
+            break;
+        }
+        p_list++;
+    }
+    return count;
+}
+
+
+static uint32_t grid_parse(char const * p_list, uint32_t * p_values)
+{
+    uint32_t count = 0;
+    char *   p_end;
+
+    while ((count < GRID_MAX) && (*p_list != '\0'))
+    {
+        p_values[count++] = (uint32_t)strtoul(p_list, &p_end, 0);
+        p_list            = (*p_end == ',') ? (p_end + 1) : p_end;
+        if (p_end == p_list)
+        {
+            break;
+        }
+    }
+    return count;
+}
+
+
+int main(int argc, char * argv[])
+{
+    edge_stream_t stream        = { 0 };
+    label_list_t  labels        = { 0 };
+    synth_t       synth         = { .p_stream = &stream, .p_labels = &labels, .now = 1000000, .seed = 1 };
+    uint32_t      hours         = 0;
+    char const *  p_labels_in   = NULL;
+    char const *  p_edges_out   = NULL;
+    char const *  p_labels_out  = NULL;
+    uint32_t      gaps[GRID_MAX]   = { EDGE_DECODER_DEFAULT_GAP_US };
+    uint32_t      slacks[GRID_MAX] = { 0 };
+    uint32_t      rejects[GRID_MAX] = { 1 };
+    tone_confidence_policy_t policies[GRID_MAX] = { TONE_CONFIDENCE_DEFAULT_POLICY };
+    uint32_t      gap_count     = 1;
+    uint32_t      slack_count   = 1;
+    uint32_t      reject_count  = 1;
+    uint32_t      policy_count  = 1;
+    uint32_t      repeat        = 1;
+    int           opt;
+
+    while ((opt = getopt(argc, argv, "S:rs:b:m:l:o:L:g:k:R:P:n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'S': hours        = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': synth.raw    = true;                               break;
+            case 's': synth.seed   = strtoull(optarg, NULL, 0);          break;
+            case 'b': synth.blip_pct = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': synth.mimic_pct = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'l': p_labels_in  = optarg;                             break;
+            case 'o': p_edges_out  = optarg;                             break;
+            case 'L': p_labels_out = optarg;                             break;
+            case 'g': gap_count    = grid_parse(optarg, gaps);           break;
+            case 'k': slack_count  = grid_parse(optarg, slacks);         break;
+            case 'R': reject_count = grid_parse(optarg, rejects);        break;
+            case 'P': policy_count = policy_parse(optarg, policies);     break;
+            case 'n': repeat       = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr,
+                        "usage: %s [-S hours [-r] [-s seed] [-b pct] [-m pct] | [-l labels] edges] [-o edges] [-L labels]\n"
+                        "       [-g gap_us,...] [-k slack_us,...] [-R 0|1,...] [-P w/r/c,...] [-n repeat]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+
+    if (hours != 0)
+    {
+        synth_run(&synth, hours);
+    }
+    else if (optind < argc)
+    {
+        edges_load(&stream, argv[optind]);
+        if (p_labels_in != NULL)
+        {
+            labels_load(&labels, p_labels_in);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "%s: no edge file and no -S\n", argv[0]);
+        return 2;
+    }
+
+    if (p_edges_out != NULL)
+    {
+        edges_write(&stream, p_edges_out);
+    }
+    if (p_labels_out != NULL)
+    {
+        labels_write(&labels, p_labels_out);
+    }
+    if ((gap_count == 0) || (slack_count == 0) || (reject_count == 0) || (policy_count == 0) || (repeat == 0) || (stream.count == 0))
+    {
+        return 0;
+    }
+
+    replay_t replay = { .p_hit = calloc(labels.count + 1, sizeof(bool)) };
+    double   span_s = (double)((stream.p_edges[stream.count - 1] - stream.p_edges[0]) >> 1) * 1e-6;
+
+    printf("# %zu edges, %.1f h of signal, %zu labelled alarms\n", stream.count, span_s / 3600.0, labels.count);
+    printf("# %8s %8s %3s %8s %10s %8s %7s %5s %5s %5s %7s %10s %10s\n",
+           "gap_us", "slack_us", "rej", "policy", "Medges/s", "speedup", "alarms", "TP", "FP", "FN", "repeats", "lat_avg_ms", "lat_max_ms");
+
+    for (uint32_t g = 0; g < gap_count; g++)
+    {
+        for (uint32_t k = 0; k < slack_count; k++)
+        for (uint32_t r = 0; r < reject_count; r++)
+        for (uint32_t p = 0; p < policy_count; p++)
+        {
+            tone_detect_config_t config  = { .gap_us       = gaps[g],
+                                             .slack_us     = slacks[k],
+                                             .reject_tones = (rejects[r] != 0),
+                                             .policy       = policies[p] };
+            double               seconds = 0;
+            char                 policy[16];
+
+            for (uint32_t n = 0; n < repeat; n++)
+            {
+                double elapsed = replay_run(&replay, &config, &stream, &labels);
+
+                if ((n == 0) || (elapsed < seconds))
+                {
+                    seconds = elapsed;
+                }
+            }
+
+            snprintf(policy, sizeof(policy), "%u/%u/%u",
+                     config.policy.window, config.policy.required, config.policy.min_confidence);
+            printf("  %8" PRIu32 " %8" PRIu32 " %3d %8s %10.1f %8.0f %7" PRIu64 " %5" PRIu64 " %5" PRIu64 " %5" PRIu64
+                   " %7" PRIu64 " %10.1f %10.1f\n",
+                   config.gap_us,
+                   config.slack_us,
+                   config.reject_tones ? 1 : 0,
+                   policy,
+                   (double)stream.count / seconds * 1e-6,
+                   span_s / seconds,
+                   replay.alarms,
+                   replay.true_positives,
+                   replay.false_positives,
+                   (uint64_t)labels.count - replay.true_positives,
+                   replay.repeats,
+                   (replay.true_positives != 0) ? ((double)replay.latency_sum / replay.true_positives * 1e-3) : 0.0,
+                   (double)replay.latency_max * 1e-3);
+        }
+    }
+
+    free(replay.p_hit);
+    free(stream.p_edges);
+    free(labels.p_labels);
+    return 0;
+}
@@ -0,0 +1,471 @@
+/** @file
+ *
+ * @brief Host simulation of the advertising train (USE_ADV_TRAIN) from the receiver side.
+ *
+ * @details A beacon sends train events at fixed instants of its own clock. Each one is late by
+ *          a random start delay, the main loop turnaround and the SoftDevice start. Every
+ *          -n events a pointer follows, built with adv_train.c like the firmware does. With -m 1
+ *          the beacon sends an ordinary heartbeat instead, every interval plus the random
+ *          0 to 10 ms advDelay, and no pointer.
+ *
+ *          Two receivers listen:
+ *          - continuous: scans all the time, the way gateways work today.
+ *          - windowed: scans until it gets a pointer (with -m 1 any frame and a configured
+ *            interval), then only opens a window around each expected event. The window
+ *            covers the start delay and the clock drift since the last frame it got. After
+ *            -M missed events in a row it scans continuously again.
+ *
+ *          Both clocks drift (-b, -r), every frame is lost with probability -p, and the alarm
+ *          status changes -a times an hour at random. The output is the radio duty cycle of
+ *          each receiver and the delay from a status change to the first frame with it. Only
+ *          train events and pointers are modelled, the alarm interval frames that continuous
+ *          scanners also get are left out, so the continuous latency is an upper bound.
+ *
+ *          Options:
+ *              -m <mode>  0 train (default), 1 heartbeat with advDelay
+ *              -T <ms>    interval (default 5000)
+ *              -n <n>     pointer every n train events (default 4)
+ *              -j <us>    maximum start delay of a train event (default 2000)
+ *              -p <pct>   frame loss (default 10)
+ *              -b <ppm>   beacon clock error (default 20)
+ *              -r <ppm>   receiver clock error (default -20)
+ *              -g <ppm>   clock error the windowed receiver allows for, both sides (default 100)
+ *              -M <n>     missed events before scanning again (default 4)
+ *              -h <h>     simulated hours (default 24)
+ *              -a <n>     status changes per hour (default 6)
+ *              -s <seed>  seed
+ *
+ *          Build and run from this directory:
+ *              cc -std=c99 -O2 -Wall -I.. -o train_sim train_sim.c ../adv_train.c -lm
+ *              ./train_sim
+ *              ./train_sim -m 1
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "adv_train.h"
+
+#define EVENT_US            1600.0                          /**< One legacy event on three channels, with ramp-up. */
+#define ADV_DELAY_MAX_US    10000.0                         /**< advDelay of ordinary advertising events. */
+#define POINTER_MARGIN_US   1000.0                          /**< The pointer's time to the next event is in whole ms. */
+#define CHANGES_MAX         100000
+#define COMPANY             0x0059
+#define MAJOR               0x01, 0x02
+#define MINOR               0x03, 0x04
+
+/**@brief Simulation options. */
+typedef struct
+{
+    int      mode;
+    uint32_t interval_ms;
+    uint32_t pointer_every;
+    double   jitter_us;
+    double   loss;
+    double   beacon_ppm;
+    double   receiver_ppm;
+    double   guard_ppm;
+    uint32_t misses_max;
+    double   hours;
+    double   changes_per_hour;
+} options_t;
+
+/**@brief A receiver. */
+typedef struct
+{
+    char const * p_name;
+    bool         windowed;
+    bool         synced;
+    double       search_since;                              /**< Start of the current continuous scan. */
+    double       anchor;                                    /**< Reception of the last frame the windows count from. */
+    double       anchor_us;                                 /**< Extra uncertainty of the anchor. */
+    uint32_t     intervals;                                 /**< Intervals from the anchor to the open window. */
+    uint32_t     misses;
+    double       on_us;                                     /**< Radio time. */
+    uint64_t     syncs;
+    uint64_t     losses;                                    /**< Resynchronisations after too many misses. */
+    uint64_t     windows;
+    uint64_t     caught;
+    uint32_t     status_seen;                               /**< Index of the last status change seen. */
+    double *     p_latency;
+    uint32_t     latency_count;
+} receiver_t;
+
+static options_t m_opt =
+{
+    .mode             = 0,
+    .interval_ms      = 5000,
+    .pointer_every    = 4,
+    .jitter_us        = 2000,
+    .loss             = 0.10,
+    .beacon_ppm       = 20,
+    .receiver_ppm     = -20,
+    .guard_ppm        = 100,
+    .misses_max       = 4,
+    .hours            = 24,
+    .changes_per_hour = 6
+};
+
+static double   m_change_at[CHANGES_MAX];                   /**< Times of the status changes, index 0 is boot. */
+static uint32_t m_change_count;
+static uint32_t m_seed = 1;
+
+
+static uint32_t rand_next(void)
+{
+    m_seed = (m_seed * 1103515245UL) + 12345UL;
+    return (m_seed >> 8);
+}
+
+
+/**@brief Uniform in [0, 1). */
+static double rand_unit(void)
+{
+    return (rand_next() & 0xFFFFFF) / 16777216.0;
+}
+
+
+static void usage(char const * p_name)
+{
+    fprintf(stderr, "usage: %s [-m mode] [-T ms] [-n n] [-j us] [-p pct] [-b ppm] [-r ppm] [-g ppm] "
+                    "[-M n] [-h hours] [-a n] [-s seed]\n", p_name);
+    exit(2);
+}
+
+
+/**@brief Length in true time of an interval the receiver measures with its clock. */
+static double receiver_interval_us(void)
+{
+    return m_opt.interval_ms * 1000.0 / (1.0 + m_opt.receiver_ppm * 1e-6);
+}
+
+
+/**@brief Window the receiver opens for the event after its anchor. */
+static void window_get(receiver_t const * p_rx, double * p_open, double * p_close)
+{
+    double elapsed = p_rx->intervals * receiver_interval_us();
+    double drift   = m_opt.guard_ppm * 1e-6 * elapsed;
+    double expect  = p_rx->anchor + elapsed;
+
+    if (m_opt.mode == 0)
+    {
+        // The anchor frame was late by 0 to jitter_us, the next one is too.
+        *p_open  = expect - m_opt.jitter_us - p_rx->anchor_us - drift;
+        *p_close = expect + m_opt.jitter_us + p_rx->anchor_us + drift + EVENT_US;
+    }
+    else
+    {
+        // Every interval adds 0 to 10 ms of advDelay.
+        *p_open  = expect - drift;
+        *p_close = expect + p_rx->intervals * ADV_DELAY_MAX_US + drift + EVENT_US;
+    }
+}
+
+
+static void receiver_anchor(receiver_t * p_rx, double at, double anchor_us)
+{
+    p_rx->anchor    = at;
+    p_rx->anchor_us = anchor_us;
+    p_rx->intervals = 1;
+    p_rx->misses    = 0;
+}
+
+
+static void receiver_status(receiver_t * p_rx, uint32_t status, double at)
+{
+    for (uint32_t i = p_rx->status_seen + 1; i <= status; i++)
+    {
+        p_rx->p_latency[p_rx->latency_count++] = at - m_change_at[i];
+    }
+    if (status > p_rx->status_seen)
+    {
+        p_rx->status_seen = status;
+    }
+}
+
+
+/**@brief Close the windows that ended before a time. */
+static void receiver_advance(receiver_t * p_rx, double now)
+{
+    double open;
+    double close;
+
+    while (p_rx->windowed && p_rx->synced)
+    {
+        window_get(p_rx, &open, &close);
+        if (close > now)
+        {
+            return;
+        }
+
+        p_rx->on_us += close - open;
+        p_rx->windows++;
+        p_rx->intervals++;
+        if (++p_rx->misses >= m_opt.misses_max)
+        {
+            p_rx->synced       = false;
+            p_rx->search_since = close;
+            p_rx->losses++;
+        }
+    }
+}
+
+
+/**@brief One frame on air.
+ *
+ * @param[in] at         Start of the frame.
+ * @param[in] train      A train event (or heartbeat), else a pointer.
+ * @param[in] p_pointer  Pointer data, NULL for a train event.
+ * @param[in] status     Index of the status change the frame carries.
+ */
+static void receiver_frame(receiver_t * p_rx, double at, uint8_t const * p_pointer, uint32_t status, bool lost)
+{
+    adv_train_pointer_t pointer;
+    double              open;
+    double              close;
+    bool                is_pointer = (p_pointer != NULL) &&
+                                     adv_train_pointer_decode(p_pointer, ADV_TRAIN_POINTER_LEN, &pointer);
+
+    receiver_advance(p_rx, at);
+
+    if (!p_rx->windowed)
+    {
+        if (!lost)
+        {
+            receiver_status(p_rx, status, at);
+        }
+        return;
+    }
+
+    if (!p_rx->synced)
+    {
+        if (lost)
+        {
+            return;
+        }
+        receiver_status(p_rx, status, at);
+
+        // Train mode needs the pointer to know where the train is, heartbeat mode knows the
+        // interval and takes any frame.
+        if (is_pointer || (m_opt.mode != 0))
+        {
+            p_rx->on_us += at + EVENT_US - p_rx->search_since;
+            p_rx->synced = true;
+            p_rx->syncs++;
+            if (is_pointer)
+            {
+                receiver_anchor(p_rx, at + pointer.next_ms * 1000.0 - receiver_interval_us(), POINTER_MARGIN_US);
+            }
+            else
+            {
+                receiver_anchor(p_rx, at, 0);
+            }
+        }
+        return;
+    }
+
+    window_get(p_rx, &open, &close);
+    if ((at < open) || lost)
+    {
+        return;
+    }
+
+    receiver_status(p_rx, status, at);
+    p_rx->on_us += at + EVENT_US - open;
+    p_rx->windows++;
+    p_rx->caught++;
+    if (is_pointer)
+    {
+        receiver_anchor(p_rx, at + pointer.next_ms * 1000.0 - receiver_interval_us(), POINTER_MARGIN_US);
+    }
+    else
+    {
+        receiver_anchor(p_rx, at, 0);
+    }
+}
+
+
+static int compare_double(void const * p_a, void const * p_b)
+{
+    double a = *(double const *)p_a;
+    double b = *(double const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+static void receiver_print(receiver_t * p_rx, double end)
+{
+    double sum = 0;
+    double p99 = 0;
+    double max = 0;
+
+    if (p_rx->windowed && !p_rx->synced)
+    {
+        p_rx->on_us += end - p_rx->search_since;
+    }
+    else if (!p_rx->windowed)
+    {
+        p_rx->on_us = end;
+    }
+
+    qsort(p_rx->p_latency, p_rx->latency_count, sizeof(double), compare_double);
+    for (uint32_t i = 0; i < p_rx->latency_count; i++)
+    {
+        sum += p_rx->p_latency[i];
+    }
+    if (p_rx->latency_count != 0)
+    {
+        p99 = p_rx->p_latency[(p_rx->latency_count * 99 + 99) / 100 - 1];
+        max = p_rx->p_latency[p_rx->latency_count - 1];
+    }
+
+    printf("%-10s %10.4f %8llu %6llu %10llu %10llu %10.2f %10.2f %10.2f\n",
+           p_rx->p_name,
+           p_rx->on_us * 100.0 / end,
+           (unsigned long long)p_rx->syncs,
+           (unsigned long long)p_rx->losses,
+           (unsigned long long)p_rx->caught,
+           (unsigned long long)p_rx->windows,
+           (p_rx->latency_count != 0) ? (sum / p_rx->latency_count / 1e6) : 0.0,
+           p99 / 1e6,
+           max / 1e6);
+}
+
+
+int main(int argc, char * argv[])
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:T:n:j:p:b:r:g:M:h:a:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm': m_opt.mode             = atoi(optarg);                    break;
+            case 'T': m_opt.interval_ms      = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': m_opt.pointer_every    = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'j': m_opt.jitter_us        = atof(optarg);                    break;
+            case 'p': m_opt.loss             = atof(optarg) / 100.0;            break;
+            case 'b': m_opt.beacon_ppm       = atof(optarg);                    break;
+            case 'r': m_opt.receiver_ppm     = atof(optarg);                    break;
+            case 'g': m_opt.guard_ppm        = atof(optarg);                    break;
+            case 'M': m_opt.misses_max       = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'h': m_opt.hours            = atof(optarg);                    break;
+            case 'a': m_opt.changes_per_hour = atof(optarg);                    break;
+            case 's': m_seed                 = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:  usage(argv[0]);
+        }
+    }
+    if ((optind != argc) || (m_opt.interval_ms < 100) || (m_opt.interval_ms > 65535) || (m_opt.misses_max == 0))
+    {
+        usage(argv[0]);
+    }
+
+    double end       = m_opt.hours * 3600e6;
+    double beacon_us = m_opt.interval_ms * 1000.0 * (1.0 + m_opt.beacon_ppm * 1e-6);
+
+    // Status changes, a Poisson process.
+    m_change_at[0] = 0;
+    m_change_count = 1;
+    for (double t = 0; (m_opt.changes_per_hour > 0) && (m_change_count < CHANGES_MAX); m_change_count++)
+    {
+        t -= log(1.0 - rand_unit()) * 3600e6 / m_opt.changes_per_hour;
+        if (t >= end)
+        {
+            break;
+        }
+        m_change_at[m_change_count] = t;
+    }
+
+    receiver_t rx[2] =
+    {
+        { .p_name = "continuous", .windowed = false },
+        { .p_name = "windowed",   .windowed = true  }
+    };
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        rx[i].p_latency = malloc(m_change_count * sizeof(double));
+        if (rx[i].p_latency == NULL)
+        {
+            perror("malloc");
+            return 1;
+        }
+    }
+
+    adv_train_config_t config = { .interval_ms = m_opt.interval_ms, .pointer_every = m_opt.pointer_every };
+    adv_train_t        train;
+    uint8_t            pointer[ADV_TRAIN_POINTER_LEN] = ADV_TRAIN_POINTER_INIT(COMPANY, MAJOR, MINOR);
+    uint32_t           status = 0;
+    double             heartbeat = 0;
+
+    adv_train_init(&train, &config, 0);
+
+    for (uint64_t k = 0; ; k++)
+    {
+        double nominal = (m_opt.mode == 0) ? (k * beacon_us) : heartbeat;
+        double thread  = nominal + rand_unit() * m_opt.jitter_us / 2;
+        double at      = (m_opt.mode == 0) ? (thread + rand_unit() * m_opt.jitter_us / 2) : nominal;
+        bool   due;
+
+        if (at >= end)
+        {
+            break;
+        }
+        while ((status + 1 < m_change_count) && (m_change_at[status + 1] <= at))
+        {
+            status++;
+        }
+
+        if (m_opt.mode != 0)
+        {
+            heartbeat += beacon_us + rand_unit() * ADV_DELAY_MAX_US;
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                receiver_frame(&rx[i], at, NULL, status, rand_unit() < m_opt.loss);
+            }
+            continue;
+        }
+
+        // The beacon's millisecond clock, as uptime_ms() reads it.
+        due = adv_train_event(&train, (uint32_t)(thread / (1.0 + m_opt.beacon_ppm * 1e-6) / 1000.0));
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            receiver_frame(&rx[i], at, NULL, status, rand_unit() < m_opt.loss);
+        }
+
+        if (due)
+        {
+            // Started by the main loop once the train event ended.
+            double start = at + EVENT_US + rand_unit() * m_opt.jitter_us / 2;
+            double p_at  = start + rand_unit() * m_opt.jitter_us / 2;
+
+            adv_train_pointer_encode(&train, (uint32_t)(start / (1.0 + m_opt.beacon_ppm * 1e-6) / 1000.0),
+                                     (uint8_t)status, pointer);
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                receiver_frame(&rx[i], p_at, pointer, status, rand_unit() < m_opt.loss);
+            }
+        }
+    }
+
+    printf("# %s, interval %u ms, pointer every %u, start delay %.0f us, loss %.0f %%, "
+           "clocks %+.0f/%+.0f ppm, guard %.0f ppm, %u misses, %.1f h, %u status changes\n",
+           (m_opt.mode == 0) ? "train" : "heartbeat",
+           m_opt.interval_ms, m_opt.pointer_every, m_opt.jitter_us, m_opt.loss * 100,
+           m_opt.beacon_ppm, m_opt.receiver_ppm, m_opt.guard_ppm, m_opt.misses_max, m_opt.hours,
+           m_change_count - 1);
+    printf("%-10s %10s %8s %6s %10s %10s %10s %10s %10s\n",
+           "# receiver", "radio_%", "syncs", "lost", "caught", "windows", "lat_mean_s", "lat_p99_s", "lat_max_s");
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        receiver_print(&rx[i], end);
+        free(rx[i].p_latency);
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/** @file
+ *
+ * @brief Latency histogram implementation.
+ */
+#include <stddef.h>
+
+#include "latency_hist.h"
+
+
+void latency_hist_init(latency_hist_t * p_hist, char const * p_name, uint32_t unit_hz)
+{
+    uint32_t i;
+
+    for (i = 0; (i < LATENCY_HIST_NAME_LEN - 1) && (p_name[i] != '\0'); i++)
+    {
+        p_hist->name[i] = p_name[i];
+    }
+    for (; i < LATENCY_HIST_NAME_LEN; i++)
+    {
+        p_hist->name[i] = '\0';
+    }
+
+    p_hist->unit_hz = unit_hz;
+    latency_hist_reset(p_hist);
+}
+
+
+void latency_hist_reset(latency_hist_t * p_hist)
+{
+    for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+    {
+        p_hist->bucket[i] = 0;
+    }
+    p_hist->count = 0;
+    p_hist->max   = 0;
+}
+
+
+uint32_t latency_hist_bucket(uint32_t value)
+{
+    uint32_t bucket;
+
+    if (value == 0)
+    {
+        return 0;
+    }
+
+#if defined(__GNUC__)
+    // A single CLZ on the Cortex-M4.
+    bucket = 32 - (uint32_t)__builtin_clz(value);
+#else
+    for (bucket = 0; value != 0; value >>= 1)
+    {
+        bucket++;
+    }
+#endif
+
+    return (bucket < LATENCY_HIST_BUCKETS) ? bucket : (LATENCY_HIST_BUCKETS - 1);
+}
+
+
+uint32_t latency_hist_bucket_limit(uint32_t bucket)
+{
+    if (bucket >= LATENCY_HIST_BUCKETS - 1)
+    {
+        return UINT32_MAX;
+    }
+    return (1UL << bucket) - 1;
+}
+
+
+void latency_hist_record(latency_hist_t * p_hist, uint32_t value)
+{
+    p_hist->bucket[latency_hist_bucket(value)]++;
+    p_hist->count++;
+    if (value > p_hist->max)
+    {
+        p_hist->max = value;
+    }
+}
+
+
+uint32_t latency_hist_percentile(latency_hist_t const * p_hist, uint32_t pct)
+{
+    uint32_t count = p_hist->count;
+    uint32_t seen  = 0;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // Rank of the sample, rounded up, 64-bit so large counts do not overflow.
+    uint32_t rank = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+
+    for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+    {
+        seen += p_hist->bucket[i];
+        if (seen >= rank)
+        {
+            uint32_t limit = latency_hist_bucket_limit(i);
+            return (limit < p_hist->max) ? limit : p_hist->max;
+        }
+    }
+
+    return p_hist->max;
+}
+
+
+uint32_t latency_hist_us(latency_hist_t const * p_hist, uint32_t value)
+{
+    if (p_hist->unit_hz == 0)
+    {
+        return value;
+    }
+    return (uint32_t)(((uint64_t)value * 1000000UL + p_hist->unit_hz / 2) / p_hist->unit_hz);
+}
@@ -0,0 +1,89 @@
+/** @file
+ *
+ * @defgroup latency_hist Latency histograms
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Fixed-bucket latency histograms that a host tool can read out of a RAM dump.
+ *
+ * @details Bucket 0 counts zero, bucket k counts values from 2^(k-1) to 2^k - 1 and the last
+ *          bucket also everything above. Recording is a count-leading-zeros and two increments,
+ *          cheap enough for interrupt handlers. Each histogram must only be written from one
+ *          context; reading it from another one may see a half updated sample, which is fine
+ *          for statistics.
+ *
+ *          Every histogram carries its name and the frequency of its unit, and a set of them
+ *          starts with a @ref latency_hist_header_t, so a RAM dump can be decoded without the
+ *          firmware image (host/latency_dump.c). All fields are 32-bit aligned, the layout is
+ *          the same on the target and on a little-endian host.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef LATENCY_HIST_H__
+#define LATENCY_HIST_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_HIST_BUCKETS            32                  /**< Buckets per histogram. */
+#define LATENCY_HIST_NAME_LEN           12                  /**< Name length including the terminating zero. */
+#define LATENCY_HIST_MAGIC              0x4854414CUL        /**< "LATH" in a little-endian dump. */
+#define LATENCY_HIST_VERSION            1
+
+/**@brief One histogram. */
+typedef struct
+{
+    char     name[LATENCY_HIST_NAME_LEN];                   /**< Zero terminated. */
+    uint32_t unit_hz;                                       /**< Values per second, 64000000 for CPU cycles. */
+    uint32_t count;                                         /**< Samples recorded. */
+    uint32_t max;                                           /**< Largest sample. */
+    uint32_t bucket[LATENCY_HIST_BUCKETS];
+} latency_hist_t;
+
+/**@brief Header in front of an array of histograms. */
+typedef struct
+{
+    uint32_t magic;                                         /**< LATENCY_HIST_MAGIC. */
+    uint16_t version;                                       /**< LATENCY_HIST_VERSION. */
+    uint16_t count;                                         /**< Histograms that follow. */
+} latency_hist_header_t;
+
+/**@brief Function for initializing an empty histogram.
+ *
+ * @param[in] p_name   Name, truncated to LATENCY_HIST_NAME_LEN - 1 characters.
+ * @param[in] unit_hz  Frequency of the unit the values are in.
+ */
+void latency_hist_init(latency_hist_t * p_hist, char const * p_name, uint32_t unit_hz);
+
+/**@brief Function for clearing the samples, name and unit stay. */
+void latency_hist_reset(latency_hist_t * p_hist);
+
+/**@brief Function for getting the bucket a value goes into. */
+uint32_t latency_hist_bucket(uint32_t value);
+
+/**@brief Function for getting the largest value of a bucket. */
+uint32_t latency_hist_bucket_limit(uint32_t bucket);
+
+/**@brief Function for recording a sample. */
+void latency_hist_record(latency_hist_t * p_hist, uint32_t value);
+
+/**@brief Function for getting an upper bound of a percentile.
+ *
+ * @param[in] pct  Percentile, 1 to 100.
+ *
+ * @return Limit of the bucket that holds the percentile, at most the largest sample. 0 without samples.
+ */
+uint32_t latency_hist_percentile(latency_hist_t const * p_hist, uint32_t pct);
+
+/**@brief Function for converting a value of the histogram to microseconds. */
+uint32_t latency_hist_us(latency_hist_t const * p_hist, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_HIST_H__
+
+/** @} */
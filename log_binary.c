@@ -0,0 +1,299 @@
+/** @file
+ *
+ * @brief Binary log ring implementation.
+ */
+#include <string.h>
+
+#include "log_binary.h"
+
+#define HEAD_NARGS_MSK          0x0F
+#define HEAD_SEVERITY_POS       4
+#define HEAD_SEVERITY_MSK       0x07
+#define HEAD_DUMP               0x80
+#define ENTRY_LEN(nargs)        (7 + 4 * (nargs))
+#define DUMP_LEN(len)           (5 + (len))
+
+
+static void put_u24(uint8_t * p_buf, uint32_t value)
+{
+    p_buf[0] = (uint8_t)value;
+    p_buf[1] = (uint8_t)(value >> 8);
+    p_buf[2] = (uint8_t)(value >> 16);
+}
+
+
+static uint32_t get_u24(uint8_t const * p_buf)
+{
+    return (uint32_t)p_buf[0] | ((uint32_t)p_buf[1] << 8) | ((uint32_t)p_buf[2] << 16);
+}
+
+
+static void put_u32(uint8_t * p_buf, uint32_t value)
+{
+    put_u24(p_buf, value);
+    p_buf[3] = (uint8_t)(value >> 24);
+}
+
+
+static uint32_t get_u32(uint8_t const * p_buf)
+{
+    return get_u24(p_buf) | ((uint32_t)p_buf[3] << 24);
+}
+
+
+/**@brief Function for the length of a record from its first bytes, 0 if they are not there yet. */
+static uint32_t record_len(uint8_t head, uint32_t have, uint8_t dump_len)
+{
+    if ((head & HEAD_DUMP) == 0)
+    {
+        return ENTRY_LEN(head & HEAD_NARGS_MSK);
+    }
+    return (have >= 5) ? DUMP_LEN(dump_len) : 0;
+}
+
+
+/**@brief Function for copying bytes in at the head, wrapping. The caller checked the space. */
+static void ring_write(log_binary_t * p_log, uint8_t const * p_data, uint32_t len)
+{
+    uint32_t first = p_log->size - p_log->head;
+
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(&p_log->p_buf[p_log->head], p_data, first);
+    memcpy(p_log->p_buf, &p_data[first], len - first);
+    p_log->head   = (p_log->head + len) % p_log->size;
+    p_log->level += len;
+}
+
+
+static uint8_t ring_peek(log_binary_t const * p_log, uint32_t offset)
+{
+    return p_log->p_buf[(p_log->tail + offset) % p_log->size];
+}
+
+
+/**@brief Function for making room for a record, or counting it dropped. */
+static bool ring_fits(log_binary_t * p_log, uint32_t len)
+{
+    if (len > p_log->size - p_log->level)
+    {
+        p_log->dropped++;
+        return false;
+    }
+    return true;
+}
+
+
+void log_binary_init(log_binary_t * p_log, uint8_t * p_buf, uint32_t size)
+{
+    *p_log       = (log_binary_t) {0};
+    p_log->p_buf = p_buf;
+    p_log->size  = size;
+}
+
+
+bool log_binary_put(log_binary_t * p_log, uint32_t module_addr, uint8_t severity, uint32_t fmt_addr,
+                    uint32_t const * p_args, uint32_t nargs)
+{
+    uint8_t record[LOG_BINARY_RECORD_MAX];
+
+    if (nargs > LOG_BINARY_ARGS_MAX)
+    {
+        nargs = LOG_BINARY_ARGS_MAX;
+    }
+    if (!ring_fits(p_log, ENTRY_LEN(nargs)))
+    {
+        return false;
+    }
+
+    record[0] = (uint8_t)(nargs | ((severity & HEAD_SEVERITY_MSK) << HEAD_SEVERITY_POS));
+    put_u24(&record[1], module_addr & LOG_BINARY_ADDR_MASK);
+    put_u24(&record[4], fmt_addr & LOG_BINARY_ADDR_MASK);
+    for (uint32_t i = 0; i < nargs; i++)
+    {
+        put_u32(&record[ENTRY_LEN(i)], p_args[i]);
+    }
+    ring_write(p_log, record, ENTRY_LEN(nargs));
+    return true;
+}
+
+
+bool log_binary_put_dump(log_binary_t * p_log, uint32_t module_addr, uint8_t severity,
+                         uint8_t const * p_data, uint32_t len)
+{
+    uint8_t head[DUMP_LEN(0)];
+
+    if (len > LOG_BINARY_DUMP_MAX)
+    {
+        len = LOG_BINARY_DUMP_MAX;
+    }
+    if (!ring_fits(p_log, DUMP_LEN(len)))
+    {
+        return false;
+    }
+
+    head[0] = (uint8_t)(HEAD_DUMP | ((severity & HEAD_SEVERITY_MSK) << HEAD_SEVERITY_POS));
+    put_u24(&head[1], module_addr & LOG_BINARY_ADDR_MASK);
+    head[4] = (uint8_t)len;
+    ring_write(p_log, head, sizeof(head));
+    ring_write(p_log, p_data, len);
+    return true;
+}
+
+
+uint32_t log_binary_level(log_binary_t const * p_log)
+{
+    return p_log->level;
+}
+
+
+uint32_t log_binary_frame(log_binary_t * p_log, uint32_t uptime_ms, uint8_t * p_buf, uint32_t size)
+{
+    uint32_t len = 0;
+    uint8_t  sum = 0;
+
+    if ((p_log->level == 0) || (size <= LOG_BINARY_FRAME_OVERHEAD))
+    {
+        return 0;
+    }
+
+    // Whole records only, so every frame decodes on its own.
+    while (len < p_log->level)
+    {
+        uint32_t rec = record_len(ring_peek(p_log, len), p_log->level - len, ring_peek(p_log, len + 4));
+
+        if (LOG_BINARY_FRAME_OVERHEAD + len + rec > size)
+        {
+            break;
+        }
+        for (uint32_t i = 0; i < rec; i++)
+        {
+            uint8_t byte = ring_peek(p_log, len + i);
+
+            p_buf[LOG_BINARY_FRAME_HEADER_LEN + len + i] = byte;
+            sum += byte;
+        }
+        len += rec;
+    }
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    p_buf[0] = (uint8_t)LOG_BINARY_SYNC;
+    p_buf[1] = (uint8_t)(LOG_BINARY_SYNC >> 8);
+    p_buf[2] = LOG_BINARY_VERSION;
+    p_buf[3] = (uint8_t)len;
+    p_buf[4] = (uint8_t)(len >> 8);
+    put_u32(&p_buf[5], uptime_ms);
+    p_buf[9]  = (uint8_t)((p_log->dropped > UINT16_MAX) ? UINT16_MAX : p_log->dropped);
+    p_buf[10] = (uint8_t)(((p_log->dropped > UINT16_MAX) ? UINT16_MAX : p_log->dropped) >> 8);
+    p_buf[LOG_BINARY_FRAME_HEADER_LEN + len] = sum;
+
+    p_log->tail     = (p_log->tail + len) % p_log->size;
+    p_log->level   -= len;
+    p_log->dropped  = 0;
+    return LOG_BINARY_FRAME_OVERHEAD + len;
+}
+
+
+log_binary_parse_t log_binary_frame_parse(uint8_t const * p_buf, uint32_t len, log_binary_frame_t * p_frame,
+                                          uint32_t * p_used)
+{
+    log_binary_frame_t frame;
+    uint32_t           records;
+    uint8_t            sum = 0;
+
+    if (((len >= 1) && (p_buf[0] != (uint8_t)LOG_BINARY_SYNC)) ||
+        ((len >= 2) && (p_buf[1] != (uint8_t)(LOG_BINARY_SYNC >> 8))) ||
+        ((len >= 3) && (p_buf[2] != LOG_BINARY_VERSION)))
+    {
+        return LOG_BINARY_PARSE_BAD;
+    }
+    if (len < LOG_BINARY_FRAME_HEADER_LEN)
+    {
+        return LOG_BINARY_PARSE_MORE;
+    }
+    records = (uint32_t)p_buf[3] | ((uint32_t)p_buf[4] << 8);
+    if (records == 0)
+    {
+        return LOG_BINARY_PARSE_BAD;
+    }
+    if (len < LOG_BINARY_FRAME_OVERHEAD + records)
+    {
+        return LOG_BINARY_PARSE_MORE;
+    }
+
+    for (uint32_t i = 0; i < records; i++)
+    {
+        sum += p_buf[LOG_BINARY_FRAME_HEADER_LEN + i];
+    }
+    if (sum != p_buf[LOG_BINARY_FRAME_HEADER_LEN + records])
+    {
+        return LOG_BINARY_PARSE_BAD;
+    }
+
+    frame.uptime_ms = get_u32(&p_buf[5]);
+    frame.dropped   = (uint32_t)p_buf[9] | ((uint32_t)p_buf[10] << 8);
+    frame.p_records = &p_buf[LOG_BINARY_FRAME_HEADER_LEN];
+    frame.len       = records;
+
+    // The records must fill the frame exactly.
+    for (uint32_t offset = 0; offset < records; )
+    {
+        uint8_t  dump_len = (offset + 4 < records) ? frame.p_records[offset + 4] : 0;
+        uint32_t rec      = record_len(frame.p_records[offset], records - offset, dump_len);
+
+        if ((rec == 0) || (rec > records - offset))
+        {
+            return LOG_BINARY_PARSE_BAD;
+        }
+        offset += rec;
+    }
+
+    *p_frame = frame;
+    *p_used  = LOG_BINARY_FRAME_OVERHEAD + records;
+    return LOG_BINARY_PARSE_OK;
+}
+
+
+bool log_binary_record_next(log_binary_frame_t * p_frame, log_binary_record_t * p_record)
+{
+    uint8_t const * p_rec = p_frame->p_records;
+    uint32_t        len;
+
+    if (p_frame->len == 0)
+    {
+        return false;
+    }
+    len = record_len(p_rec[0], p_frame->len, (p_frame->len > 4) ? p_rec[4] : 0);
+    if ((len == 0) || (len > p_frame->len))
+    {
+        return false;
+    }
+
+    *p_record             = (log_binary_record_t) {0};
+    p_record->severity    = (p_rec[0] >> HEAD_SEVERITY_POS) & HEAD_SEVERITY_MSK;
+    p_record->dump        = (p_rec[0] & HEAD_DUMP) != 0;
+    p_record->module_addr = get_u24(&p_rec[1]);
+    if (p_record->dump)
+    {
+        p_record->p_data = &p_rec[5];
+        p_record->len    = p_rec[4];
+    }
+    else
+    {
+        p_record->fmt_addr = get_u24(&p_rec[4]);
+        p_record->nargs    = p_rec[0] & HEAD_NARGS_MSK;
+        for (uint32_t i = 0; i < p_record->nargs; i++)
+        {
+            p_record->args[i] = get_u32(&p_rec[ENTRY_LEN(i)]);
+        }
+    }
+
+    p_frame->p_records += len;
+    p_frame->len       -= len;
+    return true;
+}
@@ -0,0 +1,151 @@
+/** @file
+ *
+ * @defgroup log_binary Binary log ring
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Log entries as compact binary records in a RAM ring, sent out in framed bursts.
+ *
+ * @details A record holds the address of the format string instead of the text, and the raw
+ *          arguments. The strings stay in flash, a host decoder looks them up in the ELF file
+ *          of the build. Records wait in the ring until the firmware sends a burst; a record
+ *          that does not fit is dropped whole and counted.
+ *
+ *          Record layout, little endian:
+ *
+ *          | Offset | Size | Field |
+ *          | --- | --- | --- |
+ *          | 0 | 1 | Bits 0-3: argument count, bits 4-6: severity, bit 7: hexdump |
+ *          | 1 | 3 | Address of the module name |
+ *          | 4 | 3 | Entry: address of the format string |
+ *          | 7 + 4n | 4 | Entry: argument n |
+ *          | 4 | 1 | Hexdump: data length |
+ *          | 5 | len | Hexdump: data |
+ *
+ *          A burst is one or more frames, each with as many whole records as fit:
+ *
+ *          | Offset | Size | Field |
+ *          | --- | --- | --- |
+ *          | 0 | 2 | Sync, LOG_BINARY_SYNC |
+ *          | 2 | 1 | Format version, LOG_BINARY_VERSION |
+ *          | 3 | 2 | Length of the records |
+ *          | 5 | 4 | Uptime when the frame was built, ms |
+ *          | 9 | 2 | Records dropped since the frame before, saturated |
+ *          | 11 | len | Records |
+ *          | 11 + len | 1 | Sum of the record bytes, modulo 256 |
+ *
+ *          Records carry no time of their own; the frame uptime bounds them from above.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef LOG_BINARY_H__
+#define LOG_BINARY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_BINARY_SYNC                 0x5AA5              /**< First two bytes of a frame, A5 5A on the wire. */
+#define LOG_BINARY_VERSION              1
+#define LOG_BINARY_FRAME_HEADER_LEN     11                  /**< Bytes before the records of a frame. */
+#define LOG_BINARY_FRAME_OVERHEAD       (LOG_BINARY_FRAME_HEADER_LEN + 1)
+#define LOG_BINARY_ARGS_MAX             15                  /**< Most arguments of one entry. */
+#define LOG_BINARY_DUMP_MAX             255                 /**< Longest hexdump, longer ones are cut. */
+#define LOG_BINARY_RECORD_MAX           (7 + 4 * LOG_BINARY_ARGS_MAX)
+#define LOG_BINARY_ADDR_MASK            0xFFFFFFUL          /**< Addresses are kept to 24 bits, flash is below 16 MB. */
+
+/**@brief Ring of records. Initialise with log_binary_init(). */
+typedef struct
+{
+    uint8_t * p_buf;
+    uint32_t  size;
+    uint32_t  head;                                         /**< Next byte written. */
+    uint32_t  tail;                                         /**< Next byte sent. */
+    uint32_t  level;                                        /**< Bytes waiting. */
+    uint32_t  dropped;                                      /**< Records dropped since the last frame. */
+} log_binary_t;
+
+/**@brief Record taken out of a frame. */
+typedef struct
+{
+    uint8_t         severity;
+    bool            dump;
+    uint32_t        module_addr;
+    uint32_t        fmt_addr;                               /**< Entry only. */
+    uint32_t        nargs;
+    uint32_t        args[LOG_BINARY_ARGS_MAX];
+    uint8_t const * p_data;                                 /**< Hexdump only. */
+    uint32_t        len;
+} log_binary_record_t;
+
+/**@brief Frame found in a byte stream. */
+typedef struct
+{
+    uint32_t        uptime_ms;
+    uint32_t        dropped;
+    uint8_t const * p_records;                              /**< Records not read yet. */
+    uint32_t        len;
+} log_binary_frame_t;
+
+/**@brief Results of log_binary_frame_parse(). */
+typedef enum
+{
+    LOG_BINARY_PARSE_OK,                                    /**< A whole frame. */
+    LOG_BINARY_PARSE_MORE,                                  /**< The start of a frame, more bytes needed. */
+    LOG_BINARY_PARSE_BAD                                    /**< No frame here, skip a byte and try again. */
+} log_binary_parse_t;
+
+/**@brief Function for initializing an empty ring on a buffer. */
+void log_binary_init(log_binary_t * p_log, uint8_t * p_buf, uint32_t size);
+
+/**@brief Function for adding a log entry.
+ *
+ * @param[in] fmt_addr  Address of the format string.
+ * @param[in] nargs     Argument count, at most LOG_BINARY_ARGS_MAX.
+ *
+ * @return False if the record did not fit and was dropped.
+ */
+bool log_binary_put(log_binary_t * p_log, uint32_t module_addr, uint8_t severity, uint32_t fmt_addr,
+                    uint32_t const * p_args, uint32_t nargs);
+
+/**@brief Function for adding a hexdump, cut to LOG_BINARY_DUMP_MAX bytes.
+ *
+ * @return False if the record did not fit and was dropped.
+ */
+bool log_binary_put_dump(log_binary_t * p_log, uint32_t module_addr, uint8_t severity,
+                         uint8_t const * p_data, uint32_t len);
+
+/**@brief Function for getting the bytes waiting in the ring. */
+uint32_t log_binary_level(log_binary_t const * p_log);
+
+/**@brief Function for taking the oldest records out of the ring into a frame.
+ *
+ * @param[in] size  Size of the output buffer. Fits any record if at least
+ *                  LOG_BINARY_FRAME_OVERHEAD + LOG_BINARY_DUMP_MAX + 5.
+ *
+ * @return Length of the frame, 0 if the ring is empty.
+ */
+uint32_t log_binary_frame(log_binary_t * p_log, uint32_t uptime_ms, uint8_t * p_buf, uint32_t size);
+
+/**@brief Function for finding a frame at the start of received bytes.
+ *
+ * @param[out] p_used  Length of the frame, if one was found.
+ */
+log_binary_parse_t log_binary_frame_parse(uint8_t const * p_buf, uint32_t len, log_binary_frame_t * p_frame,
+                                          uint32_t * p_used);
+
+/**@brief Function for taking the next record out of a frame.
+ *
+ * @return False at the end of the frame.
+ */
+bool log_binary_record_next(log_binary_frame_t * p_frame, log_binary_record_t * p_record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_BINARY_H__
+
+/** @} */
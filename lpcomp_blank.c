@@ -0,0 +1,87 @@
+/** @file
+ *
+ * @brief LPCOMP radio blanking implementation.
+ */
+#include <stddef.h>
+
+#include "lpcomp_blank.h"
+
+
+void lpcomp_blank_init(lpcomp_blank_t * p_blank, bool level)
+{
+    p_blank->active  = false;
+    p_blank->level   = level;
+    p_blank->hit     = false;
+    p_blank->seen[0] = false;
+    p_blank->seen[1] = false;
+
+    p_blank->stats.windows      = 0;
+    p_blank->stats.windows_hit  = 0;
+    p_blank->stats.up_blanked   = 0;
+    p_blank->stats.down_blanked = 0;
+    p_blank->stats.restored     = 0;
+}
+
+
+void lpcomp_blank_level_set(lpcomp_blank_t * p_blank, bool level)
+{
+    p_blank->level = level;
+}
+
+
+void lpcomp_blank_start(lpcomp_blank_t * p_blank)
+{
+    p_blank->hit     = false;
+    p_blank->seen[0] = false;
+    p_blank->seen[1] = false;
+    p_blank->stats.windows++;
+    p_blank->active  = true;
+}
+
+
+bool lpcomp_blank_edge(lpcomp_blank_t * p_blank, bool up, uint32_t timestamp)
+{
+    if (!p_blank->active)
+    {
+        p_blank->level = up;
+        return true;
+    }
+
+    p_blank->hit           = true;
+    p_blank->seen[up]      = true;
+    p_blank->timestamp[up] = timestamp;
+    if (up)
+    {
+        p_blank->stats.up_blanked++;
+    }
+    else
+    {
+        p_blank->stats.down_blanked++;
+    }
+    return false;
+}
+
+
+bool lpcomp_blank_end(lpcomp_blank_t * p_blank, bool level, uint32_t now, lpcomp_blank_edge_t * p_edge)
+{
+    if (!p_blank->active)
+    {
+        return false;
+    }
+    p_blank->active = false;
+
+    if (p_blank->hit)
+    {
+        p_blank->stats.windows_hit++;
+    }
+    if (level == p_blank->level)
+    {
+        return false;
+    }
+
+    p_edge->up        = level;
+    p_edge->timestamp = p_blank->seen[level] ? p_blank->timestamp[level] : now;
+    p_blank->level    = level;
+    p_blank->stats.restored++;
+    return true;
+}
@@ -0,0 +1,103 @@
+/** @file
+ *
+ * @defgroup lpcomp_blank LPCOMP radio blanking
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Drops LPCOMP edges around radio events and restores the real ones afterwards.
+ *
+ * @details The LPCOMP reference is a fraction of the supply. While the radio transmits, the
+ *          supply sags and the reference moves with it, which can cross the input for a few
+ *          hundred microseconds. Each crossing is an UP and a DOWN edge that has nothing to do
+ *          with the sound.
+ *
+ *          A blanking window opens at the radio notification ACTIVE, before the radio starts,
+ *          and closes a guard time after INACTIVE. Edges inside it are dropped and counted.
+ *          When it closes, the comparator level is read again:
+ *          - Same level as the last edge delivered: whatever happened was a glitch, nothing is
+ *            delivered.
+ *          - Other level: a real edge fell into the window. It is delivered now, with the
+ *            timestamp of the last captured edge in that direction if there was one.
+ *
+ *          So a glitch costs nothing, and a tone that starts or ends during a radio event is
+ *          late by at most the window, not lost.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef LPCOMP_BLANK_H__
+#define LPCOMP_BLANK_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Blanking counters. */
+typedef struct
+{
+    uint32_t windows;                                       /**< Blanking windows. */
+    uint32_t windows_hit;                                   /**< Windows with at least one edge dropped. */
+    uint32_t up_blanked;                                    /**< UP edges dropped. */
+    uint32_t down_blanked;                                  /**< DOWN edges dropped. */
+    uint32_t restored;                                      /**< Edges delivered when a window closed. */
+} lpcomp_blank_stats_t;
+
+/**@brief Edge to deliver when a window closes. */
+typedef struct
+{
+    bool     up;
+    uint32_t timestamp;
+} lpcomp_blank_edge_t;
+
+/**@brief Blanking state. Initialise with lpcomp_blank_init(). */
+typedef struct
+{
+    volatile bool        active;                            /**< A window is open. */
+    bool                 level;                             /**< Level of the last edge delivered. */
+    bool                 hit;                               /**< An edge was dropped in this window. */
+    bool                 seen[2];                           /**< A DOWN, UP edge was dropped in this window. */
+    uint32_t             timestamp[2];                      /**< Timestamp of the last dropped DOWN, UP edge. */
+    lpcomp_blank_stats_t stats;
+} lpcomp_blank_t;
+
+/**@brief Function for initializing the blanking.
+ *
+ * @param[in] level  Comparator level now, true if above the reference.
+ */
+void lpcomp_blank_init(lpcomp_blank_t * p_blank, bool level);
+
+/**@brief Function for setting the level of the last edge delivered, for front ends that do not
+ *        pass their edges through lpcomp_blank_edge().
+ */
+void lpcomp_blank_level_set(lpcomp_blank_t * p_blank, bool level);
+
+/**@brief Function for opening a window, at the radio notification ACTIVE.
+ */
+void lpcomp_blank_start(lpcomp_blank_t * p_blank);
+
+/**@brief Function for passing an edge through the blanking.
+ *
+ * @retval true   Deliver the edge.
+ * @retval false  The edge fell into a window and was dropped.
+ */
+bool lpcomp_blank_edge(lpcomp_blank_t * p_blank, bool up, uint32_t timestamp);
+
+/**@brief Function for closing a window, a guard time after the radio notification INACTIVE.
+ *
+ * @param[in]  level      Comparator level now.
+ * @param[in]  now        Timestamp of now, used if no edge of the restored direction was captured.
+ * @param[out] p_edge     Edge to deliver, valid if true is returned.
+ *
+ * @retval true   A real edge fell into the window, deliver p_edge.
+ * @retval false  Nothing to deliver.
+ */
+bool lpcomp_blank_end(lpcomp_blank_t * p_blank, bool level, uint32_t now, lpcomp_blank_edge_t * p_edge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LPCOMP_BLANK_H__
+
+/** @} */
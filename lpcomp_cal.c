@@ -0,0 +1,189 @@
+/** @file
+ *
+ * @brief LPCOMP reference calibration implementation.
+ */
+#include <stddef.h>
+
+#include "lpcomp_cal.h"
+
+#define LEVEL_NONE      (LPCOMP_CAL_LEVEL_MAX + 1)          /**< Quiet floor of a sweep in which every level saw edges. */
+
+
+static uint8_t level_clamp(int32_t level)
+{
+    return (level < LPCOMP_CAL_LEVEL_MIN) ? LPCOMP_CAL_LEVEL_MIN :
+           ((level > LPCOMP_CAL_LEVEL_MAX) ? LPCOMP_CAL_LEVEL_MAX : (uint8_t)level);
+}
+
+
+/**@brief Quiet sweep of one hysteresis setting finished. */
+static void quiet_done(lpcomp_cal_t * p_cal)
+{
+    if (!p_cal->full)
+    {
+        p_cal->phase = LPCOMP_CAL_PHASE_DONE;
+        return;
+    }
+
+    if (p_cal->hysteresis == 1)
+    {
+        // Hysteresis on was swept first, now the same without.
+        p_cal->hysteresis = 0;
+        p_cal->level      = LPCOMP_CAL_LEVEL_MAX;
+        return;
+    }
+
+    p_cal->hysteresis = (p_cal->floor[1] <= p_cal->floor[0]) ? 1 : 0;
+    p_cal->level      = p_cal->floor[p_cal->hysteresis];
+    p_cal->phase      = (p_cal->level <= LPCOMP_CAL_LEVEL_MAX) ? LPCOMP_CAL_PHASE_TONE_WAIT
+                                                               : LPCOMP_CAL_PHASE_DONE;
+}
+
+
+/**@brief The current level saw the test tone, try the next one up. */
+static void tone_heard(lpcomp_cal_t * p_cal)
+{
+    p_cal->ceiling = p_cal->level;
+    p_cal->level++;
+    p_cal->phase   = (p_cal->level <= LPCOMP_CAL_LEVEL_MAX) ? LPCOMP_CAL_PHASE_TONE
+                                                            : LPCOMP_CAL_PHASE_DONE;
+}
+
+
+void lpcomp_cal_start(lpcomp_cal_t * p_cal, lpcomp_cal_result_t const * p_previous, bool full)
+{
+    p_cal->previous   = *p_previous;
+    p_cal->phase      = LPCOMP_CAL_PHASE_QUIET;
+    p_cal->full       = full;
+    p_cal->disturbed  = false;
+    p_cal->floor[0]   = LEVEL_NONE;
+    p_cal->floor[1]   = LEVEL_NONE;
+    p_cal->ceiling    = 0;
+    p_cal->waits      = 0;
+
+    if (full)
+    {
+        p_cal->hysteresis = 1;
+        p_cal->level      = LPCOMP_CAL_LEVEL_MAX;
+        p_cal->level_stop = LPCOMP_CAL_LEVEL_MIN;
+    }
+    else if (p_previous->quiet_floor == 0)
+    {
+        p_cal->hysteresis = p_previous->hysteresis;
+        p_cal->level      = LPCOMP_CAL_LEVEL_MAX;
+        p_cal->level_stop = LPCOMP_CAL_LEVEL_MIN;
+    }
+    else
+    {
+        p_cal->hysteresis = p_previous->hysteresis;
+        p_cal->level      = level_clamp((int32_t)p_previous->quiet_floor + LPCOMP_CAL_TRACK_LEVELS);
+        p_cal->level_stop = level_clamp((int32_t)p_previous->quiet_floor - LPCOMP_CAL_TRACK_LEVELS);
+    }
+}
+
+
+bool lpcomp_cal_next(lpcomp_cal_t const * p_cal, lpcomp_cal_step_t * p_step)
+{
+    if (p_cal->phase == LPCOMP_CAL_PHASE_DONE)
+    {
+        return false;
+    }
+
+    p_step->level      = p_cal->level;
+    p_step->hysteresis = (p_cal->hysteresis != 0);
+    p_step->window_ms  = (p_cal->phase == LPCOMP_CAL_PHASE_QUIET) ? LPCOMP_CAL_QUIET_WINDOW_MS
+                                                                  : LPCOMP_CAL_TONE_WINDOW_MS;
+    return true;
+}
+
+
+void lpcomp_cal_count(lpcomp_cal_t * p_cal, uint32_t edges)
+{
+    switch (p_cal->phase)
+    {
+        case LPCOMP_CAL_PHASE_QUIET:
+            if (edges == 0)
+            {
+                p_cal->floor[p_cal->hysteresis] = p_cal->level;
+                if (p_cal->level > p_cal->level_stop)
+                {
+                    p_cal->level--;
+                    break;
+                }
+            }
+            else if (!p_cal->full && (p_cal->floor[p_cal->hysteresis] == LEVEL_NONE))
+            {
+                // A recheck starts above the old floor, edges there mean an alarm or a big jump.
+                p_cal->disturbed = true;
+            }
+            quiet_done(p_cal);
+            break;
+
+        case LPCOMP_CAL_PHASE_TONE_WAIT:
+            if (edges >= LPCOMP_CAL_TONE_MIN_EDGES)
+            {
+                tone_heard(p_cal);
+            }
+            else
+            {
+                p_cal->waits++;
+                p_cal->phase = (p_cal->waits < LPCOMP_CAL_TONE_WAIT_WINDOWS) ? LPCOMP_CAL_PHASE_TONE_WAIT
+                                                                             : LPCOMP_CAL_PHASE_DONE;
+            }
+            break;
+
+        case LPCOMP_CAL_PHASE_TONE:
+            if (edges >= LPCOMP_CAL_TONE_MIN_EDGES)
+            {
+                tone_heard(p_cal);
+            }
+            else
+            {
+                p_cal->phase = LPCOMP_CAL_PHASE_DONE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+lpcomp_cal_result_t lpcomp_cal_result(lpcomp_cal_t const * p_cal)
+{
+    lpcomp_cal_result_t const * p_previous = &p_cal->previous;
+    lpcomp_cal_result_t         result;
+    uint8_t                     floor      = p_cal->floor[p_cal->hysteresis];
+
+    if (p_cal->disturbed || (floor == LEVEL_NONE))
+    {
+        return *p_previous;
+    }
+
+    result.hysteresis  = p_cal->hysteresis;
+    result.quiet_floor = floor;
+
+    if (p_cal->ceiling != 0)
+    {
+        // Halfway between the highest noisy level (floor - 1) and the lowest deaf one (ceiling + 1).
+        result.level        = (uint8_t)((floor + p_cal->ceiling) / 2);
+        result.tone_ceiling = p_cal->ceiling;
+    }
+    else if ((p_previous->quiet_floor != 0) && (p_previous->hysteresis == p_cal->hysteresis))
+    {
+        // Keep the margins of the previous calibration, moved with the quiet floor.
+        int32_t delta = (int32_t)floor - p_previous->quiet_floor;
+
+        result.level        = level_clamp((int32_t)p_previous->level + delta);
+        result.level        = (result.level < floor) ? floor : result.level;
+        result.tone_ceiling = (p_previous->tone_ceiling != 0) ? level_clamp((int32_t)p_previous->tone_ceiling + delta)
+                                                              : 0;
+    }
+    else
+    {
+        result.level        = level_clamp((int32_t)floor + LPCOMP_CAL_DEFAULT_MARGIN);
+        result.tone_ceiling = 0;
+    }
+
+    return result;
+}
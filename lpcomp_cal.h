@@ -0,0 +1,138 @@
+/** @file
+ *
+ * @defgroup lpcomp_cal LPCOMP reference calibration
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Picks the LPCOMP reference level and hysteresis from edge counts of a sweep.
+ *
+ * @details The LPCOMP reference is a fraction of the supply. Levels here are in sixteenths of
+ *          the supply (1 to 15), which orders the 1/8 and 1/16 REFSEL values by voltage. The
+ *          caller owns the hardware: it asks lpcomp_cal_next() for the next sweep step, sets
+ *          the reference and hysteresis, counts LPCOMP UP edges for the step window and hands
+ *          the count to lpcomp_cal_count().
+ *
+ *          A full calibration has two phases:
+ *          - Quiet: with no alarm sounding, both hysteresis settings are swept downwards from
+ *            the top level until a level sees edges. The lowest level of the clean run on top
+ *            is the quiet floor. The hysteresis setting with the lower floor is used, with a
+ *            tie going to hysteresis on.
+ *          - Tone: the installer presses the test button of the smoke alarm. The quiet floor is
+ *            watched until the test tone shows up, then the levels above it are swept upwards
+ *            until one no longer sees the tone. The last one that did is the tone ceiling.
+ *
+ *          The chosen level is halfway between the highest noisy level and the lowest deaf
+ *          level, the largest margin to both. Without a test tone the previous calibration is
+ *          kept, shifted with the new quiet floor, or a default margin above the floor is used.
+ *
+ *          A recheck only repeats the quiet phase, for the stored hysteresis and within
+ *          LPCOMP_CAL_TRACK_LEVELS of the stored quiet floor. That is a handful of short
+ *          windows. When the floor moved the level and ceiling move with it, which tracks the
+ *          supply drifting as the battery runs down. A recheck that sees edges where it
+ *          starts or moves the floor further is taken as disturbed, for example by an alarm,
+ *          and changes nothing.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef LPCOMP_CAL_H__
+#define LPCOMP_CAL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LPCOMP_CAL_LEVEL_MIN            1                   /**< Lowest reference, 1/16 of the supply. */
+#define LPCOMP_CAL_LEVEL_MAX            15                  /**< Highest reference, 15/16 of the supply. */
+#define LPCOMP_CAL_LEVEL_DEFAULT        8                   /**< Supply 4/8, the uncalibrated reference. */
+
+#define LPCOMP_CAL_QUIET_WINDOW_MS      50                  /**< Quiet window per level, any edge makes the level noisy. */
+#define LPCOMP_CAL_TONE_WINDOW_MS       2000                /**< Tone window per level, longer than the 1.5 s temporal-3 pause. */
+#define LPCOMP_CAL_TONE_WAIT_WINDOWS    15                  /**< Tone windows to wait for the test tone at the quiet floor (30 s). */
+#define LPCOMP_CAL_TONE_MIN_EDGES       500                 /**< Edges that count as the tone, a third of a 0.5 s 3 kHz tone. */
+#define LPCOMP_CAL_DEFAULT_MARGIN       2                   /**< Levels above the quiet floor when no test tone was heard. */
+#define LPCOMP_CAL_TRACK_LEVELS         2                   /**< Largest quiet floor move a recheck accepts. */
+
+/**@brief Calibration result, also the record stored in flash. */
+typedef struct
+{
+    uint8_t level;                                          /**< Reference in sixteenths of the supply. */
+    uint8_t hysteresis;                                     /**< 1 to use the 50 mV hysteresis. */
+    uint8_t quiet_floor;                                    /**< Lowest level without edges in the quiet window, 0 if unknown. */
+    uint8_t tone_ceiling;                                   /**< Highest level that saw the test tone, 0 if unknown. */
+} lpcomp_cal_result_t;
+
+/**@brief Uncalibrated result, the reference and hysteresis main.c always used. */
+#define LPCOMP_CAL_DEFAULT_RESULT                           \
+{                                                           \
+    .level        = LPCOMP_CAL_LEVEL_DEFAULT,               \
+    .hysteresis   = 1,                                      \
+    .quiet_floor  = 0,                                      \
+    .tone_ceiling = 0                                       \
+}
+
+/**@brief Sweep step to measure. */
+typedef struct
+{
+    uint8_t  level;                                         /**< Reference in sixteenths of the supply. */
+    bool     hysteresis;
+    uint32_t window_ms;                                     /**< How long to count UP edges. */
+} lpcomp_cal_step_t;
+
+/**@brief Calibration phases. */
+typedef enum
+{
+    LPCOMP_CAL_PHASE_QUIET,
+    LPCOMP_CAL_PHASE_TONE_WAIT,
+    LPCOMP_CAL_PHASE_TONE,
+    LPCOMP_CAL_PHASE_DONE
+} lpcomp_cal_phase_t;
+
+/**@brief Calibration run. Start with lpcomp_cal_start(). */
+typedef struct
+{
+    lpcomp_cal_result_t previous;                           /**< Result before this run. */
+    lpcomp_cal_phase_t  phase;
+    bool                full;                               /**< Full calibration, otherwise a recheck. */
+    bool                disturbed;                          /**< The recheck saw something it should not have. */
+    uint8_t             hysteresis;                         /**< Setting being swept. */
+    uint8_t             level;                              /**< Level being measured. */
+    uint8_t             level_stop;                         /**< Quiet phase: lowest level to sweep. */
+    uint8_t             floor[2];                           /**< Quiet floor per hysteresis setting, LPCOMP_CAL_LEVEL_MAX + 1 if none. */
+    uint8_t             ceiling;                            /**< Tone ceiling, 0 if no tone. */
+    uint8_t             waits;                              /**< Tone windows waited so far. */
+} lpcomp_cal_t;
+
+/**@brief Function for starting a calibration run.
+ *
+ * @param[out] p_cal       Calibration run.
+ * @param[in]  p_previous  Current calibration.
+ * @param[in]  full        True for a full calibration with a test tone, false for a recheck.
+ *                         A recheck of a result without a quiet floor runs the quiet phase in full.
+ */
+void lpcomp_cal_start(lpcomp_cal_t * p_cal, lpcomp_cal_result_t const * p_previous, bool full);
+
+/**@brief Function for getting the next sweep step.
+ *
+ * @retval true   p_step holds the step to measure next.
+ * @retval false  The run is done, see lpcomp_cal_result().
+ */
+bool lpcomp_cal_next(lpcomp_cal_t const * p_cal, lpcomp_cal_step_t * p_step);
+
+/**@brief Function for handing over the UP edges counted in the step from lpcomp_cal_next(). */
+void lpcomp_cal_count(lpcomp_cal_t * p_cal, uint32_t edges);
+
+/**@brief Function for getting the result of a finished run.
+ *
+ * @details Returns the previous result unchanged when the run found nothing usable.
+ */
+lpcomp_cal_result_t lpcomp_cal_result(lpcomp_cal_t const * p_cal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LPCOMP_CAL_H__
+
+/** @} */
@@ -54,7 +54,6 @@
 #include "nrf_soc.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
-#include "ble_advdata.h"
 #include "app_timer.h"
 #include "nrf_pwr_mgmt.h"
 
@@ -67,13 +66,136 @@
 #include "nrf_lpcomp.h"
 #include "boards.h"
 #include "nrfx_timer.h"
+#include "nrfx_rtc.h"
+#include "nrfx_ppi.h"
+#include "nrf_atomic.h"
+#include "app_util_platform.h"
+#include "tone_counter.h"
+#include "edge_ring.h"
+#include "tone_pattern.h"
+#include "tone_detect.h"
+#include "lpcomp_cal.h"
+#include "latency_hist.h"
+#include "adv_sched.h"
+#include "adv_frame.h"
+#include "adv_airtime.h"
+#include "adv_train.h"
+#include "adv_auth.h"
+#include "adv_rotation.h"
+#include "lpcomp_blank.h"
+#include "adv_power.h"
+#include "event_log.h"
+#include "app_config.h"
+#include "deep_sleep.h"
+#include "energy_meter.h"
+#include "log_binary.h"
+#include "ble_radio_notification.h"
+#if defined(USE_SAADC_GOERTZEL)
+#include "nrfx_saadc.h"
+#include "goertzel.h"
+#endif
+#if (!defined(USE_PPI_TONE_COUNTER) && !defined(USE_SAADC_GOERTZEL)) || defined(USE_AUTH_FRAMES) || defined(USE_CONFIG_SERVICE)
+#include "fds.h"
+#endif
+#if defined(USE_CONFIG_SERVICE)
+#include "ble_srv_common.h"
+#endif
+#include "nrf_power.h"
+#if defined(USE_SYSTEM_OFF)
+#include "nrf_fstorage.h"
+#endif
+#if defined(USE_ADV_ROTATION) && !defined(USE_SAADC_GOERTZEL)
+#include "nrf_saadc.h"
+#endif
+#if defined(USE_LOG_BINARY)
+#include "nrf_log_backend_interface.h"
+#include "nrf_log_internal.h"
+#include "nrf_drv_uart.h"
+#include "nrf_delay.h"
+#endif
 //ADDED END
 
 #define APP_BLE_CONN_CFG_TAG            1                                  /**< A tag identifying the SoftDevice BLE configuration. */
 
-#define NON_CONNECTABLE_ADV_INTERVAL    MSEC_TO_UNITS(100, UNIT_0_625_MS)  /**< The advertising interval for non-connectable advertisement (100 ms). This value can vary between 100ms to 10.24s). */
+//ADDED START
+#ifndef ADV_IDLE_INTERVAL_MS
+#define ADV_IDLE_INTERVAL_MS            5000                               /**< Heartbeat advertising interval while idle, 1 to 10 s. */
+#endif
+#ifndef ADV_ALARM_WINDOW_MS
+#define ADV_ALARM_WINDOW_MS             30000                              /**< Time the 20 ms alarm interval is held after the alarm ended. */
+#endif
+#define ADV_DUTY_REPORT_INTERVAL        APP_TIMER_TICKS(10 * 60 * 1000)    /**< Radio duty cycle log every 10 minutes, also keeps uptime_ms() inside the RTC1 wrap. */
+#if defined(USE_CODED_PHY_ADV)
+#ifndef ADV_LEGACY_EVENTS
+#define ADV_LEGACY_EVENTS               1                                  /**< Legacy 1M advertising events per turn of the Coded PHY interleave. */
+#endif
+#ifndef ADV_CODED_EVENTS
+#define ADV_CODED_EVENTS                1                                  /**< Extended Coded PHY advertising events per turn of the interleave. */
+#endif
+#endif
+#if defined(USE_ADV_TRAIN)
+#ifndef ADV_TRAIN_INTERVAL_MS
+#define ADV_TRAIN_INTERVAL_MS           ADV_IDLE_INTERVAL_MS               /**< Time between train events, they are the heartbeat while idle. */
+#endif
+#ifndef ADV_TRAIN_POINTER_EVERY
+#define ADV_TRAIN_POINTER_EVERY         4                                  /**< A train pointer follows every this many train events. */
+#endif
+#endif
+#if defined(USE_ADV_ROTATION)
+#ifndef ADV_BEACON_WEIGHT
+#define ADV_BEACON_WEIGHT               3                                  /**< Events with the beacon frame per turn of the frame rotation. */
+#endif
+#ifndef ADV_TELEMETRY_WEIGHT
+#define ADV_TELEMETRY_WEIGHT            1                                  /**< Events with the telemetry frame per turn of the frame rotation. */
+#endif
+#ifndef ADV_TELEMETRY_INTERVAL_MS
+#define ADV_TELEMETRY_INTERVAL_MS       60000                              /**< Time between supply measurements for the telemetry frame. */
+#endif
+#endif
+#if defined(USE_LPCOMP_BLANKING)
+#ifndef LPCOMP_BLANK_GUARD_US
+#define LPCOMP_BLANK_GUARD_US           300                                /**< LPCOMP edges stay blanked this long after every radio event. */
+#endif
+#endif
+#if defined(USE_CONFIG_SERVICE)
+#ifndef CONFIG_MODE_TIMEOUT_MS
+#define CONFIG_MODE_TIMEOUT_MS          120000                             /**< Config mode ends this long after the button press, a connection is dropped then. */
+#endif
+#ifndef CONFIG_ADV_INTERVAL_MS
+#define CONFIG_ADV_INTERVAL_MS          100                                /**< Longest advertising interval in config mode, so a phone finds the beacon quickly. */
+#endif
+#endif
+#if defined(USE_ADV_POWER_POLICY)
+#ifndef ADV_POWER_IDLE_DBM
+#define ADV_POWER_IDLE_DBM              -20                                /**< TX power of the heartbeat, the hold and the back-off. */
+#endif
+#ifndef ADV_POWER_ALARM_DBM
+#define ADV_POWER_ALARM_DBM             8                                  /**< TX power while the alarm status is advertised. */
+#endif
+#ifndef ADV_POWER_COPIES
+#define ADV_POWER_COPIES                2                                  /**< Alarm events per alarm interval. */
+#endif
+#ifndef ADV_POWER_SPREAD_PCT
+#define ADV_POWER_SPREAD_PCT            50                                 /**< Alarm event gaps are random within this percentage of their mean. */
+#endif
+#endif
+#if defined(USE_SYSTEM_OFF)
+#ifndef SYSTEM_OFF_IDLE_MS
+#define SYSTEM_OFF_IDLE_MS              60000                              /**< Quiet time in the idle state before System OFF. */
+#endif
+#endif
+#if defined(USE_CODED_PHY_ADV) || defined(USE_ADV_TRAIN) || defined(USE_ADV_POWER_POLICY)
+#define ADV_TURNS_ENABLED               1                                  /**< The advertising set ends its turns by itself and the main loop starts the next one. */
+#else
+#define ADV_TURNS_ENABLED               0
+#endif
+#if ADV_TURNS_ENABLED || defined(USE_CONFIG_SERVICE)
+#define APP_BLE_OBSERVER_PRIO           3                                  /**< Priority of the BLE event handler, it watches for ended advertising turns and the config connection. */
+#endif
+//ADDED END
+#define NON_CONNECTABLE_ADV_INTERVAL    MSEC_TO_UNITS(ADV_IDLE_INTERVAL_MS, UNIT_0_625_MS)  /**< The advertising interval at boot, the idle heartbeat. adv_sched.c changes it at run time. */
 
-#define APP_BEACON_INFO_LENGTH          0x17                               /**< Total length of information advertised by the Beacon. */
+#define APP_BEACON_INFO_LENGTH          0x18                               /**< Total length of information advertised by the Beacon, the iBeacon fields and the status byte. */
 #define APP_ADV_DATA_LENGTH             0x15                               /**< Length of manufacturer specific data in the advertisement. */
 #define APP_DEVICE_TYPE                 0x02                               /**< 0x02 refers to Beacon. */
 #define APP_MEASURED_RSSI               0xC3                               /**< The Beacon's measured RSSI at 1 meter distance in dBm. */
@@ -84,58 +206,552 @@
                                         0x45, 0x56, 0x67, 0x78, \
                                         0x89, 0x9a, 0xab, 0xbc, \
                                         0xcd, 0xde, 0xef, 0xf0            /**< Proprietary UUID for Beacon. */
+//ADDED START
+#define APP_STATUS_ALARM                0x80                               /**< Status byte: an alarm pattern is sounding. */
+#define APP_STATUS_CHANGE_Pos           4
+#define APP_STATUS_CHANGE_Msk           (0x07 << APP_STATUS_CHANGE_Pos)    /**< Status byte: counter that steps on every status change, so receivers see repeated alarms. */
+#define APP_STATUS_PATTERN_Msk          0x0F                               /**< Status byte: patterns that fired, bit n for pattern n. */
+#define APP_STATUS_INITIAL              0x00                               /**< Status byte at boot, no alarm. */
+#if defined(USE_AUTH_FRAMES)
+#define APP_AUTH_KEY_DEFAULT            0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, \
+                                        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f /**< Test key of host/auth_vectors.c, only signs frames with AUTH_ALLOW_TEST_KEY while the UICR holds no key. */
+#endif
+//ADDED END
 
 #define DEAD_BEEF                       0xDEADBEEF                         /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
 #if defined(USE_UICR_FOR_MAJ_MIN_VALUES)
-#define MAJ_VAL_OFFSET_IN_BEACON_INFO   18                                 /**< Position of the MSB of the Major Value in m_beacon_info array. */
 #define UICR_ADDRESS                    0x10001080                         /**< Address of the UICR register used by this example. The major and minor versions to be encoded into the advertising data will be picked up from this location. */
 #endif
 
 //ADDED START
+#if defined(USE_CODED_PHY_ADV) && !defined(S140)
+#error "USE_CODED_PHY_ADV needs the S140, the S132 and S112 targets advertise on 1M only"
+#endif
+#if defined(USE_CODED_PHY_ADV) && ((ADV_LEGACY_EVENTS < 1) || (ADV_CODED_EVENTS < 1))
+#error "ADV_LEGACY_EVENTS and ADV_CODED_EVENTS are at least 1"
+#endif
+#if defined(USE_ADV_TRAIN) && !defined(S140)
+#error "USE_ADV_TRAIN needs the S140, the train pointer is an extended advertising event"
+#endif
+#if defined(USE_ADV_TRAIN) && ((ADV_TRAIN_INTERVAL_MS < 100) || (ADV_TRAIN_INTERVAL_MS > 65535))
+#error "ADV_TRAIN_INTERVAL_MS is 100 to 65535"
+#endif
+#if defined(USE_ADV_POWER_POLICY) && !defined(S140)
+#error "USE_ADV_POWER_POLICY uses the TX powers and currents of the nRF52840"
+#endif
+#if defined(USE_SAADC_GOERTZEL) && defined(USE_PPI_TONE_COUNTER)
+#error "USE_SAADC_GOERTZEL and USE_PPI_TONE_COUNTER select different tone front ends"
+#endif
+#if defined(USE_LPCOMP_BLANKING) && defined(USE_SAADC_GOERTZEL)
+#error "USE_LPCOMP_BLANKING blanks LPCOMP edges, the SAADC front end has none"
+#endif
+#if defined(USE_CONFIG_SERVICE) && (NRF_SDH_BLE_PERIPHERAL_LINK_COUNT < 1)
+#error "USE_CONFIG_SERVICE needs a peripheral link, see sdk_config.h"
+#endif
+#if defined(USE_SYSTEM_OFF) && defined(USE_SAADC_GOERTZEL)
+#error "USE_SYSTEM_OFF wakes up on the LPCOMP, the SAADC front end has none"
+#endif
+#if defined(USE_SYSTEM_OFF) && !defined(S140)
+#error "USE_SYSTEM_OFF retains RAM sections by the nRF52840 RAM map"
+#endif
+#if (defined(USE_SYSTEM_OFF) || defined(USE_BOOT_PROFILE)) && (TIMER_COUNT < 5)
+#error "The boot profile needs TIMER4, USE_SYSTEM_OFF times the wake up with it"
+#endif
+#if defined(USE_SAADC_GOERTZEL) && (TIMER_COUNT < 4)
+#error "USE_SAADC_GOERTZEL needs TIMER3 to pace the SAADC"
+#endif
+#if !defined(USE_PPI_TONE_COUNTER) && !defined(USE_SAADC_GOERTZEL)
+//the reference calibration counts edges while the LPCOMP interrupt is off,
+//so it only exists with the edge ring
+#define LPCOMP_CAL_ENABLED              1
+#else
+#define LPCOMP_CAL_ENABLED              0
+#endif
+#if LPCOMP_CAL_ENABLED && (TIMER_COUNT < 4)
+#error "The LPCOMP calibration needs TIMER3 to count edges"
+#endif
+#if !defined(USE_SAADC_GOERTZEL)
+static lpcomp_cal_result_t m_lpcomp_cal_result = LPCOMP_CAL_DEFAULT_RESULT;   /**< Reference and hysteresis in use. */
 static void nrfx_lpcomp_event_handler(nrf_lpcomp_event_t event);
+static void lpcomp_init(void);
+#endif
+static void nrfx_timer_event_handler(nrf_timer_event_t event_type, void * p_context);
+#if defined(USE_RTC_BURST_TIMER)
+#if (RTC_COUNT < 3)
+#error "USE_RTC_BURST_TIMER needs RTC2"
+#endif
+//the burst window runs on RTC2 and the 32.768 kHz LFCLK instead of Timer 1,
+//so it never keeps the high frequency clock running
+static const nrfx_rtc_t nrfx_rtc_2 = NRFX_RTC_INSTANCE(2);
+static void nrfx_rtc_event_handler(nrfx_rtc_int_type_t int_type);
+static void rtc2_init(void);
+#else
 //declare out timer instance as being Timer 1.
 //static scope so LPCOMP can access and start timer
 static const nrfx_timer_t nrfx_timer_1 = NRFX_TIMER_INSTANCE(1);
-static void nrfx_timer_event_handler(nrf_timer_event_t event_type, void * p_context);
-static uint8_t tone_burst_count = 0;
-static void lpcomp_init(void);
 static void timer1_init(void);
+#endif
+static uint32_t ppi_channel_setup(uint32_t eep, uint32_t tep, uint32_t fork_tep);
+#if defined(USE_PPI_TONE_COUNTER)
+//Timer 2 counts tones in hardware, it is driven through the HAL only
+#define TONE_COUNTER_TIMER              NRF_TIMER2
+static uint8_t tone_burst_count = 0;
+static void tone_counter_ppi_init(void);
+#else
+//Timer 2 timestamps LPCOMP edges at 1 MHz, it is driven through the HAL only.
+//It is started by the first edge and stopped once a burst has timed out.
+#define EDGE_CAPTURE_TIMER              NRF_TIMER2
+static edge_ring_t      m_edge_ring;                               /**< Edges captured by the LPCOMP interrupt, drained in the main loop. */
+static tone_detect_t    m_tone_detect;                             /**< Detector core, turns captured edges into alarms. */
+static uint32_t         m_edge_overflows_reported;                 /**< Value of m_edge_ring.overflows last written to the log. */
+static nrf_atomic_u32_t m_burst_timeout;                           /**< Set by the burst window CC2 interrupt, handled in the main loop. */
+static bool             m_burst_active;                            /**< A burst is in progress, calibration rechecks and log bursts wait for it to end. */
+static void edge_capture_init(void);
+static void edge_capture_process(void);
+static uint32_t edge_capture_now(void);
+#if defined(USE_SAADC_GOERTZEL)
+//Timer 3 paces the SAADC, it is driven through the HAL only
+#define SAADC_SAMPLE_TIMER              NRF_TIMER3
+static nrf_saadc_value_t m_saadc_buffer[2][GOERTZEL_HORN_BLOCK_LEN];  /**< EasyDMA double buffer, one Goertzel block each. */
+static goertzel_bank_t   m_goertzel;                                  /**< Horn filter bank, run in the SAADC interrupt. */
+static const goertzel_decision_t m_goertzel_decision = GOERTZEL_HORN_DECISION;
+static bool              m_goertzel_tone;                             /**< The last block held a horn tone. */
+static uint32_t          m_goertzel_block_end;                        /**< Timer 2 time at the end of the last block. */
+static void saadc_goertzel_init(void);
+#endif
+#endif
+#if LPCOMP_CAL_ENABLED
+//Timer 3 counts LPCOMP UP edges during a calibration sweep, it is driven through the HAL only
+#define LPCOMP_CAL_COUNTER              NRF_TIMER3
+#define LPCOMP_CAL_FILE_ID              0x1CA1                             /**< FDS file of the calibration record. */
+#define LPCOMP_CAL_RECORD_KEY           0x0001                             /**< FDS key of the calibration record. */
+#define LPCOMP_CAL_RECHECK_INTERVAL     APP_TIMER_TICKS(15 * 60 * 1000)    /**< Quiet floor recheck every 15 minutes. */
+APP_TIMER_DEF(m_lpcomp_cal_window_timer);                                  /**< Ends every sweep window. */
+APP_TIMER_DEF(m_lpcomp_cal_recheck_timer);                                 /**< Requests a recheck. */
+static lpcomp_cal_t        m_lpcomp_cal;                                   /**< Calibration run, stepped by the window timer. */
+static lpcomp_cal_result_t m_lpcomp_cal_record;                            /**< Flash write buffer, must stay valid until FDS is done. */
+static nrf_atomic_u32_t    m_lpcomp_cal_request;                           /**< Set by the recheck timer, handled in the main loop. */
+static nrf_atomic_u32_t    m_lpcomp_cal_done;                              /**< Set by the window timer after the last window. */
+static bool                m_lpcomp_cal_running;                           /**< A run owns the LPCOMP, the tone detector gets no edges. */
+static bool lpcomp_cal_init(bool load);
+static void lpcomp_cal_run(bool full);
+static void lpcomp_cal_process(void);
+#endif
+#if defined(USE_AUTH_FRAMES)
+#define AUTH_KEY_ADDRESS                0x10001090                         /**< UICR CUSTOMER[4] to [7], the 16 byte frame key. */
+#define AUTH_FILE_ID                    0xAC01                             /**< FDS file of the frame counter limit. */
+#define AUTH_RECORD_KEY                 0x0001                             /**< FDS key of the frame counter limit. */
+#define AUTH_COUNTER_RESERVE            256                                /**< Frame counters reserved by one flash write. */
+static adv_auth_t       m_auth;                                            /**< Signs the status byte of every frame. */
+static bool             m_auth_keyed;                                      /**< A key was loaded, frames are signed. */
+static uint32_t         m_auth_record;                                     /**< Flash write buffer, the limit being stored. */
+static bool             m_auth_storing;                                    /**< A limit is being written. */
+static nrf_atomic_u32_t m_auth_stored;                                     /**< Set by the FDS handler when the write ended. */
+static volatile ret_code_t m_auth_store_result;                            /**< Result of that write. */
+static bool             m_auth_unsigned;                                   /**< The frame on air has no valid tag, it is signed once counters are stored. */
+static volatile bool    m_auth_gc_pending;                                 /**< A garbage collection was queued for the limit, cleared by the FDS handler. */
+static void auth_init(uint8_t const * p_id);
+static void auth_sign(uint8_t * p_frame);
+static void auth_process(void);
+#endif
+#if defined(USE_CONFIG_SERVICE)
+#define CONFIG_FILE_ID                  0xC0F1                             /**< FDS file of the configuration record. */
+#define CONFIG_RECORD_KEY               0x0001                             /**< FDS key of the configuration record. */
+#define CONFIG_HVN_TX_QUEUE_SIZE        8                                  /**< Notifications the SoftDevice queues, several go out per connection event. */
+#define CONFIG_LOG_CHUNK_MAX            (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3) /**< Longest log chunk, one notification at the largest ATT MTU. */
+#define CONFIG_LOG_STATUS_LEN           12                                 /**< Log status: oldest and next sequence number, uptime in s, little endian. */
+#define CONFIG_SERVICE_UUID             0xA1E0                             /**< Configuration service, 16 bit alias in the vendor base. */
+#define CONFIG_CHAR_CONFIG_UUID         0xA1E1                             /**< Configuration blob, read and write. */
+#define CONFIG_CHAR_LOG_UUID            0xA1E2                             /**< Write a sequence number, the log comes back in notifications. */
+#define CONFIG_CHAR_LOG_STATUS_UUID     0xA1E3                             /**< Log status, read. */
+#define CONFIG_UUID_BASE                0x3c, 0x6d, 0x1e, 0x52, 0x8a, 0x47, 0x9b, 0x4b, \
+                                        0x91, 0x2f, 0x6e, 0x0d, 0x00, 0x00, 0x42, 0xb7 /**< Vendor base UUID, little endian, bytes 12 and 13 take the alias. */
+APP_TIMER_DEF(m_config_mode_timer);                                        /**< Ends config mode. */
+static event_log_t          m_event_log __attribute__((section(".non_init")));  /**< Detection events, downloaded over the config connection. Kept across resets and System OFF. */
+static app_config_t         m_config;                                      /**< Configuration in use. */
+static uint8_t              m_config_written[APP_CONFIG_LEN];              /**< Blob written over the air, waiting for the main loop. */
+static uint32_t             m_config_record[BYTES_TO_WORDS(APP_CONFIG_LEN)]; /**< Flash write buffer, must stay valid until FDS is done. */
+static bool                 m_config_adv;                                  /**< The advertising set is connectable, config mode waits for a connection. */
+static volatile uint16_t    m_conn_handle = BLE_CONN_HANDLE_INVALID;       /**< Config connection. */
+static volatile uint16_t    m_att_mtu = BLE_GATT_ATT_MTU_DEFAULT;          /**< ATT MTU of the config connection. */
+static uint8_t              m_config_uuid_type;                            /**< Type of the vendor base UUID. */
+static ble_gatts_char_handles_t m_config_char_handles;
+static ble_gatts_char_handles_t m_log_char_handles;
+static ble_gatts_char_handles_t m_log_status_char_handles;
+static bool                 m_log_streaming;                               /**< The log is being sent. */
+static uint32_t             m_log_seq;                                     /**< Sequence number of the next event to send. */
+static volatile uint32_t    m_log_from;                                    /**< Sequence number the client asked for. */
+static nrf_atomic_u32_t     m_config_button;                               /**< Set by the button handler, handled in the main loop. */
+static nrf_atomic_u32_t     m_config_timeout;                              /**< Set by the config mode timer. */
+static nrf_atomic_u32_t     m_config_connected;                            /**< Set by the BLE event handler. */
+static nrf_atomic_u32_t     m_config_disconnected;                         /**< Set by the BLE event handler. */
+static nrf_atomic_u32_t     m_config_write;                                /**< m_config_written holds a valid blob, cleared by the main loop. */
+static nrf_atomic_u32_t     m_log_start;                                   /**< Set by a write of the log characteristic. */
+static nrf_atomic_u32_t     m_log_pump;                                    /**< Set when notifications were sent and the queue has room. */
+static void config_init(void);
+static void config_process(void);
+static void event_log_note(event_log_type_t type, uint8_t arg8, uint16_t arg16);
+#define CONFIG_ADVERTISING()            (m_config_adv)
+#else
+#define CONFIG_ADVERTISING()            (false)
+#endif
+static uint32_t         m_reset_reason;                                    /**< RESETREAS of this boot, read and cleared first thing in main(). */
+#if defined(USE_SYSTEM_OFF)
+APP_TIMER_DEF(m_system_off_timer);                                         /**< Ends the quiet time. */
+static deep_sleep_state_t m_system_off_state __attribute__((section(".non_init")));  /**< Kept in retained RAM across System OFF. */
+static nrf_atomic_u32_t m_system_off_request;                              /**< Set by the quiet timer, handled in the main loop. */
+static uint32_t         m_system_off_activity;                             /**< Detector activity when the quiet time started. */
+#if defined(USE_PPI_TONE_COUNTER)
+static volatile uint32_t m_system_off_windows;                             /**< Burst windows ended, the activity of the hardware counter. */
+#endif
+static bool system_off_wake(void);
+static void system_off_init(void);
+static void system_off_process(void);
+#endif
+#if LPCOMP_CAL_ENABLED || defined(USE_AUTH_FRAMES) || defined(USE_CONFIG_SERVICE)
+#define STORAGE_ENABLED                 1                                  /**< FDS holds the LPCOMP calibration, the frame counter limit or the configuration. */
+static volatile bool       m_fds_initialized;
+static void storage_init(void);
+#else
+#define STORAGE_ENABLED                 0
+#endif
+#define APP_TIMER_HZ                    (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))  /**< RTC1 ticks per second. */
+//latency instrumentation only exists in Debug builds, Release compiles it out
+#if defined(DEBUG) && !defined(NDEBUG)
+#define LATENCY_TRACE_ENABLED           1
+#else
+#define LATENCY_TRACE_ENABLED           0
+#endif
+//Debug builds profile the boot when TIMER4 is there
+#if defined(USE_BOOT_PROFILE) || defined(USE_SYSTEM_OFF) || (LATENCY_TRACE_ENABLED && (TIMER_COUNT >= 5))
+#define BOOT_PROFILE_ENABLED            1
+#else
+#define BOOT_PROFILE_ENABLED            0
+#endif
+#if LATENCY_TRACE_ENABLED || defined(USE_ADV_ROTATION) || defined(USE_LPCOMP_BLANKING) || BOOT_PROFILE_ENABLED || \
+    defined(USE_ENERGY_METER)
+#define RADIO_NOTIFY_ENABLED            1                                  /**< The latency trace, the frame rotation, the LPCOMP blanking, the boot profile or the energy meter watch the advertising events. */
+#else
+#define RADIO_NOTIFY_ENABLED            0
+#endif
+#if RADIO_NOTIFY_ENABLED
+#define RADIO_NOTIFY_HANDLERS_MAX       5                                  /**< Radio notification subscribers. */
+typedef void (*radio_notify_handler_t)(bool radio_active);
+static radio_notify_handler_t m_radio_notify_handlers[RADIO_NOTIFY_HANDLERS_MAX];
+static uint32_t               m_radio_notify_count;
+static void radio_notify_subscribe(radio_notify_handler_t handler);
+#endif
+#if defined(USE_LPCOMP_BLANKING)
+#define LPCOMP_BLANK_GUARD_TICKS        MAX(ROUNDED_DIV(LPCOMP_BLANK_GUARD_US * APP_TIMER_HZ, 1000000), \
+                                            APP_TIMER_MIN_TIMEOUT_TICKS)   /**< The guard in RTC1 ticks, app_timer has a minimum. */
+APP_TIMER_DEF(m_lpcomp_blank_timer);                                       /**< Ends the blanking window a guard time after the radio event. */
+static lpcomp_blank_t   m_lpcomp_blank;                                    /**< Drops LPCOMP edges during radio events. */
+#if defined(USE_PPI_TONE_COUNTER)
+static uint32_t         m_lpcomp_blank_channels;                           /**< Tone counter PPI channels driven by LPCOMP UP, off while blanked. */
+#else
+static volatile bool    m_edge_capture_running;                            /**< Timer 2 was started by an edge that went to the edge ring. */
+#endif
+static void lpcomp_blanking_init(void);
+#endif
+#if LATENCY_TRACE_ENABLED
+#define LATENCY_DUMP_INTERVAL           APP_TIMER_TICKS(60 * 1000)         /**< Histograms go to the log every minute. */
+/**@brief Latency histograms. */
+typedef enum
+{
+    LATENCY_PROBE_FRONT_END_ISR,                                           /**< LPCOMP or SAADC handler run time, CPU cycles. */
+    LATENCY_PROBE_EDGE_TO_ISR,                                             /**< LPCOMP event to its handler, TIMER2 us. */
+    LATENCY_PROBE_TIMER_ISR,                                               /**< Burst window compare handler run time, CPU cycles. */
+    LATENCY_PROBE_EDGE_TO_ALARM,                                           /**< Last edge to the alarm decision, TIMER2 us. */
+    LATENCY_PROBE_ALARM_TO_ADV,                                            /**< Alarm decision to the next advertising event, RTC1 ticks. */
+    LATENCY_PROBE_COUNT
+} latency_probe_t;
+static struct
+{
+    latency_hist_header_t header;
+    latency_hist_t        hist[LATENCY_PROBE_COUNT];
+} m_latency;                                                               /**< Found by host/latency_dump.c through the header magic. */
+APP_TIMER_DEF(m_latency_dump_timer);                                       /**< Requests a log dump. */
+static nrf_atomic_u32_t m_latency_dump_request;                            /**< Set by the dump timer, handled in the main loop. */
+static nrf_atomic_u32_t m_latency_alarm_pending;                           /**< An alarm frame waits for its first advertising event. */
+static uint32_t         m_latency_alarm_ticks;                             /**< RTC1 time of that alarm. */
+#if !defined(USE_PPI_TONE_COUNTER)
+static uint32_t         m_latency_last_edge;                               /**< Timestamp of the last edge handed to the detector. */
+#endif
+//handler run time in CPU cycles, the DWT cycle counter stops while the CPU sleeps
+#define LATENCY_ISR_ENTER()             uint32_t latency_isr_start = DWT->CYCCNT
+#define LATENCY_ISR_EXIT(probe)         latency_hist_record(&m_latency.hist[(probe)], DWT->CYCCNT - latency_isr_start)
+static void latency_trace_init(void);
+static void latency_trace_process(void);
+static void latency_alarm_mark(void);
+#else
+#define LATENCY_ISR_ENTER()
+#define LATENCY_ISR_EXIT(probe)
+#endif
+#if BOOT_PROFILE_ENABLED
+//Timer 4 times the boot at 1 MHz from the top of main(), it is driven through the HAL only.
+//CC0 takes the first LPCOMP edge through PPI, CC1 the first advertising event, CC2 the stages.
+#define BOOT_PROFILE_TIMER              NRF_TIMER4
+#define BOOT_PROFILE_TIMEOUT_MS         2000                               /**< A first edge or advertising event not seen by then is reported as missing. */
+#define BOOT_PROFILE_NOTIFY_AHEAD_US    800                                /**< Radio notification ACTIVE comes this long before the event. */
+/**@brief Boot stages, in order, each timed at its end. */
+typedef enum
+{
+    BOOT_STAGE_DETECTION,                                                  /**< Tone front end running, LPCOMP armed. */
+    BOOT_STAGE_STACK,                                                      /**< SoftDevice enabled. */
+    BOOT_STAGE_STORAGE,                                                    /**< Flash storage ready, calibration loaded. */
+    BOOT_STAGE_ADVERTISING,                                                /**< Configuration applied, advertising started. */
+    BOOT_STAGE_DEFERRED,                                                   /**< Log backends, LEDs and buttons, latency trace, calibration sweep. */
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+static uint32_t         m_boot_stage_us[BOOT_STAGE_COUNT];                 /**< Timer 4 time at the end of every stage. */
+static bool             m_boot_profile_running;                            /**< Timer 4 runs, first edge or first advertising event outstanding. */
+static uint32_t         m_boot_edge_channel;                               /**< PPI channel of the first edge, disables itself through its group. */
+static nrf_ppi_channel_group_t m_boot_edge_group;
+static nrf_atomic_u32_t m_boot_adv_seen;                                   /**< Set by the radio notification of the first advertising event. */
+static void boot_profile_start(void);
+static void boot_profile_init(void);
+static void boot_profile_process(void);
+static void boot_stage_mark(boot_stage_t stage);
+#define BOOT_STAGE_MARK(stage)          boot_stage_mark(stage)
+#else
+#define BOOT_STAGE_MARK(stage)
+#endif
+#if defined(USE_ENERGY_METER)
+#if defined(USE_RTC_BURST_TIMER) && defined(USE_PPI_TONE_COUNTER)
+#define ENERGY_HFCLK_BURSTS             0                                  /**< RTC2 and a low power counter, bursts run on LFCLK alone. */
+#else
+#define ENERGY_HFCLK_BURSTS             1                                  /**< TIMER1 or the 1 MHz edge timestamps keep HFCLK requested during bursts. */
+#endif
+static energy_meter_t   m_energy;                                          /**< Time in state and event counters since boot. */
+static const energy_meter_model_t m_energy_model = ENERGY_METER_DEFAULT_MODEL;
+static uint32_t         m_energy_wake_ticks;                               /**< RTC1 counter when nrf_pwr_mgmt_run() last returned. */
+#if ENERGY_HFCLK_BURSTS
+#define ENERGY_BURST_LEAD_TICKS         APP_TIMER_TICKS((TONE_COUNTER_CC0_TICKS * TONE_COUNTER_TICK_US) / 1000)  /**< The PPI tone counter's CC0 comes this long after the last tone. */
+static bool             m_energy_burst_open;                               /**< A burst window runs. */
+static uint32_t         m_energy_burst_ticks;                              /**< RTC1 counter when it was seen starting. */
+#endif
+#define ENERGY_COUNT(event)             energy_meter_event_add(&m_energy, (event), 0)
+static void energy_init(void);
+static bool energy_log_process(void);
+static void energy_pwr_mgmt_run(void);
+static void energy_report(void);
+static uint32_t energy_mj(void);
+#else
+#define ENERGY_COUNT(event)
+#endif
+#if defined(USE_LOG_BINARY)
+#ifndef BINARY_LOG_RING_SIZE
+#define BINARY_LOG_RING_SIZE            2048                               /**< RAM ring of binary log records. */
+#endif
+#ifndef BINARY_LOG_WATERMARK_PCT
+#define BINARY_LOG_WATERMARK_PCT        75                                 /**< Ring level that sends a burst without a host. */
+#endif
+#define BINARY_LOG_WATERMARK            ((BINARY_LOG_RING_SIZE * BINARY_LOG_WATERMARK_PCT) / 100)
+#define BINARY_LOG_TX_SIZE              255                                /**< Longest frame, one EasyDMA transfer on every target. */
+#define BINARY_LOG_DUMP_MAX             (BINARY_LOG_TX_SIZE - LOG_BINARY_FRAME_OVERHEAD - 5)  /**< Longest hexdump that fits a frame. */
+#define BINARY_LOG_BAUDRATE             NRF_UART_BAUDRATE_1000000          /**< Bursts are short at 1 Mbaud, the UART is off in between. */
+#define BINARY_LOG_ATTACH_POLL_MS       1000                               /**< Host check interval. */
+#define BINARY_LOG_SENSE_US             2                                  /**< Settling of the RX pull-down before the host check reads the pin. */
+#define BINARY_LOG_TX_US                ((BINARY_LOG_TX_SIZE * 10) + 100)  /**< Longest frame on the wire at 1 Mbaud, with margin. */
+static log_binary_t     m_binary_log;                                      /**< Records waiting for a burst. */
+static uint8_t          m_binary_log_ring[BINARY_LOG_RING_SIZE];
+static uint8_t          m_binary_log_tx[BINARY_LOG_TX_SIZE];               /**< Frame being sent, in RAM for EasyDMA. */
+static nrf_drv_uart_t   m_binary_log_uart = NRF_DRV_UART_INSTANCE(0);
+static uint32_t         m_binary_log_poll_ms;                              /**< Uptime of the last host check. */
+static bool             m_binary_log_panic;                                /**< Every record goes out at once. */
+static bool             m_binary_log_sending;                              /**< The UART is on for a burst, one frame per main loop pass. */
+static nrf_atomic_u32_t m_binary_log_tx_done;                              /**< Set by the UART handler when a frame is out. */
+#if defined(USE_ENERGY_METER)
+static uint32_t         m_binary_log_start;                                /**< RTC1 count when the UART was turned on. */
+#endif
+static void binary_log_put(nrf_log_backend_t const * p_backend, nrf_log_entry_t * p_entry);
+static void binary_log_panic_set(nrf_log_backend_t const * p_backend);
+static void binary_log_flush(nrf_log_backend_t const * p_backend);
+static const nrf_log_backend_api_t m_binary_log_api =
+{
+    .put       = binary_log_put,
+    .panic_set = binary_log_panic_set,
+    .flush     = binary_log_flush,
+};
+NRF_LOG_BACKEND_DEF(m_binary_log_backend, m_binary_log_api, NULL);
+static void binary_log_init(void);
+static void binary_log_process(void);
+STATIC_ASSERT(BINARY_LOG_WATERMARK < BINARY_LOG_RING_SIZE);
+#endif
 //ADDED END
 
 static ble_gap_adv_params_t m_adv_params;                                  /**< Parameters to be passed to the stack when starting advertising. */
 static uint8_t              m_adv_handle = BLE_GAP_ADV_SET_HANDLE_NOT_SET; /**< Advertising handle used to identify an advertising set. */
-static uint8_t              m_enc_advdata[BLE_GAP_ADV_SET_DATA_SIZE_MAX];  /**< Buffer for storing an encoded advertising set. */
+//ADDED START
+/**@brief Information advertised by the Beacon, the manufacturer specific data after the company identifier. */
+#define APP_BEACON_INFO                                                                         \
+    APP_DEVICE_TYPE,     /* Specifies the device type in this implementation. */                \
+    APP_ADV_DATA_LENGTH, /* Specifies the length of the manufacturer specific data. */          \
+    APP_BEACON_UUID,     /* 128 bit UUID value. */                                              \
+    APP_MAJOR_VALUE,     /* Major arbitrary value that can be used to distinguish between Beacons. */ \
+    APP_MINOR_VALUE,     /* Minor arbitrary value that can be used to distinguish between Beacons. */ \
+    APP_MEASURED_RSSI,   /* The Beacon's measured TX power in this implementation. */           \
+    APP_STATUS_INITIAL   /* Alarm status, after the iBeacon fields so their length byte stays 0x15. */
+
+#define APP_ADV_FRAME   ADV_FRAME_INIT(BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED, APP_COMPANY_IDENTIFIER, APP_BEACON_INFO)
+
+STATIC_ASSERT(sizeof((uint8_t[]) {APP_BEACON_INFO}) == APP_BEACON_INFO_LENGTH);
+STATIC_ASSERT(APP_BEACON_INFO_LENGTH == ADV_FRAME_INFO_LEN);
+
+static uint8_t              m_enc_advdata[2][ADV_FRAME_LEN] =              /**< Encoded advertising data built at compile time, one copy in use by the SoftDevice and one to patch. */
+{
+    APP_ADV_FRAME,
+    APP_ADV_FRAME
+};
+//ADDED END
 
-/**@brief Struct that contains pointers to the encoded advertising data. */
-static ble_gap_adv_data_t m_adv_data =
+/**@brief Structs that contain pointers to the encoded advertising data, one per buffer. */
+static ble_gap_adv_data_t m_adv_data[2] =
+{
+    {
+        .adv_data =
+        {
+            .p_data = m_enc_advdata[0],
+            .len    = ADV_FRAME_LEN
+        },
+        .scan_rsp_data =
+        {
+            .p_data = NULL,
+            .len    = 0
+
+        }
+    },
+    {
+        .adv_data =
+        {
+            .p_data = m_enc_advdata[1],
+            .len    = ADV_FRAME_LEN
+        },
+        .scan_rsp_data =
+        {
+            .p_data = NULL,
+            .len    = 0
+
+        }
+    }
+};
+//ADDED START
+static uint8_t          m_adv_data_index;                                  /**< Buffer the SoftDevice is sending. */
+#if defined(USE_CONFIG_SERVICE)
+static uint8_t          m_config_scan_rsp[2][2 + 16];                      /**< Scan response in config mode, the service UUID. One per beacon buffer, filled by config_init(). */
+
+/**@brief Structs that contain pointers to the beacon frame and the scan response in config mode, one per buffer. */
+static ble_gap_adv_data_t m_config_adv_data[2] =
+{
+    {
+        .adv_data      = { .p_data = m_enc_advdata[0], .len = ADV_FRAME_LEN },
+        .scan_rsp_data = { .p_data = m_config_scan_rsp[0], .len = sizeof(m_config_scan_rsp[0]) }
+    },
+    {
+        .adv_data      = { .p_data = m_enc_advdata[1], .len = ADV_FRAME_LEN },
+        .scan_rsp_data = { .p_data = m_config_scan_rsp[1], .len = sizeof(m_config_scan_rsp[1]) }
+    }
+};
+#endif
+static uint8_t          m_adv_status = APP_STATUS_INITIAL;                 /**< Status byte on air. */
+static volatile uint8_t m_adv_status_request = APP_STATUS_INITIAL;         /**< Alarm and pattern bits to advertise, set by the detector hooks. */
+static adv_sched_t      m_adv_sched;                                       /**< Picks the advertising interval. */
+APP_TIMER_DEF(m_adv_sched_timer);                                          /**< Ends the hold and every back-off step. */
+APP_TIMER_DEF(m_adv_duty_timer);                                           /**< Requests a duty cycle report. */
+static nrf_atomic_u32_t m_adv_sched_request;                               /**< Set by the scheduler timer, handled in the main loop. */
+static nrf_atomic_u32_t m_adv_duty_request;                                /**< Set by the duty timer, handled in the main loop. */
+static adv_airtime_t    m_adv_airtime_legacy;                              /**< Airtime of one legacy 1M advertising event. */
+#if defined(USE_ADV_POWER_POLICY)
+static adv_power_t      m_adv_power;                                       /**< TX powers and the random gaps of the alarm events. */
+#endif
+#if ADV_TURNS_ENABLED
+/**@brief What the advertising set was last started for. */
+typedef enum
+{
+    ADV_TURN_NONE,                                                         /**< Stopped, the train alone carries the idle heartbeat. */
+    ADV_TURN_SCHED,                                                        /**< Events at the scheduler interval, or the gap before the next block of them. */
+    ADV_TURN_TRAIN,                                                        /**< One train event. */
+    ADV_TURN_POINTER                                                       /**< One train pointer event. */
+} adv_turn_t;
+
+static adv_turn_t       m_adv_turn;                                        /**< Turn of the advertising set. */
+APP_TIMER_DEF(m_adv_block_timer);                                          /**< Starts the next block of scheduler events one interval after the last event. */
+static nrf_atomic_u32_t m_adv_set_ended;                                   /**< Set by the BLE event handler when a turn reached its event limit. */
+static nrf_atomic_u32_t m_adv_block_request;                               /**< Set by the block timer, handled in the main loop. */
+#endif
+#if defined(USE_CODED_PHY_ADV)
+static adv_airtime_t    m_adv_airtime_coded;                               /**< Airtime of one extended Coded PHY advertising event. */
+static bool             m_adv_coded;                                       /**< The advertising set is configured for Coded PHY, else for legacy 1M. */
+#endif
+#if defined(USE_ADV_TRAIN)
+static adv_train_t      m_adv_train;                                       /**< Counts train events, fills in the pointer. */
+APP_TIMER_DEF(m_adv_train_timer);                                          /**< Ticks at the train instants. */
+static nrf_atomic_u32_t m_adv_train_request;                               /**< Set by the train timer, handled in the main loop. */
+static bool             m_adv_pointer_due;                                 /**< A pointer follows the current train event. */
+static adv_airtime_t    m_adv_airtime_pointer;                             /**< Airtime of one train pointer event. */
+static uint8_t          m_adv_pointer[ADV_TRAIN_POINTER_LEN] =             /**< Train pointer data, written before every pointer event. */
+    ADV_TRAIN_POINTER_INIT(APP_COMPANY_IDENTIFIER, APP_MAJOR_VALUE, APP_MINOR_VALUE);
+
+/**@brief Struct that contains a pointer to the train pointer data. */
+static ble_gap_adv_data_t m_adv_pointer_data =
 {
     .adv_data =
     {
-        .p_data = m_enc_advdata,
-        .len    = BLE_GAP_ADV_SET_DATA_SIZE_MAX
+        .p_data = m_adv_pointer,
+        .len    = ADV_TRAIN_POINTER_LEN
     },
     .scan_rsp_data =
     {
         .p_data = NULL,
         .len    = 0
-
     }
 };
+#endif
+#if defined(USE_ADV_ROTATION)
+/**@brief Frames of the rotation. */
+typedef enum
+{
+    APP_FRAME_BEACON,                                                      /**< Identity and status, during an alarm the only frame. */
+    APP_FRAME_TELEMETRY,                                                   /**< Supply, uptime and detector counters. */
+    APP_FRAME_COUNT
+} app_frame_t;
 
+static adv_rotation_t   m_adv_rotation;                                    /**< Picks the frame of the next event. */
+static app_frame_t      m_adv_frame = APP_FRAME_BEACON;                    /**< Frame of the advertising set. */
+static nrf_atomic_u32_t m_adv_rotation_request;                            /**< Set by the radio notification after every event, handled in the main loop. */
+static uint32_t         m_adv_rotation_steps;                              /**< Rotation steps since boot. */
+static uint64_t         m_adv_rotation_cycles;                             /**< CPU cycles spent in those steps. */
+static uint32_t         m_adv_rotation_cycles_max;                         /**< Longest step in CPU cycles. */
+APP_TIMER_DEF(m_telemetry_timer);                                          /**< Requests a supply measurement. */
+static nrf_atomic_u32_t m_telemetry_request;                               /**< Set by the telemetry timer, handled in the main loop. */
+static uint32_t         m_telemetry_alarms;                                /**< Alarms since boot. */
+static uint8_t          m_telemetry_index;                                 /**< Telemetry buffer with the latest values. */
+static uint8_t          m_enc_telemetry[2][ADV_TELEMETRY_LEN] =            /**< Telemetry frame, double buffered like the beacon frame. */
+{
+    ADV_TELEMETRY_INIT(BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED, APP_COMPANY_IDENTIFIER, APP_MAJOR_VALUE, APP_MINOR_VALUE),
+    ADV_TELEMETRY_INIT(BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED, APP_COMPANY_IDENTIFIER, APP_MAJOR_VALUE, APP_MINOR_VALUE)
+};
 
-static uint8_t m_beacon_info[APP_BEACON_INFO_LENGTH] =                    /**< Information advertised by the Beacon. */
+/**@brief Structs that contain pointers to the telemetry frame, one per buffer. */
+static ble_gap_adv_data_t m_telemetry_data[2] =
 {
-    APP_DEVICE_TYPE,     // Manufacturer specific information. Specifies the device type in this
-                         // implementation.
-    APP_ADV_DATA_LENGTH, // Manufacturer specific information. Specifies the length of the
-                         // manufacturer specific data in this implementation.
-    APP_BEACON_UUID,     // 128 bit UUID value.
-    APP_MAJOR_VALUE,     // Major arbitrary value that can be used to distinguish between Beacons.
-    APP_MINOR_VALUE,     // Minor arbitrary value that can be used to distinguish between Beacons.
-    APP_MEASURED_RSSI    // Manufacturer specific information. The Beacon's measured TX power in
-                         // this implementation.
+    {
+        .adv_data      = { .p_data = m_enc_telemetry[0], .len = ADV_TELEMETRY_LEN },
+        .scan_rsp_data = { .p_data = NULL, .len = 0 }
+    },
+    {
+        .adv_data      = { .p_data = m_enc_telemetry[1], .len = ADV_TELEMETRY_LEN },
+        .scan_rsp_data = { .p_data = NULL, .len = 0 }
+    }
 };
+#endif
+static uint32_t         m_uptime_ticks_last;                               /**< RTC1 counter at the last uptime_ms() call. */
+static uint64_t         m_uptime_ticks;                                    /**< RTC1 ticks since boot. */
+static void advertising_configure_start(void);
+//ADDED END
+
+
 
 
 /**@brief Callback function for asserts in the SoftDevice.
@@ -154,256 +770,3836 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
     app_error_handler(DEAD_BEEF, line_num, p_file_name);
 }
 
-/**@brief Function for initializing the Advertising functionality.
+//ADDED START
+/**@brief Function for getting the milliseconds since boot, wraps after 49 days.
  *
- * @details Encodes the required advertising data and passes it to the stack.
- *          Also builds a structure to be passed to the stack when starting advertising.
+ * @details RTC1 wraps every 1024 s, so this has to be called more often than that. The duty
+ *          report timer makes sure of it.
  */
-static void advertising_init(void)
+static uint32_t uptime_ms(void)
 {
-    uint32_t      err_code;
-    ble_advdata_t advdata;
-    uint8_t       flags = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+    uint32_t ticks = app_timer_cnt_get();
 
-    ble_advdata_manuf_data_t manuf_specific_data;
+    m_uptime_ticks     += app_timer_cnt_diff_compute(ticks, m_uptime_ticks_last);
+    m_uptime_ticks_last = ticks;
 
-    manuf_specific_data.company_identifier = APP_COMPANY_IDENTIFIER;
+    return (uint32_t)((m_uptime_ticks * 1000) / APP_TIMER_HZ);
+}
 
-#if defined(USE_UICR_FOR_MAJ_MIN_VALUES)
-    // If USE_UICR_FOR_MAJ_MIN_VALUES is defined, the major and minor values will be read from the
-    // UICR instead of using the default values. The major and minor values obtained from the UICR
-    // are encoded into advertising data in big endian order (MSB First).
-    // To set the UICR used by this example to a desired value, write to the address 0x10001080
-    // using the nrfjprog tool. The command to be used is as follows.
-    // nrfjprog --snr <Segger-chip-Serial-Number> --memwr 0x10001080 --val <your major/minor value>
-    // For example, for a major value and minor value of 0xabcd and 0x0102 respectively, the
-    // the following command should be used.
-    // nrfjprog --snr <Segger-chip-Serial-Number> --memwr 0x10001080 --val 0xabcd0102
-    uint16_t major_value = ((*(uint32_t *)UICR_ADDRESS) & 0xFFFF0000) >> 16;
-    uint16_t minor_value = ((*(uint32_t *)UICR_ADDRESS) & 0x0000FFFF);
+#if defined(USE_CONFIG_SERVICE)
+/**@brief Function for getting the seconds since boot, they do not wrap like uptime_ms().
+ */
+static uint32_t uptime_s(void)
+{
+    (void) uptime_ms();
 
-    uint8_t index = MAJ_VAL_OFFSET_IN_BEACON_INFO;
+    return (uint32_t)(m_uptime_ticks / APP_TIMER_HZ);
+}
+#endif
+
+/**@brief Scheduler timer handler, the main loop takes the step.
+ */
+static void adv_sched_timer_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_adv_sched_request, 1);
+}
 
-    m_beacon_info[index++] = MSB_16(major_value);
-    m_beacon_info[index++] = LSB_16(major_value);
+/**@brief Duty timer handler, the main loop writes the report.
+ */
+static void adv_duty_timer_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_adv_duty_request, 1);
+}
 
-    m_beacon_info[index++] = MSB_16(minor_value);
-    m_beacon_info[index++] = LSB_16(minor_value);
+#if ADV_TURNS_ENABLED
+/**@brief Block timer handler, the main loop starts the next block.
+ */
+static void adv_block_timer_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_adv_block_request, 1);
+}
 #endif
 
-    manuf_specific_data.data.p_data = (uint8_t *) m_beacon_info;
-    manuf_specific_data.data.size   = APP_BEACON_INFO_LENGTH;
+#if defined(USE_ADV_TRAIN)
+/**@brief Train timer handler, the main loop starts the train event.
+ */
+static void adv_train_timer_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_adv_train_request, 1);
+}
+#endif
 
-    // Build and set advertising data.
-    memset(&advdata, 0, sizeof(advdata));
+#if defined(USE_ADV_POWER_POLICY)
+/**@brief Function for checking whether the alarm goes out in single events with random gaps.
+ */
+static bool advertising_copies_active(void)
+{
+    return ((m_adv_status & APP_STATUS_ALARM) != 0) && !CONFIG_ADVERTISING();
+}
 
-    advdata.name_type             = BLE_ADVDATA_NO_NAME;
-    advdata.flags                 = flags;
-    advdata.p_manuf_specific_data = &manuf_specific_data;
+/**@brief Function for setting the TX power of the advertising set for the status on air.
+ *
+ * @details The SoftDevice takes it from the next advertising event on, the set keeps running.
+ */
+static void advertising_power_set(void)
+{
+    ret_code_t err_code;
 
-    // Initialize advertising parameters (used when starting advertising).
-    memset(&m_adv_params, 0, sizeof(m_adv_params));
+    err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_ADV, m_adv_handle,
+                                       adv_power_tx_dbm(&m_adv_power, (m_adv_status & APP_STATUS_ALARM) != 0));
+    APP_ERROR_CHECK(err_code);
+}
+#endif
 
+/**@brief Function for setting the advertising type and PHY of the next block of events.
+ *
+ * @details Without USE_CODED_PHY_ADV every event is legacy and the set never stops by itself.
+ *          With it the set alternates between a block of legacy 1M events for gateways without
+ *          Coded PHY and a block of extended events on Coded PHY, primary and secondary channels
+ *          both, for range. The S140 has a single advertising set, so the blocks take turns on
+ *          it: each one ends after its events and the next one is configured in its place.
+ */
+static void advertising_phy_set(void)
+{
+    m_adv_params.max_adv_evts    = 0;       // Until stopped.
+#if defined(USE_CONFIG_SERVICE)
+    //config mode waits for a phone on legacy 1M, the set holds still until it connects
+    if (m_config_adv)
+    {
+        m_adv_params.properties.type = BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED;
+        m_adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
+        m_adv_params.secondary_phy   = BLE_GAP_PHY_1MBPS;
+        return;
+    }
+#endif
+#if defined(USE_CODED_PHY_ADV)
+    if (m_adv_coded)
+    {
+        m_adv_params.properties.type = BLE_GAP_ADV_TYPE_EXTENDED_NONCONNECTABLE_NONSCANNABLE_UNDIRECTED;
+        m_adv_params.primary_phy     = BLE_GAP_PHY_CODED;
+        m_adv_params.secondary_phy   = BLE_GAP_PHY_CODED;
+        m_adv_params.max_adv_evts    = ADV_CODED_EVENTS;
+        return;
+    }
+    m_adv_params.max_adv_evts    = ADV_LEGACY_EVENTS;
+#endif
     m_adv_params.properties.type = BLE_GAP_ADV_TYPE_NONCONNECTABLE_NONSCANNABLE_UNDIRECTED;
-    m_adv_params.p_peer_addr     = NULL;    // Undirected advertisement.
-    m_adv_params.filter_policy   = BLE_GAP_ADV_FP_ANY;
-    m_adv_params.interval        = NON_CONNECTABLE_ADV_INTERVAL;
-    m_adv_params.duration        = 0;       // Never time out.
+    m_adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
+    m_adv_params.secondary_phy   = BLE_GAP_PHY_1MBPS;
+}
+
+/**@brief Function for getting the mean radio time of an advertising event, for the duty cycle.
+ */
+static uint32_t advertising_event_us(void)
+{
+#if defined(USE_CODED_PHY_ADV)
+    return (m_adv_airtime_legacy.radio_us * ADV_LEGACY_EVENTS + m_adv_airtime_coded.radio_us * ADV_CODED_EVENTS) /
+           (ADV_LEGACY_EVENTS + ADV_CODED_EVENTS);
+#else
+    return m_adv_airtime_legacy.radio_us;
+#endif
+}
+
+/**@brief Function for logging the airtime of one advertising event on each PHY.
+ */
+static void advertising_airtime_report(void)
+{
+    NRF_LOG_INFO("Airtime per frame, 1M legacy: %u us on air, %u us radio",
+                 m_adv_airtime_legacy.air_us, m_adv_airtime_legacy.radio_us);
+#if defined(USE_CODED_PHY_ADV)
+    NRF_LOG_INFO("Airtime per frame, Coded S8: %u us on air, %u us radio, %u:%u legacy:coded events",
+                 m_adv_airtime_coded.air_us, m_adv_airtime_coded.radio_us,
+                 ADV_LEGACY_EVENTS, ADV_CODED_EVENTS);
+#endif
+#if defined(USE_ADV_TRAIN)
+    NRF_LOG_INFO("Airtime per train pointer, 1M extended: %u us on air, %u us radio, every %u train events",
+                 m_adv_airtime_pointer.air_us, m_adv_airtime_pointer.radio_us, ADV_TRAIN_POINTER_EVERY);
+#endif
+}
+
+/**@brief Function for getting the advertising data of the current frame.
+ */
+static ble_gap_adv_data_t * advertising_data(void)
+{
+#if defined(USE_CONFIG_SERVICE)
+    if (m_config_adv)
+    {
+        return &m_config_adv_data[m_adv_data_index];
+    }
+#endif
+#if defined(USE_ADV_ROTATION)
+    if (m_adv_frame == APP_FRAME_TELEMETRY)
+    {
+        return &m_telemetry_data[m_telemetry_index];
+    }
+#endif
+    return &m_adv_data[m_adv_data_index];
+}
+
+/**@brief Function for switching the advertising set to the current frame without stopping it.
+ *
+ * @details The SoftDevice takes the new buffer at the next advertising event.
+ */
+static void advertising_data_switch(void)
+{
+    ret_code_t err_code;
+
+#if defined(USE_ADV_TRAIN)
+    //the pointer has its own data, the turn after it takes the new buffer
+    if (m_adv_turn == ADV_TURN_POINTER)
+    {
+        return;
+    }
+#endif
+    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, advertising_data(), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+#if defined(USE_ADV_ROTATION)
+#if !defined(USE_SAADC_GOERTZEL)
+/**@brief Function for measuring the supply voltage with one SAADC conversion.
+ *
+ * @details Blocks for about 20 us. The SAADC is only enabled for the conversion.
+ *
+ * @return Supply voltage in mV.
+ */
+static uint16_t telemetry_supply_mv(void)
+{
+    nrf_saadc_value_t          sample = 0;
+    nrf_saadc_channel_config_t config =
+    {
+        .resistor_p = NRF_SAADC_RESISTOR_DISABLED,
+        .resistor_n = NRF_SAADC_RESISTOR_DISABLED,
+        .gain       = NRF_SAADC_GAIN1_6,
+        .reference  = NRF_SAADC_REFERENCE_INTERNAL,
+        .acq_time   = NRF_SAADC_ACQTIME_10US,
+        .mode       = NRF_SAADC_MODE_SINGLE_ENDED,
+        .burst      = NRF_SAADC_BURST_DISABLED,
+        .pin_p      = NRF_SAADC_INPUT_VDD,
+        .pin_n      = NRF_SAADC_INPUT_DISABLED
+    };
+
+    nrf_saadc_resolution_set(NRF_SAADC_RESOLUTION_12BIT);
+    nrf_saadc_oversample_set(NRF_SAADC_OVERSAMPLE_DISABLED);
+    nrf_saadc_channel_init(0, &config);
+    nrf_saadc_buffer_init(&sample, 1);
+    nrf_saadc_enable();
+
+    nrf_saadc_task_trigger(NRF_SAADC_TASK_START);
+    while (!nrf_saadc_event_check(NRF_SAADC_EVENT_STARTED))
+    {
+    }
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_STARTED);
+
+    nrf_saadc_task_trigger(NRF_SAADC_TASK_SAMPLE);
+    while (!nrf_saadc_event_check(NRF_SAADC_EVENT_END))
+    {
+    }
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_END);
+
+    nrf_saadc_task_trigger(NRF_SAADC_TASK_STOP);
+    while (!nrf_saadc_event_check(NRF_SAADC_EVENT_STOPPED))
+    {
+    }
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_STOPPED);
+
+    nrf_saadc_disable();
+    nrf_saadc_channel_input_set(0, NRF_SAADC_INPUT_DISABLED, NRF_SAADC_INPUT_DISABLED);
+
+    //gain 1/6 of the 0.6 V reference is 3.6 V full scale
+    return (sample > 0) ? (uint16_t)(((uint32_t)sample * 3600UL) >> 12) : 0;
+}
+#endif
+
+/**@brief Function for writing the latest values into the spare telemetry buffer and switching to it.
+ *
+ * @param[in] measure  Also measure the supply voltage, else the last value stays.
+ */
+static void telemetry_update(bool measure)
+{
+    uint8_t const * p_old = m_enc_telemetry[m_telemetry_index];
+    uint8_t *       p_new = m_enc_telemetry[m_telemetry_index ^ 1];
+    uint32_t        tones    = 0;
+    uint32_t        rejected = 0;
+
+    memcpy(p_new, p_old, ADV_TELEMETRY_LEN);
+
+#if !defined(USE_SAADC_GOERTZEL)
+    if (measure)
+    {
+        (void) uint16_big_encode(telemetry_supply_mv(), &p_new[ADV_TELEMETRY_SUPPLY_OFFSET]);
+    }
+#endif
+#if !defined(USE_PPI_TONE_COUNTER)
+    tones    = m_tone_detect.stats.tones;
+    rejected = m_tone_detect.stats.rejected;
+#endif
+    p_new[ADV_TELEMETRY_STATUS_OFFSET] = m_adv_status;
+    (void) uint32_big_encode(uptime_ms() / 1000, &p_new[ADV_TELEMETRY_UPTIME_OFFSET]);
+    (void) uint32_big_encode(tones, &p_new[ADV_TELEMETRY_TONES_OFFSET]);
+    (void) uint16_big_encode(MIN(rejected, UINT16_MAX), &p_new[ADV_TELEMETRY_REJECTED_OFFSET]);
+    (void) uint16_big_encode(MIN(m_telemetry_alarms, UINT16_MAX), &p_new[ADV_TELEMETRY_ALARMS_OFFSET]);
+#if defined(USE_ENERGY_METER)
+    (void) uint32_big_encode(energy_mj(), &p_new[ADV_TELEMETRY_ENERGY_OFFSET]);
+#endif
+
+    m_telemetry_index ^= 1;
+    if (m_adv_frame == APP_FRAME_TELEMETRY)
+    {
+        advertising_data_switch();
+    }
+}
+
+/**@brief Telemetry timer handler, the main loop measures the supply.
+ */
+static void telemetry_timer_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_telemetry_request, 1);
+}
+
+/**@brief Radio notification subscriber, an advertising event ended and the next frame can be picked.
+ */
+static void adv_rotation_radio_notify_handler(bool radio_active)
+{
+    if (!radio_active)
+    {
+        (void) nrf_atomic_u32_store(&m_adv_rotation_request, 1);
+    }
+}
+
+/**@brief Function for initializing the frame rotation and the telemetry frame.
+ */
+static void advertising_rotation_init(void)
+{
+    static const uint8_t weights[APP_FRAME_COUNT] =
+    {
+        [APP_FRAME_BEACON]    = ADV_BEACON_WEIGHT,
+        [APP_FRAME_TELEMETRY] = ADV_TELEMETRY_WEIGHT
+    };
+    ret_code_t err_code;
+
+    adv_rotation_init(&m_adv_rotation, weights, APP_FRAME_COUNT);
+
+    //the rotation step is timed with the cycle counter, it stops while the CPU sleeps
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    telemetry_update(true);
+    radio_notify_subscribe(adv_rotation_radio_notify_handler);
+
+    err_code = app_timer_create(&m_telemetry_timer, APP_TIMER_MODE_REPEATED, telemetry_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_telemetry_timer, APP_TIMER_TICKS(ADV_TELEMETRY_INTERVAL_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for putting the next frame of the rotation in place, called from the main loop.
+ *
+ * @details Runs once per advertising event, after the radio notification that ends it. The
+ *          frames are built already, so a step is a pick and at most one
+ *          sd_ble_gap_adv_set_configure() with the other buffer, which the SoftDevice sends
+ *          from the next event on. An alarm preempts the rotation: every event carries the
+ *          beacon frame until it clears, and so does config mode while it waits for a phone.
+ *          The CPU cycles of every step are counted for the duty cycle report.
+ */
+static void advertising_rotation_process(void)
+{
+    uint32_t    start;
+    uint32_t    cycles;
+    app_frame_t frame;
+
+    if (nrf_atomic_u32_fetch_store(&m_telemetry_request, 0) != 0)
+    {
+        telemetry_update(true);
+    }
+
+    if (nrf_atomic_u32_fetch_store(&m_adv_rotation_request, 0) == 0)
+    {
+        return;
+    }
+
+    start = DWT->CYCCNT;
+    frame = ((m_adv_status & APP_STATUS_ALARM) || CONFIG_ADVERTISING()) ? APP_FRAME_BEACON
+                                                                        : (app_frame_t)adv_rotation_next(&m_adv_rotation);
+    if (frame != m_adv_frame)
+    {
+        m_adv_frame = frame;
+        advertising_data_switch();
+    }
+    cycles = DWT->CYCCNT - start;
+
+    m_adv_rotation_steps++;
+    m_adv_rotation_cycles    += cycles;
+    m_adv_rotation_cycles_max = MAX(m_adv_rotation_cycles_max, cycles);
+}
+#endif
+
+#if ADV_TURNS_ENABLED
+/**@brief Function for stopping the advertising set, whichever turn it is in.
+ */
+static void advertising_stop(void)
+{
+    ret_code_t err_code;
+
+    err_code = sd_ble_gap_adv_stop(m_adv_handle);
+    //a turn that already reached its event limit, or the gap between two blocks
+    if (err_code != NRF_ERROR_INVALID_STATE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    err_code = app_timer_stop(m_adv_block_timer);
+    APP_ERROR_CHECK(err_code);
+    (void) nrf_atomic_u32_store(&m_adv_block_request, 0);
+
+#if defined(USE_CODED_PHY_ADV)
+    //a block that ran to its end still hands over to the other PHY
+    if ((nrf_atomic_u32_fetch_store(&m_adv_set_ended, 0) != 0) && (m_adv_turn == ADV_TURN_SCHED))
+    {
+        m_adv_coded = !m_adv_coded;
+    }
+#else
+    (void) nrf_atomic_u32_store(&m_adv_set_ended, 0);
+#endif
+    m_adv_turn = ADV_TURN_NONE;
+}
+#endif
+
+#if defined(USE_ADV_TRAIN)
+/**@brief Function for putting one train event on air, called from the main loop when the train timer fired.
+ *
+ * @details The train event takes the set from whatever turn it is in. It is a legacy 1M event
+ *          with the current buffer, so every receiver can take it, and its event limit of one
+ *          ends it. The status byte is the one of the moment, an alarm is in the next train
+ *          event without waiting for anything.
+ */
+static void advertising_train_start(void)
+{
+    ret_code_t err_code;
+
+    advertising_stop();
+    m_adv_pointer_due = adv_train_event(&m_adv_train, uptime_ms());
+
+    m_adv_params.properties.type = BLE_GAP_ADV_TYPE_NONCONNECTABLE_NONSCANNABLE_UNDIRECTED;
+    m_adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
+    m_adv_params.secondary_phy   = BLE_GAP_PHY_1MBPS;
+    m_adv_params.max_adv_evts    = 1;
+    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, advertising_data(), &m_adv_params);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
+    APP_ERROR_CHECK(err_code);
+    m_adv_turn = ADV_TURN_TRAIN;
+}
+
+/**@brief Function for putting the train pointer on air, right after the train event it follows.
+ */
+static void advertising_pointer_start(void)
+{
+    ret_code_t err_code;
+
+    adv_train_pointer_encode(&m_adv_train, uptime_ms(), m_adv_status, m_adv_pointer);
+
+    m_adv_params.properties.type = BLE_GAP_ADV_TYPE_EXTENDED_NONCONNECTABLE_NONSCANNABLE_UNDIRECTED;
+    m_adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
+    m_adv_params.secondary_phy   = BLE_GAP_PHY_1MBPS;
+    m_adv_params.max_adv_evts    = 1;
+    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_pointer_data, &m_adv_params);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
+    APP_ERROR_CHECK(err_code);
+    m_adv_turn = ADV_TURN_POINTER;
+}
+#endif
+
+#if defined(USE_AUTH_FRAMES)
+/**@brief Function for encrypting one AES-128 block with the SoftDevice ECB, the cipher of adv_auth.c.
+ */
+static bool auth_ecb_encrypt(uint8_t const * p_key, uint8_t const * p_in, uint8_t * p_out)
+{
+    nrf_ecb_hal_data_t ecb;
+
+    memcpy(ecb.key, p_key, SOC_ECB_KEY_LENGTH);
+    memcpy(ecb.cleartext, p_in, SOC_ECB_CLEARTEXT_LENGTH);
+    if (sd_ecb_block_encrypt(&ecb) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    memcpy(p_out, ecb.ciphertext, SOC_ECB_CIPHERTEXT_LENGTH);
+    return true;
+}
+
+/**@brief Function for checking the ECB and adv_auth.c against a vector of host/auth_vectors.c.
+ *
+ * @details Test key, major 0x0102, minor 0x0304, counter 1, status 0x91.
+ */
+static void auth_self_check(void)
+{
+    static const uint8_t key[ADV_AUTH_KEY_LEN] = { APP_AUTH_KEY_DEFAULT };
+    static const uint8_t id[ADV_AUTH_ID_LEN]   = { 0x01, 0x02, 0x03, 0x04 };
+    adv_auth_t           auth;
+    uint32_t             tag;
+
+    APP_ERROR_CHECK_BOOL(adv_auth_init(&auth, auth_ecb_encrypt, key, id, 0, 0));
+    APP_ERROR_CHECK_BOOL(adv_auth_tag(&auth, 1, 0x91, &tag));
+    APP_ERROR_CHECK_BOOL(tag == 0xd1ab1b81);
+}
+
+/**@brief Function for loading the stored counter limit, the first counter this boot may use.
+ */
+static uint32_t auth_counter_load(void)
+{
+    fds_record_desc_t  desc  = {0};
+    fds_find_token_t   token = {0};
+    fds_flash_record_t record;
+    uint32_t           limit = 0;
+    ret_code_t         err_code;
+
+    if (fds_record_find(AUTH_FILE_ID, AUTH_RECORD_KEY, &desc, &token) != NRF_SUCCESS)
+    {
+        return 0;
+    }
+
+    err_code = fds_record_open(&desc, &record);
+    APP_ERROR_CHECK(err_code);
+
+    if (record.p_header->length_words == 1)
+    {
+        limit = *(uint32_t const *)record.p_data;
+    }
+
+    err_code = fds_record_close(&desc);
+    APP_ERROR_CHECK(err_code);
+
+    return limit;
+}
+
+/**@brief Function for writing the next counter limit to flash.
+ *
+ * @return True if the write was queued, the FDS handler reports its end.
+ */
+static bool auth_counter_reserve(uint32_t limit)
+{
+    fds_record_desc_t desc  = {0};
+    fds_find_token_t  token = {0};
+    fds_record_t      record =
+    {
+        .file_id           = AUTH_FILE_ID,
+        .key               = AUTH_RECORD_KEY,
+        .data.p_data       = &m_auth_record,
+        .data.length_words = 1
+    };
+    ret_code_t        err_code;
+
+    m_auth_record = limit;
+
+    if (fds_record_find(AUTH_FILE_ID, AUTH_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        err_code = fds_record_update(&desc, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(NULL, &record);
+    }
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        //old copies of the record fill the pages, the first pass after the collection writes again
+        err_code = fds_gc();
+        APP_ERROR_CHECK(err_code);
+        m_auth_gc_pending = true;
+        return false;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    m_auth_storing = true;
+    return true;
+}
+
+/**@brief Function for keeping the counter reservation ahead and the keystream computed, called from the main loop.
+ *
+ * @details Counters only go on air below a limit that is in flash, so a reset never reuses
+ *          one. A quarter of the reservation before the end, the next one is written. The
+ *          keystream words for the next counters are computed here, between events, so the
+ *          alarm path only has to XOR and write bytes.
+ */
+static void auth_process(void)
+{
+    if (!m_auth_keyed)
+    {
+        return;
+    }
+
+    if (nrf_atomic_u32_fetch_store(&m_auth_stored, 0) != 0)
+    {
+        m_auth_storing = false;
+        if (m_auth_store_result == NRF_SUCCESS)
+        {
+            adv_auth_limit_set(&m_auth, m_auth_record);
+        }
+        else
+        {
+            NRF_LOG_WARNING("Frame counter limit not stored: %u", m_auth_store_result);
+        }
+    }
+
+    if (!m_auth_storing && !m_auth_gc_pending && (adv_auth_counters_left(&m_auth) < AUTH_COUNTER_RESERVE / 4))
+    {
+        (void) auth_counter_reserve(m_auth.counter + AUTH_COUNTER_RESERVE);
+    }
+
+    (void) adv_auth_refill(&m_auth);
+}
+
+/**@brief Function for initializing the frame authentication, call it after storage_init().
+ *
+ * @details The key is read from the UICR. nrfjprog writes it a word at a time, the first key
+ *          byte is the lowest byte of 0x10001090:
+ *          nrfjprog --memwr 0x10001090 --val 0x03020100 (and 0x10001094 to 0x1000109C)
+ *          With an erased UICR the frames go out unsigned, receivers drop them. Only a build
+ *          with AUTH_ALLOW_TEST_KEY signs with the published test key instead.
+ *
+ *          Does not wait for the first counter reservation, advertising starts first. The
+ *          frame goes out unsigned until auth_process() has the reservation in flash, then
+ *          advertising_process() signs it.
+ *
+ * @param[in] p_id  Major and minor, big endian, as in the frame.
+ */
+static void auth_init(uint8_t const * p_id)
+{
+#if defined(AUTH_ALLOW_TEST_KEY)
+    static const uint8_t test_key[ADV_AUTH_KEY_LEN] = { APP_AUTH_KEY_DEFAULT };
+#endif
+    uint8_t const *      p_uicr = (uint8_t const *)AUTH_KEY_ADDRESS;
+    uint8_t              key[ADV_AUTH_KEY_LEN];
+    bool                 erased = true;
+    uint32_t             counter;
+
+    auth_self_check();
+
+    for (uint32_t i = 0; i < ADV_AUTH_KEY_LEN; i++)
+    {
+        key[i]  = p_uicr[i];
+        erased &= (p_uicr[i] == 0xFF);
+    }
+    if (erased)
+    {
+#if defined(AUTH_ALLOW_TEST_KEY)
+        memcpy(key, test_key, sizeof(key));
+        NRF_LOG_WARNING("Frame key: none in UICR, signing with the test key");
+#else
+        //the test key is published, frames signed with it would pass any receiver
+        NRF_LOG_ERROR("Frame key: none in UICR, frames go out unsigned");
+        return;
+#endif
+    }
+    m_auth_keyed = true;
+
+    //no counters until the first reservation is stored, the main loop finishes it
+    counter = auth_counter_load();
+    APP_ERROR_CHECK_BOOL(adv_auth_init(&m_auth, auth_ecb_encrypt, key, p_id, counter, counter));
+    m_auth_unsigned = true;
+    auth_process();
+    NRF_LOG_INFO("Frame counter %u, reservation pending", m_auth.counter);
+}
+
+/**@brief Function for signing the status byte of a frame, patches its counter and tag.
+ */
+static void auth_sign(uint8_t * p_frame)
+{
+    if (!m_auth_keyed)
+    {
+        return;
+    }
+    if (!adv_auth_sign(&m_auth,
+                       p_frame[ADV_FRAME_STATUS_OFFSET],
+                       &p_frame[ADV_FRAME_AUTH_COUNTER_OFFSET],
+                       &p_frame[ADV_FRAME_AUTH_TAG_OFFSET]))
+    {
+        //the old counter and tag stay, receivers drop the frame until a reservation is stored
+        if (!m_auth_unsigned)
+        {
+            NRF_LOG_WARNING("Frame not signed, no counter left");
+        }
+        m_auth_unsigned = true;
+        return;
+    }
+    m_auth_unsigned = false;
+}
+
+/**@brief Function for checking whether the frame on air waits for a tag that can be given now.
+ */
+static bool auth_sign_due(void)
+{
+    return m_auth_unsigned && (adv_auth_counters_left(&m_auth) > 0);
+}
+#endif
+//ADDED END
+
+/**@brief Function for initializing the Advertising functionality.
+ *
+ * @details Passes the advertising data built at compile time to the stack.
+ *          Also builds a structure to be passed to the stack when starting advertising.
+ */
+static void advertising_init(void)
+{
+    uint32_t      err_code;
+
+#if defined(USE_UICR_FOR_MAJ_MIN_VALUES)
+    // If USE_UICR_FOR_MAJ_MIN_VALUES is defined, the major and minor values will be read from the
+    // UICR instead of using the default values. The major and minor values obtained from the UICR
+    // are encoded into advertising data in big endian order (MSB First).
+    // To set the UICR used by this example to a desired value, write to the address 0x10001080
+    // using the nrfjprog tool. The command to be used is as follows.
+    // nrfjprog --snr <Segger-chip-Serial-Number> --memwr 0x10001080 --val <your major/minor value>
+    // For example, for a major value and minor value of 0xabcd and 0x0102 respectively, the
+    // the following command should be used.
+    // nrfjprog --snr <Segger-chip-Serial-Number> --memwr 0x10001080 --val 0xabcd0102
+    uint16_t major_value = ((*(uint32_t *)UICR_ADDRESS) & 0xFFFF0000) >> 16;
+    uint16_t minor_value = ((*(uint32_t *)UICR_ADDRESS) & 0x0000FFFF);
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_enc_advdata); i++)
+    {
+        m_enc_advdata[i][ADV_FRAME_MAJOR_OFFSET]     = MSB_16(major_value);
+        m_enc_advdata[i][ADV_FRAME_MAJOR_OFFSET + 1] = LSB_16(major_value);
+
+        m_enc_advdata[i][ADV_FRAME_MINOR_OFFSET]     = MSB_16(minor_value);
+        m_enc_advdata[i][ADV_FRAME_MINOR_OFFSET + 1] = LSB_16(minor_value);
+    }
+#if defined(USE_ADV_TRAIN)
+    m_adv_pointer[ADV_TRAIN_POINTER_MAJOR_OFFSET]     = MSB_16(major_value);
+    m_adv_pointer[ADV_TRAIN_POINTER_MAJOR_OFFSET + 1] = LSB_16(major_value);
+    m_adv_pointer[ADV_TRAIN_POINTER_MINOR_OFFSET]     = MSB_16(minor_value);
+    m_adv_pointer[ADV_TRAIN_POINTER_MINOR_OFFSET + 1] = LSB_16(minor_value);
+#endif
+#if defined(USE_ADV_ROTATION)
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_enc_telemetry); i++)
+    {
+        m_enc_telemetry[i][ADV_TELEMETRY_MAJOR_OFFSET]     = MSB_16(major_value);
+        m_enc_telemetry[i][ADV_TELEMETRY_MAJOR_OFFSET + 1] = LSB_16(major_value);
+        m_enc_telemetry[i][ADV_TELEMETRY_MINOR_OFFSET]     = MSB_16(minor_value);
+        m_enc_telemetry[i][ADV_TELEMETRY_MINOR_OFFSET + 1] = LSB_16(minor_value);
+    }
+#endif
+#endif
+
+#if defined(USE_AUTH_FRAMES)
+    //major and minor are final here, they are part of every nonce
+    auth_init(&m_enc_advdata[0][ADV_FRAME_MAJOR_OFFSET]);
+    auth_sign(m_enc_advdata[0]);
+#endif
+
+    // Initialize advertising parameters (used when starting advertising).
+    memset(&m_adv_params, 0, sizeof(m_adv_params));
+
+    advertising_phy_set();
+    m_adv_params.p_peer_addr     = NULL;    // Undirected advertisement.
+    m_adv_params.filter_policy   = BLE_GAP_ADV_FP_ANY;
+    m_adv_params.interval        = NON_CONNECTABLE_ADV_INTERVAL;
+    m_adv_params.duration        = 0;       // Never time out.
+
+    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_data[0], &m_adv_params);
+    APP_ERROR_CHECK(err_code);
+
+#if defined(USE_ADV_POWER_POLICY)
+    adv_power_policy_t power_policy =
+    {
+        .idle_dbm   = ADV_POWER_IDLE_DBM,
+        .alarm_dbm  = ADV_POWER_ALARM_DBM,
+        .copies     = ADV_POWER_COPIES,
+        .spread_pct = ADV_POWER_SPREAD_PCT
+    };
+    //every beacon draws other gaps, two of them never send in step
+    adv_power_init(&m_adv_power, &power_policy, NRF_FICR->DEVICEID[0]);
+    advertising_power_set();
+#endif
+
+    //the scheduler starts idle, at the interval configured above
+    adv_airtime_legacy(ADV_FRAME_LEN, &m_adv_airtime_legacy);
+#if defined(USE_CODED_PHY_ADV)
+    adv_airtime_extended(ADV_AIRTIME_PHY_CODED_S8, ADV_FRAME_LEN, &m_adv_airtime_coded);
+#endif
+#if defined(USE_ADV_TRAIN)
+    adv_airtime_extended(ADV_AIRTIME_PHY_1M, ADV_TRAIN_POINTER_LEN, &m_adv_airtime_pointer);
+#endif
+
+    adv_sched_config_t sched_config = ADV_SCHED_DEFAULT_CONFIG;
+    sched_config.idle_ms   = ADV_IDLE_INTERVAL_MS;
+    sched_config.window_ms = ADV_ALARM_WINDOW_MS;
+    sched_config.event_us  = advertising_event_us();
+    adv_sched_init(&m_adv_sched, &sched_config, uptime_ms());
+
+    err_code = app_timer_create(&m_adv_sched_timer, APP_TIMER_MODE_SINGLE_SHOT, adv_sched_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_adv_duty_timer, APP_TIMER_MODE_REPEATED, adv_duty_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+#if ADV_TURNS_ENABLED
+    err_code = app_timer_create(&m_adv_block_timer, APP_TIMER_MODE_SINGLE_SHOT, adv_block_timer_handler);
+    APP_ERROR_CHECK(err_code);
+#endif
+
+#if defined(USE_ADV_TRAIN)
+    adv_train_config_t train_config =
+    {
+        .interval_ms   = ADV_TRAIN_INTERVAL_MS,
+        .pointer_every = ADV_TRAIN_POINTER_EVERY
+    };
+    adv_train_init(&m_adv_train, &train_config, uptime_ms());
+
+    err_code = app_timer_create(&m_adv_train_timer, APP_TIMER_MODE_REPEATED, adv_train_timer_handler);
+    APP_ERROR_CHECK(err_code);
+#endif
+
+#if defined(USE_ADV_ROTATION)
+    advertising_rotation_init();
+#endif
+}
+
+
+/**@brief Function for starting advertising.
+ */
+static void advertising_start(void)
+{
+    ret_code_t err_code;
+
+#if defined(USE_ADV_TRAIN)
+    //the repeated timer keeps the train instants from wandering, the first event goes out now
+    err_code = app_timer_start(m_adv_train_timer, APP_TIMER_TICKS(ADV_TRAIN_INTERVAL_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+    advertising_train_start();
+#else
+    //the scheduler interval, a stored configuration may have changed it since advertising_init()
+    advertising_configure_start();
+#endif
+
+    err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_adv_duty_timer, ADV_DUTY_REPORT_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    advertising_airtime_report();
+}
+
+//ADDED START
+/**@brief Function for getting the interval of the scheduler events, config mode caps it so a
+ *        phone connects quickly.
+ */
+static uint32_t advertising_interval_ms(void)
+{
+    uint32_t interval_ms = adv_sched_interval_ms(&m_adv_sched);
+
+#if defined(USE_CONFIG_SERVICE)
+    if (m_config_adv)
+    {
+        interval_ms = MIN(interval_ms, CONFIG_ADV_INTERVAL_MS);
+    }
+#endif
+    return interval_ms;
+}
+
+/**@brief Function for configuring the current buffer, PHY and interval, and starting advertising.
+ */
+static void advertising_configure_start(void)
+{
+    ret_code_t err_code;
+
+#if defined(USE_ADV_TRAIN)
+    //the train alone carries the idle heartbeat
+    if ((m_adv_sched.state == ADV_SCHED_STATE_IDLE) && !CONFIG_ADVERTISING())
+    {
+        m_adv_turn = ADV_TURN_NONE;
+        return;
+    }
+#endif
+
+    advertising_phy_set();
+#if defined(USE_ADV_POWER_POLICY)
+    //one event per turn, the block timer spaces them
+    if (advertising_copies_active())
+    {
+        m_adv_params.max_adv_evts = 1;
+    }
+#endif
+    m_adv_params.interval = MSEC_TO_UNITS(advertising_interval_ms(), UNIT_0_625_MS);
+    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, advertising_data(), &m_adv_params);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
+    APP_ERROR_CHECK(err_code);
+#if ADV_TURNS_ENABLED
+    m_adv_turn = ADV_TURN_SCHED;
+#endif
+}
+
+/**@brief Function for switching advertising to the interval the scheduler picked.
+ *
+ * @details The interval can only change while advertising is stopped, so this stops it,
+ *          configures the current buffer with the new interval and starts again. The first
+ *          event at the new interval follows right away. A train event or pointer on air runs
+ *          to its end instead, the scheduler turn after it takes the new interval.
+ *
+ * @return True if the set was configured with the current buffer.
+ */
+static bool advertising_restart(void)
+{
+#if ADV_TURNS_ENABLED
+#if defined(USE_ADV_TRAIN)
+    if ((m_adv_turn == ADV_TURN_TRAIN) || (m_adv_turn == ADV_TURN_POINTER))
+    {
+        return false;
+    }
+#endif
+    advertising_stop();
+    advertising_configure_start();
+
+    return (m_adv_turn == ADV_TURN_SCHED);
+#else
+    ret_code_t err_code;
+
+    err_code = sd_ble_gap_adv_stop(m_adv_handle);
+    //a phone that connected to config mode stopped the set already
+    if (err_code != NRF_ERROR_INVALID_STATE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    advertising_configure_start();
+
+    return true;
+#endif
+}
+
+#if ADV_TURNS_ENABLED
+/**@brief Function for giving the set back to the scheduler one interval after the last event.
+ *
+ * @details The SoftDevice would start the next event one interval after the last one. The
+ *          block timer keeps that spacing, so taking turns does not add events.
+ */
+static void advertising_sched_resume(void)
+{
+    ret_code_t err_code;
+    uint32_t   ticks = APP_TIMER_TICKS(advertising_interval_ms());
+
+#if defined(USE_ADV_POWER_POLICY)
+    if (advertising_copies_active())
+    {
+        ticks = APP_TIMER_TICKS(adv_power_gap_ms(&m_adv_power, advertising_interval_ms()));
+    }
+#endif
+
+#if defined(USE_ADV_TRAIN)
+    if ((m_adv_sched.state == ADV_SCHED_STATE_IDLE) && !CONFIG_ADVERTISING())
+    {
+        m_adv_turn = ADV_TURN_NONE;
+        return;
+    }
+#endif
+
+    m_adv_turn = ADV_TURN_SCHED;
+    err_code = app_timer_start(m_adv_block_timer, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for starting the next turn of the advertising set, called from the main loop.
+ *
+ * @details With the Coded PHY interleave a block that ended hands over to a block on the other
+ *          PHY. A train event is followed by its pointer when one is due, then the scheduler
+ *          gets the set back. The train timer takes the set from any turn.
+ */
+static void advertising_turns_process(void)
+{
+    if (nrf_atomic_u32_fetch_store(&m_adv_set_ended, 0) != 0)
+    {
+        switch (m_adv_turn)
+        {
+#if defined(USE_ADV_TRAIN)
+            case ADV_TURN_TRAIN:
+                if (m_adv_pointer_due)
+                {
+                    advertising_pointer_start();
+                    break;
+                }
+                advertising_sched_resume();
+                break;
+
+            case ADV_TURN_POINTER:
+                advertising_sched_resume();
+                break;
+#endif
+
+            case ADV_TURN_SCHED:
+#if defined(USE_CODED_PHY_ADV)
+                m_adv_coded = !m_adv_coded;
+#endif
+                advertising_sched_resume();
+                break;
+
+            default:
+                //stopped on purpose, the event limit was reached just before
+                break;
+        }
+    }
+
+    if (nrf_atomic_u32_fetch_store(&m_adv_block_request, 0) != 0)
+    {
+        advertising_configure_start();
+    }
+
+#if defined(USE_ADV_TRAIN)
+    //config mode keeps the set connectable, the train instants go on after it
+    if ((nrf_atomic_u32_fetch_store(&m_adv_train_request, 0) != 0) && !CONFIG_ADVERTISING())
+    {
+        advertising_train_start();
+    }
+#endif
+}
+#endif
+
+/**@brief Function for logging the advertising radio duty cycle since boot.
+ */
+static void advertising_duty_report(void)
+{
+    uint32_t now_ms = uptime_ms();
+
+    NRF_LOG_INFO("Advertising interval %u ms, radio duty %u ppm (%u ppm at a fixed 100 ms)",
+                 adv_sched_interval_ms(&m_adv_sched),
+                 adv_sched_duty_ppm(&m_adv_sched, now_ms),
+                 adv_sched_fixed_duty_ppm(&m_adv_sched.config, 100));
+    advertising_airtime_report();
+#if defined(USE_ADV_POWER_POLICY)
+    NRF_LOG_INFO("Alarm policy: %d dBm, %u events per %u ms, %u uJ per alarm second; idle %d dBm, %u nJ per event",
+                 m_adv_power.policy.alarm_dbm, m_adv_power.policy.copies, m_adv_sched.config.alarm_ms,
+                 adv_power_alarm_uj(&m_adv_power, m_adv_sched.config.alarm_ms, advertising_event_us(), 1000),
+                 m_adv_power.policy.idle_dbm,
+                 adv_power_event_nj(m_adv_power.policy.idle_dbm, advertising_event_us()));
+#endif
+#if defined(USE_ADV_ROTATION)
+    NRF_LOG_INFO("Frame rotation: %u beacon, %u telemetry picks, %u steps of mean %u, max %u CPU cycles",
+                 m_adv_rotation.picks[APP_FRAME_BEACON], m_adv_rotation.picks[APP_FRAME_TELEMETRY],
+                 m_adv_rotation_steps,
+                 (m_adv_rotation_steps != 0) ? (uint32_t)(m_adv_rotation_cycles / m_adv_rotation_steps) : 0,
+                 m_adv_rotation_cycles_max);
+#endif
+#if defined(USE_LPCOMP_BLANKING)
+    NRF_LOG_INFO("LPCOMP blanking: %u radio events, %u with edges, %u UP and %u DOWN edges blanked, %u restored",
+                 m_lpcomp_blank.stats.windows, m_lpcomp_blank.stats.windows_hit,
+                 m_lpcomp_blank.stats.up_blanked, m_lpcomp_blank.stats.down_blanked,
+                 m_lpcomp_blank.stats.restored);
+#endif
+#if defined(USE_ENERGY_METER)
+    energy_report();
+#endif
+}
+
+/**@brief Function for putting the requested alarm status and interval on air, called from the main loop.
+ *
+ * @details The SoftDevice keeps reading the buffer it advertises, so a new status byte is
+ *          patched into the other buffer. Without an interval change
+ *          sd_ble_gap_adv_set_configure() switches over without stopping advertising and the
+ *          next advertising event carries the new status. An alarm also switches to the
+ *          alarm interval, that restart puts the alarm frame on air right away.
+ */
+static void advertising_process(void)
+{
+    ret_code_t err_code;
+    uint8_t    request        = m_adv_status_request;
+    bool       status_changed = ((m_adv_status & ~APP_STATUS_CHANGE_Msk) != request);
+    bool       step_due       = (nrf_atomic_u32_fetch_store(&m_adv_sched_request, 0) != 0);
+    bool       restart        = false;
+    bool       configured     = false;
+#if defined(USE_ADV_POWER_POLICY)
+    bool       alarm_changed  = (((m_adv_status ^ request) & APP_STATUS_ALARM) != 0);
+#endif
+    uint32_t   now_ms;
+    uint32_t   delay_ms;
+
+    if (nrf_atomic_u32_fetch_store(&m_adv_duty_request, 0) != 0)
+    {
+        advertising_duty_report();
+    }
+#if ADV_TURNS_ENABLED
+    advertising_turns_process();
+#endif
+#if defined(USE_ADV_ROTATION)
+    advertising_rotation_process();
+#endif
+
+#if defined(USE_AUTH_FRAMES)
+    if (!status_changed && auth_sign_due())
+    {
+        //the frame went out unsigned, a reservation is stored now
+        m_adv_data_index ^= 1;
+        m_enc_advdata[m_adv_data_index][ADV_FRAME_STATUS_OFFSET] = m_adv_status;
+        auth_sign(m_enc_advdata[m_adv_data_index]);
+        advertising_data_switch();
+    }
+#endif
+
+    if (!status_changed && !step_due)
+    {
+        return;
+    }
+
+    now_ms = uptime_ms();
+    if (status_changed)
+    {
+#if defined(USE_ADV_ROTATION)
+        if ((request & APP_STATUS_ALARM) && !(m_adv_status & APP_STATUS_ALARM))
+        {
+            m_telemetry_alarms++;
+        }
+#endif
+        m_adv_status      = request | ((m_adv_status + (1 << APP_STATUS_CHANGE_Pos)) & APP_STATUS_CHANGE_Msk);
+        m_adv_data_index ^= 1;
+        m_enc_advdata[m_adv_data_index][ADV_FRAME_STATUS_OFFSET] = m_adv_status;
+#if defined(USE_AUTH_FRAMES)
+        auth_sign(m_enc_advdata[m_adv_data_index]);
+#endif
+#if defined(USE_ADV_ROTATION)
+        //a status change goes out in the beacon frame first, the telemetry copy follows
+        m_adv_frame = APP_FRAME_BEACON;
+        telemetry_update(false);
+#endif
+        restart = adv_sched_alarm(&m_adv_sched, (request & APP_STATUS_ALARM) != 0, now_ms);
+#if defined(USE_ADV_POWER_POLICY)
+        //the alarm switches the power, and between periodic events and single ones with random gaps
+        advertising_power_set();
+        restart = restart || alarm_changed;
+#endif
+        NRF_LOG_INFO("Advertised status 0x%02x", m_adv_status);
+#if defined(USE_CONFIG_SERVICE)
+        event_log_note((request & APP_STATUS_ALARM) ? EVENT_LOG_ALARM_ON : EVENT_LOG_ALARM_OFF, m_adv_status, 0);
+#endif
+    }
+    if (step_due)
+    {
+        restart = adv_sched_update(&m_adv_sched, now_ms) || restart;
+    }
+
+    if (restart)
+    {
+        configured = advertising_restart();
+        NRF_LOG_INFO("Advertising interval %u ms", adv_sched_interval_ms(&m_adv_sched));
+    }
+    if (status_changed && !configured)
+    {
+        advertising_data_switch();
+    }
+
+    //a status change can end a hold or start one, so the step timer is set again every time
+    err_code = app_timer_stop(m_adv_sched_timer);
+    APP_ERROR_CHECK(err_code);
+    if (adv_sched_next(&m_adv_sched, now_ms, &delay_ms))
+    {
+        uint32_t ticks = APP_TIMER_TICKS(delay_ms);
+
+        err_code = app_timer_start(m_adv_sched_timer, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+
+#if LATENCY_TRACE_ENABLED
+    if (status_changed && (request & APP_STATUS_ALARM))
+    {
+        //the next radio event is the first one with the alarm frame
+        (void) nrf_atomic_u32_store(&m_latency_alarm_pending, 1);
+    }
+#endif
+}
+//ADDED END
+
+//ADDED START
+#if defined(USE_CONFIG_SERVICE)
+/**@brief Function for adding an event to the log and to the log status a phone reads.
+ */
+static void event_log_note(event_log_type_t type, uint8_t arg8, uint16_t arg16)
+{
+    uint8_t           status[CONFIG_LOG_STATUS_LEN];
+    ble_gatts_value_t value =
+    {
+        .len     = sizeof(status),
+        .offset  = 0,
+        .p_value = status
+    };
+    ret_code_t        err_code;
+
+    event_log_add(&m_event_log, uptime_s(), type, arg8, arg16);
+
+    (void) uint32_encode(event_log_first(&m_event_log), &status[0]);
+    (void) uint32_encode(event_log_next(&m_event_log), &status[4]);
+    (void) uint32_encode(uptime_s(), &status[8]);
+    err_code = sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, m_log_status_char_handles.value_handle, &value);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for putting the configuration in use into the configuration characteristic.
+ */
+static void config_value_update(void)
+{
+    uint8_t           blob[APP_CONFIG_LEN];
+    ble_gatts_value_t value =
+    {
+        .len     = sizeof(blob),
+        .offset  = 0,
+        .p_value = blob
+    };
+    ret_code_t        err_code;
+
+    app_config_encode(&m_config, blob);
+    err_code = sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, m_config_char_handles.value_handle, &value);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for switching the scheduler, the detector and the TX power to m_config.
+ *
+ * @param[in] running  Advertising is on, an interval change restarts it.
+ */
+static void config_apply(bool running)
+{
+    adv_sched_config_t sched_config = m_adv_sched.config;
+    ret_code_t         err_code;
+
+    app_config_sched_get(&m_config, &sched_config);
+    if (adv_sched_configure(&m_adv_sched, &sched_config, uptime_ms()) && running)
+    {
+        (void) advertising_restart();
+    }
+
+#if !defined(USE_PPI_TONE_COUNTER)
+    tone_detect_config_t detect_config;
+    tone_detect_config_get(&m_tone_detect, &detect_config);
+    app_config_detect_get(&m_config, &detect_config);
+    tone_detect_configure(&m_tone_detect, &detect_config);
+#endif
+
+    //with the delivery policy the configured power is only for the connection
+#if !defined(USE_ADV_POWER_POLICY)
+    err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_ADV, m_adv_handle, m_config.tx_power);
+    APP_ERROR_CHECK(err_code);
+#endif
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_CONN, m_conn_handle, m_config.tx_power);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    NRF_LOG_INFO("Config: %u/%u ms intervals, %u ms hold, %d dBm, policy %u,%u,%u",
+                 m_config.idle_ms, m_config.alarm_ms, m_config.window_ms, m_config.tx_power,
+                 m_config.policy.window, m_config.policy.required, m_config.policy.min_confidence);
+}
+
+/**@brief Function for loading the stored configuration.
+ *
+ * @return True if a valid one was found, m_config holds it.
+ */
+static bool config_load(void)
+{
+    fds_record_desc_t  desc  = {0};
+    fds_find_token_t   token = {0};
+    fds_flash_record_t record;
+    bool               found = false;
+    ret_code_t         err_code;
+
+    if (fds_record_find(CONFIG_FILE_ID, CONFIG_RECORD_KEY, &desc, &token) != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    err_code = fds_record_open(&desc, &record);
+    APP_ERROR_CHECK(err_code);
+
+    //a record of another format version is left for the defaults
+    if (record.p_header->length_words == BYTES_TO_WORDS(APP_CONFIG_LEN))
+    {
+        found = app_config_decode(record.p_data, APP_CONFIG_LEN, &m_config);
+    }
+
+    err_code = fds_record_close(&desc);
+    APP_ERROR_CHECK(err_code);
+
+    return found;
+}
+
+/**@brief Function for writing the configuration in use to flash.
+ */
+static void config_store(void)
+{
+    fds_record_desc_t desc  = {0};
+    fds_find_token_t  token = {0};
+    fds_record_t      record =
+    {
+        .file_id           = CONFIG_FILE_ID,
+        .key               = CONFIG_RECORD_KEY,
+        .data.p_data       = m_config_record,
+        .data.length_words = BYTES_TO_WORDS(APP_CONFIG_LEN)
+    };
+    ret_code_t        err_code;
+
+    memset(m_config_record, 0, sizeof(m_config_record));
+    app_config_encode(&m_config, (uint8_t *)m_config_record);
+
+    if (fds_record_find(CONFIG_FILE_ID, CONFIG_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        err_code = fds_record_update(&desc, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(NULL, &record);
+    }
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        //old copies of the record fill the pages, the next write is stored again
+        NRF_LOG_WARNING("Configuration not stored, flash full");
+        err_code = fds_gc();
+    }
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for switching the advertising set between config mode and the beacon.
+ *
+ * @details Config mode takes the set from any turn, a train event included, and advertises
+ *          the beacon frame connectable with the service UUID in the scan response. Back to the
+ *          beacon the set is non-connectable again, also while a phone is connected.
+ */
+static void config_advertising_set(bool on)
+{
+    m_config_adv = on;
+#if defined(USE_ADV_ROTATION)
+    m_adv_frame  = APP_FRAME_BEACON;
+#endif
+#if ADV_TURNS_ENABLED
+    advertising_stop();
+    advertising_configure_start();
+#else
+    (void) advertising_restart();
+#endif
+}
+
+/**@brief Function for sending log chunks until the notification queue is full or the log is sent.
+ *
+ * @details A chunk only counts as sent once the SoftDevice took it. The chunk without records
+ *          at the end tells the phone where to start next time.
+ */
+static void config_log_pump(void)
+{
+    uint8_t    chunk[CONFIG_LOG_CHUNK_MAX];
+    ret_code_t err_code;
+
+    while (m_log_streaming)
+    {
+        uint32_t               seq = m_log_seq;
+        uint16_t               len = (uint16_t)event_log_read(&m_event_log, &seq, chunk,
+                                                               MIN((uint32_t)(m_att_mtu - 3), sizeof(chunk)));
+        ble_gatts_hvx_params_t hvx =
+        {
+            .handle = m_log_char_handles.value_handle,
+            .type   = BLE_GATT_HVX_NOTIFICATION,
+            .offset = 0,
+            .p_len  = &len,
+            .p_data = chunk
+        };
+
+        err_code = sd_ble_gatts_hvx(m_conn_handle, &hvx);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            //the queue is full, the next BLE_GATTS_EVT_HVN_TX_COMPLETE goes on
+            return;
+        }
+        if (err_code != NRF_SUCCESS)
+        {
+            //notifications off, or the phone is gone
+            NRF_LOG_WARNING("Event log download stopped: %u", err_code);
+            m_log_streaming = false;
+            return;
+        }
+
+        m_log_seq = seq;
+        if (len == EVENT_LOG_HEADER_LEN)
+        {
+            NRF_LOG_INFO("Event log sent up to %u", seq);
+            m_log_streaming = false;
+        }
+    }
+}
+
+/**@brief Function for handling config mode, the config connection and the log download, called from the main loop.
+ */
+static void config_process(void)
+{
+    ret_code_t err_code;
+
+    if (nrf_atomic_u32_fetch_store(&m_config_button, 0) != 0)
+    {
+        //a press in config mode gives it the full time again
+        err_code = app_timer_stop(m_config_mode_timer);
+        APP_ERROR_CHECK(err_code);
+        err_code = app_timer_start(m_config_mode_timer, APP_TIMER_TICKS(CONFIG_MODE_TIMEOUT_MS), NULL);
+        APP_ERROR_CHECK(err_code);
+
+        if (!m_config_adv && (m_conn_handle == BLE_CONN_HANDLE_INVALID))
+        {
+            config_advertising_set(true);
+            err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING_DIRECTED);
+            APP_ERROR_CHECK(err_code);
+            NRF_LOG_INFO("Config mode for %u s", CONFIG_MODE_TIMEOUT_MS / 1000);
+        }
+    }
+
+    if (nrf_atomic_u32_fetch_store(&m_config_connected, 0) != 0)
+    {
+        event_log_note(EVENT_LOG_CONNECTED, 0, m_conn_handle);
+        err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_CONN, m_conn_handle, m_config.tx_power);
+        APP_ERROR_CHECK(err_code);
+        //the connection stopped the set, the beacon goes on next to it
+        config_advertising_set(false);
+        err_code = bsp_indication_set(BSP_INDICATE_CONNECTED);
+        APP_ERROR_CHECK(err_code);
+        NRF_LOG_INFO("Config connection");
+    }
+
+    if (nrf_atomic_u32_fetch_store(&m_config_disconnected, 0) != 0)
+    {
+        m_log_streaming = false;
+        err_code = app_timer_stop(m_config_mode_timer);
+        APP_ERROR_CHECK(err_code);
+        err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+        APP_ERROR_CHECK(err_code);
+        NRF_LOG_INFO("Config mode ended");
+    }
+
+    if (nrf_atomic_u32_fetch_store(&m_config_timeout, 0) != 0)
+    {
+        if (m_conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            //the disconnect event ends config mode
+            err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+            if (err_code != NRF_ERROR_INVALID_STATE)
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+        }
+        else if (m_config_adv)
+        {
+            config_advertising_set(false);
+            err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+            APP_ERROR_CHECK(err_code);
+            NRF_LOG_INFO("Config mode ended");
+        }
+    }
+
+    //the BLE event handler only writes the blob while the flag is clear
+    if (m_config_write != 0)
+    {
+        APP_ERROR_CHECK_BOOL(app_config_decode(m_config_written, APP_CONFIG_LEN, &m_config));
+        (void) nrf_atomic_u32_store(&m_config_write, 0);
+
+        config_apply(true);
+        config_value_update();
+        config_store();
+        event_log_note(EVENT_LOG_CONFIG, APP_CONFIG_VERSION, 0);
+    }
+
+    if (nrf_atomic_u32_fetch_store(&m_log_start, 0) != 0)
+    {
+        m_log_seq       = m_log_from;
+        m_log_streaming = true;
+        config_log_pump();
+    }
+    if (nrf_atomic_u32_fetch_store(&m_log_pump, 0) != 0)
+    {
+        config_log_pump();
+    }
+}
+
+/**@brief Config mode timer handler, the main loop ends config mode.
+ */
+static void config_mode_timer_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_config_timeout, 1);
+}
+
+/**@brief BSP event handler, button 1 opens config mode.
+ */
+static void bsp_evt_handler(bsp_event_t event)
+{
+    if (event == BSP_EVENT_KEY_0)
+    {
+        (void) nrf_atomic_u32_store(&m_config_button, 1);
+    }
+}
+
+/**@brief Function for adding the configuration service.
+ *
+ * @details Vendor specific service with three characteristics:
+ *          - Configuration: the app_config.h blob. Read it, or write a whole new one. A blob
+ *            that fails the checks is refused with an ATT error and changes nothing.
+ *          - Log: write a sequence number, little endian. Notifications bring the events from
+ *            there on in event_log.h chunks, an empty chunk ends the download.
+ *          - Log status: oldest and next sequence number and the uptime in seconds, to turn
+ *            event times into wall clock time.
+ */
+static void config_service_init(void)
+{
+    ble_uuid128_t const   base = { { CONFIG_UUID_BASE } };
+    ble_uuid_t            uuid;
+    uint16_t              service_handle;
+    ble_add_char_params_t params;
+    uint8_t               blob[APP_CONFIG_LEN];
+    uint8_t               status[CONFIG_LOG_STATUS_LEN] = {0};
+    uint8_t               len;
+    ret_code_t            err_code;
+
+    err_code = sd_ble_uuid_vs_add(&base, &m_config_uuid_type);
+    APP_ERROR_CHECK(err_code);
+
+    uuid.type = m_config_uuid_type;
+    uuid.uuid = CONFIG_SERVICE_UUID;
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &uuid, &service_handle);
+    APP_ERROR_CHECK(err_code);
+
+    //the scan response in config mode lists the service
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_config_scan_rsp); i++)
+    {
+        m_config_scan_rsp[i][0] = sizeof(m_config_scan_rsp[i]) - 1;
+        m_config_scan_rsp[i][1] = BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE;
+        err_code = sd_ble_uuid_encode(&uuid, &len, &m_config_scan_rsp[i][2]);
+        APP_ERROR_CHECK(err_code);
+        APP_ERROR_CHECK_BOOL(len == sizeof(m_config_scan_rsp[i]) - 2);
+    }
+
+    app_config_encode(&m_config, blob);
+    memset(&params, 0, sizeof(params));
+    params.uuid              = CONFIG_CHAR_CONFIG_UUID;
+    params.uuid_type         = m_config_uuid_type;
+    params.max_len           = APP_CONFIG_LEN;
+    params.init_len          = APP_CONFIG_LEN;
+    params.p_init_value      = blob;
+    params.char_props.read   = 1;
+    params.char_props.write  = 1;
+    params.is_defered_write  = true;
+    params.read_access       = SEC_OPEN;
+    params.write_access      = SEC_OPEN;
+    err_code = characteristic_add(service_handle, &params, &m_config_char_handles);
+    APP_ERROR_CHECK(err_code);
+
+    memset(&params, 0, sizeof(params));
+    params.uuid                     = CONFIG_CHAR_LOG_UUID;
+    params.uuid_type                = m_config_uuid_type;
+    params.max_len                  = CONFIG_LOG_CHUNK_MAX;
+    params.init_len                 = 0;
+    params.is_var_len               = true;
+    params.char_props.write         = 1;
+    params.char_props.write_wo_resp = 1;
+    params.char_props.notify        = 1;
+    params.write_access             = SEC_OPEN;
+    params.cccd_write_access        = SEC_OPEN;
+    err_code = characteristic_add(service_handle, &params, &m_log_char_handles);
+    APP_ERROR_CHECK(err_code);
+
+    memset(&params, 0, sizeof(params));
+    params.uuid            = CONFIG_CHAR_LOG_STATUS_UUID;
+    params.uuid_type       = m_config_uuid_type;
+    params.max_len         = CONFIG_LOG_STATUS_LEN;
+    params.init_len        = CONFIG_LOG_STATUS_LEN;
+    params.p_init_value    = status;
+    params.char_props.read = 1;
+    params.read_access     = SEC_OPEN;
+    err_code = characteristic_add(service_handle, &params, &m_log_status_char_handles);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for initializing the configuration and the event log.
+ *
+ * @details Loads the stored configuration, or takes the compile time one, and applies it. Call
+ *          it after storage_init(), advertising_init() and the tone front end, and before
+ *          advertising_start(). The connection parameters ask for a short interval, the log
+ *          download is over in a few of them.
+ */
+static void config_init(void)
+{
+    ble_gap_conn_params_t const conn_params =
+    {
+        .min_conn_interval = MSEC_TO_UNITS(7.5, UNIT_1_25_MS),
+        .max_conn_interval = MSEC_TO_UNITS(30, UNIT_1_25_MS),
+        .slave_latency     = 0,
+        .conn_sup_timeout  = MSEC_TO_UNITS(4000, UNIT_10_MS)
+    };
+#if !defined(USE_PPI_TONE_COUNTER)
+    tone_detect_config_t detect_config;
+    tone_detect_config_get(&m_tone_detect, &detect_config);
+#else
+    tone_detect_config_t detect_config = TONE_DETECT_DEFAULT_CONFIG;
+#endif
+    bool       stored;
+    ret_code_t err_code;
+
+    //the log is not cleared by a reset, only a power-on loses it
+    if (!event_log_valid(&m_event_log))
+    {
+        event_log_init(&m_event_log);
+    }
+
+    app_config_init(&m_config, &m_adv_sched.config, &detect_config, 0);
+    stored = config_load();
+    config_apply(false);
+
+    config_service_init();
+
+    err_code = sd_ble_gap_ppcp_set(&conn_params);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_config_mode_timer, APP_TIMER_MODE_SINGLE_SHOT, config_mode_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    event_log_note(EVENT_LOG_BOOT, (uint8_t)m_reset_reason, (uint16_t)(m_reset_reason >> 16));
+
+    NRF_LOG_INFO("Config service: %s configuration, button 1 opens config mode",
+                 stored ? "stored" : "default");
+}
+#endif
+//ADDED END
+
+
+//ADDED START
+#if defined(USE_CONFIG_SERVICE)
+/**@brief Function for handling the BLE events of the config connection.
+ *
+ * @details Runs in the SoftDevice event interrupt. Link negotiation is answered here: the
+ *          largest MTU, the longest packets and 2M PHY, so the log goes out in few, full
+ *          packets. Everything that touches the detector, the advertising set or the log is
+ *          left to the main loop.
+ */
+static void config_ble_evt_handler(ble_evt_t const * p_ble_evt)
+{
+    uint16_t   conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    ret_code_t err_code;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            ble_gap_phys_t const phys = { .tx_phys = BLE_GAP_PHY_2MBPS, .rx_phys = BLE_GAP_PHY_2MBPS };
+
+            m_conn_handle = conn_handle;
+            m_att_mtu     = BLE_GATT_ATT_MTU_DEFAULT;
+
+            err_code = sd_ble_gap_phy_update(conn_handle, &phys);
+            APP_ERROR_CHECK(err_code);
+            err_code = sd_ble_gap_data_length_update(conn_handle, NULL, NULL);
+            //the central may have started its own update first
+            if (err_code != NRF_ERROR_BUSY)
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+            err_code = sd_ble_gattc_exchange_mtu_request(conn_handle, NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+            if (err_code != NRF_ERROR_BUSY)
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+            (void) nrf_atomic_u32_store(&m_config_connected, 1);
+            break;
+        }
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            (void) nrf_atomic_u32_store(&m_config_disconnected, 1);
+            break;
+
+        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+        {
+            ble_gap_phys_t const phys = { .tx_phys = BLE_GAP_PHY_AUTO, .rx_phys = BLE_GAP_PHY_AUTO };
+
+            err_code = sd_ble_gap_phy_update(conn_handle, &phys);
+            APP_ERROR_CHECK(err_code);
+            break;
+        }
+
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST:
+            err_code = sd_ble_gap_data_length_update(conn_handle, NULL, NULL);
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
+            //no bonding, config mode is opened by hand at the beacon
+            err_code = sd_ble_gap_sec_params_reply(conn_handle, BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP, NULL, NULL);
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        case BLE_GATTS_EVT_SYS_ATTR_MISSING:
+            err_code = sd_ble_gatts_sys_attr_set(conn_handle, NULL, 0, 0);
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+            err_code = sd_ble_gatts_exchange_mtu_reply(conn_handle, NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+            APP_ERROR_CHECK(err_code);
+            m_att_mtu = MAX(MIN(p_ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu,
+                                NRF_SDH_BLE_GATT_MAX_MTU_SIZE),
+                            BLE_GATT_ATT_MTU_DEFAULT);
+            break;
+
+        case BLE_GATTC_EVT_EXCHANGE_MTU_RSP:
+            m_att_mtu = MAX(MIN(p_ble_evt->evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu,
+                                NRF_SDH_BLE_GATT_MAX_MTU_SIZE),
+                            BLE_GATT_ATT_MTU_DEFAULT);
+            break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        {
+            ble_gatts_evt_write_t const *          p_write = &p_ble_evt->evt.gatts_evt.params.authorize_request.request.write;
+            ble_gatts_rw_authorize_reply_params_t reply   =
+            {
+                .type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE,
+                .params.write.gatt_status = BLE_GATT_STATUS_SUCCESS,
+                .params.write.update      = 1,
+                .params.write.offset      = 0,
+                .params.write.len         = p_write->len,
+                .params.write.p_data      = p_write->data
+            };
+            app_config_t config;
+
+            if ((p_ble_evt->evt.gatts_evt.params.authorize_request.type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) ||
+                (p_write->handle != m_config_char_handles.value_handle))
+            {
+                break;
+            }
+
+            //a blob is taken whole or refused, the phone gets the error
+            if ((p_write->op != BLE_GATTS_OP_WRITE_REQ) || (p_write->offset != 0) || (p_write->len != APP_CONFIG_LEN))
+            {
+                reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+                reply.params.write.update      = 0;
+            }
+            else if (!app_config_decode(p_write->data, p_write->len, &config))
+            {
+                reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_APP_BEGIN;
+                reply.params.write.update      = 0;
+            }
+            else if (nrf_atomic_u32_fetch_store(&m_config_write, 1) != 0)
+            {
+                //the main loop has not taken the last one yet
+                reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INSUF_RESOURCES;
+                reply.params.write.update      = 0;
+            }
+            else
+            {
+                memcpy(m_config_written, p_write->data, APP_CONFIG_LEN);
+            }
+
+            err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+            APP_ERROR_CHECK(err_code);
+            break;
+        }
+
+        case BLE_GATTS_EVT_WRITE:
+        {
+            ble_gatts_evt_write_t const * p_write = &p_ble_evt->evt.gatts_evt.params.write;
+
+            if ((p_write->handle == m_log_char_handles.value_handle) && (p_write->len == sizeof(uint32_t)))
+            {
+                m_log_from = uint32_decode(p_write->data);
+                (void) nrf_atomic_u32_store(&m_log_start, 1);
+            }
+            break;
+        }
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            (void) nrf_atomic_u32_store(&m_log_pump, 1);
+            break;
+
+        case BLE_GATTC_EVT_TIMEOUT:
+        case BLE_GATTS_EVT_TIMEOUT:
+            err_code = sd_ble_gap_disconnect(conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+            if (err_code != NRF_ERROR_INVALID_STATE)
+            {
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+#endif
+
+#if ADV_TURNS_ENABLED || defined(USE_CONFIG_SERVICE)
+/**@brief Function for handling BLE events.
+ *
+ * @details A turn of the advertising set ends with its event limit, the main loop starts the
+ *          next one. The config connection has its own handler.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ * @param[in] p_context  Unused.
+ */
+static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
+{
+#if ADV_TURNS_ENABLED
+    if ((p_ble_evt->header.evt_id == BLE_GAP_EVT_ADV_SET_TERMINATED) &&
+        (p_ble_evt->evt.gap_evt.params.adv_set_terminated.reason == BLE_GAP_EVT_ADV_SET_TERMINATED_REASON_LIMIT_REACHED))
+    {
+        (void) nrf_atomic_u32_store(&m_adv_set_ended, 1);
+    }
+#endif
+#if defined(USE_CONFIG_SERVICE)
+    config_ble_evt_handler(p_ble_evt);
+#endif
+}
+#endif
+//ADDED END
+
+
+/**@brief Function for initializing the BLE stack.
+ *
+ * @details Initializes the SoftDevice and the BLE event interrupt.
+ */
+static void ble_stack_init(void)
+{
+    ret_code_t err_code;
+
+    err_code = nrf_sdh_enable_request();
+    APP_ERROR_CHECK(err_code);
+
+    // Configure the BLE stack using the default settings.
+    // Fetch the start address of the application RAM.
+    uint32_t ram_start = 0;
+    err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
+    APP_ERROR_CHECK(err_code);
+
+    //ADDED START
+#if defined(USE_CONFIG_SERVICE)
+    //a deeper notification queue keeps every connection event of the log download full
+    ble_cfg_t ble_cfg;
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.conn_cfg.conn_cfg_tag                            = APP_BLE_CONN_CFG_TAG;
+    ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = CONFIG_HVN_TX_QUEUE_SIZE;
+    err_code = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &ble_cfg, ram_start);
+    APP_ERROR_CHECK(err_code);
+#endif
+    //ADDED END
+
+    // Enable BLE stack.
+    err_code = nrf_sdh_ble_enable(&ram_start);
+    APP_ERROR_CHECK(err_code);
+
+    //ADDED START
+#if defined(USE_CONFIG_SERVICE)
+    //connection events run on while there is data and no other radio activity
+    ble_opt_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.common_opt.conn_evt_ext.enable = 1;
+    err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+    APP_ERROR_CHECK(err_code);
+#endif
+#if ADV_TURNS_ENABLED || defined(USE_CONFIG_SERVICE)
+    // Register a handler for BLE events.
+    NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
+#endif
+    //ADDED END
+}
+
+
+/**@brief Function for initializing logging. */
+static void log_init(void)
+{
+    ret_code_t err_code = NRF_LOG_INIT(NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**ADDED
+ * @brief Function for starting the log backends.
+ *
+ * @details Deferred until advertising runs, entries logged before wait in the log buffer.
+ */
+static void log_backends_init(void)
+{
+    NRF_LOG_DEFAULT_BACKENDS_INIT();
+#if defined(USE_LOG_BINARY)
+    binary_log_init();
+#endif
+}
+
+/**@brief Function for initializing LEDs. */
+static void leds_init(void)
+{
+    //ADDED START
+#if defined(USE_CONFIG_SERVICE)
+    ret_code_t err_code = bsp_init(BSP_INIT_LEDS | BSP_INIT_BUTTONS, bsp_evt_handler);
+#else
+    ret_code_t err_code = bsp_init(BSP_INIT_LEDS, NULL);
+#endif
+    //ADDED END
+    APP_ERROR_CHECK(err_code);
+
+    //ADDED START
+    //advertising started before the BSP, so its indication was dropped, and bsp_init()
+    //turned off the LEDs the detector lit in the meantime
+#if defined(USE_CONFIG_SERVICE)
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID)
+    {
+        err_code = bsp_indication_set(BSP_INDICATE_CONNECTED);
+    }
+    else if (m_config_adv)
+    {
+        err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING_DIRECTED);
+    }
+    else
+#endif
+    {
+        err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+    }
+    APP_ERROR_CHECK(err_code);
+
+    if ((m_adv_status_request & APP_STATUS_ALARM) != 0)
+    {
+        //turn on LED4
+        bsp_board_led_on(BSP_BOARD_LED_3);
+    }
+#if !defined(USE_PPI_TONE_COUNTER)
+    if (m_tone_detect.decoder.tone_on)
+    {
+        //turn on LED3
+        bsp_board_led_on(BSP_BOARD_LED_2);
+    }
+#endif
+    //ADDED END
+}
+
+
+/**@brief Function for initializing timers. */
+static void timers_init(void)
+{
+    ret_code_t err_code = app_timer_init();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for initializing power management.
+ */
+static void power_management_init(void)
+{
+    ret_code_t err_code;
+    err_code = nrf_pwr_mgmt_init();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for handling the idle state (main loop).
+ *
+ * @details If there is no pending log operation, then sleep until next the next event occurs.
+ */
+static void idle_state_handle(void)
+{
+#if !defined(USE_PPI_TONE_COUNTER)
+    edge_capture_process();
+#endif
+    advertising_process();
+#if defined(USE_AUTH_FRAMES)
+    auth_process();
+#endif
+#if LATENCY_TRACE_ENABLED
+    latency_trace_process();
+#endif
+#if defined(USE_CONFIG_SERVICE)
+    config_process();
+#endif
+#if defined(USE_SYSTEM_OFF)
+    system_off_process();
+#endif
+#if BOOT_PROFILE_ENABLED
+    boot_profile_process();
+#endif
+#if defined(USE_LOG_BINARY)
+    binary_log_process();
+#endif
+
+#if defined(USE_ENERGY_METER)
+    if (energy_log_process() == false)
+    {
+        energy_pwr_mgmt_run();
+    }
+#else
+    if (NRF_LOG_PROCESS() == false)
+    {
+        nrf_pwr_mgmt_run();
+    }
+#endif
+}
+
+#if !defined(USE_SAADC_GOERTZEL)
+/**@brief LPCOMP reference of every calibration level, level n is n/16 of the supply. */
+static const nrf_lpcomp_ref_t m_lpcomp_refs[LPCOMP_CAL_LEVEL_MAX] =
+{
+    NRF_LPCOMP_REF_SUPPLY_1_16,   NRF_LPCOMP_REF_SUPPLY_1_8,    NRF_LPCOMP_REF_SUPPLY_3_16,
+    NRF_LPCOMP_REF_SUPPLY_2_8,    NRF_LPCOMP_REF_SUPPLY_5_16,   NRF_LPCOMP_REF_SUPPLY_3_8,
+    NRF_LPCOMP_REF_SUPPLY_7_16,   NRF_LPCOMP_REF_SUPPLY_4_8,    NRF_LPCOMP_REF_SUPPLY_9_16,
+    NRF_LPCOMP_REF_SUPPLY_5_8,    NRF_LPCOMP_REF_SUPPLY_11_16,  NRF_LPCOMP_REF_SUPPLY_6_8,
+    NRF_LPCOMP_REF_SUPPLY_13_16,  NRF_LPCOMP_REF_SUPPLY_7_8,    NRF_LPCOMP_REF_SUPPLY_15_16
+};
+
+/**@brief Function for building the LPCOMP HAL configuration of a calibration level.
+ *
+ * @param[in] level       Reference in sixteenths of the supply.
+ * @param[in] hysteresis  True for the 50 mV hysteresis.
+ */
+static nrf_lpcomp_config_t lpcomp_hal_config(uint8_t level, bool hysteresis)
+{
+    nrf_lpcomp_config_t config =
+    {
+        .reference = m_lpcomp_refs[level - LPCOMP_CAL_LEVEL_MIN],
+        .detection = NRF_LPCOMP_DETECT_UP,
+        .hyst      = hysteresis ? NRF_LPCOMP_HYST_50mV : NRF_LPCOMP_HYST_NOHYST
+    };
+
+    return config;
+}
+
+/**@brief Function for initializing the LPCOMP for smoke detector sensing.
+ * ADDED
+ *@details 
+ */
+static void lpcomp_init(void)
+{
+  //make config struct for LPCOMP for initialization later
+    nrfx_lpcomp_config_t nrfx_lpcomp_config = {
+                                              //reference and hysteresis come from the calibration,
+                                              //supply 4/8 with 50mV hysteresis until there is one
+                                              .hal                = lpcomp_hal_config(m_lpcomp_cal_result.level,
+                                                                                      m_lpcomp_cal_result.hysteresis != 0),
+                                              //Pin 0.31
+                                              .input              = NRF_LPCOMP_INPUT_7,
+                                              //NRFX_LPCOMP_CONFIG_IRQ_PRIORITY set to <2=> 2
+                                              .interrupt_priority = 2
+                                              };
+    //initialize LPCOMP
+    nrfx_err_t err_code = nrfx_lpcomp_init(&nrfx_lpcomp_config,
+                                           nrfx_lpcomp_event_handler);
+
+#if defined(USE_PPI_TONE_COUNTER)
+    //edges are counted through PPI, so LPCOMP must not wake the CPU at all
+    nrf_lpcomp_int_disable(LPCOMP_INTENSET_UP_Msk);
+#else
+    //have to override work done in SDK init function
+    //because they went too far with abstraction and
+    //made this impossible through their preferred interface
+    nrf_lpcomp_int_enable(LPCOMP_INTENSET_UP_Msk | LPCOMP_INTENSET_DOWN_Msk);
+#endif
+}
+#endif // USE_SAADC_GOERTZEL
+
+#if !defined(USE_RTC_BURST_TIMER)
+/**@brief This function initialized Timer1 for smoke detector sensing.
+ * ADDED
+ * @details Expects a global or static variable "static const nrfx_timer_t nrfx_timer_1 = NRFX_TIMER_INSTANCE(1);" to 
+ *          be in the file. Expects a handler function "static void nrfx_timer_event_handler(nrf_timer_event_t event_type, void * p_context)"
+ *          to be in the file.
+ */
+static void timer1_init(void)
+{
+    //Note that that Timer 1 instance was created as static outside of main.
+    //Note that if frequency is set to 31.25KHz max CC time is ~2 seconds with default
+    //    bit width of 16. To get more time increase bit width.
+
+    //make timer 1 config struct for init function later
+    nrfx_timer_config_t nrfx_timer_config_1 = {
+                                                //frequency set to <9=> 31.25 kHz 
+                                               .frequency          = (nrf_timer_frequency_t) 9,
+                                                //mode set to <0=> Timer 
+                                               .mode               = (nrf_timer_mode_t) 0,
+                                                //bit_width set to <2=> 24 bit
+                                               .bit_width          = (nrf_timer_bit_width_t) 2,
+                                                //interrupt_priority set to <3=> 3
+                                               .interrupt_priority = 3,                    
+                                               .p_context          = NULL                                                       
+                                              };
+
+    //find out how many ticks we need for our counter times:
+    //1.25 seconds worth of ticks at 31.25KHz
+    uint32_t timer_1_CC0_ticks = TONE_COUNTER_CC0_TICKS;
+                                 //nrfx_timer_ms_to_ticks(&nrfx_timer_1, 
+                                 //      (uint32_t) 1250);
+    //0.75 seconds worth of ticks at 31.25KHz
+    uint32_t timer_1_CC1_ticks = TONE_COUNTER_CC1_TICKS;
+                                 //nrfx_timer_ms_to_ticks(&nrfx_timer_1, 
+                                 //      (uint32_t) 750);
+
+#if defined(USE_PPI_TONE_COUNTER)
+    //3 seconds worth of ticks at 31.25KHz
+    uint32_t timer_1_CC2_ticks = TONE_COUNTER_CC2_TICKS;
+                                 //nrfx_timer_ms_to_ticks(&nrfx_timer_1, 
+                                 //      (uint32_t) 3000);
+#else
+    //the pattern engine needs to see the longest pause of any pattern table
+    uint32_t timer_1_CC2_ticks = TONE_PATTERN_SILENCE_US / TONE_COUNTER_TICK_US;
+#endif
+
+    //initialize timer 1
+    nrfx_err_t timer_init_err = nrfx_timer_init(&nrfx_timer_1,
+                                                &nrfx_timer_config_1,
+                                                nrfx_timer_event_handler);
+
+    //set up CC0 for 1.25 sec and enable interrupts
+    //(only the tone counter closes its burst window on CC0, the
+    //pattern engine decides on every decoded tone instead)
+#if defined(USE_PPI_TONE_COUNTER)
+    nrfx_timer_compare(&nrfx_timer_1,
+                       (nrf_timer_cc_channel_t) 0,
+                       timer_1_CC0_ticks,
+                       1);
+#else
+    UNUSED_VARIABLE(timer_1_CC0_ticks);
+#endif
+
+    //set up CC1 for 0.75 sec without interrupts, the PPI tone counter
+    //uses the compare event to re-arm LPCOMP in hardware
+    nrfx_timer_compare(&nrfx_timer_1,
+                       (nrf_timer_cc_channel_t) 1,
+                       timer_1_CC1_ticks,
+                       0);
+
+    //set up CC2 for 3 sec and enable interrupts, the timer stops itself
+    //on CC2 so a late interrupt can never pause a window that was just restarted
+    nrfx_timer_extended_compare(&nrfx_timer_1,
+                                (nrf_timer_cc_channel_t) 2,
+                                timer_1_CC2_ticks,
+                                NRF_TIMER_SHORT_COMPARE2_STOP_MASK,
+                                1);
+    
+    //enabling automatically starts the timer, so we need to
+    //    stop it and reset after enabling
+    nrfx_timer_enable(&nrfx_timer_1);
+    nrfx_timer_pause(&nrfx_timer_1);
+    nrfx_timer_clear(&nrfx_timer_1);
+}
+#endif // !USE_RTC_BURST_TIMER
+
+#if defined(USE_RTC_BURST_TIMER)
+/**@brief Function for initializing RTC2 as the burst window timer.
+ *
+ * @details Same compare channels as timer1_init(), on the 32.768 kHz LFCLK that the
+ *          SoftDevice keeps running anyway. The RTC has no shortcuts, so CC2 stops the
+ *          RTC through a PPI channel instead. The RTC is only started by the first tone.
+ */
+static void rtc2_init(void)
+{
+    nrfx_rtc_config_t nrfx_rtc_config = NRFX_RTC_DEFAULT_CONFIG;
+    //prescaler 0, one tick is 30.5 us
+    nrfx_rtc_config.prescaler          = 0;
+    nrfx_rtc_config.interrupt_priority = 3;
+
+#if defined(USE_PPI_TONE_COUNTER)
+    uint32_t rtc_2_CC2_ticks = TONE_COUNTER_RTC_CC2_TICKS;
+#else
+    //the pattern engine needs to see the longest pause of any pattern table
+    uint32_t rtc_2_CC2_ticks = (uint32_t)(((uint64_t)TONE_PATTERN_SILENCE_US * TONE_COUNTER_RTC_FREQ_HZ) / 1000000);
+#endif
+
+    nrfx_err_t err_code = nrfx_rtc_init(&nrfx_rtc_2, &nrfx_rtc_config, nrfx_rtc_event_handler);
+    APP_ERROR_CHECK(err_code);
+
+    //CC0 only interrupts for the tone counter, CC1 has no interrupt and is only
+    //used through PPI, CC2 interrupts at the end of the burst
+#if defined(USE_PPI_TONE_COUNTER)
+    err_code = nrfx_rtc_cc_set(&nrfx_rtc_2, 0, TONE_COUNTER_RTC_CC0_TICKS, true);
+    APP_ERROR_CHECK(err_code);
+#endif
+    err_code = nrfx_rtc_cc_set(&nrfx_rtc_2, 1, TONE_COUNTER_RTC_CC1_TICKS, false);
+    APP_ERROR_CHECK(err_code);
+    err_code = nrfx_rtc_cc_set(&nrfx_rtc_2, 2, rtc_2_CC2_ticks, true);
+    APP_ERROR_CHECK(err_code);
+
+    (void) ppi_channel_setup(nrfx_rtc_event_address_get(&nrfx_rtc_2, NRF_RTC_EVENT_COMPARE_2),
+                             nrfx_rtc_task_address_get(&nrfx_rtc_2, NRF_RTC_TASK_STOP),
+                             0);
+
+    //nrfx_rtc_enable() would start counting, the first tone does that instead
+    nrf_rtc_task_trigger(nrfx_rtc_2.p_reg, NRF_RTC_TASK_CLEAR);
+}
+#endif // USE_RTC_BURST_TIMER
+
+/**@brief Function for allocating and enabling a PPI channel.
+ *
+ * @param[in] eep       Event end point address.
+ * @param[in] tep       Task end point address.
+ * @param[in] fork_tep  Fork task end point address, 0 for none.
+ *
+ * @return The allocated channel.
+ */
+static uint32_t ppi_channel_setup(uint32_t eep, uint32_t tep, uint32_t fork_tep)
+{
+    nrf_ppi_channel_t channel;
+    nrfx_err_t        err_code;
+
+    err_code = nrfx_ppi_channel_alloc(&channel);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrfx_ppi_channel_assign(channel, eep, tep);
+    APP_ERROR_CHECK(err_code);
+
+    if (fork_tep != 0)
+    {
+        err_code = nrfx_ppi_channel_fork_assign(channel, fork_tep);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    err_code = nrfx_ppi_channel_enable(channel);
+    APP_ERROR_CHECK(err_code);
+
+    return channel;
+}
+
+#if RADIO_NOTIFY_ENABLED
+/**@brief Radio notification handler, passes the notification on to every subscriber.
+ */
+static void radio_notify_evt_handler(bool radio_active)
+{
+    for (uint32_t i = 0; i < m_radio_notify_count; i++)
+    {
+        m_radio_notify_handlers[i](radio_active);
+    }
+}
+
+/**@brief Function for adding a radio notification subscriber.
+ *
+ * @details The SoftDevice has a single radio notification, the first subscriber enables it.
+ *          Subscribers are called from the SWI1 interrupt at APP_IRQ_PRIORITY_LOW, ACTIVE
+ *          800 us before every radio event and INACTIVE right after it.
+ */
+static void radio_notify_subscribe(radio_notify_handler_t handler)
+{
+    ret_code_t err_code;
+
+    if (m_radio_notify_count >= RADIO_NOTIFY_HANDLERS_MAX)
+    {
+        APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
+    }
+
+    m_radio_notify_handlers[m_radio_notify_count] = handler;
+    if (m_radio_notify_count++ == 0)
+    {
+        err_code = ble_radio_notification_init(APP_IRQ_PRIORITY_LOW,
+                                               NRF_RADIO_NOTIFICATION_DISTANCE_800US,
+                                               radio_notify_evt_handler);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+#endif // RADIO_NOTIFY_ENABLED
+
+#if LATENCY_TRACE_ENABLED
+/**@brief Function for remembering when an alarm was decided.
+ *
+ * @details The span ends at the first advertising event after advertising_process()
+ *          has put the alarm frame in place.
+ */
+static void latency_alarm_mark(void)
+{
+    m_latency_alarm_ticks = app_timer_cnt_get();
+}
+
+/**@brief Radio notification subscriber, records the alarm to advertising latency.
+ *
+ * @details The span ends at the ACTIVE notification, the first packet goes out
+ *          NRF_RADIO_NOTIFICATION_DISTANCE_800US later.
+ */
+static void latency_radio_notify_handler(bool radio_active)
+{
+    if (radio_active && (nrf_atomic_u32_fetch_store(&m_latency_alarm_pending, 0) != 0))
+    {
+        latency_hist_record(&m_latency.hist[LATENCY_PROBE_ALARM_TO_ADV],
+                            app_timer_cnt_diff_compute(app_timer_cnt_get(), m_latency_alarm_ticks));
+    }
+}
+
+/**@brief Dump timer handler, the main loop writes the histograms to the log.
+ */
+static void latency_dump_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_latency_dump_request, 1);
+}
+
+/**@brief Function for initializing the latency histograms and the DWT cycle counter.
+ *
+ * @details Needs the SoftDevice for the radio notification and app_timer for the dump timer.
+ */
+static void latency_trace_init(void)
+{
+    ret_code_t err_code;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    m_latency.header.magic   = LATENCY_HIST_MAGIC;
+    m_latency.header.version = LATENCY_HIST_VERSION;
+    m_latency.header.count   = LATENCY_PROBE_COUNT;
+    latency_hist_init(&m_latency.hist[LATENCY_PROBE_FRONT_END_ISR], "fe_isr", SystemCoreClock);
+    latency_hist_init(&m_latency.hist[LATENCY_PROBE_EDGE_TO_ISR], "edge_isr", 1000000UL);
+    latency_hist_init(&m_latency.hist[LATENCY_PROBE_TIMER_ISR], "timer_isr", SystemCoreClock);
+    latency_hist_init(&m_latency.hist[LATENCY_PROBE_EDGE_TO_ALARM], "edge_alarm", 1000000UL);
+    latency_hist_init(&m_latency.hist[LATENCY_PROBE_ALARM_TO_ADV], "alarm_adv", APP_TIMER_HZ);
+
+    radio_notify_subscribe(latency_radio_notify_handler);
+
+    err_code = app_timer_create(&m_latency_dump_timer, APP_TIMER_MODE_REPEATED, latency_dump_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_latency_dump_timer, LATENCY_DUMP_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    NRF_LOG_INFO("Latency histograms at 0x%08x", (uint32_t) &m_latency);
+}
+
+/**@brief Function for writing the histograms to the log, called from the main loop.
+ *
+ * @details CPU cycle histograms are logged in cycles, the others in microseconds. Percentiles
+ *          are bucket limits, so they are upper bounds.
+ */
+static void latency_trace_process(void)
+{
+    if (nrf_atomic_u32_fetch_store(&m_latency_dump_request, 0) == 0)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < LATENCY_PROBE_COUNT; i++)
+    {
+        latency_hist_t const * p_hist = &m_latency.hist[i];
+        bool                   cycles = (p_hist->unit_hz == SystemCoreClock);
+
+        if (p_hist->count == 0)
+        {
+            continue;
+        }
+
+        uint32_t p50 = latency_hist_percentile(p_hist, 50);
+        uint32_t p99 = latency_hist_percentile(p_hist, 99);
+        uint32_t max = p_hist->max;
+        if (!cycles)
+        {
+            p50 = latency_hist_us(p_hist, p50);
+            p99 = latency_hist_us(p_hist, p99);
+            max = latency_hist_us(p_hist, max);
+        }
+        NRF_LOG_INFO("Latency %s: n %u, p50 %u, p99 %u, max %u %s",
+                     p_hist->name, p_hist->count, p50, p99, max, cycles ? "cycles" : "us");
+    }
+}
+#endif // LATENCY_TRACE_ENABLED
+
+#if defined(USE_ENERGY_METER)
+/**@brief Function for getting the TX power the advertising set sends with.
+ */
+static int8_t energy_adv_dbm(void)
+{
+#if defined(USE_ADV_POWER_POLICY)
+    return adv_power_tx_dbm(&m_adv_power, (m_adv_status & APP_STATUS_ALARM) != 0);
+#elif defined(USE_CONFIG_SERVICE)
+    return m_config.tx_power;
+#else
+    return 0;
+#endif
+}
+
+/**@brief Radio notification subscriber, counts every radio event with the charge of its packets.
+ *
+ * @details The packets take the radio time of an advertising event at the current of the TX
+ *          power in use. Connection events in config mode are counted the same way.
+ */
+static void energy_radio_notify_handler(bool radio_active)
+{
+    if (radio_active)
+    {
+        energy_meter_event_add(&m_energy, ENERGY_METER_RADIO,
+                               (adv_power_tx_ua(energy_adv_dbm()) * advertising_event_us()) / 1000);
+    }
+}
+
+/**@brief Function for starting the energy counters.
+ *
+ * @details Call it after ble_stack_init() and before advertising_init(), the telemetry frame
+ *          reads the counters. The radio notification wakes the main loop around every radio
+ *          event, so no sleep is long enough for RTC1 to wrap.
+ */
+static void energy_init(void)
+{
+    energy_meter_init(&m_energy, APP_TIMER_HZ);
+    m_energy_wake_ticks = app_timer_cnt_get();
+    radio_notify_subscribe(energy_radio_notify_handler);
+}
+
+/**@brief Function for running the log, timed as UART time when the UART backend is in use.
+ *
+ * @details The deferred UART backend waits for every entry to go out, so the time in
+ *          NRF_LOG_PROCESS() is the time the UART sends.
+ *
+ * @return True if more entries wait.
+ */
+static bool energy_log_process(void)
+{
+#if NRF_LOG_BACKEND_UART_ENABLED
+    uint32_t start   = app_timer_cnt_get();
+    bool     pending = NRF_LOG_PROCESS();
+
+    energy_meter_time_add(&m_energy, ENERGY_METER_UART, app_timer_cnt_diff_compute(app_timer_cnt_get(), start));
+    return pending;
+#else
+    return NRF_LOG_PROCESS();
+#endif
+}
+
+/**@brief Function for sleeping, timed: the main loop ran since the last wake up, then the
+ *        CPU sleeps until nrf_pwr_mgmt_run() returns.
+ */
+static void energy_pwr_mgmt_run(void)
+{
+    uint32_t sleep_ticks = app_timer_cnt_get();
+
+    energy_meter_time_add(&m_energy, ENERGY_METER_CPU, app_timer_cnt_diff_compute(sleep_ticks, m_energy_wake_ticks));
+    nrf_pwr_mgmt_run();
+    m_energy_wake_ticks = app_timer_cnt_get();
+    energy_meter_time_add(&m_energy, ENERGY_METER_SLEEP, app_timer_cnt_diff_compute(m_energy_wake_ticks, sleep_ticks));
+}
+
+#if ENERGY_HFCLK_BURSTS
+/**@brief Function for noting that a burst window runs.
+ *
+ * @param[in] lead_ticks  Time it ran before it was seen, in RTC1 ticks.
+ */
+static void energy_burst_start(uint32_t lead_ticks)
+{
+    if (!m_energy_burst_open)
+    {
+        m_energy_burst_open  = true;
+        m_energy_burst_ticks = app_timer_cnt_get();
+        energy_meter_time_add(&m_energy, ENERGY_METER_HFCLK, lead_ticks);
+    }
+}
+
+/**@brief Function for noting the end of a burst window.
+ */
+static void energy_burst_stop(void)
+{
+    if (m_energy_burst_open)
+    {
+        m_energy_burst_open = false;
+        energy_meter_time_add(&m_energy, ENERGY_METER_HFCLK,
+                              app_timer_cnt_diff_compute(app_timer_cnt_get(), m_energy_burst_ticks));
+    }
+}
+#endif
+
+/**@brief Function for getting the RTC1 ticks since boot.
+ */
+static uint64_t energy_uptime_ticks(void)
+{
+    (void) uptime_ms();
+    return m_uptime_ticks;
+}
+
+/**@brief Function for getting the energy used since boot, in mJ.
+ */
+static uint32_t energy_mj(void)
+{
+    return (uint32_t)(energy_meter_uj(energy_meter_total_nc(&m_energy, &m_energy_model, energy_uptime_ticks())) / 1000);
+}
+
+/**@brief Function for logging the time in every state, the events and the charge of each since boot.
+ */
+static void energy_report(void)
+{
+    static char const * const state_names[ENERGY_METER_STATES] =
+    {
+        "cpu", "sleep", "hfclk", "uart"
+    };
+    static char const * const event_names[ENERGY_METER_EVENTS] =
+    {
+        "radio events", "front end interrupts", "timer interrupts"
+    };
+    uint64_t uptime = energy_uptime_ticks();
+
+    NRF_LOG_INFO("Energy since boot: %u mJ at %u mV, mean %u nA, base %u uC",
+                 energy_mj(), ENERGY_METER_SUPPLY_MV,
+                 energy_meter_mean_na(&m_energy, &m_energy_model, uptime),
+                 (uint32_t)(energy_meter_base_nc(&m_energy, &m_energy_model, uptime) / 1000));
+    for (uint32_t i = 0; i < ENERGY_METER_STATES; i++)
+    {
+        NRF_LOG_INFO("  %s: %u ms, %u uC", state_names[i], energy_meter_ms(&m_energy, (energy_meter_state_t) i),
+                     (uint32_t)(energy_meter_state_nc(&m_energy, &m_energy_model, (energy_meter_state_t) i) / 1000));
+    }
+    for (uint32_t i = 0; i < ENERGY_METER_EVENTS; i++)
+    {
+        NRF_LOG_INFO("  %s: %u, %u uC", event_names[i], m_energy.count[i],
+                     (uint32_t)(energy_meter_event_nc(&m_energy, &m_energy_model, (energy_meter_event_t) i) / 1000));
+    }
+}
+#endif // USE_ENERGY_METER
+
+#if defined(USE_LOG_BINARY)
+/**@brief Function for starting the binary log backend.
+ *
+ * @details Entries logged before this wait in the nrf_log buffer and come through here.
+ */
+static void binary_log_init(void)
+{
+    int32_t backend_id;
+
+    log_binary_init(&m_binary_log, m_binary_log_ring, sizeof(m_binary_log_ring));
+    backend_id = nrf_log_backend_add(&m_binary_log_backend, NRF_LOG_SEVERITY_DEBUG);
+    if (backend_id < 0)
+    {
+        APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
+    }
+    nrf_log_backend_enable(&m_binary_log_backend);
+}
+
+/**@brief Function for the binary log UART events, every frame ends with one.
+ */
+static void binary_log_uart_handler(nrf_drv_uart_event_t * p_event, void * p_context)
+{
+    if ((p_event->type == NRF_DRV_UART_EVT_TX_DONE) || (p_event->type == NRF_DRV_UART_EVT_ERROR))
+    {
+        (void) nrf_atomic_u32_store(&m_binary_log_tx_done, 1);
+    }
+}
+
+/**@brief Function for turning the UART on for a burst.
+ *
+ * @param[in] handler  NULL for blocking transfers.
+ */
+static bool binary_log_uart_start(nrf_uart_event_handler_t handler)
+{
+    nrf_drv_uart_config_t config = NRF_DRV_UART_DEFAULT_CONFIG;
+
+    config.pseltxd  = NRF_LOG_BACKEND_UART_TX_PIN;
+    config.pselrxd  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselcts  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselrts  = NRF_UART_PSEL_DISCONNECTED;
+    config.hwfc     = NRF_UART_HWFC_DISABLED;
+    config.baudrate = BINARY_LOG_BAUDRATE;
+
+    //no error check, a burst from the error handler must not recurse
+    if (nrf_drv_uart_init(&m_binary_log_uart, &config, handler) != NRF_SUCCESS)
+    {
+        return false;
+    }
+#if defined(USE_ENERGY_METER)
+    m_binary_log_start = app_timer_cnt_get();
+#endif
+    return true;
+}
+
+/**@brief Function for turning the UART off after a burst, so neither it nor HFCLK draws
+ *        anything until the next one.
+ */
+static void binary_log_uart_stop(void)
+{
+    nrf_drv_uart_uninit(&m_binary_log_uart);
+#if defined(USE_ENERGY_METER)
+    energy_meter_time_add(&m_energy, ENERGY_METER_UART, app_timer_cnt_diff_compute(app_timer_cnt_get(), m_binary_log_start));
+#endif
+}
+
+/**@brief Function for checking whether bursts wait, which they do while a burst window is open.
+ *
+ * @details The main loop drains the edge ring and feeds the detector then, it gets no log work
+ *          on top. With the PPI tone counter the tones are counted in hardware, nothing waits.
+ */
+static bool binary_log_held(void)
+{
+#if !defined(USE_PPI_TONE_COUNTER)
+    return m_burst_active && !m_binary_log_panic;
+#else
+    return false;
+#endif
+}
+
+/**@brief Function for sending the next frame of a burst, without waiting for it.
+ *
+ * @details Starts the burst if none runs, and ends it when the ring is empty or a burst window
+ *          opened. A frame in flight is left alone, the UART handler wakes the main loop when
+ *          it is out.
+ */
+static void binary_log_frame_send(void)
+{
+    uint32_t len = 0;
+
+    if (m_binary_log_sending)
+    {
+        if (nrf_atomic_u32_fetch_store(&m_binary_log_tx_done, 0) == 0)
+        {
+            return;
+        }
+    }
+    else
+    {
+        if (!binary_log_uart_start(binary_log_uart_handler))
+        {
+            return;
+        }
+        m_binary_log_sending = true;
+    }
+
+    if (!binary_log_held())
+    {
+        len = log_binary_frame(&m_binary_log, uptime_ms(), m_binary_log_tx, sizeof(m_binary_log_tx));
+    }
+    if ((len == 0) || (nrf_drv_uart_tx(&m_binary_log_uart, m_binary_log_tx, len) != NRF_SUCCESS))
+    {
+        binary_log_uart_stop();
+        m_binary_log_sending = false;
+    }
+}
+
+/**@brief Function for sending everything in the ring at once, for panic and flush.
+ *
+ * @details Blocking: 2 KB take about 20 ms at 1 Mbaud. It waits out a frame that the main
+ *          loop burst has in flight by time, interrupts may be off in the error handler.
+ */
+static void binary_log_burst(void)
+{
+    uint32_t len;
+
+    if (m_binary_log_sending)
+    {
+        nrf_delay_us(BINARY_LOG_TX_US);
+        binary_log_uart_stop();
+        m_binary_log_sending = false;
+        (void) nrf_atomic_u32_fetch_store(&m_binary_log_tx_done, 0);
+    }
+    if ((log_binary_level(&m_binary_log) == 0) || !binary_log_uart_start(NULL))
+    {
+        return;
+    }
+    //no handler, so every transfer blocks
+    while ((len = log_binary_frame(&m_binary_log, uptime_ms(), m_binary_log_tx, sizeof(m_binary_log_tx))) > 0)
+    {
+        (void) nrf_drv_uart_tx(&m_binary_log_uart, m_binary_log_tx, len);
+    }
+    binary_log_uart_stop();
+}
+
+/**@brief Function for checking whether a host drives the idle level on the UART RX line.
+ *
+ * @details The pull-down is only on for the read, a host holding the line high would draw
+ *          current through it all the time otherwise. Without a host the line reads low.
+ */
+static bool binary_log_host_attached(void)
+{
+    bool attached;
+
+    nrf_gpio_cfg_input(RX_PIN_NUMBER, NRF_GPIO_PIN_PULLDOWN);
+    nrf_delay_us(BINARY_LOG_SENSE_US);
+    attached = (nrf_gpio_pin_read(RX_PIN_NUMBER) != 0);
+    nrf_gpio_cfg_default(RX_PIN_NUMBER);
+
+    return attached;
+}
+
+/**@brief Function for starting a burst when the ring passes the watermark, or when a host is
+ *        attached and records wait, and for sending the next frame of a running one.
+ *
+ * @details The host check runs at most every BINARY_LOG_ATTACH_POLL_MS, on a main loop wake up,
+ *          so a host that attaches gets the records within a heartbeat. No burst starts while
+ *          a burst window is open; records that do not fit the ring meanwhile are counted.
+ */
+static void binary_log_process(void)
+{
+    uint32_t now_ms = uptime_ms();
+
+    if (m_binary_log_sending)
+    {
+        binary_log_frame_send();
+        return;
+    }
+    if ((log_binary_level(&m_binary_log) == 0) || binary_log_held())
+    {
+        return;
+    }
+    if (log_binary_level(&m_binary_log) >= BINARY_LOG_WATERMARK)
+    {
+        binary_log_frame_send();
+    }
+    else if ((now_ms - m_binary_log_poll_ms) >= BINARY_LOG_ATTACH_POLL_MS)
+    {
+        m_binary_log_poll_ms = now_ms;
+        if (binary_log_host_attached())
+        {
+            binary_log_frame_send();
+        }
+    }
+}
+
+/**@brief Function for taking a log entry into the ring, called from NRF_LOG_PROCESS().
+ *
+ * @details The format string and module name stay in flash, only their addresses are kept.
+ */
+static void binary_log_put(nrf_log_backend_t const * p_backend, nrf_log_entry_t * p_entry)
+{
+    nrf_log_header_t header;
+    uint32_t         module;
+
+    nrf_memobj_get(p_entry);
+    nrf_memobj_read(p_entry, &header, HEADER_SIZE * sizeof(uint32_t), 0);
+    module = (uint32_t) nrf_log_module_name_get(header.module_id, false);
+
+    if (header.base.generic.type == HEADER_TYPE_STD)
+    {
+        uint32_t args[NRF_LOG_MAX_NUM_OF_ARGS];
+        uint32_t nargs = header.base.std.nargs;
+
+        nrf_memobj_read(p_entry, args, nargs * sizeof(uint32_t), HEADER_SIZE * sizeof(uint32_t));
+        (void) log_binary_put(&m_binary_log, module, header.base.std.severity, header.base.std.addr, args, nargs);
+    }
+    else if (header.base.generic.type == HEADER_TYPE_HEXDUMP)
+    {
+        uint8_t  data[BINARY_LOG_DUMP_MAX];
+        uint32_t len = MIN(header.base.hexdump.len, BINARY_LOG_DUMP_MAX);
+
+        nrf_memobj_read(p_entry, data, len, HEADER_SIZE * sizeof(uint32_t));
+        (void) log_binary_put_dump(&m_binary_log, module, header.base.hexdump.severity, data, len);
+    }
+    nrf_memobj_put(p_entry);
+
+    if (m_binary_log_panic)
+    {
+        binary_log_burst();
+    }
+}
+
+/**@brief Function for sending everything at once from now on, for the error handler and
+ *        NRF_LOG_FINAL_FLUSH(). The RAM ring does not survive a reset or System OFF.
+ */
+static void binary_log_panic_set(nrf_log_backend_t const * p_backend)
+{
+    m_binary_log_panic = true;
+    binary_log_burst();
+}
+
+static void binary_log_flush(nrf_log_backend_t const * p_backend)
+{
+    binary_log_burst();
+}
+#endif // USE_LOG_BINARY
+
+#if defined(USE_PPI_TONE_COUNTER)
+/**@brief Function for getting the register address of a tone counter PPI event.
+ */
+static uint32_t tone_counter_event_address(tone_counter_evt_t event)
+{
+    switch (event)
+    {
+        case TONE_COUNTER_EVT_LPCOMP_UP:
+            return nrf_lpcomp_event_address_get(NRF_LPCOMP_EVENT_UP);
+
+        case TONE_COUNTER_EVT_WINDOW_COMPARE1:
+#if defined(USE_RTC_BURST_TIMER)
+            return nrfx_rtc_event_address_get(&nrfx_rtc_2, NRF_RTC_EVENT_COMPARE_1);
+#else
+            return nrfx_timer_compare_event_address_get(&nrfx_timer_1,
+                                                        (nrf_timer_cc_channel_t) 1);
+#endif
+
+        default:
+            APP_ERROR_CHECK_BOOL(false);
+            return 0;
+    }
+}
+
+/**@brief Function for getting the register address of a tone counter PPI task.
+ *
+ * @details Returns 0 for TONE_COUNTER_TASK_NONE.
+ */
+static uint32_t tone_counter_task_address(tone_counter_task_t task)
+{
+    switch (task)
+    {
+        case TONE_COUNTER_TASK_NONE:
+            return 0;
+
+        case TONE_COUNTER_TASK_COUNT:
+            return nrf_timer_task_address_get(TONE_COUNTER_TIMER, NRF_TIMER_TASK_COUNT);
+
+        case TONE_COUNTER_TASK_LPCOMP_START:
+            return nrf_lpcomp_task_address_get(NRF_LPCOMP_TASK_START);
+
+        case TONE_COUNTER_TASK_LPCOMP_STOP:
+            return nrf_lpcomp_task_address_get(NRF_LPCOMP_TASK_STOP);
+
+#if defined(USE_RTC_BURST_TIMER)
+        case TONE_COUNTER_TASK_WINDOW_CLEAR:
+            return nrfx_rtc_task_address_get(&nrfx_rtc_2, NRF_RTC_TASK_CLEAR);
+
+        case TONE_COUNTER_TASK_WINDOW_START:
+            return nrfx_rtc_task_address_get(&nrfx_rtc_2, NRF_RTC_TASK_START);
+#else
+        case TONE_COUNTER_TASK_WINDOW_CLEAR:
+            return nrfx_timer_task_address_get(&nrfx_timer_1, NRF_TIMER_TASK_CLEAR);
+
+        case TONE_COUNTER_TASK_WINDOW_START:
+            return nrfx_timer_task_address_get(&nrfx_timer_1, NRF_TIMER_TASK_START);
+#endif
+
+        default:
+            APP_ERROR_CHECK_BOOL(false);
+            return 0;
+    }
+}
+
+/**@brief Function for initializing the hardware tone counter.
+ *
+ * @details Sets up Timer 2 as a low power counter and wires LPCOMP and Timer 1 together
+ *          through PPI as described by TONE_COUNTER_PPI_LINKS. After this, tone edges are
+ *          counted and the burst window is restarted without any CPU involvement; the CPU
+ *          only wakes up on Timer 1 CC0 and CC2. Must be called after lpcomp_init() and
+ *          timer1_init().
+ */
+static void tone_counter_ppi_init(void)
+{
+    static const tone_counter_link_t links[TONE_COUNTER_PPI_LINK_COUNT] = TONE_COUNTER_PPI_LINKS;
+
+    nrf_timer_mode_set(TONE_COUNTER_TIMER, NRF_TIMER_MODE_LOW_POWER_COUNTER);
+    nrf_timer_bit_width_set(TONE_COUNTER_TIMER, NRF_TIMER_BIT_WIDTH_16);
+    nrf_timer_task_trigger(TONE_COUNTER_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(TONE_COUNTER_TIMER, NRF_TIMER_TASK_START);
+
+    for (uint32_t i = 0; i < TONE_COUNTER_PPI_LINK_COUNT; i++)
+    {
+        uint32_t channel = ppi_channel_setup(tone_counter_event_address(links[i].event),
+                                             tone_counter_task_address(links[i].task),
+                                             tone_counter_task_address(links[i].fork));
+#if defined(USE_LPCOMP_BLANKING)
+        if (links[i].event == TONE_COUNTER_EVT_LPCOMP_UP)
+        {
+            m_lpcomp_blank_channels |= (1UL << channel);
+        }
+#else
+        (void) channel;
+#endif
+    }
+}
+
+/**@brief Function for reading and resetting the number of tones counted by Timer 2.
+ */
+static uint32_t tone_counter_take(void)
+{
+    nrf_timer_task_trigger(TONE_COUNTER_TIMER, NRF_TIMER_TASK_CAPTURE0);
+    nrf_timer_task_trigger(TONE_COUNTER_TIMER, NRF_TIMER_TASK_CLEAR);
+
+    return nrf_timer_cc_read(TONE_COUNTER_TIMER, NRF_TIMER_CC_CHANNEL0);
+}
+#else
+/**@brief Tone detector hook: a tone started or ended.
+ */
+static void tone_detect_tone_set(bool on, void * p_context)
+{
+    if (on)
+    {
+        //turn on LED3
+        bsp_board_led_on(BSP_BOARD_LED_2);
+    }
+    else
+    {
+        //turn off LED3
+        bsp_board_led_off(BSP_BOARD_LED_2);
+    }
+}
+
+/**@brief Tone detector hook: an alarm pattern matched, or the burst ended.
+ *
+ * @param[in] on       True when a pattern matched, false when the burst timed out.
+ * @param[in] matched  Bit mask of the patterns that matched.
+ */
+static void tone_detect_alarm_set(bool on, uint32_t matched, uint32_t timestamp, void * p_context)
+{
+    if (!on)
+    {
+        //turn off LED4
+        bsp_board_led_off(BSP_BOARD_LED_3);
+        m_adv_status_request = APP_STATUS_INITIAL;
+        return;
+    }
+
+    //turn on LED4
+    bsp_board_led_on(BSP_BOARD_LED_3);
+    m_adv_status_request = APP_STATUS_ALARM | (matched & APP_STATUS_PATTERN_Msk);
+#if LATENCY_TRACE_ENABLED
+    latency_hist_record(&m_latency.hist[LATENCY_PROBE_EDGE_TO_ALARM], edge_capture_now() - m_latency_last_edge);
+    latency_alarm_mark();
+#endif
+
+    for (uint32_t i = 0; i < tone_pattern_count(); i++)
+    {
+        if (matched & (1UL << i))
+        {
+            NRF_LOG_INFO("Alarm pattern: %s, confidence %u",
+                         tone_pattern_get(i)->p_name, tone_detect_confidence(&m_tone_detect, i));
+        }
+    }
+}
+
+/**@brief Tone detector hook: restart the burst window timeout.
+ */
+static void tone_detect_burst_timer_restart(void * p_context)
+{
+    m_burst_active = true;
+#if defined(USE_ENERGY_METER)
+    energy_burst_start(0);
+#endif
+#if defined(USE_RTC_BURST_TIMER)
+    nrf_rtc_task_trigger(nrfx_rtc_2.p_reg, NRF_RTC_TASK_CLEAR);
+    nrf_rtc_task_trigger(nrfx_rtc_2.p_reg, NRF_RTC_TASK_START);
+#else
+    nrfx_timer_clear(&nrfx_timer_1);
+    nrfx_timer_resume(&nrfx_timer_1);
+#endif
+}
+
+static const tone_detect_hal_t m_tone_detect_hal =
+{
+    .tone_set            = tone_detect_tone_set,
+    .alarm_set           = tone_detect_alarm_set,
+    .burst_timer_restart = tone_detect_burst_timer_restart
+};
+
+/**@brief Function for initializing LPCOMP edge timestamp capture.
+ *
+ * @details Timer 2 runs at 1 MHz with 32 bit width. LPCOMP UP captures into CC0 and also
+ *          starts the timer, LPCOMP DOWN captures into CC1. The LPCOMP interrupt then only
+ *          has to copy the capture register into the edge ring.
+ */
+static void edge_capture_init(void)
+{
+    nrf_timer_mode_set(EDGE_CAPTURE_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(EDGE_CAPTURE_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(EDGE_CAPTURE_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_task_trigger(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_CLEAR);
+
+    tone_detect_config_t config = TONE_DETECT_DEFAULT_CONFIG;
+#if defined(USE_SAADC_GOERTZEL)
+    //tone starts and ends are only known to the nearest block
+    config.slack_us = GOERTZEL_HORN_BLOCK_US / 2;
+#endif
+#if defined(TONE_ALARM_POLICY)
+    //site alarm policy, e.g. TONE_ALARM_POLICY={3,2,0} for 2 of the last 3 cycles
+    config.policy = (tone_confidence_policy_t)TONE_ALARM_POLICY;
+#endif
+    tone_detect_init(&m_tone_detect, &config, &m_tone_detect_hal, NULL);
+
+#if defined(USE_SAADC_GOERTZEL)
+    //the SAADC samples all the time, so the timestamp timer runs all the time
+    //and every finished block is timestamped in CC0
+    (void) ppi_channel_setup(nrf_saadc_event_address_get(NRF_SAADC_EVENT_END),
+                             nrf_timer_task_address_get(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_CAPTURE0),
+                             0);
+    nrf_timer_task_trigger(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_START);
+
+    saadc_goertzel_init();
+#else
+    (void) ppi_channel_setup(nrf_lpcomp_event_address_get(NRF_LPCOMP_EVENT_UP),
+                             nrf_timer_task_address_get(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_CAPTURE0),
+                             nrf_timer_task_address_get(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_START));
+
+    (void) ppi_channel_setup(nrf_lpcomp_event_address_get(NRF_LPCOMP_EVENT_DOWN),
+                             nrf_timer_task_address_get(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_CAPTURE1),
+                             0);
+#endif
+}
+
+/**@brief Function for reading the edge capture timer from thread context.
+ */
+static uint32_t edge_capture_now(void)
+{
+    nrf_timer_task_trigger(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_CAPTURE2);
+    return nrf_timer_cc_read(EDGE_CAPTURE_TIMER, NRF_TIMER_CC_CHANNEL2);
+}
+
+#if !defined(USE_SAADC_GOERTZEL)
+/**@brief Function for queueing a captured edge for the tone detector, called from the LPCOMP interrupt.
+ */
+static void edge_capture_push(uint32_t timestamp, bool up)
+{
+#if defined(USE_LPCOMP_BLANKING)
+    if (!lpcomp_blank_edge(&m_lpcomp_blank, up, timestamp))
+    {
+        return;
+    }
+    m_edge_capture_running = true;
+#endif
+    (void) edge_ring_push(&m_edge_ring, timestamp, up ? EDGE_RING_EDGE_UP : EDGE_RING_EDGE_DOWN);
+}
+#endif
+
+/**@brief Function for draining the edge ring into the tone detector.
+ */
+static void edge_capture_drain(void)
+{
+    edge_ring_entry_t entry;
+
+    while (edge_ring_pop(&m_edge_ring, &entry))
+    {
+        tone_detect_edge(&m_tone_detect, entry.timestamp, entry.edge == EDGE_RING_EDGE_UP);
+#if LATENCY_TRACE_ENABLED
+        m_latency_last_edge = entry.timestamp;
+#endif
+    }
+}
+
+/**@brief Function for decoding captured edges, called from the main loop.
+ *
+ * @details Once a burst has timed out the capture timer is stopped to release the high
+ *          frequency clock. Edges captured before the stop are decoded first and the pause
+ *          so far goes to the pattern engine, everything after it starts with an unknown
+ *          off time.
+ */
+static void edge_capture_process(void)
+{
+#if LPCOMP_CAL_ENABLED
+    lpcomp_cal_process();
+#endif
+    edge_capture_drain();
+    tone_detect_poll(&m_tone_detect, edge_capture_now());
+
+    if (nrf_atomic_u32_fetch_store(&m_burst_timeout, 0) != 0)
+    {
+#if !defined(USE_SAADC_GOERTZEL)
+#if defined(USE_LPCOMP_BLANKING)
+        m_edge_capture_running = false;
+#endif
+        //the SAADC front end keeps sampling, so its timestamps keep running too
+        nrf_timer_task_trigger(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_STOP);
+#endif
+        edge_capture_drain();
+        tone_detect_timeout(&m_tone_detect, edge_capture_now());
+        m_burst_active = false;
+#if defined(USE_ENERGY_METER)
+        energy_burst_stop();
+#endif
+    }
+
+    uint32_t overflows = m_edge_ring.overflows;
+    if (overflows != m_edge_overflows_reported)
+    {
+        NRF_LOG_WARNING("Edge ring overflows: %u", overflows);
+        m_edge_overflows_reported = overflows;
+    }
+}
+
+#if LPCOMP_CAL_ENABLED
+/**@brief Function for switching the LPCOMP reference and hysteresis while it runs.
+ */
+static void lpcomp_reference_set(uint8_t level, bool hysteresis)
+{
+    nrf_lpcomp_config_t config = lpcomp_hal_config(level, hysteresis);
+
+    //reconfigure with the comparator stopped, then wait the start-up time (at most 140 us)
+    nrf_lpcomp_task_trigger(NRF_LPCOMP_TASK_STOP);
+    nrf_lpcomp_configure(&config);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_READY);
+    nrf_lpcomp_task_trigger(NRF_LPCOMP_TASK_START);
+    while (!nrf_lpcomp_event_check(NRF_LPCOMP_EVENT_READY))
+    {
+    }
+}
+
+/**@brief Function for starting the next sweep window, or ending the run after the last one.
+ */
+static void lpcomp_cal_step_start(void)
+{
+    lpcomp_cal_step_t step;
+
+    if (!lpcomp_cal_next(&m_lpcomp_cal, &step))
+    {
+        (void) nrf_atomic_u32_store(&m_lpcomp_cal_done, 1);
+        return;
+    }
+
+    lpcomp_reference_set(step.level, step.hysteresis);
+    nrf_timer_task_trigger(LPCOMP_CAL_COUNTER, NRF_TIMER_TASK_CLEAR);
+
+    ret_code_t err_code = app_timer_start(m_lpcomp_cal_window_timer, APP_TIMER_TICKS(step.window_ms), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Sweep window timer handler, hands the edge count to the calibration.
+ */
+static void lpcomp_cal_window_handler(void * p_context)
+{
+    nrf_timer_task_trigger(LPCOMP_CAL_COUNTER, NRF_TIMER_TASK_CAPTURE0);
+    lpcomp_cal_count(&m_lpcomp_cal, nrf_timer_cc_read(LPCOMP_CAL_COUNTER, NRF_TIMER_CC_CHANNEL0));
+    lpcomp_cal_step_start();
+}
+
+/**@brief Recheck timer handler, the main loop starts the recheck once no burst is running.
+ */
+static void lpcomp_cal_recheck_handler(void * p_context)
+{
+    (void) nrf_atomic_u32_store(&m_lpcomp_cal_request, 1);
+}
+
+/**@brief Function for loading the stored calibration, the default stays if there is none.
+ *
+ * @return True if a valid calibration was stored.
+ */
+static bool lpcomp_cal_load(void)
+{
+    fds_record_desc_t  desc  = {0};
+    fds_find_token_t   token = {0};
+    fds_flash_record_t record;
+    ret_code_t         err_code;
+    bool               valid;
+
+    if (fds_record_find(LPCOMP_CAL_FILE_ID, LPCOMP_CAL_RECORD_KEY, &desc, &token) != NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("LPCOMP calibration: none stored");
+        return false;
+    }
+
+    err_code = fds_record_open(&desc, &record);
+    APP_ERROR_CHECK(err_code);
+
+    lpcomp_cal_result_t const * p_stored = record.p_data;
+    valid = (record.p_header->length_words == BYTES_TO_WORDS(sizeof(lpcomp_cal_result_t))) &&
+            (p_stored->level >= LPCOMP_CAL_LEVEL_MIN) && (p_stored->level <= LPCOMP_CAL_LEVEL_MAX);
+    if (valid)
+    {
+        m_lpcomp_cal_result = *p_stored;
+    }
+
+    err_code = fds_record_close(&desc);
+    APP_ERROR_CHECK(err_code);
+    return valid;
+}
+
+/**@brief Function for writing m_lpcomp_cal_result to flash.
+ */
+static void lpcomp_cal_store(void)
+{
+    fds_record_desc_t desc  = {0};
+    fds_find_token_t  token = {0};
+    fds_record_t      record =
+    {
+        .file_id           = LPCOMP_CAL_FILE_ID,
+        .key               = LPCOMP_CAL_RECORD_KEY,
+        .data.p_data       = &m_lpcomp_cal_record,
+        .data.length_words = BYTES_TO_WORDS(sizeof(m_lpcomp_cal_record))
+    };
+    ret_code_t        err_code;
+
+    m_lpcomp_cal_record = m_lpcomp_cal_result;
+
+    if (fds_record_find(LPCOMP_CAL_FILE_ID, LPCOMP_CAL_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        err_code = fds_record_update(&desc, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(NULL, &record);
+    }
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        //old copies of the record fill the pages, the next calibration change is stored again
+        NRF_LOG_WARNING("LPCOMP calibration not stored, flash full");
+        err_code = fds_gc();
+    }
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for initializing the LPCOMP calibration.
+ *
+ * @details Loads the stored calibration and switches the running LPCOMP to it, so call it
+ *          after storage_init() and lpcomp_init(). Timer 3 counts LPCOMP UP edges through PPI
+ *          in low power counter mode, it only runs during a sweep.
+ *
+ * @param[in] load  False on a wake up from System OFF, the LPCOMP already runs with the
+ *                  calibration from retained RAM.
+ *
+ * @return True if the LPCOMP runs with a calibration, false if with the default.
+ */
+static bool lpcomp_cal_init(bool load)
+{
+    ret_code_t err_code;
+    bool       calibrated = !load;
+
+    if (load && lpcomp_cal_load())
+    {
+        //detection started on the default reference, it moves to the stored one now
+        lpcomp_reference_set(m_lpcomp_cal_result.level, m_lpcomp_cal_result.hysteresis != 0);
+        calibrated = true;
+    }
+
+    nrf_timer_mode_set(LPCOMP_CAL_COUNTER, NRF_TIMER_MODE_LOW_POWER_COUNTER);
+    nrf_timer_bit_width_set(LPCOMP_CAL_COUNTER, NRF_TIMER_BIT_WIDTH_32);
+    (void) ppi_channel_setup(nrf_lpcomp_event_address_get(NRF_LPCOMP_EVENT_UP),
+                             nrf_timer_task_address_get(LPCOMP_CAL_COUNTER, NRF_TIMER_TASK_COUNT),
+                             0);
+
+    err_code = app_timer_create(&m_lpcomp_cal_window_timer, APP_TIMER_MODE_SINGLE_SHOT, lpcomp_cal_window_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_lpcomp_cal_recheck_timer, APP_TIMER_MODE_REPEATED, lpcomp_cal_recheck_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_lpcomp_cal_recheck_timer, LPCOMP_CAL_RECHECK_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    return calibrated;
+}
+
+/**@brief Function for starting a calibration run.
+ *
+ * @details The LPCOMP interrupt is off for the whole run, the sweep edges are only counted.
+ *          A full run lights LED2 while it waits for the test tone of the smoke alarm.
+ *
+ * @param[in] full  True for the full sweep with the test tone, false for a quiet floor recheck.
+ */
+static void lpcomp_cal_run(bool full)
+{
+    m_lpcomp_cal_running = true;
+    lpcomp_cal_start(&m_lpcomp_cal, &m_lpcomp_cal_result, full);
+
+    nrf_lpcomp_int_disable(LPCOMP_INTENSET_UP_Msk | LPCOMP_INTENSET_DOWN_Msk);
+    nrf_timer_task_trigger(LPCOMP_CAL_COUNTER, NRF_TIMER_TASK_START);
+    if (full)
+    {
+        //turn on LED2, press the test button of the smoke alarm now
+        bsp_board_led_on(BSP_BOARD_LED_1);
+    }
+
+    lpcomp_cal_step_start();
+}
+
+/**@brief Function for ending a calibration run and switching to its result.
+ */
+static void lpcomp_cal_finish(void)
+{
+    lpcomp_cal_result_t result = lpcomp_cal_result(&m_lpcomp_cal);
+
+    nrf_timer_task_trigger(LPCOMP_CAL_COUNTER, NRF_TIMER_TASK_STOP);
+    lpcomp_reference_set(result.level, result.hysteresis != 0);
+#if defined(USE_LPCOMP_BLANKING)
+    //the sweep moved the comparator without edges, blanking starts over from where it is now
+    lpcomp_blank_level_set(&m_lpcomp_blank, nrf_lpcomp_result_get() == LPCOMP_RESULT_RESULT_Above);
+#endif
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_UP);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_DOWN);
+    nrf_lpcomp_int_enable(LPCOMP_INTENSET_UP_Msk | LPCOMP_INTENSET_DOWN_Msk);
+    //turn off LED2
+    bsp_board_led_off(BSP_BOARD_LED_1);
+    m_lpcomp_cal_running = false;
+
+    //sweep edges started the timestamp timer, end that like a burst that timed out
+    (void) nrf_atomic_u32_store(&m_burst_timeout, 1);
+
+    if (memcmp(&result, &m_lpcomp_cal_result, sizeof(result)) != 0)
+    {
+        m_lpcomp_cal_result = result;
+        lpcomp_cal_store();
+    }
+
+    NRF_LOG_INFO("LPCOMP reference %u/16, hysteresis %u, quiet floor %u, tone ceiling %u",
+                 result.level, result.hysteresis, result.quiet_floor, result.tone_ceiling);
+#if defined(USE_CONFIG_SERVICE)
+    event_log_note(EVENT_LOG_CALIBRATION, result.level, (uint16_t)((result.quiet_floor << 8) | result.hysteresis));
+#endif
+}
+
+/**@brief Function for running the calibration from the main loop.
+ */
+static void lpcomp_cal_process(void)
+{
+    if (nrf_atomic_u32_fetch_store(&m_lpcomp_cal_done, 0) != 0)
+    {
+        lpcomp_cal_finish();
+    }
+    else if (!m_lpcomp_cal_running && !m_burst_active &&
+             (nrf_atomic_u32_fetch_store(&m_lpcomp_cal_request, 0) != 0))
+    {
+        lpcomp_cal_run(false);
+    }
+}
+#endif // LPCOMP_CAL_ENABLED
+
+#if STORAGE_ENABLED
+/**@brief FDS event handler, the writes are told apart by their file.
+ */
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            APP_ERROR_CHECK(p_evt->result);
+            m_fds_initialized = true;
+            break;
+
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+#if defined(USE_AUTH_FRAMES)
+            if (p_evt->write.file_id == AUTH_FILE_ID)
+            {
+                m_auth_store_result = p_evt->result;
+                (void) nrf_atomic_u32_store(&m_auth_stored, 1);
+                break;
+            }
+#endif
+#if defined(USE_CONFIG_SERVICE)
+            if (p_evt->write.file_id == CONFIG_FILE_ID)
+            {
+                if (p_evt->result != NRF_SUCCESS)
+                {
+                    NRF_LOG_WARNING("Configuration not stored: %u", p_evt->result);
+                }
+                break;
+            }
+#endif
+            if (p_evt->result != NRF_SUCCESS)
+            {
+                NRF_LOG_WARNING("LPCOMP calibration not stored: %u", p_evt->result);
+            }
+            break;
+
+        case FDS_EVT_GC:
+#if defined(USE_AUTH_FRAMES)
+            //the counter reservation waited for the space, it may be written again
+            m_auth_gc_pending = false;
+#endif
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**@brief Function for initializing the flash data storage, waits until it is ready.
+ */
+static void storage_init(void)
+{
+    ret_code_t err_code;
+
+    err_code = fds_register(fds_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+
+    while (!m_fds_initialized)
+    {
+        nrf_pwr_mgmt_run();
+    }
+}
+#endif
+
+#if defined(USE_SAADC_GOERTZEL)
+/**@brief SAADC event handler, called once per finished block.
+ *
+ * @details Runs the block through the horn filter bank and turns the block decisions into
+ *          edges for the edge ring: UP where the tone starts, DOWN where it ends, both at
+ *          block boundaries. From the ring on the path is the same as for LPCOMP edges.
+ *          The finished buffer is queued again right away, the other one is already filling.
+ */
+static void saadc_event_handler(nrfx_saadc_evt_t const * p_event)
+{
+    LATENCY_ISR_ENTER();
+    ENERGY_COUNT(ENERGY_METER_FE_ISR);
+
+    if (p_event->type == NRFX_SAADC_EVT_DONE)
+    {
+        uint32_t power[GOERTZEL_BINS_MAX];
+        uint32_t block_end = nrf_timer_cc_read(EDGE_CAPTURE_TIMER, NRF_TIMER_CC_CHANNEL0);
+        uint32_t block_start = m_goertzel_block_end;
+
+        goertzel_update(&m_goertzel, p_event->data.done.p_buffer, p_event->data.done.size);
+        goertzel_power(&m_goertzel, power);
+
+        bool tone = goertzel_decide(&m_goertzel_decision, power, m_goertzel.count);
+        if (tone != m_goertzel_tone)
+        {
+            (void) edge_ring_push(&m_edge_ring,
+                                  block_start,
+                                  tone ? EDGE_RING_EDGE_UP : EDGE_RING_EDGE_DOWN);
+            m_goertzel_tone = tone;
+        }
+        m_goertzel_block_end = block_end;
+
+        nrfx_err_t err_code = nrfx_saadc_buffer_convert(p_event->data.done.p_buffer, GOERTZEL_HORN_BLOCK_LEN);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    LATENCY_ISR_EXIT(LATENCY_PROBE_FRONT_END_ISR);
+}
+
+/**@brief Function for initializing the SAADC Goertzel front end.
+ *
+ * @details Timer 3 triggers SAADC SAMPLE through PPI every 64 us (15625 Hz) and EasyDMA
+ *          fills the two block buffers in turn, so the CPU only wakes once per 8 ms block
+ *          no matter how noisy the input is. The SAADC reads the pin LPCOMP uses (AIN7).
+ */
+static void saadc_goertzel_init(void)
+{
+    static const uint16_t bins[] = GOERTZEL_HORN_BINS;
+    nrfx_err_t err_code;
+
+    goertzel_init(&m_goertzel, bins, ARRAY_SIZE(bins), GOERTZEL_HORN_BLOCK_LEN);
+
+    nrfx_saadc_config_t saadc_config = {
+                                        .resolution         = NRF_SAADC_RESOLUTION_12BIT,
+                                        .oversample         = NRF_SAADC_OVERSAMPLE_DISABLED,
+                                        .interrupt_priority = NRFX_SAADC_CONFIG_IRQ_PRIORITY,
+                                        .low_power_mode     = false
+                                       };
+    err_code = nrfx_saadc_init(&saadc_config, saadc_event_handler);
+    APP_ERROR_CHECK(err_code);
+
+    //gain 1/4 against VDD/4 gives a 0 to VDD input range, 10 us acquisition
+    //stays well inside the 64 us sample period
+    nrf_saadc_channel_config_t channel_config = NRFX_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_AIN7);
+    channel_config.gain      = NRF_SAADC_GAIN1_4;
+    channel_config.reference = NRF_SAADC_REFERENCE_VDD4;
+    err_code = nrfx_saadc_channel_init(0, &channel_config);
+    APP_ERROR_CHECK(err_code);
+
+    //the first buffer starts filling right away, the second one is queued behind it
+    err_code = nrfx_saadc_buffer_convert(m_saadc_buffer[0], GOERTZEL_HORN_BLOCK_LEN);
+    APP_ERROR_CHECK(err_code);
+    err_code = nrfx_saadc_buffer_convert(m_saadc_buffer[1], GOERTZEL_HORN_BLOCK_LEN);
+    APP_ERROR_CHECK(err_code);
+
+    m_goertzel_block_end = nrf_timer_cc_read(EDGE_CAPTURE_TIMER, NRF_TIMER_CC_CHANNEL0);
+
+    //1 MHz / 64 = 15625 Hz
+    nrf_timer_mode_set(SAADC_SAMPLE_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(SAADC_SAMPLE_TIMER, NRF_TIMER_BIT_WIDTH_16);
+    nrf_timer_frequency_set(SAADC_SAMPLE_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_cc_write(SAADC_SAMPLE_TIMER, NRF_TIMER_CC_CHANNEL0,
+                       1000000UL / GOERTZEL_HORN_SAMPLE_RATE_HZ);
+    nrf_timer_shorts_enable(SAADC_SAMPLE_TIMER, NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK);
+
+    (void) ppi_channel_setup(nrf_timer_event_address_get(SAADC_SAMPLE_TIMER, NRF_TIMER_EVENT_COMPARE0),
+                             nrf_saadc_task_address_get(NRF_SAADC_TASK_SAMPLE),
+                             0);
+
+    nrf_timer_task_trigger(SAADC_SAMPLE_TIMER, NRF_TIMER_TASK_START);
+}
+#endif // USE_SAADC_GOERTZEL
+#endif // USE_PPI_TONE_COUNTER
+
+#if defined(USE_LPCOMP_BLANKING)
+#if defined(USE_PPI_TONE_COUNTER)
+/**@brief Function for doing in software what the tone counter PPI does on LPCOMP UP.
+ */
+static void lpcomp_blank_up_replay(void)
+{
+    static const tone_counter_link_t links[TONE_COUNTER_PPI_LINK_COUNT] = TONE_COUNTER_PPI_LINKS;
+
+    for (uint32_t i = 0; i < TONE_COUNTER_PPI_LINK_COUNT; i++)
+    {
+        if (links[i].event != TONE_COUNTER_EVT_LPCOMP_UP)
+        {
+            continue;
+        }
+        *(volatile uint32_t *)tone_counter_task_address(links[i].task) = 1;
+        if (links[i].fork != TONE_COUNTER_TASK_NONE)
+        {
+            *(volatile uint32_t *)tone_counter_task_address(links[i].fork) = 1;
+        }
+    }
+}
+#endif
+
+/**@brief Radio notification handler, opens a blanking window before every radio event and
+ *        starts the guard after it.
+ */
+static void lpcomp_blank_radio_notify_handler(bool radio_active)
+{
+    ret_code_t err_code;
+
+    if (!radio_active)
+    {
+        err_code = app_timer_start(m_lpcomp_blank_timer, LPCOMP_BLANK_GUARD_TICKS, NULL);
+        APP_ERROR_CHECK(err_code);
+        return;
+    }
+
+    //a radio event inside the guard of the last one keeps its window open
+    err_code = app_timer_stop(m_lpcomp_blank_timer);
+    APP_ERROR_CHECK(err_code);
+    if (m_lpcomp_blank.active)
+    {
+        return;
+    }
+
+#if defined(USE_PPI_TONE_COUNTER)
+    //the PPI gets no UP edges while blanked, the event registers collect them instead
+    nrf_ppi_channels_disable(m_lpcomp_blank_channels);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_UP);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_DOWN);
+    lpcomp_blank_level_set(&m_lpcomp_blank, nrf_lpcomp_result_get() == LPCOMP_RESULT_RESULT_Above);
+#endif
+    lpcomp_blank_start(&m_lpcomp_blank);
+}
+
+/**@brief Blanking guard timer handler, closes the window and delivers a real edge that fell into it.
+ */
+static void lpcomp_blank_timer_handler(void * p_context)
+{
+    lpcomp_blank_edge_t edge;
+    bool                level = (nrf_lpcomp_result_get() == LPCOMP_RESULT_RESULT_Above);
+
+#if defined(USE_PPI_TONE_COUNTER)
+    //without the interrupt there are no single edges, a window counts at most one of each
+    if (nrf_lpcomp_event_check(NRF_LPCOMP_EVENT_UP))
+    {
+        (void) lpcomp_blank_edge(&m_lpcomp_blank, true, 0);
+    }
+    if (nrf_lpcomp_event_check(NRF_LPCOMP_EVENT_DOWN))
+    {
+        (void) lpcomp_blank_edge(&m_lpcomp_blank, false, 0);
+    }
+    if (lpcomp_blank_end(&m_lpcomp_blank, level, 0, &edge) && edge.up)
+    {
+        lpcomp_blank_up_replay();
+    }
+    nrf_ppi_channels_enable(m_lpcomp_blank_channels);
+#else
+    bool hit = m_lpcomp_blank.hit;
+    bool restored;
+
+    //the LPCOMP interrupt pushes to the ring too, keep it out until the ring is in order
+    CRITICAL_REGION_ENTER();
+    //capture registers hold the last edge of each direction, for a window that saw none
+    restored = lpcomp_blank_end(&m_lpcomp_blank, level,
+                                nrf_timer_cc_read(EDGE_CAPTURE_TIMER, level ? NRF_TIMER_CC_CHANNEL0
+                                                                            : NRF_TIMER_CC_CHANNEL1),
+                                &edge);
+#if LPCOMP_CAL_ENABLED
+    //a sweep moves the reference, its edges are only counted and its end stops the timer
+    if (m_lpcomp_cal_running)
+    {
+        restored = false;
+        hit      = false;
+    }
+#endif
+    if (restored)
+    {
+        (void) edge_ring_push(&m_edge_ring, edge.timestamp, edge.up ? EDGE_RING_EDGE_UP : EDGE_RING_EDGE_DOWN);
+        m_edge_capture_running = true;
+    }
+    else if (hit && !m_edge_capture_running)
+    {
+        //a glitch started the timestamp timer and no burst timeout will stop it,
+        //unless a real UP came in just now and its interrupt is pending
+        nrf_timer_task_trigger(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_STOP);
+        if (nrf_lpcomp_event_check(NRF_LPCOMP_EVENT_UP))
+        {
+            nrf_timer_task_trigger(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_START);
+        }
+    }
+    CRITICAL_REGION_EXIT();
+#endif
+}
+
+/**@brief Function for initializing the LPCOMP radio blanking.
+ *
+ * @details Every radio event opens a window at its radio notification ACTIVE, 800 us ahead,
+ *          and LPCOMP_BLANK_GUARD_US after INACTIVE the guard timer closes it. Call it after
+ *          the front end is set up and the LPCOMP is enabled.
+ */
+static void lpcomp_blanking_init(void)
+{
+    ret_code_t err_code;
+
+    lpcomp_blank_init(&m_lpcomp_blank, false);
+
+    err_code = app_timer_create(&m_lpcomp_blank_timer, APP_TIMER_MODE_SINGLE_SHOT, lpcomp_blank_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    radio_notify_subscribe(lpcomp_blank_radio_notify_handler);
+    NRF_LOG_INFO("LPCOMP blanking: %u us guard after every radio event", LPCOMP_BLANK_GUARD_US);
+}
+#endif // USE_LPCOMP_BLANKING
+
+#if BOOT_PROFILE_ENABLED
+/**@brief Function for starting the boot profile, called first thing in main().
+ *
+ * @details Timer 4 runs at 1 MHz from here. The first LPCOMP UP is captured into CC0 through
+ *          PPI and disables its own channel through a channel group, so later edges leave CC0
+ *          alone. Needs neither the SoftDevice nor app_timer.
+ */
+static void boot_profile_start(void)
+{
+    nrfx_err_t err_code;
 
-    err_code = ble_advdata_encode(&advdata, m_adv_data.adv_data.p_data, &m_adv_data.adv_data.len);
-    APP_ERROR_CHECK(err_code);
+    nrf_timer_mode_set(BOOT_PROFILE_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(BOOT_PROFILE_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_frequency_set(BOOT_PROFILE_TIMER, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_task_trigger(BOOT_PROFILE_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(BOOT_PROFILE_TIMER, NRF_TIMER_TASK_START);
+    m_boot_profile_running = true;
 
-    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_data, &m_adv_params);
+    err_code = nrfx_ppi_group_alloc(&m_boot_edge_group);
+    APP_ERROR_CHECK(err_code);
+    m_boot_edge_channel = ppi_channel_setup(nrf_lpcomp_event_address_get(NRF_LPCOMP_EVENT_UP),
+                                            nrf_timer_task_address_get(BOOT_PROFILE_TIMER, NRF_TIMER_TASK_CAPTURE0),
+                                            nrfx_ppi_task_addr_group_disable_get(m_boot_edge_group));
+    err_code = nrfx_ppi_channel_include_in_group((nrf_ppi_channel_t) m_boot_edge_channel, m_boot_edge_group);
+    APP_ERROR_CHECK(err_code);
+    err_code = nrfx_ppi_group_enable(m_boot_edge_group);
     APP_ERROR_CHECK(err_code);
 }
 
-
-/**@brief Function for starting advertising.
+/**@brief Function for timing the end of a boot stage.
  */
-static void advertising_start(void)
+static void boot_stage_mark(boot_stage_t stage)
 {
-    ret_code_t err_code;
-
-    err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = bsp_indication_set(BSP_INDICATE_ADVERTISING);
-    APP_ERROR_CHECK(err_code);
+    nrf_timer_task_trigger(BOOT_PROFILE_TIMER, NRF_TIMER_TASK_CAPTURE2);
+    m_boot_stage_us[stage] = nrf_timer_cc_read(BOOT_PROFILE_TIMER, NRF_TIMER_CC_CHANNEL2);
 }
 
+/**@brief Radio notification subscriber, takes the time of the first advertising event.
+ *
+ * @details ACTIVE comes BOOT_PROFILE_NOTIFY_AHEAD_US before the event, that is added back when
+ *          the time is read.
+ */
+static void boot_radio_notify_handler(bool radio_active)
+{
+    if (radio_active && (nrf_atomic_u32_fetch_store(&m_boot_adv_seen, 1) == 0))
+    {
+        nrf_timer_task_trigger(BOOT_PROFILE_TIMER, NRF_TIMER_TASK_CAPTURE1);
+    }
+}
 
-/**@brief Function for initializing the BLE stack.
+/**@brief Function for initializing the timing of the first advertising event.
  *
- * @details Initializes the SoftDevice and the BLE event interrupt.
+ * @details Call it after ble_stack_init() and before advertising_start().
  */
-static void ble_stack_init(void)
+static void boot_profile_init(void)
 {
-    ret_code_t err_code;
+    radio_notify_subscribe(boot_radio_notify_handler);
+}
 
-    err_code = nrf_sdh_enable_request();
-    APP_ERROR_CHECK(err_code);
+/**@brief Function for reading the boot times off Timer 4 and stopping it.
+ *
+ * @param[in] edge  True if the first edge was captured.
+ */
+static void boot_profile_finish(bool edge)
+{
+    static char const * const names[BOOT_STAGE_COUNT] =
+    {
+        "detection", "stack", "storage", "advertising", "deferred"
+    };
+    bool     adv     = (m_boot_adv_seen != 0);
+    uint32_t edge_us = edge ? nrf_timer_cc_read(BOOT_PROFILE_TIMER, NRF_TIMER_CC_CHANNEL0) : UINT32_MAX;
+    uint32_t adv_us  = adv ? nrf_timer_cc_read(BOOT_PROFILE_TIMER, NRF_TIMER_CC_CHANNEL1) + BOOT_PROFILE_NOTIFY_AHEAD_US
+                           : UINT32_MAX;
 
-    // Configure the BLE stack using the default settings.
-    // Fetch the start address of the application RAM.
-    uint32_t ram_start = 0;
-    err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
-    APP_ERROR_CHECK(err_code);
+    nrf_timer_task_trigger(BOOT_PROFILE_TIMER, NRF_TIMER_TASK_STOP);
+    (void) nrfx_ppi_channel_free((nrf_ppi_channel_t) m_boot_edge_channel);
+    (void) nrfx_ppi_group_free(m_boot_edge_group);
+    m_boot_profile_running = false;
 
-    // Enable BLE stack.
-    err_code = nrf_sdh_ble_enable(&ram_start);
-    APP_ERROR_CHECK(err_code);
+    NRF_LOG_INFO("Boot profile, reset reason 0x%08x, from main():", m_reset_reason);
+    for (uint32_t i = 0; i < BOOT_STAGE_COUNT; i++)
+    {
+        NRF_LOG_INFO("  %s done at %u us", names[i], m_boot_stage_us[i]);
+    }
+    NRF_LOG_INFO("  first edge %d us, first advertising event %d us",
+                 edge ? (int32_t) edge_us : -1, adv ? (int32_t) adv_us : -1);
+#if defined(USE_SYSTEM_OFF)
+    m_system_off_state.edge_us = edge ? edge_us : DEEP_SLEEP_TIME_NONE;
+    m_system_off_state.adv_us  = adv ? adv_us : DEEP_SLEEP_TIME_NONE;
+#endif
+#if defined(USE_CONFIG_SERVICE)
+    event_log_note(EVENT_LOG_BOOT_TIMES, (uint8_t) MIN(edge_us / 1000, UINT8_MAX), (uint16_t) MIN(adv_us / 1000, UINT16_MAX));
+#endif
 }
 
-
-/**@brief Function for initializing logging. */
-static void log_init(void)
+/**@brief Function for ending the boot profile once it is complete, called from the main loop.
+ */
+static void boot_profile_process(void)
 {
-    ret_code_t err_code = NRF_LOG_INIT(NULL);
-    APP_ERROR_CHECK(err_code);
+    bool edge;
 
-    NRF_LOG_DEFAULT_BACKENDS_INIT();
+    if (!m_boot_profile_running)
+    {
+        return;
+    }
+
+    edge = (nrf_ppi_channel_enable_get((nrf_ppi_channel_t) m_boot_edge_channel) == NRF_PPI_CHANNEL_DISABLED);
+    if ((edge && (m_boot_adv_seen != 0)) || (uptime_ms() >= BOOT_PROFILE_TIMEOUT_MS))
+    {
+        boot_profile_finish(edge);
+    }
 }
+#endif // BOOT_PROFILE_ENABLED
 
-/**@brief Function for initializing LEDs. */
-static void leds_init(void)
+#if defined(USE_SYSTEM_OFF)
+/**@brief Function for checking for a wake up from System OFF, called first thing in main().
+ *
+ * @details A wake up by the LPCOMP that finds the sealed state block takes the LPCOMP
+ *          calibration and the status change counter from the block. Anything else starts a
+ *          new state block.
+ *
+ * @return True for a wake up.
+ */
+static bool system_off_wake(void)
 {
-    ret_code_t err_code = bsp_init(BSP_INIT_LEDS, NULL);
-    APP_ERROR_CHECK(err_code);
-}
+    if (((m_reset_reason & DEEP_SLEEP_RESETREAS_LPCOMP) == 0) ||
+        !deep_sleep_state_take(&m_system_off_state))
+    {
+        deep_sleep_state_init(&m_system_off_state, &m_lpcomp_cal_result);
+        return false;
+    }
 
+    m_system_off_state.wakes++;
+    m_lpcomp_cal_result = m_system_off_state.lpcomp_cal;
+    //the change counter goes on, so receivers do not take the first change for an old one
+    m_adv_status        = m_system_off_state.status & APP_STATUS_CHANGE_Msk;
+    m_enc_advdata[0][ADV_FRAME_STATUS_OFFSET] = m_adv_status;
+    m_enc_advdata[1][ADV_FRAME_STATUS_OFFSET] = m_adv_status;
 
-/**@brief Function for initializing timers. */
-static void timers_init(void)
+    return true;
+}
+
+/**@brief Function for handling the quiet timer timeout.
+ */
+static void system_off_timer_handler(void * p_context)
 {
-    ret_code_t err_code = app_timer_init();
-    APP_ERROR_CHECK(err_code);
+    UNUSED_PARAMETER(p_context);
+    (void) nrf_atomic_u32_store(&m_system_off_request, 1);
 }
 
+/**@brief Function for getting a number that changes with every detector activity.
+ */
+static uint32_t system_off_activity(void)
+{
+#if defined(USE_PPI_TONE_COUNTER)
+    return m_system_off_windows;
+#else
+    return m_tone_detect.stats.edges;
+#endif
+}
 
-/**@brief Function for initializing power management.
+/**@brief Function for starting the quiet time.
  */
-static void power_management_init(void)
+static void system_off_timer_start(void)
 {
     ret_code_t err_code;
-    err_code = nrf_pwr_mgmt_init();
+
+    m_system_off_activity = system_off_activity();
+    err_code = app_timer_start(m_system_off_timer, APP_TIMER_TICKS(SYSTEM_OFF_IDLE_MS), NULL);
     APP_ERROR_CHECK(err_code);
 }
 
-
-/**@brief Function for handling the idle state (main loop).
- *
- * @details If there is no pending log operation, then sleep until next the next event occurs.
+/**@brief Function for initializing System OFF.
  */
-static void idle_state_handle(void)
+static void system_off_init(void)
 {
-    if (NRF_LOG_PROCESS() == false)
-    {
-        nrf_pwr_mgmt_run();
-    }
+    ret_code_t err_code;
+
+    err_code = app_timer_create(&m_system_off_timer, APP_TIMER_MODE_SINGLE_SHOT, system_off_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    system_off_timer_start();
+
+    NRF_LOG_INFO("System OFF after %u ms quiet, %u sleeps, %u wake ups",
+                 SYSTEM_OFF_IDLE_MS, m_system_off_state.sleeps, m_system_off_state.wakes);
 }
 
-/**@brief Function for initializing the LPCOMP for smoke detector sensing.
- * ADDED
- *@details 
+/**@brief Function for checking that nothing keeps the beacon on.
+ *
+ * @details No alarm, hold or back-off, no calibration, no burst, no config mode or connection,
+ *          no flash write and no boot profile still waiting for its times.
  */
-static void lpcomp_init(void)
+static bool system_off_quiet(void)
 {
-  //make config struct for LPCOMP for initialization later
-    nrfx_lpcomp_config_t nrfx_lpcomp_config = {
-                                               //NRFX_LPCOMP_CONFIG_REFERENCE is set to <3=> Supply 4/8 
-                                               //NRFX_LPCOMP_CONFIG_DETECTION is set to <1=> Up
-                                               //NRFX_LPCOMP_CONFIG_HYST is set to 1. It looks like this is automatically
-                                               //     set to 50mV in nrf_lpcomp.h
-                                              .hal                = { 
-                                                                      (nrf_lpcomp_ref_t) 3,
-                                                                      (nrf_lpcomp_detect_t) 1,
-                                                                      (nrf_lpcomp_hysteresis_t) 1 
-                                                                    },
-                                              //NRFX_LPCOMP_CONFIG_INPUT set to <7=> 7 (Pin 0.31)
-                                              .input              = (nrf_lpcomp_input_t) 7,
-                                              //NRFX_LPCOMP_CONFIG_IRQ_PRIORITY set to <2=> 2
-                                              .interrupt_priority = 2
-                                              };
-    //initialize LPCOMP
-    nrfx_err_t err_code = nrfx_lpcomp_init(&nrfx_lpcomp_config,
-                                           nrfx_lpcomp_event_handler);
+    bool quiet = (m_adv_sched.state == ADV_SCHED_STATE_IDLE) &&
+                 ((m_adv_status_request & APP_STATUS_ALARM) == 0) &&
+                 !m_boot_profile_running;
 
-    //have to override work done in SDK init function
-    //because they went too far with abstraction and
-    //made this impossible through their preferred interface
-    //nrf_lpcomp_int_enable(LPCOMP_INTENSET_UP_Msk | LPCOMP_INTENSET_DOWN_Msk); 
+#if LPCOMP_CAL_ENABLED
+    quiet = quiet && !m_lpcomp_cal_running && !m_burst_active;
+#endif
+#if defined(USE_AUTH_FRAMES)
+    quiet = quiet && !m_auth_storing && !m_auth_gc_pending;
+#endif
+#if defined(USE_CONFIG_SERVICE)
+    quiet = quiet && !m_config_adv && (m_conn_handle == BLE_CONN_HANDLE_INVALID);
+#endif
+#if STORAGE_ENABLED
+    quiet = quiet && !nrf_fstorage_is_busy(NULL);
+#endif
+    return quiet;
 }
 
-/**@brief This function initialized Timer1 for smoke detector sensing.
- * ADDED
- * @details Expects a global or static variable "static const nrfx_timer_t nrfx_timer_1 = NRFX_TIMER_INSTANCE(1);" to 
- *          be in the file. Expects a handler function "static void nrfx_timer_event_handler(nrf_timer_event_t event_type, void * p_context)"
- *          to be in the file.
+/**@brief Function for going to System OFF with the LPCOMP armed as wake up source.
+ *
+ * @details The LPCOMP keeps running in System OFF and ANADETECT is UP, the same edge the
+ *          detector counts, so the next tone resets the chip and main() starts detection first.
+ *          Only the RAM sections of the state block, and of the event log with
+ *          USE_CONFIG_SERVICE, are retained. Does not return.
  */
-static void timer1_init(void)
+static void system_off_enter(void)
 {
-    //Note that that Timer 1 instance was created as static outside of main.
-    //Note that if frequency is set to 31.25KHz max CC time is ~2 seconds with default
-    //    bit width of 16. To get more time increase bit width.
-
-    //make timer 1 config struct for init function later
-    nrfx_timer_config_t nrfx_timer_config_1 = {
-                                                //frequency set to <9=> 31.25 kHz 
-                                               .frequency          = (nrf_timer_frequency_t) 9,
-                                                //mode set to <0=> Timer 
-                                               .mode               = (nrf_timer_mode_t) 0,
-                                                //bit_width set to <2=> 24 bit
-                                               .bit_width          = (nrf_timer_bit_width_t) 2,
-                                                //interrupt_priority set to <3=> 3
-                                               .interrupt_priority = 3,                    
-                                               .p_context          = NULL                                                       
-                                              };
+    uint32_t   masks[DEEP_SLEEP_RAM_BLOCKS] = {0};
+    uint32_t   retained;
+    ret_code_t err_code;
 
-    //find out how many ticks we need for our counter times:
-    //1.25 seconds worth of ticks at 31.25KHz
-    uint32_t timer_1_CC0_ticks = 39063;
-                                 //nrfx_timer_ms_to_ticks(&nrfx_timer_1, 
-                                 //      (uint32_t) 1250);
-    //0.75 seconds worth of ticks at 31.25KHz
-    uint32_t timer_1_CC1_ticks = 23438;
-                                 //nrfx_timer_ms_to_ticks(&nrfx_timer_1, 
-                                 //      (uint32_t) 750);
+    m_system_off_state.sleeps++;
+    m_system_off_state.lpcomp_cal = m_lpcomp_cal_result;
+    m_system_off_state.status     = m_adv_status;
 
-    //3 seconds worth of ticks at 31.25KHz
-    uint32_t timer_1_CC2_ticks = 93750;
-                                 //nrfx_timer_ms_to_ticks(&nrfx_timer_1, 
-                                 //      (uint32_t) 3000);
+    retained = deep_sleep_retention((uint32_t) &m_system_off_state, sizeof(m_system_off_state), masks);
+#if defined(USE_CONFIG_SERVICE)
+    //the event log must still be there when a technician downloads it
+    retained = deep_sleep_retention((uint32_t) &m_event_log, sizeof(m_event_log), masks);
+#endif
+    for (uint32_t block = 0; block < DEEP_SLEEP_RAM_BLOCKS; block++)
+    {
+        if (masks[block] != 0)
+        {
+            err_code = sd_power_ram_power_set(block, masks[block]);
+            APP_ERROR_CHECK(err_code);
+        }
+    }
 
-    //initialize timer 1
-    nrfx_err_t timer_init_err = nrfx_timer_init(&nrfx_timer_1,
-                                                &nrfx_timer_config_1,
-                                                nrfx_timer_event_handler);
+    NRF_LOG_INFO("System OFF: %u bytes of RAM retained, about %u nA", retained, deep_sleep_current_na(retained));
+    NRF_LOG_FINAL_FLUSH();
 
-    //set up CC0 for 1.25 sec and enable interrupts
-    nrfx_timer_compare(&nrfx_timer_1,
-                       (nrf_timer_cc_channel_t) 0,
-                       timer_1_CC0_ticks,
-                       1);
+    //the tone counter links can leave the LPCOMP stopped, and a stale event would wake it right away
+    nrf_lpcomp_task_trigger(NRF_LPCOMP_TASK_START);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_READY);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_UP);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_DOWN);
+    nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_CROSS);
 
-    //set up CC1 for 0.75 sec and enable interrupts
-    nrfx_timer_compare(&nrfx_timer_1,
-                       (nrf_timer_cc_channel_t) 1,
-                       timer_1_CC1_ticks,
-                       1);
+    deep_sleep_state_seal(&m_system_off_state);
+    nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF);
+}
 
-    //set up CC2 for 3 sec and enable interrupts
-    nrfx_timer_compare(&nrfx_timer_1,
-                       (nrf_timer_cc_channel_t) 2,
-                       timer_1_CC2_ticks,
-                       1);
-    
-    //enabling automatically starts the timer, so we need to
-    //    stop it and reset after enabling
-    nrfx_timer_enable(&nrfx_timer_1);
-    nrfx_timer_pause(&nrfx_timer_1);
-    nrfx_timer_clear(&nrfx_timer_1);
+/**@brief Function for going to System OFF once quiet, called from the main loop.
+ *
+ * @details The quiet timer only asks. Unless the beacon is quiet and the detector saw nothing
+ *          for the whole quiet time, the quiet time starts again.
+ */
+static void system_off_process(void)
+{
+    if (nrf_atomic_u32_fetch_store(&m_system_off_request, 0) == 0)
+    {
+        return;
+    }
+    if (system_off_quiet() && (system_off_activity() == m_system_off_activity))
+    {
+        system_off_enter();
+    }
+    system_off_timer_start();
 }
+#endif // USE_SYSTEM_OFF
 
+#if !defined(USE_SAADC_GOERTZEL)
 /**ADDED
  * @brief LPCOMP event handler is called when LPCOMP detects voltage drop.
  *
@@ -411,36 +4607,63 @@ static void timer1_init(void)
  * to return quickly. Don't put busy loops or any other CPU intensive actions here.
  * It is also not allowed to call soft device functions from it (if LPCOMP IRQ
  * priority is set to APP_IRQ_PRIORITY_HIGH).
+ *
+ * The edge has already been timestamped by Timer 2 through PPI, all that is left
+ * is to queue it for edge_capture_process(). With the PPI tone counter the
+ * LPCOMP interrupt is disabled and this is never called.
  */
 static void nrfx_lpcomp_event_handler(nrf_lpcomp_event_t event)
 {
+    LATENCY_ISR_ENTER();
+    ENERGY_COUNT(ENERGY_METER_FE_ISR);
+#if LATENCY_TRACE_ENABLED && !defined(USE_PPI_TONE_COUNTER)
+    //CC3 against the capture of the edge itself is the time from the event to here
+    nrf_timer_task_trigger(EDGE_CAPTURE_TIMER, NRF_TIMER_TASK_CAPTURE3);
+#endif
+#if !defined(USE_PPI_TONE_COUNTER)
     if (event == NRF_LPCOMP_EVENT_UP)
     {
-      //TODO LPCOMP RISING EVENT CODE HERE
-
-      //disable LPCOMP interrupts so we only trigger once at
-      //    start of PWM (timer will turn them back on later)
-      //nrf_lpcomp_int_disable(LPCOMP_INTENSET_UP_Msk);
-      nrf_lpcomp_task_trigger(NRF_LPCOMP_TASK_STOP);
-      //turn on LED3
-      bsp_board_led_on(BSP_BOARD_LED_2);
-      //increment tone_burst_count
-      tone_burst_count++;
-      //clear Timer 1
-      nrfx_timer_clear(&nrfx_timer_1);
-      //start Timer 1
-      nrfx_timer_resume(&nrfx_timer_1);
+        edge_capture_push(nrf_timer_cc_read(EDGE_CAPTURE_TIMER, NRF_TIMER_CC_CHANNEL0), true);
     }
+    else if (event == NRF_LPCOMP_EVENT_DOWN)
+    {
+        uint32_t down = nrf_timer_cc_read(EDGE_CAPTURE_TIMER, NRF_TIMER_CC_CHANNEL1);
+
+        //the nrfx handler runs DOWN before UP, so an UP pending as well may be the earlier edge:
+        //take it here and push both in timestamp order, its own callback then does not run
+        if (nrf_lpcomp_event_check(NRF_LPCOMP_EVENT_UP))
+        {
+            uint32_t up;
 
-    //if you want to use NRF_LPCOMP_EVENT_DOWN and UP  at the same time you have to have
-    //  nrf_lpcomp_int_enable(LPCOMP_INTENSET_UP_Msk | LPCOMP_INTENSET_DOWN_Msk)
-    //  after LPCOMP is initialized
-    //else if (event == NRF_LPCOMP_EVENT_DOWN)
-    //{
-      //TODO LPCOMP FALLING EVENT CODE HERE
-    //  bsp_board_led_off(BSP_BOARD_LED_2);
-    //}
+            //cleared before the read, so an UP after this gets its own event and capture
+            nrf_lpcomp_event_clear(NRF_LPCOMP_EVENT_UP);
+            up = nrf_timer_cc_read(EDGE_CAPTURE_TIMER, NRF_TIMER_CC_CHANNEL0);
+            if ((int32_t)(up - down) < 0)
+            {
+                edge_capture_push(up, true);
+                edge_capture_push(down, false);
+            }
+            else
+            {
+                edge_capture_push(down, false);
+                edge_capture_push(up, true);
+            }
+        }
+        else
+        {
+            edge_capture_push(down, false);
+        }
+    }
+#if LATENCY_TRACE_ENABLED
+    latency_hist_record(&m_latency.hist[LATENCY_PROBE_EDGE_TO_ISR],
+                        nrf_timer_cc_read(EDGE_CAPTURE_TIMER, NRF_TIMER_CC_CHANNEL3) -
+                        nrf_timer_cc_read(EDGE_CAPTURE_TIMER, (event == NRF_LPCOMP_EVENT_UP) ? NRF_TIMER_CC_CHANNEL0
+                                                                                             : NRF_TIMER_CC_CHANNEL1));
+#endif
+#endif
+    LATENCY_ISR_EXIT(LATENCY_PROBE_FRONT_END_ISR);
 }
+#endif // USE_SAADC_GOERTZEL
 
 /**ADDED
  * @brief Timer driver event handler type.
@@ -453,42 +4676,119 @@ static void nrfx_lpcomp_event_handler(nrf_lpcomp_event_t event)
  */
 static void nrfx_timer_event_handler(nrf_timer_event_t event_type, void * p_context)
 {
-    //TODO TIMER1 COMPARE 0 EVENT CODE HERE
+    LATENCY_ISR_ENTER();
+    ENERGY_COUNT(ENERGY_METER_TIMER_ISR);
+
+#if defined(USE_PPI_TONE_COUNTER)
     //the mid-burst inter-tone timeout has been reached
     if(event_type == NRF_TIMER_EVENT_COMPARE0)
     {
+      //tones were counted in hardware, fetch the count for this window
+      tone_burst_count = tone_counter_take();
+#if defined(USE_SYSTEM_OFF)
+      m_system_off_windows++;
+#endif
+#if defined(USE_ENERGY_METER) && ENERGY_HFCLK_BURSTS
+      //the window started with the first tone, unseen, the CPU only knows the last one
+      energy_burst_start(ENERGY_BURST_LEAD_TICKS);
+#endif
       //if we got here because a tone 3xburst finished...
-      if(tone_burst_count == 3)
+      if(tone_counter_burst_detected(tone_burst_count))
       {
         //turn on LED4
         bsp_board_led_on(BSP_BOARD_LED_3);
+        //the 3-tone burst is temporal-3, pattern 0, the main loop puts it on air
+        m_adv_status_request = APP_STATUS_ALARM | 0x01;
+#if LATENCY_TRACE_ENABLED
+        latency_alarm_mark();
+#endif
       }
       //if we got here but three tones weren't counted...
       else
       {
         //turn off LED4
         bsp_board_led_off(BSP_BOARD_LED_3);
+        m_adv_status_request = APP_STATUS_INITIAL;
       }
       tone_burst_count = 0;
     }
-    //TODO TIMER1 COMPARE 1 EVENT CODE HERE
-    //the LPCOMP interrupt pause is done
-    else if(event_type == NRF_TIMER_EVENT_COMPARE1)
-    {
-      //turn off LED3
-      bsp_board_led_off(BSP_BOARD_LED_2);
-      //nrf_lpcomp_int_enable(LPCOMP_INTENSET_UP_Msk);
-      nrf_lpcomp_task_trigger(NRF_LPCOMP_TASK_START);
-    }
-    //TODO TIMER1 COMPARE 2 EVENT CODE HERE
+    else
+#endif
+    //TIMER1 COMPARE 1 has no interrupt, it only re-arms LPCOMP through PPI
     //the inter-burst timeout has been reached
-    else if(event_type == NRF_TIMER_EVENT_COMPARE2)
+    if(event_type == NRF_TIMER_EVENT_COMPARE2)
     {
+      //the timer already stopped itself through the CC2 short
+#if defined(USE_PPI_TONE_COUNTER)
       //turn off LED4
       bsp_board_led_off(BSP_BOARD_LED_3);
-      //pause timers
-      nrfx_timer_pause(&nrfx_timer_1);
+      m_adv_status_request = APP_STATUS_INITIAL;
+#if defined(USE_ENERGY_METER) && ENERGY_HFCLK_BURSTS
+      energy_burst_stop();
+#endif
+#else
+      //let the main loop stop edge capture and end the burst
+      (void) nrf_atomic_u32_store(&m_burst_timeout, 1);
+#endif
+    }
+
+    LATENCY_ISR_EXIT(LATENCY_PROBE_TIMER_ISR);
+}
+
+#if defined(USE_RTC_BURST_TIMER)
+/**ADDED
+ * @brief RTC driver event handler, the RTC2 burst window counterpart of nrfx_timer_event_handler().
+ *
+ * @param[in] int_type RTC interrupt.
+ */
+static void nrfx_rtc_event_handler(nrfx_rtc_int_type_t int_type)
+{
+    //the driver disables a compare channel once it fired, arm it again
+    if(int_type == NRFX_RTC_INT_COMPARE0)
+    {
+      (void) nrfx_rtc_cc_set(&nrfx_rtc_2, 0, TONE_COUNTER_RTC_CC0_TICKS, true);
+    }
+    else if(int_type == NRFX_RTC_INT_COMPARE2)
+    {
+      (void) nrfx_rtc_cc_set(&nrfx_rtc_2, 2, nrf_rtc_cc_get(nrfx_rtc_2.p_reg, 2), true);
+    }
+    else
+    {
+      return;
     }
+
+    //from here on the compare channels mean the same as on Timer 1
+    nrfx_timer_event_handler(nrf_timer_compare_event_get((uint32_t) int_type), NULL);
+}
+#endif
+
+
+/**ADDED
+ * @brief Function for starting the tone front end: the LPCOMP or the SAADC, the burst window,
+ *        and edge capture or the hardware tone counter.
+ *
+ * @details Needs neither the SoftDevice nor app_timer, so main() runs it first.
+ */
+static void detection_init(void)
+{
+#if !defined(USE_SAADC_GOERTZEL)
+    lpcomp_init();
+#endif
+#if defined(USE_RTC_BURST_TIMER)
+    rtc2_init();
+    NRF_LOG_INFO("Burst window: RTC2 on LFCLK");
+#else
+    timer1_init();
+    NRF_LOG_INFO("Burst window: TIMER1 on HFCLK");
+#endif
+#if defined(USE_PPI_TONE_COUNTER)
+    tone_counter_ppi_init();
+#else
+    edge_capture_init();
+#endif
+#if !defined(USE_SAADC_GOERTZEL)
+    nrfx_lpcomp_enable();
+#endif
 }
 
 
@@ -497,25 +4797,89 @@ static void nrfx_timer_event_handler(nrf_timer_event_t event_type, void * p_cont
  */
 int main(void)
 {
+    //ADDED START
+    bool woken = false;
+#if LPCOMP_CAL_ENABLED
+    bool calibrated;
+#endif
+
+#if BOOT_PROFILE_ENABLED
+    boot_profile_start();
+#endif
+    //RESETREAS is sticky, clear it so the next boot sees its own reason.
+    //The SoftDevice is not enabled yet, so the register is still open.
+    m_reset_reason = nrf_power_resetreas_get();
+    nrf_power_resetreas_clear(m_reset_reason);
+#if defined(USE_SYSTEM_OFF)
+    woken = system_off_wake();
+#endif
+    //ADDED END
+
     // Initialize.
     log_init();
     timers_init();
-    leds_init();
     power_management_init();
+    //ADDED START
+    //after a watchdog reset, a brown-out or a wake up the alarm may be sounding,
+    //so detection comes before the SoftDevice and everything else
+    detection_init();
+    BOOT_STAGE_MARK(BOOT_STAGE_DETECTION);
+    //ADDED END
     ble_stack_init();
+    //ADDED START
+#if BOOT_PROFILE_ENABLED
+    boot_profile_init();
+#endif
+#if defined(USE_ENERGY_METER)
+    energy_init();
+#endif
+    BOOT_STAGE_MARK(BOOT_STAGE_STACK);
+#if STORAGE_ENABLED
+    storage_init();
+#endif
+#if LPCOMP_CAL_ENABLED
+    calibrated = lpcomp_cal_init(!woken);
+#endif
+    BOOT_STAGE_MARK(BOOT_STAGE_STORAGE);
+    //ADDED END
     advertising_init();
     
     //ADDED START
-    bsp_board_init(BSP_INIT_LEDS);
-    lpcomp_init();
-    timer1_init();
-    nrfx_lpcomp_enable();
+#if defined(USE_LPCOMP_BLANKING)
+    lpcomp_blanking_init();
+#endif
+#if defined(USE_CONFIG_SERVICE)
+    config_init();
+#endif
+#if defined(USE_SYSTEM_OFF)
+    system_off_init();
+#endif
     //ADDED END
 
     // Start execution.
     NRF_LOG_INFO("Beacon example started.");
     advertising_start();
 
+    //ADDED START
+    BOOT_STAGE_MARK(BOOT_STAGE_ADVERTISING);
+
+    //nothing from here on is needed to detect or to advertise
+    log_backends_init();
+    leds_init();
+#if LATENCY_TRACE_ENABLED
+    latency_trace_init();
+#endif
+#if LPCOMP_CAL_ENABLED
+    //the sweep blinds the detector, so only an installer gets it: nothing stored yet, or the reset button
+    if (!calibrated || ((m_reset_reason & POWER_RESETREAS_RESETPIN_Msk) != 0))
+    {
+        lpcomp_cal_run(true);
+    }
+#endif
+    BOOT_STAGE_MARK(BOOT_STAGE_DEFERRED);
+    (void) woken;
+    //ADDED END
+
     // Enter main loop.
     for (;; )
     {
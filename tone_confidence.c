@@ -0,0 +1,110 @@
+/** @file
+ *
+ * @brief Multi-cycle confidence scorer implementation.
+ */
+#include <stddef.h>
+
+#include "tone_confidence.h"
+
+
+static uint8_t value_clamp(uint8_t value, uint8_t min, uint8_t max)
+{
+    return (value < min) ? min : ((value > max) ? max : value);
+}
+
+
+static void track_reset(tone_confidence_track_t * p_track)
+{
+    for (uint32_t i = 0; i < TONE_CONFIDENCE_WINDOW_MAX; i++)
+    {
+        p_track->slot[i] = TONE_CONFIDENCE_MISSED;
+    }
+    p_track->confidence = 0;
+    p_track->running    = false;
+    p_track->last_cycle = 0;
+}
+
+
+/**@brief Shift a slot into the window, the oldest one drops out. */
+static void track_push(tone_confidence_track_t * p_track, uint8_t slot)
+{
+    for (uint32_t i = TONE_CONFIDENCE_WINDOW_MAX - 1; i > 0; i--)
+    {
+        p_track->slot[i] = p_track->slot[i - 1];
+    }
+    p_track->slot[0] = slot;
+}
+
+
+void tone_confidence_init(tone_confidence_t * p_scorer, tone_confidence_policy_t const * p_policy)
+{
+    tone_confidence_policy_t policy = *p_policy;
+
+    policy.window         = value_clamp(policy.window, 1, TONE_CONFIDENCE_WINDOW_MAX);
+    policy.required       = value_clamp(policy.required, 1, policy.window);
+    policy.min_confidence = value_clamp(policy.min_confidence, 0, 100);
+
+    p_scorer->policy = policy;
+    tone_confidence_reset(p_scorer);
+}
+
+
+void tone_confidence_reset(tone_confidence_t * p_scorer)
+{
+    for (uint32_t i = 0; i < TONE_PATTERN_MAX; i++)
+    {
+        track_reset(&p_scorer->track[i]);
+    }
+}
+
+
+bool tone_confidence_cycle(tone_confidence_t * p_scorer, uint32_t pattern_id, uint8_t quality, uint32_t timestamp)
+{
+    tone_confidence_policy_t const * p_policy = &p_scorer->policy;
+    tone_confidence_track_t *        p_track;
+    uint32_t                         cycles   = 0;
+    uint32_t                         sum      = 0;
+
+    if (pattern_id >= TONE_PATTERN_MAX)
+    {
+        return false;
+    }
+    p_track = &p_scorer->track[pattern_id];
+
+    if (p_track->running)
+    {
+        // Whole periods since the last cycle beyond the first are missed slots.
+        uint32_t period = tone_pattern_period_us(pattern_id);
+        uint32_t gap    = timestamp - p_track->last_cycle;
+        uint32_t missed = (period == 0) ? 0 : ((gap + period / 2) / period);
+
+        missed = (missed > 1) ? (missed - 1) : 0;
+        for (uint32_t i = 0; (i < missed) && (i < p_policy->window); i++)
+        {
+            track_push(p_track, TONE_CONFIDENCE_MISSED);
+        }
+    }
+    track_push(p_track, (quality > 100) ? 100 : quality);
+    p_track->running    = true;
+    p_track->last_cycle = timestamp;
+
+    for (uint32_t i = 0; i < p_policy->window; i++)
+    {
+        if (p_track->slot[i] != TONE_CONFIDENCE_MISSED)
+        {
+            cycles++;
+            sum += p_track->slot[i];
+        }
+    }
+
+    sum                 /= p_policy->required;
+    p_track->confidence  = (uint8_t)((sum > 100) ? 100 : sum);
+
+    return (cycles >= p_policy->required) && (p_track->confidence >= p_policy->min_confidence);
+}
+
+
+uint8_t tone_confidence_get(tone_confidence_t const * p_scorer, uint32_t pattern_id)
+{
+    return (pattern_id < TONE_PATTERN_MAX) ? p_scorer->track[pattern_id].confidence : 0;
+}
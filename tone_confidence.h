@@ -0,0 +1,97 @@
+/** @file
+ *
+ * @defgroup tone_confidence Multi-cycle confidence scorer
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Decides on alarms from a sliding window of consecutive pattern cycles.
+ *
+ * @details Every cycle the pattern engine completes goes into a per-pattern window of the
+ *          last @ref tone_confidence_policy_t::window cycle slots, with the cycle quality from
+ *          tone_pattern_quality(). Cycles are timed by the end of their last tone, because the
+ *          open-ended final pause can be cut short by the burst timeout. A cycle is consecutive
+ *          when it ends within one and a half nominal periods (tone_pattern_period_us()) of the
+ *          previous one. Every period further without a cycle is a missed slot.
+ *
+ *          The confidence is the summed quality of the cycles in the window divided by
+ *          @ref tone_confidence_policy_t::required, at most 100. An alarm fires when at least
+ *          that many cycles are in the window and the confidence reaches
+ *          @ref tone_confidence_policy_t::min_confidence. For example:
+ *          - { 1, 1, 0 }: every cycle fires, the behaviour without the scorer.
+ *          - { 1, 1, 80 }: the first cycle fires if its timing is good enough.
+ *          - { 3, 2, 0 }: 2 out of the last 3 cycles, one period more latency.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef TONE_CONFIDENCE_H__
+#define TONE_CONFIDENCE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tone_pattern.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TONE_CONFIDENCE_WINDOW_MAX      8                   /**< Longest window, in cycles. */
+#define TONE_CONFIDENCE_MISSED          0xFF                /**< Slot without a cycle. */
+
+/**@brief Decision policy. */
+typedef struct
+{
+    uint8_t window;                                         /**< Cycle slots in the window, 1 to TONE_CONFIDENCE_WINDOW_MAX. */
+    uint8_t required;                                       /**< Cycles the window must hold, 1 to window. */
+    uint8_t min_confidence;                                 /**< Confidence the window must reach, 0 to 100. */
+} tone_confidence_policy_t;
+
+/**@brief Default policy, every cycle fires. */
+#define TONE_CONFIDENCE_DEFAULT_POLICY                      \
+{                                                           \
+    .window         = 1,                                    \
+    .required       = 1,                                    \
+    .min_confidence = 0                                     \
+}
+
+/**@brief Window of one pattern. */
+typedef struct
+{
+    uint8_t  slot[TONE_CONFIDENCE_WINDOW_MAX];              /**< Cycle quality or TONE_CONFIDENCE_MISSED, newest first. */
+    uint8_t  confidence;                                    /**< Confidence after the last cycle. */
+    bool     running;                                       /**< last_cycle is valid. */
+    uint32_t last_cycle;                                    /**< Time of the last cycle. */
+} tone_confidence_track_t;
+
+/**@brief Scorer state. Initialise with tone_confidence_init(). */
+typedef struct
+{
+    tone_confidence_policy_t policy;
+    tone_confidence_track_t  track[TONE_PATTERN_MAX];
+} tone_confidence_t;
+
+/**@brief Function for initializing a scorer, out of range policy values are clamped. */
+void tone_confidence_init(tone_confidence_t * p_scorer, tone_confidence_policy_t const * p_policy);
+
+/**@brief Function for forgetting every cycle, for example when a burst has ended. */
+void tone_confidence_reset(tone_confidence_t * p_scorer);
+
+/**@brief Function for adding a completed cycle.
+ *
+ * @param[in] pattern_id  Pattern that completed.
+ * @param[in] quality     Cycle quality, 0 to 100.
+ * @param[in] timestamp   End of the last tone of the cycle in microseconds, differences wrap.
+ *
+ * @return True if the policy fires.
+ */
+bool tone_confidence_cycle(tone_confidence_t * p_scorer, uint32_t pattern_id, uint8_t quality, uint32_t timestamp);
+
+/**@brief Function for getting the confidence of a pattern after its last cycle, 0 to 100. */
+uint8_t tone_confidence_get(tone_confidence_t const * p_scorer, uint32_t pattern_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TONE_CONFIDENCE_H__
+
+/** @} */
@@ -0,0 +1,102 @@
+/** @file
+ *
+ * @defgroup tone_counter Tone burst counter
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Burst timing constants and PPI wiring for the smoke alarm tone counter.
+ *
+ * @details The tone counter measures tone bursts with a burst window timer, TIMER1 running at
+ *          31.25 kHz or, with USE_RTC_BURST_TIMER, RTC2 running at 32.768 kHz:
+ *          - CC0 closes the burst window 1.25 s after the last tone.
+ *          - CC1 re-arms LPCOMP 0.75 s after a tone (blanks the rest of the tone).
+ *          - CC2 ends the burst 3 s after the last tone and stops the timer.
+ *
+ *          When USE_PPI_TONE_COUNTER is defined the counting is done in hardware. The
+ *          wiring is described by @ref TONE_COUNTER_PPI_LINKS using symbolic events and
+ *          tasks, so the firmware and the host model in host/tone_counter_model.c run
+ *          the exact same table.
+ *
+ *          This header has no SDK dependencies and compiles on the host.
+ */
+#ifndef TONE_COUNTER_H__
+#define TONE_COUNTER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TONE_COUNTER_TICK_US            32                  /**< Length of a TIMER1 tick at 31.25 kHz, in microseconds. */
+
+#define TONE_COUNTER_CC0_TICKS          39063               /**< Burst window, 1.25 seconds at 31.25 kHz. */
+#define TONE_COUNTER_CC1_TICKS          23438               /**< LPCOMP re-arm delay, 0.75 seconds at 31.25 kHz. */
+#define TONE_COUNTER_CC2_TICKS          93750               /**< Inter-burst timeout, 3 seconds at 31.25 kHz. */
+
+#define TONE_COUNTER_RTC_FREQ_HZ        32768               /**< RTC2 tick rate, prescaler 0. */
+
+#define TONE_COUNTER_RTC_CC0_TICKS      40960               /**< Burst window, 1.25 seconds at 32.768 kHz. */
+#define TONE_COUNTER_RTC_CC1_TICKS      24576               /**< LPCOMP re-arm delay, 0.75 seconds at 32.768 kHz. */
+#define TONE_COUNTER_RTC_CC2_TICKS      98304               /**< Inter-burst timeout, 3 seconds at 32.768 kHz. */
+
+#define TONE_COUNTER_BURST_LENGTH       3                   /**< Number of tones in one smoke alarm burst. */
+
+/**@brief Symbolic PPI event endpoints used by the tone counter. */
+typedef enum
+{
+    TONE_COUNTER_EVT_LPCOMP_UP,                             /**< LPCOMP EVENTS_UP. */
+    TONE_COUNTER_EVT_WINDOW_COMPARE1                        /**< Burst window EVENTS_COMPARE[1] (LPCOMP re-arm). */
+} tone_counter_evt_t;
+
+/**@brief Symbolic PPI task endpoints used by the tone counter. */
+typedef enum
+{
+    TONE_COUNTER_TASK_NONE,                                 /**< No task (unused fork). */
+    TONE_COUNTER_TASK_COUNT,                                /**< TIMER2 TASKS_COUNT. */
+    TONE_COUNTER_TASK_LPCOMP_START,                         /**< LPCOMP TASKS_START. */
+    TONE_COUNTER_TASK_LPCOMP_STOP,                          /**< LPCOMP TASKS_STOP. */
+    TONE_COUNTER_TASK_WINDOW_CLEAR,                         /**< Burst window TASKS_CLEAR. */
+    TONE_COUNTER_TASK_WINDOW_START                          /**< Burst window TASKS_START. */
+} tone_counter_task_t;
+
+/**@brief One PPI channel: an event endpoint, a task endpoint and an optional fork task. */
+typedef struct
+{
+    tone_counter_evt_t  event;
+    tone_counter_task_t task;
+    tone_counter_task_t fork;
+} tone_counter_link_t;
+
+#define TONE_COUNTER_PPI_LINK_COUNT     3                   /**< Number of PPI channels used by the tone counter. */
+
+/**@brief PPI wiring of the hardware tone counter.
+ *
+ * @details Each rising edge counts a tone and stops LPCOMP, then restarts the burst window.
+ *          CC1 of the burst window starts LPCOMP again. The CPU only wakes up on CC0 and CC2.
+ */
+#define TONE_COUNTER_PPI_LINKS                                                                      \
+{                                                                                                   \
+    { TONE_COUNTER_EVT_LPCOMP_UP,        TONE_COUNTER_TASK_COUNT,        TONE_COUNTER_TASK_LPCOMP_STOP  }, \
+    { TONE_COUNTER_EVT_LPCOMP_UP,        TONE_COUNTER_TASK_WINDOW_CLEAR, TONE_COUNTER_TASK_WINDOW_START }, \
+    { TONE_COUNTER_EVT_WINDOW_COMPARE1,  TONE_COUNTER_TASK_LPCOMP_START, TONE_COUNTER_TASK_NONE         }  \
+}
+
+/**@brief Function for checking whether the tones counted in a burst window make up an alarm burst.
+ *
+ * @param[in] count  Number of tones counted when the burst window (CC0) closed.
+ *
+ * @return True if the count matches a smoke alarm burst.
+ */
+static inline bool tone_counter_burst_detected(uint32_t count)
+{
+    return count == TONE_COUNTER_BURST_LENGTH;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TONE_COUNTER_H__
+
+/** @} */
@@ -0,0 +1,188 @@
+/** @file
+ *
+ * @brief Tone detector core implementation.
+ */
+#include <stddef.h>
+
+#include "tone_detect.h"
+
+
+static void pattern_feed(tone_detect_t * p_detect, bool on, uint32_t duration, uint32_t timestamp)
+{
+    uint32_t matched = tone_pattern_feed(&p_detect->matcher, on, duration);
+    uint32_t fired   = 0;
+    // Cycles are timed by the end of their last tone, an open-ended final pause can be any length.
+    uint32_t cycle   = (on || (duration == EDGE_DECODER_DURATION_UNKNOWN)) ? timestamp : (timestamp - duration);
+
+    for (uint32_t i = 0; matched != 0; i++, matched >>= 1)
+    {
+        if ((matched & 1) == 0)
+        {
+            continue;
+        }
+
+        p_detect->stats.cycles++;
+        if (tone_confidence_cycle(&p_detect->confidence, i, tone_pattern_quality(&p_detect->matcher, i), cycle))
+        {
+            fired |= (1UL << i);
+        }
+    }
+
+    if (fired != 0)
+    {
+        p_detect->stats.alarms++;
+        p_detect->p_hal->alarm_set(true, fired, timestamp, p_detect->p_context);
+    }
+}
+
+
+/**@brief Add to the pause that is waiting for the next accepted tone. */
+static void pause_add(tone_detect_t * p_detect, uint32_t duration)
+{
+    if (duration == EDGE_DECODER_DURATION_UNKNOWN)
+    {
+        p_detect->pause_known = false;
+        p_detect->pause_us    = 0;
+    }
+    else
+    {
+        p_detect->pause_us += duration;
+    }
+}
+
+
+/**@brief Feed the pending pause, if its start was seen. */
+static void pause_flush(tone_detect_t * p_detect, uint32_t timestamp)
+{
+    if (p_detect->pause_known)
+    {
+        pattern_feed(p_detect, false, p_detect->pause_us, timestamp);
+    }
+    p_detect->pause_known = true;
+    p_detect->pause_us    = 0;
+}
+
+
+static void decoder_evt_handler(edge_decoder_evt_t const * p_evt, void * p_context)
+{
+    tone_detect_t * p_detect = p_context;
+
+    switch (p_evt->type)
+    {
+        case EDGE_DECODER_EVT_TONE_ON:
+            p_detect->stats.tones++;
+            p_detect->p_hal->tone_set(true, p_detect->p_context);
+            p_detect->p_hal->burst_timer_restart(p_detect->p_context);
+            if (p_detect->reject_tones)
+            {
+                pause_add(p_detect, p_evt->duration);
+            }
+            // An unknown pause was already reported by EDGE_DECODER_EVT_SILENCE.
+            else if (p_evt->duration != EDGE_DECODER_DURATION_UNKNOWN)
+            {
+                pattern_feed(p_detect, false, p_evt->duration, p_evt->timestamp);
+            }
+            break;
+
+        case EDGE_DECODER_EVT_TONE_OFF:
+            p_detect->p_hal->tone_set(false, p_detect->p_context);
+            if (!p_detect->reject_tones)
+            {
+                pattern_feed(p_detect, true, p_evt->duration, p_evt->timestamp);
+            }
+            else if (tone_pattern_tone_valid(&p_detect->matcher, p_evt->duration))
+            {
+                pause_flush(p_detect, p_evt->timestamp - p_evt->duration);
+                pattern_feed(p_detect, true, p_evt->duration, p_evt->timestamp);
+            }
+            else
+            {
+                // The tone never happened as far as the patterns are concerned.
+                p_detect->stats.rejected++;
+                if (p_detect->pause_known)
+                {
+                    p_detect->pause_us += p_evt->duration;
+                }
+            }
+            break;
+
+        case EDGE_DECODER_EVT_SILENCE:
+            if (p_detect->reject_tones)
+            {
+                pause_add(p_detect, p_evt->duration);
+                pause_flush(p_detect, p_evt->timestamp);
+            }
+            else
+            {
+                pattern_feed(p_detect, false, p_evt->duration, p_evt->timestamp);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void tone_detect_init(tone_detect_t *              p_detect,
+                      tone_detect_config_t const * p_config,
+                      tone_detect_hal_t const *    p_hal,
+                      void *                       p_context)
+{
+    p_detect->p_hal        = p_hal;
+    p_detect->p_context    = p_context;
+    p_detect->reject_tones = p_config->reject_tones;
+    p_detect->pause_known  = false;
+    p_detect->pause_us     = 0;
+    p_detect->stats        = (tone_detect_stats_t){ 0 };
+
+    edge_decoder_init(&p_detect->decoder, p_config->gap_us, decoder_evt_handler, p_detect);
+    tone_pattern_init(&p_detect->matcher);
+    p_detect->matcher.slack_us = p_config->slack_us;
+    tone_confidence_init(&p_detect->confidence, &p_config->policy);
+}
+
+
+void tone_detect_configure(tone_detect_t * p_detect, tone_detect_config_t const * p_config)
+{
+    p_detect->decoder.gap_us   = p_config->gap_us;
+    p_detect->matcher.slack_us = p_config->slack_us;
+    p_detect->reject_tones     = p_config->reject_tones;
+    tone_confidence_init(&p_detect->confidence, &p_config->policy);
+}
+
+
+void tone_detect_config_get(tone_detect_t const * p_detect, tone_detect_config_t * p_config)
+{
+    p_config->gap_us       = p_detect->decoder.gap_us;
+    p_config->slack_us     = p_detect->matcher.slack_us;
+    p_config->reject_tones = p_detect->reject_tones;
+    p_config->policy       = p_detect->confidence.policy;
+}
+
+
+void tone_detect_edge(tone_detect_t * p_detect, uint32_t timestamp, bool up)
+{
+    p_detect->stats.edges++;
+    edge_decoder_feed(&p_detect->decoder, timestamp, up);
+}
+
+
+void tone_detect_poll(tone_detect_t * p_detect, uint32_t now)
+{
+    edge_decoder_poll(&p_detect->decoder, now);
+}
+
+
+void tone_detect_timeout(tone_detect_t * p_detect, uint32_t now)
+{
+    edge_decoder_timebase_break(&p_detect->decoder, now);
+    tone_confidence_reset(&p_detect->confidence);
+    p_detect->p_hal->alarm_set(false, 0, now, p_detect->p_context);
+}
+
+
+uint8_t tone_detect_confidence(tone_detect_t const * p_detect, uint32_t pattern_id)
+{
+    return tone_confidence_get(&p_detect->confidence, pattern_id);
+}
@@ -0,0 +1,142 @@
+/** @file
+ *
+ * @defgroup tone_detect Tone detector core
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Alarm detection from LPCOMP edge timestamps, behind a thin HAL.
+ *
+ * @details Combines the edge decoder and the pattern engine with the burst timeout handling
+ *          that used to live in the LPCOMP and Timer 1 handlers of main.c. Everything that
+ *          touches hardware (LEDs, the burst timer) goes through @ref tone_detect_hal_t, so
+ *          the same code runs in the firmware main loop and in the host replay driver
+ *          (host/tone_replay.c).
+ *
+ *          Expected use:
+ *          - tone_detect_edge() for every captured edge, in timestamp order.
+ *          - tone_detect_poll() whenever the main loop runs.
+ *          - tone_detect_timeout() when the burst timer started by
+ *            @ref tone_detect_hal_t::burst_timer_restart expires without a new tone
+ *            (TONE_PATTERN_SILENCE_US after the last tone start).
+ *
+ *          With tone rejection on (the default) every tone is checked against the tone lengths
+ *          of the pattern tables once it ends. A tone that fits no pattern, such as a blip
+ *          of HVAC or TV audio, is dropped and its time is counted as pause, so it cannot
+ *          break a pattern that is in progress. Pauses only go to the pattern engine once
+ *          the next tone has been accepted, or when the burst times out.
+ *
+ *          Completed pattern cycles go through the confidence scorer (tone_confidence.c) and
+ *          only raise an alarm when the configured policy fires. The default policy fires on
+ *          every cycle. The scorer forgets all cycles when a burst times out.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef TONE_DETECT_H__
+#define TONE_DETECT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "edge_decoder.h"
+#include "tone_pattern.h"
+#include "tone_confidence.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Hardware hooks of the detector. All hooks are called from the context that feeds the detector. */
+typedef struct
+{
+    void (*tone_set)(bool on, void * p_context);                        /**< A tone started or ended (LED3). */
+    void (*alarm_set)(bool on, uint32_t matched, uint32_t timestamp,
+                      void * p_context);                                /**< The policy fired for these patterns, or the burst ended (LED4). */
+    void (*burst_timer_restart)(void * p_context);                      /**< (Re)start the burst silence timeout. */
+} tone_detect_hal_t;
+
+/**@brief Tunable detector parameters. */
+typedef struct
+{
+    uint32_t                 gap_us;                                    /**< Silence after a DOWN edge that ends a tone. */
+    uint32_t                 slack_us;                                  /**< Extra tolerance on every pattern segment. */
+    bool                     reject_tones;                              /**< Drop tones whose length fits no pattern. */
+    tone_confidence_policy_t policy;                                    /**< When completed cycles raise an alarm. */
+} tone_detect_config_t;
+
+/**@brief Default detector parameters. */
+#define TONE_DETECT_DEFAULT_CONFIG                  \
+{                                                   \
+    .gap_us       = EDGE_DECODER_DEFAULT_GAP_US,    \
+    .slack_us     = 0,                              \
+    .reject_tones = true,                           \
+    .policy       = TONE_CONFIDENCE_DEFAULT_POLICY  \
+}
+
+/**@brief Detector counters. */
+typedef struct
+{
+    uint32_t edges;                                                     /**< Edges fed to the detector. */
+    uint32_t tones;                                                     /**< Tones decoded. */
+    uint32_t rejected;                                                  /**< Tones dropped by tone rejection. */
+    uint32_t cycles;                                                    /**< Pattern cycles completed. */
+    uint32_t alarms;                                                    /**< Cycles after which the policy fired. */
+} tone_detect_stats_t;
+
+/**@brief Detector instance. */
+typedef struct
+{
+    tone_detect_hal_t const * p_hal;
+    void *                    p_context;
+    edge_decoder_t            decoder;
+    tone_pattern_matcher_t    matcher;
+    tone_confidence_t         confidence;
+    bool                      reject_tones;
+    bool                      pause_known;                              /**< pause_us holds the whole pause since the last accepted tone. */
+    uint32_t                  pause_us;                                 /**< Pause not yet fed to the pattern engine. */
+    tone_detect_stats_t       stats;
+} tone_detect_t;
+
+/**@brief Function for initializing a detector.
+ *
+ * @param[out] p_detect   Detector instance.
+ * @param[in]  p_config   Parameters.
+ * @param[in]  p_hal      Hardware hooks, must stay valid.
+ * @param[in]  p_context  Passed to every hook.
+ */
+void tone_detect_init(tone_detect_t *              p_detect,
+                      tone_detect_config_t const * p_config,
+                      tone_detect_hal_t const *    p_hal,
+                      void *                       p_context);
+
+/**@brief Function for changing the parameters of a running detector.
+ *
+ * @details Counters and the tone in progress are kept. The confidence scorer starts over with
+ *          the new policy, so a burst that is sounding needs its cycles again before the next
+ *          alarm.
+ */
+void tone_detect_configure(tone_detect_t * p_detect, tone_detect_config_t const * p_config);
+
+/**@brief Function for getting the parameters a detector runs with. */
+void tone_detect_config_get(tone_detect_t const * p_detect, tone_detect_config_t * p_config);
+
+/**@brief Function for feeding a captured edge. */
+void tone_detect_edge(tone_detect_t * p_detect, uint32_t timestamp, bool up);
+
+/**@brief Function for ending a tone that has gone quiet. */
+void tone_detect_poll(tone_detect_t * p_detect, uint32_t now);
+
+/**@brief Function for getting the confidence of a pattern after its last completed cycle, 0 to 100. */
+uint8_t tone_detect_confidence(tone_detect_t const * p_detect, uint32_t pattern_id);
+
+/**@brief Function for handling the burst silence timeout.
+ *
+ * @param[in] now  Time of the timeout. The edge timebase may stop after this call.
+ */
+void tone_detect_timeout(tone_detect_t * p_detect, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TONE_DETECT_H__
+
+/** @} */
@@ -0,0 +1,215 @@
+/** @file
+ *
+ * @brief Temporal pattern engine and pattern tables.
+ */
+#include <stddef.h>
+
+#include "tone_pattern.h"
+
+#if defined(TONE_PATTERN_SITE_FILE)
+#include TONE_PATTERN_SITE_FILE
+#endif
+
+#define TONE_PATTERN_TOLERANCE_PCT      10                  /**< Timing tolerance of ANSI S3.41. */
+
+/**@brief Temporal-3, smoke. */
+static const tone_pattern_segment_t m_temporal_3[] =
+{
+    TONE_PATTERN_SEGMENT(true,  500, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(false, 500, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(true,  500, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(false, 500, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(true,  500, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_PAUSE(1350)
+};
+
+/**@brief Temporal-4, carbon monoxide. */
+static const tone_pattern_segment_t m_temporal_4[] =
+{
+    TONE_PATTERN_SEGMENT(true,  100, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(false, 100, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(true,  100, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(false, 100, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(true,  100, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(false, 100, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_SEGMENT(true,  100, TONE_PATTERN_TOLERANCE_PCT),
+    TONE_PATTERN_PAUSE(4500)
+};
+
+#define TONE_PATTERN_TABLE(name, segments) \
+    { (name), (segments), (uint8_t)(sizeof(segments) / sizeof((segments)[0])) }
+
+#ifndef TONE_PATTERN_SITE_TABLES
+#define TONE_PATTERN_SITE_TABLES
+#endif
+
+static const tone_pattern_t m_patterns[] =
+{
+    TONE_PATTERN_TABLE("temporal-3", m_temporal_3),
+    TONE_PATTERN_TABLE("temporal-4", m_temporal_4),
+    TONE_PATTERN_SITE_TABLES
+};
+
+#define PATTERN_COUNT   (sizeof(m_patterns) / sizeof(m_patterns[0]))
+
+// Compile-time check, a negative array size fails the build. TONE_PATTERN_PAUSE() checks every final pause.
+typedef char tone_pattern_count_check[(PATTERN_COUNT <= TONE_PATTERN_MAX) ? 1 : -1];
+
+
+static bool segment_match(tone_pattern_segment_t const * p_segment,
+                          bool                           on,
+                          uint32_t                       duration_us,
+                          uint32_t                       slack_us)
+{
+    uint32_t min_us = (p_segment->min_us > slack_us) ? (p_segment->min_us - slack_us) : 0;
+    uint32_t max_us = (p_segment->max_us < TONE_PATTERN_OPEN - slack_us) ? (p_segment->max_us + slack_us)
+                                                                         : TONE_PATTERN_OPEN;
+
+    return (p_segment->on == on) &&
+           (duration_us >= min_us) &&
+           (duration_us <= max_us);
+}
+
+
+/**@brief Distance of a duration from the segment nominal, per mille of the tolerance, at most 1000. */
+static uint32_t segment_error(tone_pattern_segment_t const * p_segment, uint32_t duration_us)
+{
+    if (p_segment->max_us == TONE_PATTERN_OPEN)
+    {
+        return 0;
+    }
+
+    uint32_t half    = (p_segment->max_us - p_segment->min_us) / 2;
+    uint32_t nominal = p_segment->min_us + half;
+    uint32_t offset  = (duration_us > nominal) ? (duration_us - nominal) : (nominal - duration_us);
+
+    if (offset >= half)
+    {
+        return 1000;
+    }
+    return (uint32_t)(((uint64_t)offset * 1000) / half);
+}
+
+
+/**@brief Quality of a completed cycle from its summed segment errors. */
+static uint8_t cycle_quality(tone_pattern_t const * p_pattern, uint32_t error)
+{
+    uint32_t timed = 0;
+
+    for (uint32_t i = 0; i < p_pattern->segment_count; i++)
+    {
+        timed += (p_pattern->p_segments[i].max_us != TONE_PATTERN_OPEN) ? 1 : 0;
+    }
+
+    return (timed == 0) ? 100 : (uint8_t)(100 - (error / timed) / 10);
+}
+
+
+uint32_t tone_pattern_count(void)
+{
+    return PATTERN_COUNT;
+}
+
+
+tone_pattern_t const * tone_pattern_get(uint32_t pattern_id)
+{
+    return (pattern_id < PATTERN_COUNT) ? &m_patterns[pattern_id] : NULL;
+}
+
+
+uint32_t tone_pattern_period_us(uint32_t pattern_id)
+{
+    tone_pattern_t const * p_pattern = tone_pattern_get(pattern_id);
+    uint32_t               period    = 0;
+
+    for (uint32_t i = 0; (p_pattern != NULL) && (i < p_pattern->segment_count); i++)
+    {
+        tone_pattern_segment_t const * p_segment = &p_pattern->p_segments[i];
+
+        period += (p_segment->max_us == TONE_PATTERN_OPEN) ? p_segment->min_us
+                                                           : (p_segment->min_us + (p_segment->max_us - p_segment->min_us) / 2);
+    }
+
+    return period;
+}
+
+
+void tone_pattern_init(tone_pattern_matcher_t * p_matcher)
+{
+    p_matcher->slack_us = 0;
+
+    for (uint32_t i = 0; i < TONE_PATTERN_MAX; i++)
+    {
+        p_matcher->index[i]   = 0;
+        p_matcher->error[i]   = 0;
+        p_matcher->quality[i] = 0;
+    }
+}
+
+
+bool tone_pattern_tone_valid(tone_pattern_matcher_t const * p_matcher, uint32_t duration_us)
+{
+    for (uint32_t i = 0; i < PATTERN_COUNT; i++)
+    {
+        tone_pattern_t const * p_pattern = &m_patterns[i];
+
+        for (uint32_t j = 0; j < p_pattern->segment_count; j++)
+        {
+            if (segment_match(&p_pattern->p_segments[j], true, duration_us, p_matcher->slack_us))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+uint32_t tone_pattern_feed(tone_pattern_matcher_t * p_matcher, bool on, uint32_t duration_us)
+{
+    uint32_t matched = 0;
+
+    for (uint32_t i = 0; i < PATTERN_COUNT; i++)
+    {
+        tone_pattern_t const * p_pattern = &m_patterns[i];
+        uint8_t                index     = p_matcher->index[i];
+        uint32_t               error     = p_matcher->error[i];
+
+        if (segment_match(&p_pattern->p_segments[index], on, duration_us, p_matcher->slack_us))
+        {
+            error += segment_error(&p_pattern->p_segments[index], duration_us);
+            index++;
+        }
+        else if (segment_match(&p_pattern->p_segments[0], on, duration_us, p_matcher->slack_us))
+        {
+            // The interval starts the pattern over.
+            error = segment_error(&p_pattern->p_segments[0], duration_us);
+            index = 1;
+        }
+        else
+        {
+            error = 0;
+            index = 0;
+        }
+
+        if (index == p_pattern->segment_count)
+        {
+            matched              |= (1UL << i);
+            p_matcher->quality[i] = cycle_quality(p_pattern, error);
+            error                 = 0;
+            index                 = 0;
+        }
+
+        p_matcher->index[i] = index;
+        p_matcher->error[i] = (uint16_t)((error < UINT16_MAX) ? error : UINT16_MAX);
+    }
+
+    return matched;
+}
+
+
+uint8_t tone_pattern_quality(tone_pattern_matcher_t const * p_matcher, uint32_t pattern_id)
+{
+    return (pattern_id < PATTERN_COUNT) ? p_matcher->quality[pattern_id] : 0;
+}
@@ -0,0 +1,136 @@
+/** @file
+ *
+ * @defgroup tone_pattern Temporal pattern engine
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Recognises alarm tone patterns from tone on/off intervals.
+ *
+ * @details Every pattern is a compile-time table of segments. A segment is a tone (on) or a
+ *          pause (off) with a minimum and maximum duration. The matcher keeps one segment
+ *          index per pattern and every completed interval moves each index one step forward
+ *          or back to the start, so matching costs one table lookup per pattern per interval.
+ *
+ *          Every completed cycle also gets a quality from 0 to 100: 100 minus the mean distance
+ *          of its segments from their nominal duration, in percent of the tolerance. A cycle
+ *          right on the nominal timing scores 100, one at the edge of every tolerance scores 0.
+ *          The open-ended final pause does not count.
+ *
+ *          Built-in patterns:
+ *          - ANSI S3.41 / NFPA 72 temporal-3 (smoke): 3 x (0.5 s on, 0.5 s off), 1.5 s pause.
+ *          - NFPA 720 / UL 2034 temporal-4 (CO): 4 x (0.1 s on, 0.1 s off), 5 s pause.
+ *
+ *          Site-specific patterns are added by defining TONE_PATTERN_SITE_FILE to a header
+ *          that defines TONE_PATTERN_SITE_TABLES, see tone_pattern.c.
+ *
+ *          This module has no SDK dependencies and compiles on the host.
+ */
+#ifndef TONE_PATTERN_H__
+#define TONE_PATTERN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TONE_PATTERN_MAX                8                   /**< Maximum number of pattern tables. */
+#define TONE_PATTERN_OPEN               UINT32_MAX          /**< Maximum duration of an open-ended segment. */
+
+#define TONE_PATTERN_SILENCE_US         5500000             /**< Silence after the last tone start that ends a burst. Must exceed every final pause minimum plus TONE_PATTERN_SLACK_MAX_US. */
+#define TONE_PATTERN_SLACK_MAX_US       UINT16_MAX          /**< Largest slack a stored configuration can set (app_config.h keeps it in 16 bits). */
+
+/**@brief Segment with a nominal duration and a tolerance in percent. */
+#define TONE_PATTERN_SEGMENT(on, nominal_ms, tolerance_pct)                 \
+    { (on),                                                                 \
+      ((nominal_ms) * (100 - (tolerance_pct)) * 10UL),                      \
+      ((nominal_ms) * (100 + (tolerance_pct)) * 10UL) }
+
+/**@brief Final pause of a pattern, only the minimum matters.
+ *
+ * @details Every table, site tables included, must end with this pause. A minimum that the
+ *          burst silence timeout cannot reach with the largest slack fails the build (negative
+ *          array size).
+ */
+#define TONE_PATTERN_PAUSE(min_ms)                                                              \
+    { false,                                                                                    \
+      ((min_ms) * 1000UL) +                                                                     \
+      0 * sizeof(char[(((min_ms) * 1000UL + TONE_PATTERN_SLACK_MAX_US) < TONE_PATTERN_SILENCE_US) ? 1 : -1]), \
+      TONE_PATTERN_OPEN }
+
+/**@brief One tone or pause of a pattern. */
+typedef struct
+{
+    bool     on;                                            /**< True for a tone, false for a pause. */
+    uint32_t min_us;                                        /**< Shortest accepted duration. */
+    uint32_t max_us;                                        /**< Longest accepted duration, or TONE_PATTERN_OPEN. */
+} tone_pattern_segment_t;
+
+/**@brief Pattern table. */
+typedef struct
+{
+    char const *                   p_name;
+    tone_pattern_segment_t const * p_segments;
+    uint8_t                        segment_count;
+} tone_pattern_t;
+
+/**@brief Matcher state, one segment index per pattern. Initialise with tone_pattern_init(). */
+typedef struct
+{
+    uint32_t slack_us;                                      /**< Widens every segment by this much on both sides, 0 by default. */
+    uint8_t  index[TONE_PATTERN_MAX];
+    uint16_t error[TONE_PATTERN_MAX];                       /**< Timing error of the segments matched so far, per mille of the tolerance each. */
+    uint8_t  quality[TONE_PATTERN_MAX];                     /**< Quality of the last completed cycle. */
+} tone_pattern_matcher_t;
+
+/**@brief Function for getting the number of pattern tables. */
+uint32_t tone_pattern_count(void);
+
+/**@brief Function for getting a pattern table.
+ *
+ * @param[in] pattern_id  Index of the pattern, less than tone_pattern_count().
+ */
+tone_pattern_t const * tone_pattern_get(uint32_t pattern_id);
+
+/**@brief Function for getting the nominal length of one cycle of a pattern.
+ *
+ * @details The sum of the nominal segment durations, with the minimum for the final pause.
+ */
+uint32_t tone_pattern_period_us(uint32_t pattern_id);
+
+/**@brief Function for resetting a matcher. */
+void tone_pattern_init(tone_pattern_matcher_t * p_matcher);
+
+/**@brief Function for checking a tone length against every tone segment of every pattern.
+ *
+ * @param[in] duration_us  Length of the tone.
+ *
+ * @return True if at least one pattern has a tone of this length, slack included.
+ */
+bool tone_pattern_tone_valid(tone_pattern_matcher_t const * p_matcher, uint32_t duration_us);
+
+/**@brief Function for feeding a completed tone or pause into the matcher.
+ *
+ * @details A pause that is still going on may be fed with its length so far, it only
+ *          matches an open-ended final pause.
+ *
+ * @param[in] on           True for a tone, false for a pause.
+ * @param[in] duration_us  Length of the interval.
+ *
+ * @return Bit mask of the patterns that completed with this interval.
+ */
+uint32_t tone_pattern_feed(tone_pattern_matcher_t * p_matcher, bool on, uint32_t duration_us);
+
+/**@brief Function for getting the quality of the last completed cycle of a pattern.
+ *
+ * @return 0 to 100, 100 when every segment was at its nominal duration.
+ */
+uint8_t tone_pattern_quality(tone_pattern_matcher_t const * p_matcher, uint32_t pattern_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TONE_PATTERN_H__
+
+/** @} */